@@ -0,0 +1,230 @@
+#!/usr/bin/env python3
+#
+# COPYRIGHT (c) 2019 Software AG
+#
+# Converts binary sensor payloads of the XDK (PAYLOADFORMAT=BINARY or DELTA) back to
+# SmartREST lines or JSON, e.g. for a local bridge that forwards them to
+# Cumulocity. The format is described in source/MQTTBinary.h. Payloads
+# compressed with PAYLOADCOMPRESS=TRUE (source/MQTTCompress.h) are
+# decompressed first, SmartREST payloads are passed through line by line.
+#
+# usage: xdk_decode.py [--json] [--client-id ID] [--hex] [FILE]
+#
+# FILE holds one payload as received on s/uc/XDK, "-" or no FILE reads stdin.
+# With --hex the payload is read as hex string.
+
+import argparse
+import datetime
+import json
+import struct
+import sys
+
+MAGIC = 0xC8
+COMPRESSED = 0xC9
+HEADER_SIZE = 10
+TAG_STREAM = 0x0F
+TAG_INVENTORY = 0x10
+TAG_INT32 = 0x20
+TAG_TEXT = 0xFF
+
+
+def fixed(value, decimals):
+    """Write a scaled integer like MQTTFormat_Fixed on the device."""
+    if decimals == 0:
+        return str(value)
+    sign = "-" if value < 0 else ""
+    digits = str(abs(value)).rjust(decimals + 1, "0")
+    return sign + digits[:-decimals] + "." + digits[-decimals:]
+
+
+def iso_time(epoch_ms):
+    time = datetime.datetime.fromtimestamp(epoch_ms / 1000.0, datetime.timezone.utc)
+    return time.strftime("%Y-%m-%dT%H:%M:%S.") + "%03dZ" % (epoch_ms % 1000)
+
+
+def measurement(tag, decimals, epoch, elapsed, values):
+    stream = tag & TAG_STREAM
+    return {
+        "stream": stream,
+        "inventory": bool(tag & TAG_INVENTORY),
+        "template": str((1990 if tag & TAG_INVENTORY else 990) + stream),
+        "time": iso_time(epoch + elapsed) if epoch != 0 else None,
+        "decimals": decimals,
+        "values": values,
+    }
+
+
+def varint(payload, offset):
+    """Read a varint of 7 bits per byte, return the value and the next offset."""
+    value = 0
+    shift = 0
+    while True:
+        byte = payload[offset]
+        offset += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, offset
+
+
+def unzigzag(value):
+    return (value >> 1) ^ -(value & 1)
+
+
+def wrap_int32(value):
+    value &= 0xFFFFFFFF
+    return value - (1 << 32) if value & 0x80000000 else value
+
+
+def text_record(payload, offset):
+    length = payload[offset + 1]
+    text = payload[offset + 2:offset + 2 + length].decode("ascii")
+    return {"text": text}, offset + 2 + length
+
+
+def decode_packed(payload, epoch):
+    """Yield the records of a version 2 payload, texts first, then by time."""
+    offset = HEADER_SIZE
+    while offset < len(payload) and payload[offset] == TAG_TEXT:
+        record, offset = text_record(payload, offset)
+        yield record
+
+    rows = []
+    while offset < len(payload):
+        tag = payload[offset]
+        count = payload[offset + 1] & 0x1F
+        decimals = payload[offset + 1] >> 5
+        length, offset = varint(payload, offset + 2)
+        times = []
+        elapsed = 0
+        for _ in range(length):
+            delta, offset = varint(payload, offset)
+            elapsed += delta
+            times.append(elapsed)
+        axes = []
+        for _ in range(count):
+            values = []
+            value = 0
+            for _ in range(length):
+                delta, offset = varint(payload, offset)
+                # the device adds the differences modulo 2^32
+                value = wrap_int32(value + unzigzag(delta))
+                values.append(value)
+            axes.append(values)
+        for row in range(length):
+            rows.append((times[row], len(rows), tag, decimals, [axis[row] for axis in axes]))
+
+    # sorted by time and, within the same time, by the order of the columns
+    for elapsed, _, tag, decimals, values in sorted(rows):
+        yield measurement(tag, decimals, epoch, elapsed, values)
+
+
+def decompress(payload):
+    """Undo MQTTCompress_Payload, the first byte is the marker."""
+    out = bytearray()
+    offset = 1
+    while offset < len(payload):
+        flags = payload[offset]
+        offset += 1
+        for bit in range(8):
+            if offset >= len(payload):
+                break
+            if flags >> bit & 1:
+                distance = (payload[offset] | (payload[offset + 1] & 0x07) << 8) + 1
+                length = (payload[offset + 1] >> 3) + 3
+                offset += 2
+                if distance > len(out):
+                    raise ValueError("match before the start of the payload")
+                # byte by byte, a match may overlap the bytes it produces
+                for _ in range(length):
+                    out.append(out[-distance])
+            else:
+                out.append(payload[offset])
+                offset += 1
+    return bytes(out)
+
+
+def decode(payload):
+    """Yield one dict per record of a binary payload, or per line of a SmartREST payload."""
+    if payload[:1] == bytes([COMPRESSED]):
+        payload = decompress(payload)
+    if payload[:1] != bytes([MAGIC]):
+        for line in payload.decode("ascii").splitlines():
+            if line:
+                yield {"text": line}
+        return
+    if len(payload) < HEADER_SIZE:
+        raise ValueError("not a binary XDK payload")
+    version = payload[1]
+    if version not in (1, 2):
+        raise ValueError("unsupported version %d" % version)
+    (epoch,) = struct.unpack_from("<Q", payload, 2)
+    if version == 2:
+        yield from decode_packed(payload, epoch)
+        return
+
+    offset = HEADER_SIZE
+    elapsed = 0
+    while offset < len(payload):
+        tag = payload[offset]
+        if tag == TAG_TEXT:
+            record, offset = text_record(payload, offset)
+            yield record
+            continue
+
+        count = payload[offset + 1] & 0x1F
+        decimals = payload[offset + 1] >> 5
+        (delta,) = struct.unpack_from("<H", payload, offset + 2)
+        offset += 4
+        width = "i" if tag & TAG_INT32 else "h"
+        values = list(struct.unpack_from("<%d%s" % (count, width), payload, offset))
+        offset += count * struct.calcsize(width)
+
+        elapsed += delta
+        yield measurement(tag, decimals, epoch, elapsed, values)
+
+
+def to_smartrest(record, client_id):
+    if "text" in record:
+        return record["text"]
+    values = [fixed(value, record["decimals"]) for value in record["values"]]
+    # measurements take the time, inventory updates the external id of the device
+    source = client_id if record["inventory"] else (record["time"] or "")
+    return ",".join([record["template"], source] + values)
+
+
+def to_json(record):
+    if "text" in record:
+        return record
+    scale = 10 ** record["decimals"]
+    return {
+        "template": record["template"],
+        "inventory": record["inventory"],
+        "time": record["time"],
+        "values": [value / scale for value in record["values"]],
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode binary XDK sensor payloads")
+    parser.add_argument("file", nargs="?", default="-")
+    parser.add_argument("--json", action="store_true", help="write JSON instead of SmartREST")
+    parser.add_argument("--client-id", default="", help="external id used in inventory lines")
+    parser.add_argument("--hex", action="store_true", help="payload is given as hex string")
+    args = parser.parse_args()
+
+    stream = sys.stdin.buffer if args.file == "-" else open(args.file, "rb")
+    payload = stream.read()
+    if args.hex:
+        payload = bytes.fromhex(payload.decode("ascii"))
+
+    records = list(decode(payload))
+    if args.json:
+        print(json.dumps([to_json(record) for record in records], indent=2))
+    else:
+        for record in records:
+            sys.stdout.write(to_smartrest(record, args.client_id) + "\r\n")
+
+
+if __name__ == "__main__":
+    main()
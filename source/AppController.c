@@ -78,7 +78,6 @@ APP_STATUS app_status = APP_STATUS_UNKNOWN;
 APP_STATUS cmd_status = APP_STATUS_UNKNOWN;
 APP_STATUS boot_mode = APP_STATUS_UNKNOWN;
 uint16_t logging_enabled = 0UL;
-SensorDataBuffer sensorStreamBuffer;
 AssetDataBuffer assetStreamBuffer;
 
 xTaskHandle AppControllerHandle = NULL;/**< OS thread handle for Application controller to be used by run-time blocking threads */
@@ -188,6 +187,8 @@ static void AppController_Setup(void * param1, uint32_t param2) {
 	}
 
 	if (RETCODE_OK == retcode) {
+		// publish completions run where Serval reports the MQTT events
+		MqttSetupInfo.CmdProcessorHandle = AppCmdProcessor;
 		retcode = MQTT_Setup_Z(&MqttSetupInfo);
 	}
 
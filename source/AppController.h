@@ -260,6 +260,26 @@ typedef enum {
 #define DEFAULT_ENV                 true              /**< Environmental Data Enable */
 #define DEFAULT_LIGHT               true              /**< Ambient Light Data Enable */
 #define DEFAULT_NOISE               false             /**< Noise Data Enable */
+#define DEFAULT_INVENTORYMODE       "ALWAYS"          /**< Policy for inventory updates: ALWAYS, COUNT, CHANGE or PERIOD */
+#define DEFAULT_STR_INVENTORYCOUNT  "10"              /**< Samples between inventory updates */
+#define DEFAULT_STR_INVENTORYDELTA  "10"              /**< Minimal change in the last transmitted digit */
+#define DEFAULT_STR_INVENTORYPERIOD "60000"           /**< Time between inventory updates in MS */
+#define DEFAULT_STR_SENSORRATE      "0"               /**< Sampling rate of a sensor in MS, 0 uses STREAMRATE */
+#define DEFAULT_STR_AGGREGATEWINDOW "0"               /**< Samples aggregated into one record, 0 sends every sample */
+#define DEFAULT_STR_SENSORDEADBAND  "0"               /**< Change before a measurement is sent, absolute or in %, 0 sends all */
+#define DEFAULT_STR_HEARTBEAT       "300000"          /**< Maximal time in MS without a measurement within the deadband */
+#define DEFAULT_STR_BATCHSIZE       "0"               /**< Samples sent in one publish with their sample time, 0 or 1 disables batching */
+#define DEFAULT_STR_NOISEWINDOW     "0"               /**< Window in MS for rms, Leq and peak of the noise, 0 sends every reading */
+#define DEFAULT_PAYLOADFORMAT       "SMARTREST"       /**< Format of the sensor payloads: SMARTREST, BINARY or DELTA */
+#define DEFAULT_PAYLOADCOMPRESS     false             /**< Compress asset and sensor payloads for a local bridge */
+#define DEFAULT_STR_OFFLINESTORE    "0"               /**< KB on the SD card for measurements while offline, 0 drops them */
+#define DEFAULT_STR_OFFLINEDRAIN    "500"             /**< Time in MS between two publishes of stored measurements */
+#define DEFAULT_STR_BACKLOGSIZE     "16"              /**< Samples waiting to be published, up to 32 */
+#define DEFAULT_BACKLOGPOLICY       "DROPNEWEST"      /**< Samples dropped when the backlog is full: DROPNEWEST, DROPOLDEST or DECIMATE */
+#define DEFAULT_STR_BACKLOGDECIMATE "2"               /**< Every n-th sample is kept once the backlog is half full */
+#define DEFAULT_STR_PUBLISHQOS      "0"               /**< Quality of service of measurements and inventory updates, 0 or 1 */
+#define DEFAULT_STR_PUBLISHWINDOW   "2"               /**< QoS 1 publishes waiting for their acknowledgement at the same time */
+#define DEFAULT_STR_COMMANDQUEUE    "16"              /**< Received operations waiting to be executed, up to 32 */
 
 #define REBOOT_DELAY 		        3000			  /**< Delay reboot so that device can send back "reboot is in progress" */
 
@@ -272,6 +292,8 @@ typedef enum {
 #define SIZE_SMALL_BUF    128
 #define SIZE_XSMALL_BUF    64
 #define SIZE_XXSMALL_BUF   32
+#define SIZE_CONFIG_BUF  1536
+#define SIZE_PACKET_BUF   860  /**< Serval packets hold 900 bytes, less the MQTT header and the topic */
 
 typedef struct {
 	uint32_t length;
@@ -285,7 +307,7 @@ typedef struct {
 
 typedef struct {
 	uint32_t length;
-	char data[SIZE_XXLARGE_BUF];
+	char data[SIZE_CONFIG_BUF];
 } ConfigDataBuffer;
 
 /* local inline function definitions */
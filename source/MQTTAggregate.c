@@ -0,0 +1,70 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	MQTTAggregate.c
+ **
+ **	DESCRIPTION:	Source Code for the Cumulocity MQTT Client for the Bosch XDK
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* system header files */
+#include <string.h>
+#include <math.h>
+
+/* own header files */
+#include "MQTTAggregate.h"
+
+/* constant definitions ***************************************************** */
+
+/* local variables ********************************************************** */
+
+/* global variables ********************************************************* */
+
+/* local functions ********************************************************** */
+
+/* global functions ********************************************************* */
+
+void MQTTAggregate_Reset(MQTTAggregate_T * aggregate) {
+	memset(aggregate, 0x00, sizeof(MQTTAggregate_T));
+}
+
+void MQTTAggregate_Add(MQTTAggregate_T * aggregate, const int32_t * values, uint8_t count) {
+	if (count > MQTTAGGREGATE_MAX_VALUES) {
+		count = MQTTAGGREGATE_MAX_VALUES;
+	}
+	aggregate->count++;
+	aggregate->values = count;
+
+	for (uint8_t index = 0U; index < count; index++) {
+		float value = (float) values[index];
+		float delta = value - aggregate->mean[index];
+
+		aggregate->mean[index] += delta / (float) aggregate->count;
+		aggregate->m2[index] += delta * (value - aggregate->mean[index]);
+
+		if (aggregate->count == 1UL || values[index] < aggregate->min[index]) {
+			aggregate->min[index] = values[index];
+		}
+		if (aggregate->count == 1UL || values[index] > aggregate->max[index]) {
+			aggregate->max[index] = values[index];
+		}
+	}
+}
+
+float MQTTAggregate_Mean(const MQTTAggregate_T * aggregate, uint8_t index) {
+	return aggregate->mean[index];
+}
+
+float MQTTAggregate_StdDev(const MQTTAggregate_T * aggregate, uint8_t index) {
+	if (aggregate->count == 0UL) {
+		return 0.0F;
+	}
+	return sqrtf(aggregate->m2[index] / (float) aggregate->count);
+}
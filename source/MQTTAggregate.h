@@ -0,0 +1,71 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	MQTTAggregate.h
+ **
+ **	DESCRIPTION:	Source Code for the Cumulocity MQTT Client for the Bosch XDK
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* header definition ******************************************************** */
+#ifndef MQTTAGGREGATE_H_
+#define MQTTAGGREGATE_H_
+
+/* local interface declaration ********************************************** */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* local type and macro definitions */
+
+#define MQTTAGGREGATE_MAX_VALUES	UINT8_C(4)	/**< Maximum number of values (axes) of one stream */
+
+/**
+ * @brief Running statistics of the values of one stream over a window
+ *
+ * Mean and variance are updated with Welford's method, so the memory needed
+ * does not depend on the window length.
+ */
+typedef struct {
+	uint32_t count; /**< samples added since the last reset */
+	uint8_t values; /**< number of values per sample */
+	float mean[MQTTAGGREGATE_MAX_VALUES]; /**< running mean */
+	float m2[MQTTAGGREGATE_MAX_VALUES]; /**< running sum of squared differences from the mean */
+	int32_t min[MQTTAGGREGATE_MAX_VALUES]; /**< smallest value */
+	int32_t max[MQTTAGGREGATE_MAX_VALUES]; /**< largest value */
+} MQTTAggregate_T;
+
+/* global function prototype declarations */
+
+/**
+ * @brief Start a new window
+ */
+void MQTTAggregate_Reset(MQTTAggregate_T * aggregate);
+
+/**
+ * @brief Add one sample to the window
+ *
+ * @param[in] values values of the sample, scaled to integers
+ * @param[in] count number of values, at most MQTTAGGREGATE_MAX_VALUES
+ */
+void MQTTAggregate_Add(MQTTAggregate_T * aggregate, const int32_t * values, uint8_t count);
+
+/**
+ * @brief Mean of a value over the window
+ */
+float MQTTAggregate_Mean(const MQTTAggregate_T * aggregate, uint8_t index);
+
+/**
+ * @brief Population standard deviation of a value over the window
+ */
+float MQTTAggregate_StdDev(const MQTTAggregate_T * aggregate, uint8_t index);
+
+/* global inline function definitions */
+
+#endif /* MQTTAGGREGATE_H_ */
@@ -0,0 +1,266 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	MQTTBinary.c
+ **
+ **	DESCRIPTION:	Source Code for the Cumulocity MQTT Client for the Bosch XDK
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* system header files */
+#include <string.h>
+
+/* own header files */
+#include "MQTTBinary.h"
+
+/* constant definitions ***************************************************** */
+
+/**
+ * One record of a version 1 payload
+ */
+typedef struct {
+	uint8_t tag; /**< tag without MQTTBINARY_TAG_INT32 */
+	uint8_t format; /**< count + decimals << 5 */
+	uint8_t width; /**< bytes per value */
+	uint32_t elapsed; /**< ms since the epoch of the payload */
+	const uint8_t * data; /**< values, or text of a text record */
+	uint32_t length; /**< bytes of the values or the text */
+} MQTTBinary_Record_T;
+
+/* local variables ********************************************************** */
+
+/* global variables ********************************************************* */
+
+/* local functions ********************************************************** */
+
+static void MQTTBinary_Put(MQTTBuffer_Payload_T * payload, uint32_t value, uint8_t bytes) {
+	uint8_t * data = (uint8_t *) payload->data + payload->length;
+
+	for (uint8_t index = 0U; index < bytes; index++) {
+		data[index] = (uint8_t) (value >> (8U * index));
+	}
+	payload->length += bytes;
+}
+
+static uint32_t MQTTBinary_Get(const uint8_t * data, uint8_t bytes) {
+	uint32_t value = 0UL;
+
+	for (uint8_t index = 0U; index < bytes; index++) {
+		value |= (uint32_t) data[index] << (8U * index);
+	}
+	return value;
+}
+
+static int32_t MQTTBinary_Value(const MQTTBinary_Record_T * record, uint8_t index) {
+	uint32_t value = MQTTBinary_Get(record->data + index * record->width, record->width);
+	return (record->width == 2U) ? (int32_t) (int16_t) value : (int32_t) value;
+}
+
+/**
+ * @brief Read the record at offset, elapsed has to hold the time of the previous record
+ *
+ * @return offset of the next record, 0 if the record is not complete
+ */
+static uint32_t MQTTBinary_Next(const MQTTBuffer_Payload_T * payload, uint32_t offset, MQTTBinary_Record_T * record) {
+	const uint8_t * data = (const uint8_t *) payload->data;
+
+	if (offset + 2UL > payload->length) {
+		return 0UL;
+	}
+	record->tag = data[offset];
+	if (record->tag == MQTTBINARY_TAG_TEXT) {
+		record->length = data[offset + 1UL];
+		record->data = data + offset + 2UL;
+		offset += 2UL + record->length;
+	} else {
+		record->format = data[offset + 1UL];
+		record->width = (record->tag & MQTTBINARY_TAG_INT32) ? 4U : 2U;
+		record->tag &= (uint8_t) ~MQTTBINARY_TAG_INT32;
+		if (offset + 4UL > payload->length) {
+			return 0UL;
+		}
+		record->elapsed += MQTTBinary_Get(data + offset + 2UL, 2U);
+		record->length = (record->format & MQTTBINARY_MAX_VALUES) * (uint32_t) record->width;
+		record->data = data + offset + 4UL;
+		offset += 4UL + record->length;
+	}
+	return (offset <= payload->length) ? offset : 0UL;
+}
+
+static bool MQTTBinary_Varint(MQTTBuffer_Payload_T * payload, uint32_t value) {
+	uint8_t * data = (uint8_t *) payload->data;
+
+	do {
+		if (payload->length >= payload->size) {
+			return false;
+		}
+		uint8_t byte = (uint8_t) (value & 0x7FUL);
+		value >>= 7;
+		data[payload->length++] = (value != 0UL) ? (byte | 0x80U) : byte;
+	} while (value != 0UL);
+	return true;
+}
+
+/**
+ * @brief Map signed to unsigned, so small differences of both signs give short varints
+ */
+static uint32_t MQTTBinary_ZigZag(int32_t value) {
+	return (value < 0L) ? ~((uint32_t) value << 1) : ((uint32_t) value << 1);
+}
+
+/**
+ * @brief Append the column of all records with the given tag and format
+ */
+static bool MQTTBinary_Column(const MQTTBuffer_Payload_T * payload, MQTTBuffer_Payload_T * packed,
+		uint8_t tag, uint8_t format) {
+	const uint8_t count = format & MQTTBINARY_MAX_VALUES;
+	MQTTBinary_Record_T record;
+	uint32_t rows = 0UL;
+	bool fits = true;
+
+	// one pass for the number of rows, one for the times and one per axis
+	for (int16_t axis = -2; axis < (int16_t) count && fits; axis++) {
+		uint32_t previous = 0UL;
+		record.elapsed = 0UL;
+		for (uint32_t offset = MQTTBINARY_HEADER_SIZE; offset < payload->length && fits;) {
+			offset = MQTTBinary_Next(payload, offset, &record);
+			if (record.tag != tag || record.format != format) {
+				continue;
+			}
+			if (axis == -2) {
+				rows++;
+			} else if (axis == -1) {
+				fits = MQTTBinary_Varint(packed, record.elapsed - previous);
+				previous = record.elapsed;
+			} else {
+				// differences are taken modulo 2^32, so they can not overflow
+				uint32_t value = (uint32_t) MQTTBinary_Value(&record, (uint8_t) axis);
+				fits = MQTTBinary_Varint(packed, MQTTBinary_ZigZag((int32_t) (value - previous)));
+				previous = value;
+			}
+		}
+		if (axis == -2) {
+			fits = (packed->length + 2UL <= packed->size);
+			if (fits) {
+				packed->data[packed->length++] = (char) tag;
+				packed->data[packed->length++] = (char) format;
+				fits = MQTTBinary_Varint(packed, rows);
+			}
+		}
+	}
+	return fits;
+}
+
+/* global functions ********************************************************* */
+
+bool MQTTBinary_Header(MQTTBuffer_Payload_T * payload, uint64_t epochMs) {
+	if (payload->length != 0UL || payload->size < MQTTBINARY_HEADER_SIZE) {
+		return false;
+	}
+	MQTTBinary_Put(payload, MQTTBINARY_MAGIC, 1U);
+	MQTTBinary_Put(payload, MQTTBINARY_VERSION, 1U);
+	MQTTBinary_Put(payload, (uint32_t) epochMs, 4U);
+	MQTTBinary_Put(payload, (uint32_t) (epochMs >> 32), 4U);
+	return true;
+}
+
+bool MQTTBinary_Values(MQTTBuffer_Payload_T * payload, uint8_t tag, uint32_t delta,
+		const int32_t * values, uint8_t count, uint8_t decimals) {
+	uint8_t width = 2U;
+
+	if (count > MQTTBINARY_MAX_VALUES || decimals > MQTTBINARY_MAX_DECIMALS || delta > MQTTBINARY_MAX_DELTA) {
+		return false;
+	}
+	for (uint8_t index = 0U; index < count; index++) {
+		if (values[index] < INT16_MIN || values[index] > INT16_MAX) {
+			width = 4U;
+			tag |= MQTTBINARY_TAG_INT32;
+			break;
+		}
+	}
+	if (payload->length + 4UL + (uint32_t) count * width > payload->size) {
+		return false;
+	}
+
+	MQTTBinary_Put(payload, tag, 1U);
+	MQTTBinary_Put(payload, (uint32_t) count | ((uint32_t) decimals << 5), 1U);
+	MQTTBinary_Put(payload, delta, 2U);
+	for (uint8_t index = 0U; index < count; index++) {
+		MQTTBinary_Put(payload, (uint32_t) values[index], width);
+	}
+	return true;
+}
+
+bool MQTTBinary_Text(MQTTBuffer_Payload_T * payload, const char * text, uint32_t length) {
+	if (length >= 2UL && text[length - 2UL] == '\r' && text[length - 1UL] == '\n') {
+		length -= 2UL;
+	}
+	if (length > MQTTBINARY_MAX_TEXT || payload->length + 2UL + length > payload->size) {
+		return false;
+	}
+
+	MQTTBinary_Put(payload, MQTTBINARY_TAG_TEXT, 1U);
+	MQTTBinary_Put(payload, length, 1U);
+	memcpy(payload->data + payload->length, text, length);
+	payload->length += length;
+	return true;
+}
+
+bool MQTTBinary_Pack(MQTTBuffer_Payload_T * payload, MQTTBuffer_Payload_T * scratch) {
+	const uint8_t * data = (const uint8_t *) payload->data;
+	uint16_t columns[MQTTBINARY_MAX_COLUMNS];
+	uint8_t columnCount = 0U;
+	MQTTBinary_Record_T record;
+	bool fits = true;
+
+	if (payload->length < MQTTBINARY_HEADER_SIZE || data[0] != MQTTBINARY_MAGIC
+			|| data[1] != MQTTBINARY_VERSION || scratch->size < payload->length) {
+		return false;
+	}
+
+	// the header stays, the text records come first and keep their order
+	memcpy(scratch->data, payload->data, MQTTBINARY_HEADER_SIZE);
+	scratch->data[1] = (char) MQTTBINARY_VERSION_PACKED;
+	scratch->length = MQTTBINARY_HEADER_SIZE;
+	record.elapsed = 0UL;
+	for (uint32_t offset = MQTTBINARY_HEADER_SIZE; offset < payload->length;) {
+		offset = MQTTBinary_Next(payload, offset, &record);
+		if (offset == 0UL) {
+			return false;
+		}
+		if (record.tag == MQTTBINARY_TAG_TEXT) {
+			fits = fits && MQTTBinary_Text(scratch, (const char *) record.data, record.length);
+			continue;
+		}
+
+		// columns are written in the order of their first record
+		uint16_t column = (uint16_t) ((record.tag << 8) | record.format);
+		uint8_t index = 0U;
+		while (index < columnCount && columns[index] != column) {
+			index++;
+		}
+		if (index == columnCount) {
+			if (columnCount == MQTTBINARY_MAX_COLUMNS) {
+				return false;
+			}
+			columns[columnCount++] = column;
+		}
+	}
+
+	for (uint8_t index = 0U; index < columnCount && fits; index++) {
+		fits = MQTTBinary_Column(payload, scratch, (uint8_t) (columns[index] >> 8), (uint8_t) columns[index]);
+	}
+	if (fits == false || scratch->length >= payload->length) {
+		return false;
+	}
+	memcpy(payload->data, scratch->data, scratch->length);
+	payload->length = scratch->length;
+	return true;
+}
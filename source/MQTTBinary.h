@@ -0,0 +1,118 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	MQTTBinary.h
+ **
+ **	DESCRIPTION:	Source Code for the Cumulocity MQTT Client for the Bosch XDK
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* header definition ******************************************************** */
+#ifndef MQTTBINARY_H_
+#define MQTTBINARY_H_
+
+/* local interface declaration ********************************************** */
+#include <stdint.h>
+#include <stdbool.h>
+#include "MQTTBuffer.h"
+
+/* local type and macro definitions */
+
+/*
+ * Binary payload, all numbers little endian:
+ *
+ *   header:  0xC8 | version | epoch of the first record in ms (8 bytes, 0 if unknown)
+ *   values:  tag | count + decimals << 5 | delta in ms to the previous record (2 bytes) | values
+ *   text:    0xFF | length | SmartREST line without "\r\n"
+ *
+ * The low nibble of the tag is the stream, 99<stream> is its measurement
+ * template and 199<stream> its inventory template. The values are int16,
+ * or int32 if MQTTBINARY_TAG_INT32 is set, scaled by 10^decimals.
+ *
+ * Version 2 is the same payload packed by columns, see MQTTBinary_Pack:
+ *
+ *   header:  0xC8 | 2 | epoch of the first record in ms (8 bytes, 0 if unknown)
+ *   text:    all text records of version 1 in their order
+ *   column:  tag | count + decimals << 5 | rows | times | values of axis 0 | values of axis 1 | ...
+ *
+ * rows, times and values are varints of 7 bits per byte, least significant
+ * first. The first time is the offset to the epoch, every other time the
+ * difference to the previous row. The first value of an axis is zigzag
+ * encoded, every other one is the zigzag encoded difference to the previous
+ * row.
+ *
+ * resources/xdk_decode.py converts payloads back to SmartREST or JSON.
+ */
+#define MQTTBINARY_MAGIC			UINT8_C(0xC8)
+#define MQTTBINARY_VERSION			UINT8_C(1)
+#define MQTTBINARY_VERSION_PACKED	UINT8_C(2)
+#define MQTTBINARY_HEADER_SIZE		UINT32_C(10)
+#define MQTTBINARY_TAG_STREAM		UINT8_C(0x0F)	/**< Mask of the stream in a tag */
+#define MQTTBINARY_TAG_INVENTORY	UINT8_C(0x10)	/**< Record is an inventory update */
+#define MQTTBINARY_TAG_INT32		UINT8_C(0x20)	/**< Values are int32 instead of int16 */
+#define MQTTBINARY_TAG_TEXT			UINT8_C(0xFF)	/**< Record is a SmartREST line */
+#define MQTTBINARY_MAX_VALUES		UINT8_C(31)
+#define MQTTBINARY_MAX_DECIMALS		UINT8_C(7)
+#define MQTTBINARY_MAX_DELTA		UINT32_C(0xFFFF)	/**< Largest delta between two records in ms */
+#define MQTTBINARY_MAX_TEXT			UINT32_C(0xFF)
+#define MQTTBINARY_MAX_COLUMNS		UINT8_C(32)		/**< Different streams and value layouts in one packed payload */
+
+/* global function prototype declarations */
+
+/**
+ * @brief Write the header into an empty payload
+ *
+ * @param[in] epochMs time of the first record in ms since 1970, 0 if the clock is not synchronized
+ *
+ * @return true if the header fits
+ */
+bool MQTTBinary_Header(MQTTBuffer_Payload_T * payload, uint64_t epochMs);
+
+/**
+ * @brief Append a record of values, int16 is used if all values fit
+ *
+ * @param[in] tag stream, optionally with MQTTBINARY_TAG_INVENTORY
+ * @param[in] delta ms since the previous record, at most MQTTBINARY_MAX_DELTA
+ * @param[in] values values scaled by 10^decimals
+ * @param[in] count number of values, at most MQTTBINARY_MAX_VALUES
+ * @param[in] decimals decimals of the values, at most MQTTBINARY_MAX_DECIMALS
+ *
+ * @return true if the record fits, otherwise the payload is left unchanged
+ */
+bool MQTTBinary_Values(MQTTBuffer_Payload_T * payload, uint8_t tag, uint32_t delta,
+		const int32_t * values, uint8_t count, uint8_t decimals);
+
+/**
+ * @brief Append a SmartREST line for records without a binary representation
+ *
+ * @param[in] text line, a trailing "\r\n" is removed
+ * @param[in] length length of the line
+ *
+ * @return true if the record fits, otherwise the payload is left unchanged
+ */
+bool MQTTBinary_Text(MQTTBuffer_Payload_T * payload, const char * text, uint32_t length);
+
+/**
+ * @brief Pack a version 1 payload by columns with delta and zigzag varint coded values
+ *
+ * The records of each stream become one column, so the small differences
+ * between consecutive samples take one byte instead of two or four. The
+ * payload is only replaced if the packed one is smaller.
+ *
+ * @param[in,out] payload complete version 1 payload
+ * @param[in] scratch buffer of at least the payload size
+ *
+ * @return true if the payload was packed
+ */
+bool MQTTBinary_Pack(MQTTBuffer_Payload_T * payload, MQTTBuffer_Payload_T * scratch);
+
+/* global inline function definitions */
+
+#endif /* MQTTBINARY_H_ */
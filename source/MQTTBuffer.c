@@ -0,0 +1,214 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	MQTTBuffer.c
+ **
+ **	DESCRIPTION:	Source Code for the Cumulocity MQTT Client for the Bosch XDK
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* system header files */
+#include <string.h>
+
+/* own header files */
+#include "MQTTBuffer.h"
+
+/* constant definitions ***************************************************** */
+
+/* local variables ********************************************************** */
+
+/* global variables ********************************************************* */
+
+/* local functions ********************************************************** */
+
+/* global functions ********************************************************* */
+
+bool MQTTBuffer_RingInit(MQTTBuffer_Ring_T * ring, void * storage, uint32_t recordSize, uint32_t capacity) {
+	// indices are masked, so the capacity has to be a power of two
+	if (ring == NULL || storage == NULL || capacity == 0UL
+			|| (capacity & (capacity - 1UL)) != 0UL) {
+		return false;
+	}
+	ring->storage = (uint8_t *) storage;
+	ring->recordSize = recordSize;
+	ring->capacity = capacity;
+	ring->head = 0UL;
+	ring->tail = 0UL;
+	ring->overrun = 0UL;
+	ring->highWater = 0UL;
+	ring->limit = capacity;
+	ring->policy = MQTTBUFFER_DROP_NEWEST;
+	ring->decimation = 1UL;
+	ring->offered = 0UL;
+	ring->decimated = 0UL;
+	return true;
+}
+
+void MQTTBuffer_RingSetPolicy(MQTTBuffer_Ring_T * ring, uint32_t limit, MQTTBuffer_Policy_T policy, uint32_t decimation) {
+	ring->limit = (limit == 0UL || limit > ring->capacity) ? ring->capacity : limit;
+	ring->policy = policy;
+	ring->decimation = (decimation > 1UL) ? decimation : 1UL;
+	ring->offered = 0UL;
+}
+
+bool MQTTBuffer_RingOffer(MQTTBuffer_Ring_T * ring, const void * record) {
+	uint32_t head = ring->head;
+	uint32_t tail = ring->tail;
+
+	if (ring->policy == MQTTBUFFER_DECIMATE && head - tail >= ring->limit / 2UL) {
+		// the backlog grows slower, so it covers a longer outage at a lower rate
+		ring->offered++;
+		if (ring->offered % ring->decimation != 0UL) {
+			ring->decimated++;
+			return false;
+		}
+	} else {
+		ring->offered = 0UL;
+	}
+
+	if (head - tail >= ring->limit) {
+		if (ring->policy != MQTTBUFFER_DROP_OLDEST) {
+			ring->overrun++;
+			return false;
+		}
+		// the consumer may take the oldest record at the same time, whoever moves tail first wins
+		while (head - tail >= ring->limit) {
+			if (__sync_bool_compare_and_swap(&ring->tail, tail, tail + 1UL)) {
+				ring->overrun++;
+			}
+			tail = ring->tail;
+		}
+	}
+	return MQTTBuffer_RingPush(ring, record);
+}
+
+bool MQTTBuffer_RingPush(MQTTBuffer_Ring_T * ring, const void * record) {
+	uint32_t head = ring->head;
+	uint32_t used = head - ring->tail;
+
+	if (used >= ring->capacity) {
+		ring->overrun++;
+		return false;
+	}
+	memcpy(ring->storage + (head & (ring->capacity - 1UL)) * ring->recordSize,
+			record, ring->recordSize);
+	// record has to be visible before the consumer can see the new head
+	MQTTBUFFER_BARRIER();
+	ring->head = head + 1UL;
+
+	if (used + 1UL > ring->highWater) {
+		ring->highWater = used + 1UL;
+	}
+	return true;
+}
+
+void * MQTTBuffer_RingPeek(MQTTBuffer_Ring_T * ring) {
+	uint32_t tail = ring->tail;
+
+	if (ring->head == tail) {
+		return NULL;
+	}
+	// do not read the record before the head was read
+	MQTTBUFFER_BARRIER();
+	return ring->storage + (tail & (ring->capacity - 1UL)) * ring->recordSize;
+}
+
+void MQTTBuffer_RingDiscard(MQTTBuffer_Ring_T * ring) {
+	if (ring->head != ring->tail) {
+		// record must be consumed before the producer can overwrite it
+		MQTTBUFFER_BARRIER();
+		ring->tail = ring->tail + 1UL;
+	}
+}
+
+bool MQTTBuffer_RingPop(MQTTBuffer_Ring_T * ring, void * record) {
+	for (;;) {
+		uint32_t tail = ring->tail;
+		if (ring->head == tail) {
+			return false;
+		}
+		// do not read the record before the head was read
+		MQTTBUFFER_BARRIER();
+		memcpy(record, ring->storage + (tail & (ring->capacity - 1UL)) * ring->recordSize, ring->recordSize);
+		// if the producer dropped the record meanwhile the copy may be torn, take the next one
+		if (__sync_bool_compare_and_swap(&ring->tail, tail, tail + 1UL)) {
+			return true;
+		}
+	}
+}
+
+uint32_t MQTTBuffer_RingCount(const MQTTBuffer_Ring_T * ring) {
+	return ring->head - ring->tail;
+}
+
+bool MQTTBuffer_PoolInit(MQTTBuffer_Pool_T * pool, MQTTBuffer_Payload_T * payloads, uint8_t count) {
+	if (pool == NULL || payloads == NULL || count == 0U || count > MQTTBUFFER_POOL_MAX) {
+		return false;
+	}
+	pool->payloads = payloads;
+	pool->count = count;
+	pool->fill = NULL;
+	pool->exhausted = 0UL;
+	MQTTBuffer_RingInit(&pool->free, pool->freeStorage, sizeof(uint8_t), MQTTBUFFER_POOL_MAX);
+	MQTTBuffer_RingInit(&pool->sealed, pool->sealedStorage, sizeof(uint8_t), MQTTBUFFER_POOL_MAX);
+	for (uint8_t index = 0U; index < count; index++) {
+		payloads[index].length = 0UL;
+		memset(payloads[index].data, 0x00, payloads[index].size);
+		MQTTBuffer_RingPush(&pool->free, &index);
+	}
+	return true;
+}
+
+MQTTBuffer_Payload_T * MQTTBuffer_PoolAcquire(MQTTBuffer_Pool_T * pool) {
+	if (pool->fill == NULL) {
+		uint8_t index;
+		if (MQTTBuffer_RingPop(&pool->free, &index)) {
+			pool->fill = &pool->payloads[index];
+		} else {
+			pool->exhausted++;
+		}
+	}
+	return pool->fill;
+}
+
+void MQTTBuffer_PoolSeal(MQTTBuffer_Pool_T * pool) {
+	if (pool->fill != NULL && pool->fill->length > 0UL) {
+		uint8_t index = (uint8_t) (pool->fill - pool->payloads);
+		// can't fail, the ring holds more indices than the pool has payloads
+		MQTTBuffer_RingPush(&pool->sealed, &index);
+		pool->fill = NULL;
+	}
+}
+
+MQTTBuffer_Payload_T * MQTTBuffer_PoolPeek(MQTTBuffer_Pool_T * pool) {
+	uint8_t * index = (uint8_t *) MQTTBuffer_RingPeek(&pool->sealed);
+	return (index != NULL) ? &pool->payloads[*index] : NULL;
+}
+
+MQTTBuffer_Payload_T * MQTTBuffer_PoolPeekAt(MQTTBuffer_Pool_T * pool, uint8_t position) {
+	MQTTBuffer_Ring_T * ring = &pool->sealed;
+	uint32_t tail = ring->tail;
+
+	if (ring->head - tail <= (uint32_t) position) {
+		return NULL;
+	}
+	// do not read the index before the head was read
+	MQTTBUFFER_BARRIER();
+	return &pool->payloads[ring->storage[(tail + position) & (ring->capacity - 1UL)]];
+}
+
+void MQTTBuffer_PoolRelease(MQTTBuffer_Pool_T * pool) {
+	uint8_t index;
+	if (MQTTBuffer_RingPop(&pool->sealed, &index)) {
+		pool->payloads[index].length = 0UL;
+		pool->payloads[index].data[0] = '\0';
+		MQTTBuffer_RingPush(&pool->free, &index);
+	}
+}
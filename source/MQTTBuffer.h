@@ -0,0 +1,208 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	MQTTBuffer.h
+ **
+ **	DESCRIPTION:	Source Code for the Cumulocity MQTT Client for the Bosch XDK
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* header definition ******************************************************** */
+#ifndef MQTTBUFFER_H_
+#define MQTTBUFFER_H_
+
+/* local interface declaration ********************************************** */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* local type and macro definitions */
+
+/**
+ * Barrier used to publish the record content before the index is moved.
+ * On the Cortex-M3 of the XDK this is translated to a "dmb" instruction.
+ */
+#define MQTTBUFFER_BARRIER()		__sync_synchronize()
+
+/**
+ * @brief What MQTTBuffer_RingOffer does when the ring is full
+ */
+typedef enum {
+	MQTTBUFFER_DROP_NEWEST, /**< reject the new record, the consumer sees the oldest records */
+	MQTTBUFFER_DROP_OLDEST, /**< drop the oldest record, the consumer sees the latest records */
+	MQTTBUFFER_DECIMATE, /**< above half the limit only every n-th record is kept, when full the new one is rejected */
+} MQTTBuffer_Policy_T;
+
+/**
+ * @brief Single producer / single consumer ring of fixed-size records.
+ *
+ * The producer only writes head, the consumer only writes tail. Therefore
+ * neither side ever has to wait for the other one: a full ring rejects the
+ * record on the producer side and counts an overrun instead of blocking.
+ * Only with MQTTBUFFER_DROP_OLDEST the producer moves tail as well, with a
+ * compare and swap, and the consumer has to use MQTTBuffer_RingPop.
+ */
+typedef struct {
+	uint8_t * storage; /**< memory for capacity * recordSize bytes */
+	uint32_t recordSize; /**< size of one record in bytes */
+	uint32_t capacity; /**< number of records, must be a power of two */
+	volatile uint32_t head; /**< next record to write, owned by the producer */
+	volatile uint32_t tail; /**< next record to read, owned by the consumer */
+	volatile uint32_t overrun; /**< records dropped because the ring was full */
+	volatile uint32_t highWater; /**< maximum fill level seen by the producer */
+	uint32_t limit; /**< records MQTTBuffer_RingOffer keeps at most, up to capacity */
+	MQTTBuffer_Policy_T policy; /**< used by MQTTBuffer_RingOffer */
+	uint32_t decimation; /**< keep every n-th record for MQTTBUFFER_DECIMATE */
+	uint32_t offered; /**< records offered while decimating */
+	volatile uint32_t decimated; /**< records dropped by decimation */
+} MQTTBuffer_Ring_T;
+
+#define MQTTBUFFER_POOL_MAX			UINT8_C(8)	/**< Maximum number of payloads in a pool, power of two */
+
+/**
+ * @brief One outbound payload of a pool
+ */
+typedef struct {
+	uint32_t length; /**< number of bytes used */
+	uint32_t size; /**< size of data in bytes */
+	char * data; /**< payload memory */
+} MQTTBuffer_Payload_T;
+
+/**
+ * @brief Pool of payloads shared between one producer and the publisher.
+ *
+ * The producer fills one payload and seals it, which hands it over to the
+ * publisher and switches to the next free payload. The publisher sends the
+ * oldest sealed payload and releases it. Hand over in both directions goes
+ * through rings of payload indices, so no lock is held while publishing.
+ */
+typedef struct {
+	MQTTBuffer_Payload_T * payloads; /**< payloads of the pool */
+	uint8_t count; /**< number of payloads */
+	MQTTBuffer_Payload_T * fill; /**< payload currently filled, owned by the producer */
+	MQTTBuffer_Ring_T free; /**< released payloads, publisher to producer */
+	MQTTBuffer_Ring_T sealed; /**< sealed payloads, producer to publisher */
+	uint8_t freeStorage[MQTTBUFFER_POOL_MAX];
+	uint8_t sealedStorage[MQTTBUFFER_POOL_MAX];
+	volatile uint32_t exhausted; /**< acquire attempts without a free payload */
+} MQTTBuffer_Pool_T;
+
+/* global function prototype declarations */
+
+/**
+ * @brief Initialize a ring on the given storage
+ *
+ * @param[in] ring ring to initialize
+ * @param[in] storage memory for capacity * recordSize bytes
+ * @param[in] recordSize size of one record in bytes
+ * @param[in] capacity number of records, must be a power of two
+ *
+ * @return true on success, false if the capacity is not a power of two
+ */
+bool MQTTBuffer_RingInit(MQTTBuffer_Ring_T * ring, void * storage, uint32_t recordSize, uint32_t capacity);
+
+/**
+ * @brief Producer side: copy one record into the ring, never blocks
+ *
+ * @return true if the record was stored, false if the ring was full (overrun is counted)
+ */
+bool MQTTBuffer_RingPush(MQTTBuffer_Ring_T * ring, const void * record);
+
+/**
+ * @brief Set the limit and the policy used by MQTTBuffer_RingOffer
+ *
+ * @param[in] limit records kept at most, 0 or more than the capacity uses the capacity
+ * @param[in] policy what to drop when the limit is reached
+ * @param[in] decimation keep every n-th record for MQTTBUFFER_DECIMATE, at least 1
+ */
+void MQTTBuffer_RingSetPolicy(MQTTBuffer_Ring_T * ring, uint32_t limit, MQTTBuffer_Policy_T policy, uint32_t decimation);
+
+/**
+ * @brief Producer side: copy one record into the ring as the policy allows, never blocks
+ *
+ * @return true if the record was stored, false if it was dropped
+ */
+bool MQTTBuffer_RingOffer(MQTTBuffer_Ring_T * ring, const void * record);
+
+/**
+ * @brief Consumer side: returns the oldest record without removing it
+ *
+ * @return pointer to the record inside the ring or NULL if the ring is empty
+ */
+void * MQTTBuffer_RingPeek(MQTTBuffer_Ring_T * ring);
+
+/**
+ * @brief Consumer side: removes the record returned by MQTTBuffer_RingPeek
+ */
+void MQTTBuffer_RingDiscard(MQTTBuffer_Ring_T * ring);
+
+/**
+ * @brief Consumer side: copy the oldest record out of the ring
+ *
+ * Safe against a producer that drops the oldest record while it is copied.
+ *
+ * @return true if a record was copied, false if the ring is empty
+ */
+bool MQTTBuffer_RingPop(MQTTBuffer_Ring_T * ring, void * record);
+
+/**
+ * @brief Number of records currently stored in the ring
+ */
+uint32_t MQTTBuffer_RingCount(const MQTTBuffer_Ring_T * ring);
+
+/**
+ * @brief Initialize a pool on the given payloads
+ *
+ * @param[in] pool pool to initialize
+ * @param[in] payloads payloads with size and data set, length is cleared
+ * @param[in] count number of payloads, at most MQTTBUFFER_POOL_MAX
+ *
+ * @return true on success
+ */
+bool MQTTBuffer_PoolInit(MQTTBuffer_Pool_T * pool, MQTTBuffer_Payload_T * payloads, uint8_t count);
+
+/**
+ * @brief Producer side: payload to append to, takes a free payload if needed
+ *
+ * @return payload to fill or NULL if all payloads are waiting to be published
+ */
+MQTTBuffer_Payload_T * MQTTBuffer_PoolAcquire(MQTTBuffer_Pool_T * pool);
+
+/**
+ * @brief Producer side: hand the filled payload over to the publisher
+ *
+ * Nothing is handed over if the payload is empty.
+ */
+void MQTTBuffer_PoolSeal(MQTTBuffer_Pool_T * pool);
+
+/**
+ * @brief Publisher side: oldest sealed payload
+ *
+ * @return payload to publish or NULL if nothing is sealed
+ */
+MQTTBuffer_Payload_T * MQTTBuffer_PoolPeek(MQTTBuffer_Pool_T * pool);
+
+/**
+ * @brief Publisher side: sealed payload at a position, 0 is the oldest
+ *
+ * Lets the publisher send further payloads while older ones still wait for
+ * their acknowledgement, they are released oldest first.
+ *
+ * @return payload or NULL if less payloads are sealed
+ */
+MQTTBuffer_Payload_T * MQTTBuffer_PoolPeekAt(MQTTBuffer_Pool_T * pool, uint8_t position);
+
+/**
+ * @brief Publisher side: clears the payload returned by MQTTBuffer_PoolPeek and gives it back to the producer
+ */
+void MQTTBuffer_PoolRelease(MQTTBuffer_Pool_T * pool);
+
+/* global inline function definitions */
+
+#endif /* MQTTBUFFER_H_ */
@@ -62,14 +62,14 @@ void button1Callback(uint32_t buttonstatus) {
 	} else {
 		TickType_t time_passed = xTaskGetTickCountFromISR() - time_start;
 		if (time_passed > pdMS_TO_TICKS(3000)) {
-			CmdProcessor_EnqueueFromIsr(AppCmdProcessor, MQTTOperation_QueueCommand, "511,DUMMY,requestCommands", UINT32_C(0));
+			CmdProcessor_EnqueueFromIsr(AppCmdProcessor, MQTTOperation_QueueCommand, NULL, (uint32_t) MQTTOPERATION_LOCAL_REQUEST_COMMANDS);
 			LOG_AT_TRACE(("MQTTButton: Button1 pressed long: %lu\r\n", time_passed));
 		} else {
 			// only use button 1 when in operation mode
 			if (AppController_GetAppStatus() == APP_STATUS_OPERATING_STARTED ) {
-				CmdProcessor_EnqueueFromIsr(AppCmdProcessor, MQTTOperation_QueueCommand, "511,DUMMY,stopButton", UINT32_C(0));
+				CmdProcessor_EnqueueFromIsr(AppCmdProcessor, MQTTOperation_QueueCommand, NULL, (uint32_t) MQTTOPERATION_LOCAL_STOP_BUTTON);
 			} else if (AppController_GetAppStatus() == APP_STATUS_OPERATING_STOPPED) {
-				CmdProcessor_EnqueueFromIsr(AppCmdProcessor, MQTTOperation_QueueCommand, "511,DUMMY,startButton", UINT32_C(0));
+				CmdProcessor_EnqueueFromIsr(AppCmdProcessor, MQTTOperation_QueueCommand, NULL, (uint32_t) MQTTOPERATION_LOCAL_START_BUTTON);
 			}
 		}
 	}
@@ -84,10 +84,10 @@ void button2Callback(uint32_t buttonstatus) {
 	} else if (BSP_XDK_BUTTON_RELEASED == buttonstatus){
 		TickType_t time_passed = xTaskGetTickCountFromISR() - time_start;
 		if (time_passed > pdMS_TO_TICKS(3000)) {
-			CmdProcessor_EnqueueFromIsr(AppCmdProcessor, MQTTOperation_QueueCommand, "511,DUMMY,resetBootstatus", UINT32_C(0));
+			CmdProcessor_EnqueueFromIsr(AppCmdProcessor, MQTTOperation_QueueCommand, NULL, (uint32_t) MQTTOPERATION_LOCAL_RESET_BOOTSTATUS);
 			LOG_AT_TRACE(("MQTTButton: Button2 pressed long: %lu\r\n", time_passed));
 		} else {
-			CmdProcessor_EnqueueFromIsr(AppCmdProcessor, MQTTOperation_QueueCommand, "511,DUMMY,printConfig", UINT32_C(0));
+			CmdProcessor_EnqueueFromIsr(AppCmdProcessor, MQTTOperation_QueueCommand, NULL, (uint32_t) MQTTOPERATION_LOCAL_PRINT_CONFIG);
 			LOG_AT_TRACE(("MQTTButton: Button2 pressed for: %lu\r\n", time_passed));
 		}
 	}
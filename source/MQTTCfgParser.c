@@ -55,6 +55,28 @@
  * NOISE=<TRUE TO SEND,FALSE OTHERWISE>
  * SNTPNAME=<NAME/IP OF SNTP SERVER>
  * SNTPPORT=<PORT SNTP SEVER>
+ * INVENTORYMODE=<ALWAYS, COUNT, CHANGE OR PERIOD, POLICY FOR THE INVENTORY UPDATES 1990-1998>
+ * INVENTORYCOUNT=<SAMPLES BETWEEN INVENTORY UPDATES FOR MODE COUNT>
+ * INVENTORYDELTA=<MINIMAL CHANGE IN THE LAST TRANSMITTED DIGIT FOR MODE CHANGE>
+ * INVENTORYPERIOD=<MILLISECONDS BETWEEN INVENTORY UPDATES FOR MODE PERIOD>
+ * ACCELRATE=<RATE TO SAMPLE THE SENSOR IN MILISECONDS, 0 FOR STREAMRATE>
+ * GYRORATE, MAGRATE, ENVRATE, LIGHTRATE, NOISERATE=<SAME AS ACCELRATE FOR THE OTHER SENSORS>
+ * AGGREGATEWINDOW=<SAMPLES AGGREGATED TO MIN/MAX/MEAN/STDDEV, 0 TO SEND EVERY SAMPLE>
+ * ACCELDEADBAND=<CHANGE IN THE LAST TRANSMITTED DIGIT, OR IN PERCENT WITH %, BEFORE A MEASUREMENT IS SENT, 0 TO SEND ALL>
+ * GYRODEADBAND, MAGDEADBAND, ENVDEADBAND, LIGHTDEADBAND, NOISEDEADBAND=<SAME AS ACCELDEADBAND FOR THE OTHER SENSORS>
+ * HEARTBEAT=<MILLISECONDS AFTER WHICH A MEASUREMENT IS SENT EVEN WITHIN THE DEADBAND>
+ * BATCHSIZE=<SAMPLES SENT WITH THEIR SAMPLE TIME IN ONE PUBLISH, 0 OR 1 SENDS EVERY STREAMRATE>
+ * NOISEWINDOW=<MILLISECONDS OVER WHICH RMS, LEQ AND PEAK OF THE NOISE ARE COMPUTED, 0 SENDS EVERY READING>
+ * PAYLOADFORMAT=<SMARTREST, BINARY OR DELTA FOR A LOCAL BRIDGE>
+ * PAYLOADCOMPRESS=<TRUE TO COMPRESS ALL PAYLOADS FOR A LOCAL BRIDGE, FALSE OTHERWISE>
+ * OFFLINESTORE=<KB ON THE SD CARD FOR MEASUREMENTS WHILE OFFLINE, 0 TO DROP THEM>
+ * OFFLINEDRAIN=<MILLISECONDS BETWEEN TWO PUBLISHES OF STORED MEASUREMENTS>
+ * BACKLOGSIZE=<SAMPLES WAITING TO BE PUBLISHED, UP TO 32>
+ * BACKLOGPOLICY=<DROPNEWEST, DROPOLDEST OR DECIMATE WHEN THE BACKLOG IS FULL>
+ * BACKLOGDECIMATE=<EVERY N-TH SAMPLE IS KEPT ONCE THE BACKLOG IS HALF FULL>
+ * PUBLISHQOS=<0 OR 1, QUALITY OF SERVICE OF MEASUREMENTS AND INVENTORY UPDATES>
+ * PUBLISHWINDOW=<QOS 1 PUBLISHES WAITING FOR THEIR ACKNOWLEDGEMENT AT THE SAME TIME, 1 TO 8>
+ * COMMANDQUEUE=<RECEIVED OPERATIONS WAITING TO BE EXECUTED, 1 TO 32>
  * MQTTUSER=<USESNAME IN THE FORM TENANT/USER, RECEIVED IN REGISTRATION>
  * MQTTPASSWORD=<PASSWORD, RECEIVED IN REGISTRATION>
  */
@@ -99,13 +121,17 @@
 #define CFG_NUMBER_UINT8_ZERO           UINT8_C(0)    /**< Zero value */
 
 #define CFG_WHITESPACE                  "\t\n\r "
+
+#define CFG_KEY_SLOTS                   UINT8_C(64)   /**< Slots of the hash index of the attribute names, power of two */
 #define CFG_SPACE                       "\t "
 
 /* local variables ********************************************************** */
 
 /** Variable containers for configuration values */
-static char AttValues[ATT_IDX_SIZE][UINT8_C(50)];
+static char AttValues[ATT_IDX_SIZE][CFG_MAX_LINE_SIZE];
 static ConfigDataBuffer fileReadBuffer;
+/** Attribute index by hash of the attribute name, open addressing */
+static int8_t KeyIndex[CFG_KEY_SLOTS];
 void MQTTCfgParser_List(const char* Title, uint8_t defaultsOnly);
 static char *itoa (int value, char *result, int base);
 
@@ -135,6 +161,36 @@ static ConfigLine_T ConfigStructure[ATT_IDX_SIZE] = {
 		{ ATT_KEY_NAME[17], DEFAULT_FIRMWARE, CFG_FALSE, CFG_FALSE, AttValues[17]},
 		{ ATT_KEY_NAME[18], DEFAULT_FIRMWARE, CFG_FALSE, CFG_FALSE, AttValues[18]},
 		{ ATT_KEY_NAME[19], DEFAULT_FIRMWARE, CFG_FALSE, CFG_FALSE, AttValues[19]},
+		{ ATT_KEY_NAME[20], DEFAULT_INVENTORYMODE, CFG_FALSE, CFG_FALSE, AttValues[20]},
+		{ ATT_KEY_NAME[21], DEFAULT_STR_INVENTORYCOUNT, CFG_FALSE, CFG_FALSE, AttValues[21]},
+		{ ATT_KEY_NAME[22], DEFAULT_STR_INVENTORYDELTA, CFG_FALSE, CFG_FALSE, AttValues[22]},
+		{ ATT_KEY_NAME[23], DEFAULT_STR_INVENTORYPERIOD, CFG_FALSE, CFG_FALSE, AttValues[23]},
+		{ ATT_KEY_NAME[24], DEFAULT_STR_SENSORRATE, CFG_FALSE, CFG_FALSE, AttValues[24]},
+		{ ATT_KEY_NAME[25], DEFAULT_STR_SENSORRATE, CFG_FALSE, CFG_FALSE, AttValues[25]},
+		{ ATT_KEY_NAME[26], DEFAULT_STR_SENSORRATE, CFG_FALSE, CFG_FALSE, AttValues[26]},
+		{ ATT_KEY_NAME[27], DEFAULT_STR_SENSORRATE, CFG_FALSE, CFG_FALSE, AttValues[27]},
+		{ ATT_KEY_NAME[28], DEFAULT_STR_SENSORRATE, CFG_FALSE, CFG_FALSE, AttValues[28]},
+		{ ATT_KEY_NAME[29], DEFAULT_STR_SENSORRATE, CFG_FALSE, CFG_FALSE, AttValues[29]},
+		{ ATT_KEY_NAME[30], DEFAULT_STR_AGGREGATEWINDOW, CFG_FALSE, CFG_FALSE, AttValues[30]},
+		{ ATT_KEY_NAME[31], DEFAULT_STR_SENSORDEADBAND, CFG_FALSE, CFG_FALSE, AttValues[31]},
+		{ ATT_KEY_NAME[32], DEFAULT_STR_SENSORDEADBAND, CFG_FALSE, CFG_FALSE, AttValues[32]},
+		{ ATT_KEY_NAME[33], DEFAULT_STR_SENSORDEADBAND, CFG_FALSE, CFG_FALSE, AttValues[33]},
+		{ ATT_KEY_NAME[34], DEFAULT_STR_SENSORDEADBAND, CFG_FALSE, CFG_FALSE, AttValues[34]},
+		{ ATT_KEY_NAME[35], DEFAULT_STR_SENSORDEADBAND, CFG_FALSE, CFG_FALSE, AttValues[35]},
+		{ ATT_KEY_NAME[36], DEFAULT_STR_SENSORDEADBAND, CFG_FALSE, CFG_FALSE, AttValues[36]},
+		{ ATT_KEY_NAME[37], DEFAULT_STR_HEARTBEAT, CFG_FALSE, CFG_FALSE, AttValues[37]},
+		{ ATT_KEY_NAME[38], DEFAULT_STR_BATCHSIZE, CFG_FALSE, CFG_FALSE, AttValues[38]},
+		{ ATT_KEY_NAME[39], DEFAULT_STR_NOISEWINDOW, CFG_FALSE, CFG_FALSE, AttValues[39]},
+		{ ATT_KEY_NAME[40], DEFAULT_PAYLOADFORMAT, CFG_FALSE, CFG_FALSE, AttValues[40]},
+		{ ATT_KEY_NAME[41], BOOL_TO_STR(DEFAULT_PAYLOADCOMPRESS), CFG_FALSE, CFG_FALSE, AttValues[41]},
+		{ ATT_KEY_NAME[42], DEFAULT_STR_OFFLINESTORE, CFG_FALSE, CFG_FALSE, AttValues[42]},
+		{ ATT_KEY_NAME[43], DEFAULT_STR_OFFLINEDRAIN, CFG_FALSE, CFG_FALSE, AttValues[43]},
+		{ ATT_KEY_NAME[44], DEFAULT_STR_BACKLOGSIZE, CFG_FALSE, CFG_FALSE, AttValues[44]},
+		{ ATT_KEY_NAME[45], DEFAULT_BACKLOGPOLICY, CFG_FALSE, CFG_FALSE, AttValues[45]},
+		{ ATT_KEY_NAME[46], DEFAULT_STR_BACKLOGDECIMATE, CFG_FALSE, CFG_FALSE, AttValues[46]},
+		{ ATT_KEY_NAME[47], DEFAULT_STR_PUBLISHQOS, CFG_FALSE, CFG_FALSE, AttValues[47]},
+		{ ATT_KEY_NAME[48], DEFAULT_STR_PUBLISHWINDOW, CFG_FALSE, CFG_FALSE, AttValues[48]},
+		{ ATT_KEY_NAME[49], DEFAULT_STR_COMMANDQUEUE, CFG_FALSE, CFG_FALSE, AttValues[49]},
 };
 
 
@@ -160,7 +216,7 @@ static void setAttValue(int index, const char* value) {
 	if (0 <= index && index < ATT_IDX_SIZE) {
 		LOG_AT_TRACE(("MQTTCfgParser: Debugging attribute set: %i / %s \r\n",
 				ConfigStructure[index].defined, ConfigStructure[index].attValue ));
-		strcpy(ConfigStructure[index].attValue, value);
+		strncpy(ConfigStructure[index].attValue, value, CFG_MAX_LINE_SIZE - 1);
 		ConfigStructure[index].defined = CFG_TRUE;
 	}
 }
@@ -255,12 +311,8 @@ static TokensType_T GetToken(const char *buffer, uint16_t *idxAtBuffer,
 			};
 		}
 		/* Is this string is a known string ,i.e. attribute name ?*/
-		for (uint8_t ConfigIndex = UINT8_C(0); ConfigIndex < ATT_IDX_SIZE;
-				ConfigIndex++) {
-			if (0 == strcmp(token, ConfigStructure[ConfigIndex].attName)) {
-				Result = TOKEN_ATT_NAME;
-				break;
-			}
+		if (MQTTCfgParser_FindKey(token) >= 0) {
+			Result = TOKEN_ATT_NAME;
 		}
 		/* The string is not known one, so it's a value */
 		if ((index > 0) && (TOKEN_TYPE_UNKNOWN == Result)) {
@@ -308,13 +360,8 @@ static uint8_t MQTTCfgParser_Config(const char *buffer, uint16_t bufSize, uint8_
 				Result = CFG_FALSE;
 				break;
 			}
-			for (uint8_t i = UINT8_C(0); i < ATT_IDX_SIZE; i++) {
-				if (strcmp(Token, ConfigStructure[i].attName) == UINT8_C(0)) {
-					CurrentConfigToSet = i;
-					State = STAT_EXP_ATT_EQUAL;
-					break;
-				}
-			}
+			CurrentConfigToSet = MQTTCfgParser_FindKey(Token);
+			State = STAT_EXP_ATT_EQUAL;
 
 			break;
 		}
@@ -387,21 +434,24 @@ void MQTTCfgParser_List(const char* Title, uint8_t defaultsOnly) {
 void MQTTCfgParser_GetConfig(ConfigDataBuffer *configBuffer, uint8_t defaultsOnly) {
 	for (uint8_t i = UINT8_C(0); i < ATT_IDX_SIZE; i++) {
 		if (CFG_FALSE == ConfigStructure[i].ignore) {
+			const char * value = NULL;
 			if (CFG_TRUE == ConfigStructure[i].defined) {
-				configBuffer->length += sprintf(configBuffer->data + configBuffer->length,"%s=%s\n", ConfigStructure[i].attName,
-						ConfigStructure[i].attValue);
-			} else {
-				if (CFG_TRUE == defaultsOnly) {
-					if (0 != *ConfigStructure[i].defaultValue) {
-						configBuffer->length += sprintf(configBuffer->data + configBuffer->length, "%s=%s\n", ConfigStructure[i].attName,
-								ConfigStructure[i].defaultValue);
-
-					}
-				} else {
-					configBuffer->length += sprintf(configBuffer->data + configBuffer->length, "%s=%s\n",
-							ConfigStructure[i].attName,
-							ConfigStructure[i].defaultValue);
+				value = ConfigStructure[i].attValue;
+			} else if (CFG_FALSE == defaultsOnly || 0 != *ConfigStructure[i].defaultValue) {
+				value = ConfigStructure[i].defaultValue;
+			}
+			if (value != NULL) {
+				uint32_t available = sizeof(configBuffer->data) - configBuffer->length;
+				int written = snprintf(configBuffer->data + configBuffer->length, available,
+						"%s=%s\n", ConfigStructure[i].attName, value);
+				if (written < 0 || (uint32_t) written >= available) {
+					// never store half an attribute
+					configBuffer->data[configBuffer->length] = 0;
+					LOG_AT_ERROR(("MQTTCfgParser: Config exceeds buffer at %s!\r\n",
+							ConfigStructure[i].attName));
+					break;
 				}
+				configBuffer->length += (uint32_t) written;
 			}
 		} else if (CFG_TRUE == ConfigStructure[i].defined) {
 			LOG_AT_WARNING(("[%19s] is deprecated and should be removed\r\n",
@@ -419,7 +469,7 @@ Retcode_T MQTTCfgParser_ParseConfigFile(void) {
 	Retcode_T returnValTotal = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_FAILURE);
 
 	fileReadBuffer.length = NUMBER_UINT32_ZERO;
-	memset(fileReadBuffer.data, CFG_NUMBER_UINT8_ZERO, SIZE_XXLARGE_BUF);
+	memset(fileReadBuffer.data, CFG_NUMBER_UINT8_ZERO, sizeof(fileReadBuffer.data));
 
 	returnVal = MQTTStorage_Flash_ReadConfig(&fileReadBuffer);
 	if (returnVal == RETCODE_OK ) {
@@ -435,7 +485,7 @@ Retcode_T MQTTCfgParser_ParseConfigFile(void) {
 	// test if config on SDCard exists and overwrite setting from config on flash
 	LOG_AT_INFO(("MQTTCfgParser_ParseConfigFile: Trying to read config from SDCard ...\r\n"));
 	fileReadBuffer.length = NUMBER_UINT32_ZERO;
-	memset(fileReadBuffer.data, CFG_NUMBER_UINT8_ZERO, SIZE_XXLARGE_BUF);
+	memset(fileReadBuffer.data, CFG_NUMBER_UINT8_ZERO, sizeof(fileReadBuffer.data));
 
 	returnVal = MQTTStorage_SD_ReadConfig(&fileReadBuffer);
 	if (returnVal == RETCODE_OK ) {
@@ -586,10 +636,10 @@ bool MQTTCfgParser_IsNoiseEnabled(void) {
 }
 
 void MQTTCfgParser_FLWriteConfig(void) {
-	// update config in flash memory
-	ConfigDataBuffer localbuffer;
+	// update config in flash memory, buffer is too large for the stack
+	static ConfigDataBuffer localbuffer;
 	localbuffer.length = NUMBER_UINT32_ZERO;
-	memset(localbuffer.data, 0x00, SIZE_XXLARGE_BUF);
+	memset(localbuffer.data, 0x00, sizeof(localbuffer.data));
 	MQTTCfgParser_GetConfig(&localbuffer, CFG_FALSE);
 	MQTTStorage_Flash_WriteConfig(&localbuffer);
 }
@@ -607,15 +657,15 @@ const char *MQTTCfgParser_GetFirmwareURL(void) {
 	return getAttValue(ATT_IDX_FIRMWAREURL);
 }
 
-void MQTTCfgParser_SetFirmwareName(char * name) {
+void MQTTCfgParser_SetFirmwareName(const char * name) {
 	setAttValue(ATT_IDX_FIRMWARENAME, name);
 }
 
-void MQTTCfgParser_SetFirmwareVersion(char * name) {
+void MQTTCfgParser_SetFirmwareVersion(const char * name) {
 	setAttValue(ATT_IDX_FIRMWAREVERSION, name);
 }
 
-void MQTTCfgParser_SetFirmwareURL(char * name) {
+void MQTTCfgParser_SetFirmwareURL(const char * name) {
 	setAttValue(ATT_IDX_FIRMWAREURL, name);
 }
 
@@ -643,7 +693,188 @@ int32_t MQTTCfgParser_GetSntpPort(void) {
 	return (int32_t) atol(getAttValue(ATT_IDX_SNTPPORT));
 }
 
+/**
+ * @brief returns the policy for inventory updates: ALWAYS, COUNT, CHANGE or PERIOD
+ */
+const char *MQTTCfgParser_GetInventoryMode(void) {
+	return getAttValue(ATT_IDX_INVENTORYMODE);
+}
+
+/**
+ * @brief returns the number of samples between inventory updates for policy COUNT
+ */
+int32_t MQTTCfgParser_GetInventoryCount(void) {
+	return (int32_t) atol(getAttValue(ATT_IDX_INVENTORYCOUNT));
+}
+
+/**
+ * @brief returns the minimal change in the last transmitted digit for policy CHANGE
+ */
+int32_t MQTTCfgParser_GetInventoryDelta(void) {
+	return (int32_t) atol(getAttValue(ATT_IDX_INVENTORYDELTA));
+}
+
+/**
+ * @brief returns the time between inventory updates in milliseconds for policy PERIOD
+ */
+int32_t MQTTCfgParser_GetInventoryPeriod(void) {
+	return (int32_t) atol(getAttValue(ATT_IDX_INVENTORYPERIOD));
+}
+
+/**
+ * @brief returns the sampling rate in milliseconds of a sensor, STREAMRATE if no own rate is defined
+ *
+ * @param[in] index index of the sensor switch, ATT_IDX_ACCEL to ATT_IDX_NOISE
+ */
+int32_t MQTTCfgParser_GetSensorRate(int index) {
+	int32_t rate = (int32_t) atol(getAttValue(ATT_IDX_ACCELRATE + (index - ATT_IDX_ACCEL)));
+	return (rate > 0L) ? rate : MQTTCfgParser_GetStreamRate();
+}
+
+/**
+ * @brief returns the number of samples aggregated into one record, 0 or 1 sends every sample
+ */
+int32_t MQTTCfgParser_GetAggregateWindow(void) {
+	return (int32_t) atol(getAttValue(ATT_IDX_AGGREGATEWINDOW));
+}
+
+/**
+ * @brief returns the deadband of a sensor, absolute like "10" or relative like "2%"
+ *
+ * @param[in] index index of the sensor switch, ATT_IDX_ACCEL to ATT_IDX_NOISE
+ */
+const char *MQTTCfgParser_GetSensorDeadband(int index) {
+	return getAttValue(ATT_IDX_ACCELDEADBAND + (index - ATT_IDX_ACCEL));
+}
+
+/**
+ * @brief returns the maximal time in milliseconds without a measurement when a deadband is used
+ */
+int32_t MQTTCfgParser_GetHeartbeat(void) {
+	return (int32_t) atol(getAttValue(ATT_IDX_HEARTBEAT));
+}
+
+/**
+ * @brief returns the number of samples sent with their sample time in one publish
+ */
+int32_t MQTTCfgParser_GetBatchSize(void) {
+	return (int32_t) atol(getAttValue(ATT_IDX_BATCHSIZE));
+}
+
+/**
+ * @brief returns the window in milliseconds over which the noise level is computed
+ */
+int32_t MQTTCfgParser_GetNoiseWindow(void) {
+	return (int32_t) atol(getAttValue(ATT_IDX_NOISEWINDOW));
+}
+
+/**
+ * @brief returns the format of the sensor payloads: SMARTREST, BINARY or DELTA
+ */
+const char *MQTTCfgParser_GetPayloadFormat(void) {
+	return getAttValue(ATT_IDX_PAYLOADFORMAT);
+}
+
+/**
+ * @brief returns true if asset and sensor payloads are compressed for a local bridge
+ */
+bool MQTTCfgParser_IsPayloadCompressEnabled(void) {
+	const char* value = getAttValue(ATT_IDX_PAYLOADCOMPRESS);
+	if (strcmp(value,"TRUE") == 0 || strcmp(value,"1") == 0 )
+		return true;
+	else
+		return false;
+}
+
+/**
+ * @brief returns the size in KB on the SD card for measurements that can not be published
+ */
+int32_t MQTTCfgParser_GetOfflineStore(void) {
+	return (int32_t) atol(getAttValue(ATT_IDX_OFFLINESTORE));
+}
+
+/**
+ * @brief returns the time in milliseconds between two publishes of stored measurements
+ */
+int32_t MQTTCfgParser_GetOfflineDrain(void) {
+	return (int32_t) atol(getAttValue(ATT_IDX_OFFLINEDRAIN));
+}
+
+/**
+ * @brief returns the number of samples that can wait to be published
+ */
+int32_t MQTTCfgParser_GetBacklogSize(void) {
+	return (int32_t) atol(getAttValue(ATT_IDX_BACKLOGSIZE));
+}
+
+/**
+ * @brief returns which samples are dropped when the backlog is full: DROPNEWEST, DROPOLDEST or DECIMATE
+ */
+const char *MQTTCfgParser_GetBacklogPolicy(void) {
+	return getAttValue(ATT_IDX_BACKLOGPOLICY);
+}
+
+/**
+ * @brief returns n, every n-th sample is kept while the backlog is decimated
+ */
+int32_t MQTTCfgParser_GetBacklogDecimate(void) {
+	return (int32_t) atol(getAttValue(ATT_IDX_BACKLOGDECIMATE));
+}
+
+/**
+ * @brief returns the quality of service of measurements and inventory updates, 0 or 1
+ */
+int32_t MQTTCfgParser_GetPublishQoS(void) {
+	return (int32_t) atol(getAttValue(ATT_IDX_PUBLISHQOS));
+}
+
+/**
+ * @brief returns the number of QoS 1 publishes that may wait for their acknowledgement
+ */
+int32_t MQTTCfgParser_GetPublishWindow(void) {
+	return (int32_t) atol(getAttValue(ATT_IDX_PUBLISHWINDOW));
+}
+
+/**
+ * @brief returns the number of received operations that may wait to be executed
+ */
+int32_t MQTTCfgParser_GetCommandQueue(void) {
+	return (int32_t) atol(getAttValue(ATT_IDX_COMMANDQUEUE));
+}
+
+/**
+ * @brief FNV-1a hash of an attribute name
+ */
+static uint32_t MQTTCfgParser_HashKey(const char * name) {
+	uint32_t hash = UINT32_C(2166136261);
+	while (*name != '\0') {
+		hash ^= (uint8_t) *name++;
+		hash *= UINT32_C(16777619);
+	}
+	return hash;
+}
+
+int8_t MQTTCfgParser_FindKey(const char * name) {
+	for (uint32_t slot = MQTTCfgParser_HashKey(name) & (CFG_KEY_SLOTS - 1U); KeyIndex[slot] >= 0;
+			slot = (slot + 1U) & (CFG_KEY_SLOTS - 1U)) {
+		if (strcmp(name, ATT_KEY_NAME[KeyIndex[slot]]) == 0) {
+			return KeyIndex[slot];
+		}
+	}
+	return INT8_C(-1);
+}
+
 Retcode_T MQTTCfgParser_Init(void) {
+	/* Index the attribute names, there are less names than slots */
+	memset(KeyIndex, -1, sizeof(KeyIndex));
+	for (uint8_t i = UINT8_C(0); i < ATT_IDX_SIZE; i++) {
+		uint32_t slot = MQTTCfgParser_HashKey(ATT_KEY_NAME[i]) & (CFG_KEY_SLOTS - 1U);
+		while (KeyIndex[slot] >= 0) {
+			slot = (slot + 1U) & (CFG_KEY_SLOTS - 1U);
+		}
+		KeyIndex[slot] = (int8_t) i;
+	}
+
 	/* Initialize the attribute values holders */
 	for (uint8_t i = UINT8_C(0); i < ATT_IDX_SIZE; i++) {
 		ConfigStructure[i].defined = CFG_FALSE;
@@ -35,7 +35,7 @@
 #define CFG_TESTMODE_ON                  UINT8_C(1)
 #define CFG_TESTMODE_MIX                 UINT8_C(2)
 
-#define ATT_IDX_SIZE					UINT8_C(20)
+#define ATT_IDX_SIZE					UINT8_C(50)
 #define ATT_KEY_LENGTH					UINT8_C(20)
 
 #define BOOL_TO_STR(x) ((x) ? "TRUE" : "FALSE")
@@ -62,7 +62,15 @@ static const char ATT_KEY_NAME[ATT_IDX_SIZE][ATT_KEY_LENGTH] = {
 		"MQTTSECURE","MQTTUSER","MQTTPASSWORD","MQTTANONYMOUS",
 		"STREAMRATE","ACCEL","GYRO","MAG",
 		"ENV", "LIGHT","NOISE","SNTPNAME",
-		"SNTPPORT","FIRMWARENAME","FIRMWAREVERSION","FIRMWAREURL"};
+		"SNTPPORT","FIRMWARENAME","FIRMWAREVERSION","FIRMWAREURL",
+		"INVENTORYMODE","INVENTORYCOUNT","INVENTORYDELTA","INVENTORYPERIOD",
+		"ACCELRATE","GYRORATE","MAGRATE","ENVRATE",
+		"LIGHTRATE","NOISERATE","AGGREGATEWINDOW","ACCELDEADBAND",
+		"GYRODEADBAND","MAGDEADBAND","ENVDEADBAND","LIGHTDEADBAND",
+		"NOISEDEADBAND","HEARTBEAT","BATCHSIZE","NOISEWINDOW","PAYLOADFORMAT",
+		"PAYLOADCOMPRESS","OFFLINESTORE","OFFLINEDRAIN","BACKLOGSIZE",
+		"BACKLOGPOLICY","BACKLOGDECIMATE","PUBLISHQOS","PUBLISHWINDOW",
+		"COMMANDQUEUE"};
 
 
 enum AttributesIndex_E
@@ -86,7 +94,37 @@ enum AttributesIndex_E
 	ATT_IDX_SNTPPORT,
 	ATT_IDX_FIRMWARENAME,
 	ATT_IDX_FIRMWAREVERSION,
-	ATT_IDX_FIRMWAREURL
+	ATT_IDX_FIRMWAREURL,
+	ATT_IDX_INVENTORYMODE,
+	ATT_IDX_INVENTORYCOUNT,
+	ATT_IDX_INVENTORYDELTA,
+	ATT_IDX_INVENTORYPERIOD,
+	ATT_IDX_ACCELRATE,
+	ATT_IDX_GYRORATE,
+	ATT_IDX_MAGRATE,
+	ATT_IDX_ENVRATE,
+	ATT_IDX_LIGHTRATE,
+	ATT_IDX_NOISERATE,
+	ATT_IDX_AGGREGATEWINDOW,
+	ATT_IDX_ACCELDEADBAND,
+	ATT_IDX_GYRODEADBAND,
+	ATT_IDX_MAGDEADBAND,
+	ATT_IDX_ENVDEADBAND,
+	ATT_IDX_LIGHTDEADBAND,
+	ATT_IDX_NOISEDEADBAND,
+	ATT_IDX_HEARTBEAT,
+	ATT_IDX_BATCHSIZE,
+	ATT_IDX_NOISEWINDOW,
+	ATT_IDX_PAYLOADFORMAT,
+	ATT_IDX_PAYLOADCOMPRESS,
+	ATT_IDX_OFFLINESTORE,
+	ATT_IDX_OFFLINEDRAIN,
+	ATT_IDX_BACKLOGSIZE,
+	ATT_IDX_BACKLOGPOLICY,
+	ATT_IDX_BACKLOGDECIMATE,
+	ATT_IDX_PUBLISHQOS,
+	ATT_IDX_PUBLISHWINDOW,
+	ATT_IDX_COMMANDQUEUE
 };
 
 typedef enum AttributesIndex_E AttributesIndex_T;
@@ -149,6 +187,13 @@ enum Retcode_CfgParser_E
  */
 Retcode_T MQTTCfgParser_Init(void);
 
+/**
+ * @brief find the index of an attribute by its name, through a hash index built by MQTTCfgParser_Init
+ *
+ * @return ATT_IDX_* of the attribute or -1 if the name is unknown
+ */
+int8_t MQTTCfgParser_FindKey(const char * name);
+
 /**
  * @brief return boot status fo device
  */
@@ -232,11 +277,11 @@ void MQTTCfgParser_FLWriteConfig(void);
 
 const char *MQTTCfgParser_GetSntpName(void);
 
-void MQTTCfgParser_SetFirmwareName(char * name);
+void MQTTCfgParser_SetFirmwareName(const char * name);
 
-void MQTTCfgParser_SetFirmwareVersion(char * name);
+void MQTTCfgParser_SetFirmwareVersion(const char * name);
 
-void MQTTCfgParser_SetFirmwareURL(char * name);
+void MQTTCfgParser_SetFirmwareURL(const char * name);
 
 void MQTTCfgParser_SetConfig(const char * value, int index);
 
@@ -248,6 +293,46 @@ const char *MQTTCfgParser_GetFirmwareURL(void);
 
 int32_t MQTTCfgParser_GetSntpPort(void);
 
+const char *MQTTCfgParser_GetInventoryMode(void);
+
+int32_t MQTTCfgParser_GetInventoryCount(void);
+
+int32_t MQTTCfgParser_GetInventoryDelta(void);
+
+int32_t MQTTCfgParser_GetInventoryPeriod(void);
+
+int32_t MQTTCfgParser_GetSensorRate(int index);
+
+int32_t MQTTCfgParser_GetAggregateWindow(void);
+
+const char *MQTTCfgParser_GetSensorDeadband(int index);
+
+int32_t MQTTCfgParser_GetHeartbeat(void);
+
+int32_t MQTTCfgParser_GetBatchSize(void);
+
+int32_t MQTTCfgParser_GetNoiseWindow(void);
+
+const char *MQTTCfgParser_GetPayloadFormat(void);
+
+bool MQTTCfgParser_IsPayloadCompressEnabled(void);
+
+int32_t MQTTCfgParser_GetOfflineStore(void);
+
+int32_t MQTTCfgParser_GetOfflineDrain(void);
+
+int32_t MQTTCfgParser_GetBacklogSize(void);
+
+const char *MQTTCfgParser_GetBacklogPolicy(void);
+
+int32_t MQTTCfgParser_GetBacklogDecimate(void);
+
+int32_t MQTTCfgParser_GetPublishQoS(void);
+
+int32_t MQTTCfgParser_GetPublishWindow(void);
+
+int32_t MQTTCfgParser_GetCommandQueue(void);
+
 /* inline function definitions */
 
 #endif /* MQTTCFGPARSER_H_ */
@@ -35,6 +35,7 @@
 
 /* system header files */
 #include <stdio.h>
+#include <string.h>
 
 /* additional interface header files */
 //#include "aws_mqtt_agent.h"
@@ -49,12 +50,16 @@
 #include "Serval_Types.h"
 #include "FreeRTOS.h"
 #include "semphr.h"
+#include "task.h"
+#include "timers.h"
 #include "Serval_Mqtt.h"
 #include "AppController.h"
+#include "MQTTRouter.h"
+#include "MQTTWheel.h"
 
 /* constant definitions ***************************************************** */
 
-/**<  Macro for the number of topics to subscribe */
+/**<  Macro for the number of topics to unsubscribe */
 #define MQTT_SUBSCRIBE_COUNT                1UL
 
 /**<  Macro for the non secure serval stack expected MQTT URL format */
@@ -63,7 +68,44 @@
 /**<  Macro for the secure serval stack expected MQTT URL format */
 #define MQTT_URL_FORMAT_SECURE              "mqtts://%s:%d"
 
-/* local variables ********************************************************** */
+/**<  Macro for the time in milli-second of one tick of the publish timer wheel */
+#define MQTT_PUBLISH_TICK_IN_MS             UINT32_C(100)
+
+/**<  Macro for the extra time in milli-second a synchronous publish waits, in case the command processor is stalled */
+#define MQTT_PUBLISH_GRACE_IN_MS            UINT32_C(1000)
+
+/**<  Macro for the publish slot of a running index */
+#define MQTT_PUBLISH_SLOT(index)            (&MqttPublishSlots_Z[(index) & (MQTT_PUBLISH_SLOTS - 1UL)])
+
+/**
+ * @brief   State of a publish slot, slots are used in the order the publishes are queued.
+ */
+typedef enum
+{
+    MQTT_SLOT_FREE, /**< Not used */
+    MQTT_SLOT_WAITING, /**< Queued, not sent on the current connection yet */
+    MQTT_SLOT_SENT, /**< Sent, waiting for the acknowledgement */
+} MQTT_SlotState_TZ;
+
+/**
+ * @brief   A publish from being queued until it completes.
+ */
+typedef struct
+{
+    MQTT_SlotState_TZ State; /**< Where the publish is */
+    bool Retry; /**< Sent again after a reconnect, otherwise it completes with the error */
+    uint8_t QoS; /**< The MQTT Quality of Service level */
+    uint8_t Attempts; /**< Number of times the publish was sent */
+    StringDescr_T Topic; /**< The topic, the stack keeps a reference while sending */
+    const char * Payload; /**< Pointer to the payload, owned by the caller until completion */
+    uint32_t PayloadLength; /**< Length of the payload */
+    uint32_t Timeout; /**< Ticks of the wheel to await the acknowledgement */
+    uint32_t Deadline; /**< Tick of the wheel at which a waiting publish fails */
+    MQTTWheel_Timer_T Timer; /**< Runs until the acknowledgement while sent, until the deadline while waiting */
+    MQTT_PublishHandle_TZ Handle; /**< Handle returned to the caller */
+    MQTT_PublishCB_TZ Callback; /**< Called when the publish completed */
+    void * Context; /**< Context of the caller */
+} MQTT_PublishSlot_TZ;
 
 /**< Handle for MQTT subscribe operation  */
 static SemaphoreHandle_t MqttSubscribeHandle_Z;
@@ -75,16 +117,397 @@ static SemaphoreHandle_t MqttSendHandle_Z;
 static SemaphoreHandle_t MqttConnectHandle_Z;
 /**< MQTT setup information */
 static MQTT_Setup_TZ MqttSetupInfo_Z;
-/**< MQTT incoming publish notification callback for the application */
-static MQTT_SubscribeCB_TZ IncomingPublishNotificationCB_Z;
+/**< Routes the topics of incoming publishes to the subscriptions */
+static MQTTRouter_T MqttRouter_Z;
+/**< MQTT incoming publish notification callbacks for the application, by route */
+static MQTT_SubscribeCB_TZ MqttRouteCB_Z[MQTTROUTER_ROUTES];
 /**< MQTT session instance */
 static MqttSession_T MqttSession_Z;
 /**< MQTT connection status */
 static bool MqttConnectionStatus_Z = false;
 /**< MQTT subscription status */
 static bool MqttSubscriptionStatus_Z = false;
-/**< MQTT publish status */
-static bool MqttPublishStatus_Z = false;
+/*
+ * Publishes are queued by the callers into slots. Sending, acknowledgements,
+ * timeouts and completion callbacks are handled in the command processor of
+ * MQTT_Setup_Z, where the stack reports its events, so only queuing has to
+ * be protected.
+ */
+/**< Publishes from queuing to completion, in order */
+static MQTT_PublishSlot_TZ MqttPublishSlots_Z[MQTT_PUBLISH_SLOTS];
+/**< Running index of the next slot to queue into, moved by the callers */
+static volatile uint32_t MqttPublishHead_Z = 0UL;
+/**< Running index of the oldest slot in use, moved by the command processor */
+static volatile uint32_t MqttPublishTail_Z = 0UL;
+/**< Last handle given to a publish */
+static MQTT_PublishHandle_TZ MqttPublishHandles_Z = MQTT_PUBLISH_HANDLE_INVALID;
+/**< Number of QoS 1 publishes that may wait for their acknowledgement */
+static uint8_t MqttPublishWindow_Z = 1U;
+/**< A publish failed on this connection, nothing is sent until the next one is established */
+static volatile bool MqttPublishBroken_Z = false;
+/**< Timeouts of the publishes */
+static MQTTWheel_T MqttPublishWheel_Z;
+/**< Timer turning the wheel */
+static xTimerHandle MqttPublishTimer_Z;
+/**< Sending is enqueued in the command processor */
+static volatile bool MqttPublishScheduled_Z = false;
+/**< Synchronous publish the semaphore is given for */
+static volatile uint32_t MqttPublishAwaited_Z = 0UL;
+/**< Result of the synchronous publish */
+static volatile Retcode_T MqttPublishResult_Z = RETCODE_OK;
+
+/**
+ * @brief Free the slot of a publish and report its result to the caller
+ */
+static void MqttPublishComplete_Z(MQTT_PublishSlot_TZ * slot, Retcode_T result)
+{
+    MQTT_PublishCB_TZ callback = slot->Callback;
+    MQTT_PublishHandle_TZ handle = slot->Handle;
+    void * context = slot->Context;
+
+    MQTTWheel_Stop(&MqttPublishWheel_Z, &slot->Timer);
+    taskENTER_CRITICAL();
+    slot->State = MQTT_SLOT_FREE;
+    // a publish without retry may give up before older ones complete
+    while (MqttPublishTail_Z != MqttPublishHead_Z && MQTT_SLOT_FREE == MQTT_PUBLISH_SLOT(MqttPublishTail_Z)->State)
+    {
+        MqttPublishTail_Z++;
+    }
+    taskEXIT_CRITICAL();
+
+    // the slot is free already, so the callback may queue the next publish
+    if (NULL != callback)
+    {
+        callback(handle, context, result);
+    }
+}
+
+/**
+ * @brief Let a waiting publish fail at its deadline
+ */
+static void MqttPublishWait_Z(MQTT_PublishSlot_TZ * slot)
+{
+    const uint32_t left = slot->Deadline - MqttPublishWheel_Z.now;
+
+    // a deadline that passed while the publish was sent expires with the next tick
+    MQTTWheel_Start(&MqttPublishWheel_Z, &slot->Timer, ((int32_t) left > 0L) ? left : 1UL);
+}
+
+/**
+ * @brief Take back every publish still waiting for its acknowledgement, they are sent again on the next connection
+ *
+ * The broker acknowledges QoS 1 publishes in the order it received them, see
+ * MQTT 3.1.1 section 4.6, and the stack reports acknowledgements without the
+ * packet identifier. After a lost acknowledgement the order can not be trusted
+ * any more, so the connection is given up.
+ *
+ * @param[in] result
+ * Result for publishes that are not sent again
+ */
+static void MqttPublishReset_Z(Retcode_T result)
+{
+    const uint32_t head = MqttPublishHead_Z;
+
+    MqttPublishBroken_Z = true;
+    for (uint32_t index = MqttPublishTail_Z; index != head; index++)
+    {
+        MQTT_PublishSlot_TZ * slot = MQTT_PUBLISH_SLOT(index);
+        if (MQTT_SLOT_SENT == slot->State)
+        {
+            if (slot->Retry && slot->Attempts < MQTT_PUBLISH_ATTEMPTS)
+            {
+                // waits for the next connection until its deadline
+                slot->State = MQTT_SLOT_WAITING;
+                MqttPublishWait_Z(slot);
+            }
+            else
+            {
+                MqttPublishComplete_Z(slot, result);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Complete the oldest sent publish, acknowledgements arrive in the order of sending
+ */
+static void MqttPublishAcknowledged_Z(void)
+{
+    for (uint32_t index = MqttPublishTail_Z; index != MqttPublishHead_Z; index++)
+    {
+        MQTT_PublishSlot_TZ * slot = MQTT_PUBLISH_SLOT(index);
+        if (MQTT_SLOT_SENT == slot->State)
+        {
+            MqttPublishComplete_Z(slot, RETCODE_OK);
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Send waiting publishes as far as the window allows
+ */
+static void MqttPublishSend_Z(void)
+{
+    uint8_t sent = 0U;
+    bool sentQoS0 = false;
+
+    for (uint32_t index = MqttPublishTail_Z; index != MqttPublishHead_Z; index++)
+    {
+        MQTT_PublishSlot_TZ * slot = MQTT_PUBLISH_SLOT(index);
+        if (MQTT_SLOT_WAITING == slot->State && false == slot->Timer.running)
+        {
+            MqttPublishWait_Z(slot);
+        }
+    }
+    if (MqttPublishBroken_Z)
+    {
+        return;
+    }
+
+    for (uint32_t index = MqttPublishTail_Z; index != MqttPublishHead_Z; index++)
+    {
+        MQTT_PublishSlot_TZ * slot = MQTT_PUBLISH_SLOT(index);
+        if (MQTT_SLOT_WAITING == slot->State)
+        {
+            // a QoS 0 publish is done when it is sent, it must not overtake a pending acknowledgement
+            if (0U != sent && (sent >= MqttPublishWindow_Z || sentQoS0 || 0U == slot->QoS))
+            {
+                break;
+            }
+            slot->State = MQTT_SLOT_SENT;
+            slot->Attempts++;
+            MQTTWheel_Start(&MqttPublishWheel_Z, &slot->Timer, slot->Timeout);
+            if (RC_OK != Mqtt_publish(&MqttSession_Z, slot->Topic, slot->Payload, slot->PayloadLength, slot->QoS, false))
+            {
+                LOG_AT_ERROR(("MqttPublishSend_Z: Failed to publish\r\n"));
+                MqttPublishReset_Z(RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_MQTT_PUBLISH_FAILED));
+                break;
+            }
+        }
+        if (MQTT_SLOT_SENT == slot->State)
+        {
+            sent++;
+            sentQoS0 = sentQoS0 || (0U == slot->QoS);
+        }
+    }
+}
+
+/**
+ * @brief Command processor job sending waiting publishes
+ */
+static void MqttPublishSendJob_Z(void * param1, uint32_t param2)
+{
+    BCDS_UNUSED(param1);
+    BCDS_UNUSED(param2);
+    // cleared first, a publish queued from now on enqueues the job again
+    MqttPublishScheduled_Z = false;
+    MqttPublishSend_Z();
+}
+
+/**
+ * @brief Let the command processor send waiting publishes, can be called from any task
+ */
+static void MqttPublishSchedule_Z(void)
+{
+    if (false == MqttPublishScheduled_Z)
+    {
+        MqttPublishScheduled_Z = true;
+        if (RETCODE_OK != CmdProcessor_Enqueue(MqttSetupInfo_Z.CmdProcessorHandle, MqttPublishSendJob_Z, NULL, 0UL))
+        {
+            // the next tick of the wheel sends them
+            MqttPublishScheduled_Z = false;
+        }
+    }
+}
+
+/**
+ * @brief Command processor job turning the wheel by one tick and handling the expired publishes
+ */
+static void MqttPublishTickJob_Z(void * param1, uint32_t param2)
+{
+    struct
+    {
+        MQTT_PublishSlot_TZ * Slot;
+        MQTT_PublishHandle_TZ Handle;
+    } expired[MQTT_PUBLISH_SLOTS];
+    uint8_t count = 0U;
+
+    BCDS_UNUSED(param1);
+    BCDS_UNUSED(param2);
+    // completing one publish may change or reuse the slots of the others, so remember them first
+    for (MQTTWheel_Timer_T * timer = MQTTWheel_Advance(&MqttPublishWheel_Z); NULL != timer; timer = timer->next)
+    {
+        expired[count].Slot = (MQTT_PublishSlot_TZ *) timer->owner;
+        expired[count].Handle = expired[count].Slot->Handle;
+        count++;
+    }
+    for (uint8_t index = 0U; index < count; index++)
+    {
+        MQTT_PublishSlot_TZ * slot = expired[index].Slot;
+        if (slot->Handle != expired[index].Handle || slot->Timer.running)
+        {
+            continue;
+        }
+        if (MQTT_SLOT_SENT == slot->State)
+        {
+            LOG_AT_ERROR(("MqttPublishTickJob_Z: Publish not acknowledged in time\r\n"));
+            MqttPublishReset_Z(RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_MQTT_PUBLISH_CB_NOT_RECEIVED));
+        }
+        else if (MQTT_SLOT_WAITING == slot->State)
+        {
+            LOG_AT_ERROR(("MqttPublishTickJob_Z: Publish not sent in time\r\n"));
+            MqttPublishComplete_Z(slot, RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_MQTT_PUBLISH_CB_NOT_RECEIVED));
+        }
+    }
+    MqttPublishSend_Z();
+}
+
+/**
+ * @brief Timer callback, the wheel only turns while publishes are pending
+ */
+static void MqttPublishTimerCallback_Z(xTimerHandle timer)
+{
+    BCDS_UNUSED(timer);
+    if (MqttPublishHead_Z != MqttPublishTail_Z)
+    {
+        (void) CmdProcessor_Enqueue(MqttSetupInfo_Z.CmdProcessorHandle, MqttPublishTickJob_Z, NULL, 0UL);
+    }
+}
+
+/**
+ * @brief Command processor job completing all publishes with an error
+ */
+static void MqttPublishAbortJob_Z(void * param1, uint32_t param2)
+{
+    const uint32_t head = MqttPublishHead_Z;
+
+    BCDS_UNUSED(param1);
+    BCDS_UNUSED(param2);
+    // acknowledgements of aborted publishes must not complete newer ones
+    MqttPublishBroken_Z = true;
+    for (uint32_t index = MqttPublishTail_Z; index != head; index++)
+    {
+        MQTT_PublishSlot_TZ * slot = MQTT_PUBLISH_SLOT(index);
+        if (MQTT_SLOT_FREE != slot->State)
+        {
+            MqttPublishComplete_Z(slot, RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_MQTT_PUBLISH_FAILED));
+        }
+    }
+}
+
+/**
+ * @brief Queue a publish into the next free slot
+ *
+ * @return  handle of the publish or MQTT_PUBLISH_HANDLE_INVALID if all slots are used
+ */
+static MQTT_PublishHandle_TZ MqttPublishQueue_Z(MQTT_Publish_TZ * publish, uint32_t timeout,
+        MQTT_PublishCB_TZ callback, void * context, bool retry)
+{
+    MQTT_PublishHandle_TZ handle = MQTT_PUBLISH_HANDLE_INVALID;
+
+    taskENTER_CRITICAL();
+    if ((MqttPublishHead_Z - MqttPublishTail_Z) < MQTT_PUBLISH_SLOTS)
+    {
+        MQTT_PublishSlot_TZ * slot = MQTT_PUBLISH_SLOT(MqttPublishHead_Z);
+        MqttPublishHandles_Z++;
+        if (MQTT_PUBLISH_HANDLE_INVALID == MqttPublishHandles_Z)
+        {
+            MqttPublishHandles_Z++;
+        }
+        handle = MqttPublishHandles_Z;
+        slot->Retry = retry;
+        slot->QoS = (uint8_t) publish->QoS;
+        slot->Attempts = 0U;
+        StringDescr_wrap(&slot->Topic, publish->Topic);
+        slot->Payload = publish->Payload;
+        slot->PayloadLength = publish->PayloadLength;
+        slot->Timeout = (timeout + MQTT_PUBLISH_TICK_IN_MS - 1UL) / MQTT_PUBLISH_TICK_IN_MS;
+        // all attempts of a publish with retry together may take as long as their timeouts
+        slot->Deadline = MqttPublishWheel_Z.now + slot->Timeout * (retry ? MQTT_PUBLISH_ATTEMPTS : 1UL);
+        slot->Handle = handle;
+        slot->Callback = callback;
+        slot->Context = context;
+        slot->State = MQTT_SLOT_WAITING;
+        MqttPublishHead_Z++;
+    }
+    taskEXIT_CRITICAL();
+    return handle;
+}
+
+/**
+ * @brief Completion of a synchronous publish, wakes up the waiting caller
+ */
+static void MqttPublishAwaitedCB_Z(MQTT_PublishHandle_TZ handle, void * context, Retcode_T result)
+{
+    BCDS_UNUSED(handle);
+    // a caller that gave up waiting is not woken up
+    if ((uint32_t) (uintptr_t) context == MqttPublishAwaited_Z)
+    {
+        MqttPublishResult_Z = result;
+        (void) xSemaphoreGive(MqttPublishHandle_Z);
+    }
+}
+
+/**
+ * @brief Route the topic of a subscription to its callback
+ */
+static void MqttRouteAdd_Z(MQTT_Subscribe_TZ * subscribe)
+{
+    taskENTER_CRITICAL();
+    int8_t route = MQTTRouter_Add(&MqttRouter_Z, subscribe->Topic);
+    if (MQTTROUTER_NONE != route)
+    {
+        MqttRouteCB_Z[route] = subscribe->IncomingPublishNotificationCB;
+    }
+    taskEXIT_CRITICAL();
+    if (MQTTROUTER_NONE == route)
+    {
+        LOG_AT_ERROR(("MqttRouteAdd_Z: Can not route topic: [%s]\r\n", subscribe->Topic));
+    }
+}
+
+/**
+ * @brief Stop routing the topic of a subscription
+ */
+static void MqttRouteRemove_Z(MQTT_Subscribe_TZ * subscribe)
+{
+    taskENTER_CRITICAL();
+    int8_t route = MQTTRouter_Remove(&MqttRouter_Z, subscribe->Topic);
+    if (MQTTROUTER_NONE != route)
+    {
+        MqttRouteCB_Z[route] = NULL;
+    }
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Pass an incoming publish to the callback of the subscription its topic matches
+ *
+ * @param[in] param
+ * The incoming publish, topic and payload point into the receive buffer of the stack
+ */
+static void MqttRouteIncoming_Z(MQTT_SubscribeCBParam_TZ param)
+{
+    MQTT_SubscribeCB_TZ callback = NULL;
+
+    taskENTER_CRITICAL();
+    int8_t route = MQTTRouter_Match(&MqttRouter_Z, param.Topic, param.TopicLength);
+    if (MQTTROUTER_NONE != route)
+    {
+        callback = MqttRouteCB_Z[route];
+    }
+    taskEXIT_CRITICAL();
+
+    if (NULL != callback)
+    {
+        callback(param);
+    }
+    else
+    {
+        LOG_AT_WARNING(("MqttRouteIncoming_Z: No subscription for topic: [%.*s]\r\n", (int) param.TopicLength, param.Topic));
+    }
+}
 
 /**
  * @brief Event handler for incoming publish MQTT data
@@ -94,17 +517,14 @@ static bool MqttPublishStatus_Z = false;
  */
 static void HandleEventIncomingPublish_Z(MqttPublishData_T publishData)
 {
-    if (NULL != IncomingPublishNotificationCB_Z)
-    {
-        MQTT_SubscribeCBParam_TZ param =
-                {
-                        .Topic = publishData.topic.start,
-                        .TopicLength = publishData.topic.length,
-                        .Payload = (const char *) publishData.payload,
-                        .PayloadLength = publishData.length
-                };
-        IncomingPublishNotificationCB_Z(param);
-    }
+    MQTT_SubscribeCBParam_TZ param =
+            {
+                    .Topic = publishData.topic.start,
+                    .TopicLength = publishData.topic.length,
+                    .Payload = (const char *) publishData.payload,
+                    .PayloadLength = publishData.length
+            };
+    MqttRouteIncoming_Z(param);
 }
 
 /**
@@ -132,6 +552,9 @@ static retcode_t MqttEventHandler_Z(MqttSession_T* session, MqttEvent_t event, c
     {
     case MQTT_CONNECTION_ESTABLISHED:
         MqttConnectionStatus_Z = true;
+        // publishes taken back from the previous connection are sent again
+        MqttPublishBroken_Z = false;
+        MqttPublishSchedule_Z();
         if (pdTRUE != xSemaphoreGive(MqttConnectHandle_Z))
         {
             retcode = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_SEMAPHORE_ERROR);
@@ -149,6 +572,7 @@ static retcode_t MqttEventHandler_Z(MqttSession_T* session, MqttEvent_t event, c
         break;
     case MQTT_CONNECTION_CLOSED:
         MqttConnectionStatus_Z = false;
+        MqttPublishReset_Z(RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_MQTT_CONNECTION_CLOSED));
         retcode = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_MQTT_CONNECTION_CLOSED);
         break;
     case MQTT_SUBSCRIPTION_ACKNOWLEDGED:
@@ -174,21 +598,15 @@ static retcode_t MqttEventHandler_Z(MqttSession_T* session, MqttEvent_t event, c
         HandleEventIncomingPublish_Z(eventData->publish);
         break;
     case MQTT_PUBLISHED_DATA:
-        MqttPublishStatus_Z = true;
-        if (pdTRUE != xSemaphoreGive(MqttPublishHandle_Z))
-        {
-            retcode = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_SEMAPHORE_ERROR);
-        }
+        // the stack may not be entered from its own callback, the next publish is sent by a job
+        MqttPublishAcknowledged_Z();
+        MqttPublishSchedule_Z();
         break;
     case MQTT_PUBLISH_SEND_FAILED:
         case MQTT_PUBLISH_SEND_ACK_FAILED:
         case MQTT_PUBLISH_TIMEOUT:
         LOG_AT_ERROR(("MqttEventHandler_Z: Received Publish failed Event\r\n"));
-        MqttPublishStatus_Z = false;
-        if (pdTRUE != xSemaphoreGive(MqttPublishHandle_Z))
-        {
-            retcode = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_SEMAPHORE_ERROR);
-        }
+        MqttPublishReset_Z(RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_MQTT_PUBLISH_STATUS_ERROR));
         break;
     default:
     	LOG_AT_TRACE(("MqttEventHandler_Z: Unhandled MQTT Event\r\n"));
@@ -207,8 +625,7 @@ static retcode_t MqttEventHandler_Z(MqttSession_T* session, MqttEvent_t event, c
 
 static MQTTBool_t MqttAgentSubscribeCallback_Z(void * pvPublishCallbackContext, const MQTTPublishData_t * const pxPublishData)
 {
-    if ((NULL != IncomingPublishNotificationCB_Z) &&
-            (NULL != pvPublishCallbackContext) &&
+    if ((NULL != pvPublishCallbackContext) &&
             (NULL != pxPublishData))
     {
         MQTT_SubscribeCBParam_TZ param =
@@ -218,7 +635,7 @@ static MQTTBool_t MqttAgentSubscribeCallback_Z(void * pvPublishCallbackContext,
             .Payload = (const char *) pxPublishData->pvData,
             .PayloadLength = pxPublishData->ulDataLength
         };
-        IncomingPublishNotificationCB_Z(param);
+        MqttRouteIncoming_Z(param);
     }
 
     return eMQTTFalse; /* Returning eMQTTFalse will free the buffer */
@@ -277,9 +694,34 @@ Retcode_T MQTT_Setup_Z(MQTT_Setup_TZ * setup)
 			}
 		}
 
+        if (RETCODE_OK == retcode)
+        {
+            MqttPublishTimer_Z = xTimerCreate((const char * const ) "MqttPublish", pdMS_TO_TICKS(MQTT_PUBLISH_TICK_IN_MS), pdTRUE, NULL, MqttPublishTimerCallback_Z);
+            if (NULL == MqttPublishTimer_Z)
+            {
+                vSemaphoreDelete(MqttSubscribeHandle_Z);
+                vSemaphoreDelete(MqttPublishHandle_Z);
+                vSemaphoreDelete(MqttSendHandle_Z);
+                vSemaphoreDelete(MqttConnectHandle_Z);
+                retcode = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_OUT_OF_RESOURCES);
+            }
+        }
+
         if (RETCODE_OK == retcode)
         {
             MqttSetupInfo_Z = *setup;
+            MQTTWheel_Init(&MqttPublishWheel_Z);
+            MQTTRouter_Init(&MqttRouter_Z);
+            for (uint8_t index = 0U; index < MQTT_PUBLISH_SLOTS; index++)
+            {
+                memset(&MqttPublishSlots_Z[index], 0x00, sizeof(MqttPublishSlots_Z[index]));
+                MqttPublishSlots_Z[index].Timer.owner = &MqttPublishSlots_Z[index];
+            }
+            // the timer enqueues into the command processor, so it starts after the setup is stored
+            if (pdPASS != xTimerStart(MqttPublishTimer_Z, 0UL))
+            {
+                retcode = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_OUT_OF_RESOURCES);
+            }
         }
     }
     return retcode;
@@ -330,6 +772,12 @@ Retcode_T MQTT_ConnectToBroker_Z(MQTT_Connect_TZ * mqttConnect, uint32_t timeout
 		char mqttBrokerURL[30] = { 0 };
 		char serverIpStringBuffer[16] = { 0 };
 
+		if (MqttPublishBroken_Z && Mqtt_isConnected(&MqttSession_Z))
+		{
+			// the connection is still open but lost an acknowledgement, close it before connecting again
+			LOG_AT_WARNING(("MQTT_ConnectToBroker_Z: Closing connection after failed publish\r\n"));
+			(void) Mqtt_disconnect(&MqttSession_Z);
+		}
 		if (RC_OK != Mqtt_initialize())
 		{
 			retcode = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_MQTT_INIT_FAILED);
@@ -431,26 +879,42 @@ Retcode_T MQTT_ConnectToBroker_Z(MQTT_Connect_TZ * mqttConnect, uint32_t timeout
 
 /** Refer interface header for description */
 Retcode_T MQTT_SubsribeToTopic_Z(MQTT_Subscribe_TZ * subscribe, uint32_t timeout)
+{
+    return MQTT_SubscribeToTopics_Z(subscribe, 1U, timeout, NULL);
+}
+
+/** Refer interface header for description */
+Retcode_T MQTT_SubscribeToTopics_Z(MQTT_Subscribe_TZ * subscribe, uint8_t count, uint32_t timeout, Retcode_T * results)
 {
     Retcode_T retcode = RETCODE_OK;
 
     if (NULL == subscribe)
     {
         retcode = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_NULL_POINTER);
-    }  else {
-		static StringDescr_T subscribeTopicDescription[MQTT_SUBSCRIBE_COUNT];
-		Mqtt_qos_t qos[MQTT_SUBSCRIBE_COUNT];
-
-		StringDescr_wrap(&(subscribeTopicDescription[0]), subscribe->Topic);
-		qos[0] = (Mqtt_qos_t) subscribe->QoS;
+    }
+    else if (0U == count || count > MQTT_SUBSCRIBE_TOPICS)
+    {
+        retcode = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_INVALID_PARAM);
+    }
+    else
+    {
+		// the stack keeps a reference to the topics until the SUBACK arrived
+		static StringDescr_T subscribeTopicDescription[MQTT_SUBSCRIBE_TOPICS];
+		Mqtt_qos_t qos[MQTT_SUBSCRIBE_TOPICS];
 
-		LOG_AT_TRACE(("MQTT_SubsribeToTopic_Z: Subscribing to topic: [%s], Qos: [%d]\r\n", subscribe->Topic, qos[0]));
-		IncomingPublishNotificationCB_Z = subscribe->IncomingPublishNotificationCB;
+		for (uint8_t index = 0U; index < count; index++)
+		{
+			StringDescr_wrap(&(subscribeTopicDescription[index]), subscribe[index].Topic);
+			qos[index] = (Mqtt_qos_t) subscribe[index].QoS;
+			LOG_AT_TRACE(("MQTT_SubscribeToTopics_Z: Subscribing to topic: [%s], Qos: [%d]\r\n", subscribe[index].Topic, qos[index]));
+			// routed before the SUBACK, retained messages may follow it right away
+			MqttRouteAdd_Z(&subscribe[index]);
+		}
 		MqttSubscriptionStatus_Z = false;
 		/* This is a dummy take. In case of any callback received
 		 * after the previous timeout will be cleared here. */
 		(void) xSemaphoreTake(MqttSubscribeHandle_Z, 0UL);
-		if (RC_OK != Mqtt_subscribe(&MqttSession_Z, MQTT_SUBSCRIBE_COUNT, subscribeTopicDescription, qos))
+		if (RC_OK != Mqtt_subscribe(&MqttSession_Z, count, subscribeTopicDescription, qos))
 		{
 			retcode = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_MQTT_SUBSCRIBE_FAILED);
 		}
@@ -469,6 +933,15 @@ Retcode_T MQTT_SubsribeToTopic_Z(MQTT_Subscribe_TZ * subscribe, uint32_t timeout
 				}
 			}
 		}
+
+		if (NULL != results)
+		{
+			// the stack reports one event per SUBACK, not the return code of each topic
+			for (uint8_t index = 0U; index < count; index++)
+			{
+				results[index] = retcode;
+			}
+		}
     }
     return retcode;
 }
@@ -484,35 +957,71 @@ Retcode_T MQTT_PublishToTopic_Z(MQTT_Publish_TZ * publish, uint32_t timeout)
     }
     else
     {
-		static StringDescr_T publishTopicDescription;
-		StringDescr_wrap(&publishTopicDescription, publish->Topic);
-
-		MqttPublishStatus_Z = false;
-		/* This is a dummy take. In case of any callback received
-		 * after the previous timeout will be cleared here. */
-		(void) xSemaphoreTake(MqttPublishHandle_Z, 0UL);
-		if (RC_OK != Mqtt_publish(&MqttSession_Z, publishTopicDescription, publish->Payload, publish->PayloadLength, (uint8_t) publish->QoS, false))
-		{
-			retcode = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_MQTT_PUBLISH_FAILED);
-		}
-		if (RETCODE_OK == retcode)
-		{
-			if (pdTRUE != xSemaphoreTake(MqttPublishHandle_Z, pdMS_TO_TICKS(timeout)))
-			{
-				retcode = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_MQTT_PUBLISH_CB_NOT_RECEIVED);
-			}
-			else
-			{
-				if (true != MqttPublishStatus_Z)
-				{
-					retcode = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_MQTT_PUBLISH_STATUS_ERROR);
-				}
-			}
-		}
+        uint32_t awaited = MqttPublishAwaited_Z + 1UL;
+        MqttPublishAwaited_Z = awaited;
+        /* This is a dummy take. In case of any callback received
+         * after the previous timeout will be cleared here. */
+        (void) xSemaphoreTake(MqttPublishHandle_Z, 0UL);
+        // without retry, so the publish completes within its timeout even if the connection is lost
+        if (MQTT_PUBLISH_HANDLE_INVALID == MqttPublishQueue_Z(publish, timeout, MqttPublishAwaitedCB_Z, (void *) (uintptr_t) awaited, false))
+        {
+            retcode = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_OUT_OF_RESOURCES);
+        }
+        if (RETCODE_OK == retcode)
+        {
+            MqttPublishSchedule_Z();
+            if (pdTRUE != xSemaphoreTake(MqttPublishHandle_Z, pdMS_TO_TICKS(timeout + MQTT_PUBLISH_GRACE_IN_MS)))
+            {
+                LOG_AT_ERROR(("MQTT_PublishToTopic_Z: Publish did not complete\r\n"));
+                retcode = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_MQTT_PUBLISH_CB_NOT_RECEIVED);
+            }
+            else
+            {
+                retcode = MqttPublishResult_Z;
+            }
+        }
     }
 
     return retcode;
 }
+
+/** Refer interface header for description */
+MQTT_PublishHandle_TZ MQTT_PublishToTopicAsync_Z(MQTT_Publish_TZ * publish, uint32_t timeout, MQTT_PublishCB_TZ callback, void * context)
+{
+    MQTT_PublishHandle_TZ handle = MQTT_PUBLISH_HANDLE_INVALID;
+
+    if (NULL != publish)
+    {
+        handle = MqttPublishQueue_Z(publish, timeout, callback, context, true);
+        if (MQTT_PUBLISH_HANDLE_INVALID != handle)
+        {
+            MqttPublishSchedule_Z();
+        }
+    }
+    return handle;
+}
+
+/** Refer interface header for description */
+void MQTT_SetPublishWindow_Z(uint8_t window)
+{
+    if (window < 1U)
+    {
+        window = 1U;
+    }
+    MqttPublishWindow_Z = (window > MQTT_PUBLISH_SLOTS) ? MQTT_PUBLISH_SLOTS : window;
+}
+
+/** Refer interface header for description */
+void MQTT_PublishAbort_Z(void)
+{
+    // stops sending right away, the slots are completed by the command processor
+    MqttPublishBroken_Z = true;
+    if (RETCODE_OK != CmdProcessor_Enqueue(MqttSetupInfo_Z.CmdProcessorHandle, MqttPublishAbortJob_Z, NULL, 0UL))
+    {
+        LOG_AT_ERROR(("MQTT_PublishAbort_Z: Failed to enqueue abort\r\n"));
+    }
+}
+
 /** Refer interface header for description */
 Retcode_T MQTT_UnSubsribeFromTopic_Z(MQTT_Subscribe_TZ * subscribe, uint32_t timeout)
 {
@@ -530,7 +1039,7 @@ Retcode_T MQTT_UnSubsribeFromTopic_Z(MQTT_Subscribe_TZ * subscribe, uint32_t tim
 		qos[0] = (Mqtt_qos_t) subscribe->QoS;
 
 		LOG_AT_TRACE(("MQTT_UnSubsribeFromTopic_Z: Unsubscribing from topic: [%s], Qos: [%d]\r\n", subscribe->Topic, qos[0]));
-		IncomingPublishNotificationCB_Z = subscribe->IncomingPublishNotificationCB;
+		MqttRouteRemove_Z(subscribe);
 		MqttSubscriptionStatus_Z = false;
 		/* This is a dummy take. In case of any callback received
 		 * after the previous timeout will be cleared here. */
@@ -563,7 +1072,8 @@ Retcode_T MQTT_UnSubsribeFromTopic_Z(MQTT_Subscribe_TZ * subscribe, uint32_t tim
 Retcode_T MQTT_IsConnected_Z(void)
 {
 	Retcode_T retcode = RETCODE_OK;
-	if (false == Mqtt_isConnected(&MqttSession_Z))
+	// after a lost acknowledgement the connection is given up, see MqttPublishReset_Z
+	if (false == Mqtt_isConnected(&MqttSession_Z) || MqttPublishBroken_Z)
 	{
 		retcode = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_MQTT_DISCONNECT);
 	}
@@ -122,9 +122,9 @@ typedef void (*MQTT_SubscribeCB_TZ)(MQTT_SubscribeCBParam_TZ param);
  */
 struct MQTT_Subscribe_SZ
 {
-    const char * Topic; /**< The MQTT topic for which the messages are to be subscribed */
+    const char * Topic; /**< The MQTT topic filter for which the messages are to be subscribed, may contain '+' and '#'. Must stay valid until it is unsubscribed */
     uint32_t QoS; /**< The MQTT Quality of Service level. If 0, the message is send in a fire and forget way and it will arrive at most once. If 1 Message reception is acknowledged by the other side, retransmission could occur. */
-    MQTT_SubscribeCB_TZ IncomingPublishNotificationCB; /**< The function to be called upon receiving incoming MQTT messages. Can be NULL. */
+    MQTT_SubscribeCB_TZ IncomingPublishNotificationCB; /**< The function to be called upon receiving incoming MQTT messages matching the topic. Can be NULL. */
 };
 
 /**
@@ -132,6 +132,45 @@ struct MQTT_Subscribe_SZ
  */
 typedef struct MQTT_Subscribe_SZ MQTT_Subscribe_TZ;
 
+/**
+ * @brief   Number of topics that can be subscribed with one SUBSCRIBE packet.
+ */
+#define MQTT_SUBSCRIBE_TOPICS               UINT8_C(4)
+
+/**
+ * @brief   Number of publishes that can be queued, sent or completed at the same time.
+ */
+#define MQTT_PUBLISH_SLOTS                  UINT8_C(8)
+
+/**
+ * @brief   Number of times a queued publish is sent before it completes with an error.
+ */
+#define MQTT_PUBLISH_ATTEMPTS               UINT8_C(3)
+
+/**
+ * @brief   Handle of a queued publish, never #MQTT_PUBLISH_HANDLE_INVALID.
+ */
+typedef uint32_t MQTT_PublishHandle_TZ;
+
+/**
+ * @brief   Handle returned if a publish could not be queued.
+ */
+#define MQTT_PUBLISH_HANDLE_INVALID         UINT32_C(0)
+
+/**
+ * @brief   Typedef to the function to be called when a queued publish completed.
+ *
+ * @param[in] handle
+ * Handle returned when the publish was queued
+ *
+ * @param[in] context
+ * Context given when the publish was queued
+ *
+ * @param[in] result
+ * RETCODE_OK if the publish was delivered, or an error code otherwise.
+ */
+typedef void (*MQTT_PublishCB_TZ)(MQTT_PublishHandle_TZ handle, void * context, Retcode_T result);
+
 /**
  * @brief This will setup the MQTT
  *
@@ -200,6 +239,28 @@ Retcode_T MQTT_ConnectToBroker_Z(MQTT_Connect_TZ * mqttConnect, uint32_t timeout
  */
 Retcode_T MQTT_SubsribeToTopic_Z(MQTT_Subscribe_TZ * subscribe, uint32_t timeout);
 
+/**
+ * @brief This will subscribe to several MQTT topics with one SUBSCRIBE packet
+ *
+ * The broker answers all topics with one SUBACK, so a list of topics takes a
+ * single round trip instead of one per topic.
+ *
+ * @param[in] subscribe
+ * Array of MQTT subscribe features, each with its own QoS
+ *
+ * @param[in] count
+ * Number of topics, 1 up to #MQTT_SUBSCRIBE_TOPICS
+ *
+ * @param[in] timeout
+ * Timeout in milli-second to await the SUBACK
+ *
+ * @param[out] results
+ * Array of count results, one for each topic, can be NULL
+ *
+ * @return  RETCODE_OK if all topics were subscribed, or an error code otherwise.
+ */
+Retcode_T MQTT_SubscribeToTopics_Z(MQTT_Subscribe_TZ * subscribe, uint8_t count, uint32_t timeout, Retcode_T * results);
+
 /**
  * @brief This will publish to a MQTT topic
  *
@@ -210,9 +271,59 @@ Retcode_T MQTT_SubsribeToTopic_Z(MQTT_Subscribe_TZ * subscribe, uint32_t timeout
  * Timeout in milli-second to await successful publication
  *
  * @return  RETCODE_OK on success, or an error code otherwise.
+ *
+ * @note
+ * - The publish is queued behind other publishes, see #MQTT_PublishToTopicAsync_Z.
+ * - Do not call this API from the command processor of #MQTT_Setup_TZ, it waits for that processor.
  */
 Retcode_T MQTT_PublishToTopic_Z(MQTT_Publish_TZ * publish, uint32_t timeout);
 
+/**
+ * @brief This will set how many QoS 1 publishes may wait for their PUBACK at the same time
+ *
+ * QoS 0 publishes are always sent one after the other.
+ *
+ * @param[in] window
+ * Number of unacknowledged publishes, 1 up to #MQTT_PUBLISH_SLOTS
+ */
+void MQTT_SetPublishWindow_Z(uint8_t window);
+
+/**
+ * @brief This will queue a publish to a MQTT topic without waiting for it
+ *
+ * The publish is sent as soon as the window allows. If the connection breaks
+ * before it was acknowledged, it is sent again after the next successful
+ * #MQTT_ConnectToBroker_Z, up to #MQTT_PUBLISH_ATTEMPTS times. Publishes are
+ * sent in the order they were queued. A publish still waiting to be sent
+ * #MQTT_PUBLISH_ATTEMPTS times the timeout after it was queued, e.g. because
+ * no connection came up, completes with RETCODE_MQTT_PUBLISH_CB_NOT_RECEIVED.
+ *
+ * @param[in] publish
+ * Pointer to the MQTT publish feature, topic and payload must stay valid until the publish completed
+ *
+ * @param[in] timeout
+ * Timeout in milli-second to await the acknowledgement after sending
+ *
+ * @param[in] callback
+ * Called with the result when the publish completed, can be NULL
+ *
+ * @param[in] context
+ * Passed to the callback
+ *
+ * @return  handle of the queued publish, or #MQTT_PUBLISH_HANDLE_INVALID if no slot is free.
+ *
+ * @note
+ * - The callback runs in the command processor of #MQTT_Setup_TZ, it must not block.
+ */
+MQTT_PublishHandle_TZ MQTT_PublishToTopicAsync_Z(MQTT_Publish_TZ * publish, uint32_t timeout, MQTT_PublishCB_TZ callback, void * context);
+
+/**
+ * @brief This will complete all queued publishes with an error, e.g. when the network is lost
+ *
+ * The callbacks are called in the command processor of #MQTT_Setup_TZ.
+ */
+void MQTT_PublishAbort_Z(void);
+
 /**
  * @brief This will unsubscribe to a MQTT topic
  *
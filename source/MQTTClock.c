@@ -0,0 +1,134 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	MQTTClock.c
+ **
+ **	DESCRIPTION:	Source Code for the Cumulocity MQTT Client for the Bosch XDK
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* system header files */
+#include <string.h>
+#include <time.h>
+
+/* own header files */
+#include "AppController.h"
+#include "MQTTClock.h"
+#include "MQTTFormat.h"
+
+/* additional interface header files */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "XDK_SNTP.h"
+#include "XDK_TimeStamp.h"
+
+/* constant definitions ***************************************************** */
+
+#define MQTTCLOCK_MIN_EPOCH			UINT64_C(1546300800)	/**< 2019-01-01, earlier times are not synchronized */
+#define MQTTCLOCK_SECOND_LENGTH		UINT8_C(19)				/**< Length of "2019-05-01T12:00:00" */
+
+/* local variables ********************************************************** */
+
+static bool synchronized = false;
+static uint64_t anchorMs = 0ULL;
+static TickType_t anchorTick = 0UL;
+
+/* the date and time of the last formatted second, only the milliseconds change within a second */
+static uint64_t cachedSecond = 0ULL;
+static char cachedTime[MQTTCLOCK_SECOND_LENGTH + 1];
+
+/* global variables ********************************************************* */
+
+/* local functions ********************************************************** */
+
+/**
+ * @brief Write "YYYY-MM-DDTHH:MM:SS" of a second since 1970 into the cache
+ */
+static void MQTTClock_FormatSecond(uint64_t second) {
+	struct tm time;
+	MQTTBuffer_Payload_T buffer = { 0UL, sizeof(cachedTime), cachedTime };
+	MQTTFormat_Line_T line;
+
+	TimeStamp_SecsToTm(second, &time);
+	MQTTFormat_BeginLine(&line, &buffer);
+	MQTTFormat_UIntPadded(&line, (uint32_t) time.tm_year + 1900UL, 4U);
+	MQTTFormat_Char(&line, '-');
+	MQTTFormat_UIntPadded(&line, (uint32_t) time.tm_mon + 1UL, 2U);
+	MQTTFormat_Char(&line, '-');
+	MQTTFormat_UIntPadded(&line, (uint32_t) time.tm_mday, 2U);
+	MQTTFormat_Char(&line, 'T');
+	MQTTFormat_UIntPadded(&line, (uint32_t) time.tm_hour, 2U);
+	MQTTFormat_Char(&line, ':');
+	MQTTFormat_UIntPadded(&line, (uint32_t) time.tm_min, 2U);
+	MQTTFormat_Char(&line, ':');
+	MQTTFormat_UIntPadded(&line, (uint32_t) time.tm_sec, 2U);
+	cachedTime[buffer.length] = '\0';
+	cachedSecond = second;
+}
+
+/* global functions ********************************************************* */
+
+bool MQTTClock_Sync(void) {
+	uint64_t start = 0ULL;
+	uint64_t second = 0ULL;
+	uint32_t timeLapseInMs = 0UL;
+
+	if (RETCODE_OK != SNTP_GetTimeFromSystem(&start, &timeLapseInMs)
+			|| start < MQTTCLOCK_MIN_EPOCH) {
+		LOG_AT_WARNING(("MQTTClock: System time not synchronized, no sample times\r\n"));
+		synchronized = false;
+		return false;
+	}
+
+	// wait for the next second to start, so the anchor is exact to a tick
+	TickType_t begin = xTaskGetTickCount();
+	do {
+		vTaskDelay(1UL);
+		SNTP_GetTimeFromSystem(&second, &timeLapseInMs);
+	} while (second == start && (xTaskGetTickCount() - begin) < pdMS_TO_TICKS(1100UL));
+
+	anchorTick = xTaskGetTickCount();
+	anchorMs = second * 1000ULL;
+	synchronized = true;
+	return true;
+}
+
+bool MQTTClock_IsSynchronized(void) {
+	return synchronized;
+}
+
+uint64_t MQTTClock_ToEpochMs(uint32_t tick) {
+	// samples can be older than the anchor
+	int32_t elapsed = (int32_t) ((TickType_t) tick - anchorTick);
+	return anchorMs + (uint64_t) ((int64_t) elapsed * (int64_t) portTICK_PERIOD_MS);
+}
+
+bool MQTTClock_Format(uint32_t tick, char * time) {
+	if (synchronized == false) {
+		time[0] = '\0';
+		return false;
+	}
+
+	uint64_t epochMs = MQTTClock_ToEpochMs(tick);
+	uint64_t second = epochMs / 1000ULL;
+	if (second != cachedSecond) {
+		MQTTClock_FormatSecond(second);
+	}
+
+	MQTTBuffer_Payload_T buffer = { 0UL, MQTTCLOCK_TIME_SIZE, time };
+	MQTTFormat_Line_T line;
+	MQTTFormat_BeginLine(&line, &buffer);
+	MQTTFormat_Text(&line, cachedTime);
+	MQTTFormat_Char(&line, '.');
+	MQTTFormat_UIntPadded(&line, (uint32_t) (epochMs % 1000ULL), 3U);
+	MQTTFormat_Char(&line, 'Z');
+	time[buffer.length] = '\0';
+	return true;
+}
@@ -0,0 +1,63 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	MQTTClock.h
+ **
+ **	DESCRIPTION:	Source Code for the Cumulocity MQTT Client for the Bosch XDK
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* header definition ******************************************************** */
+#ifndef MQTTCLOCK_H_
+#define MQTTCLOCK_H_
+
+/* local interface declaration ********************************************** */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* local type and macro definitions */
+
+#define MQTTCLOCK_TIME_SIZE			UINT8_C(25)	/**< Size of "2019-05-01T12:00:00.123Z" including the terminating zero */
+
+/* global function prototype declarations */
+
+/**
+ * @brief Anchor the tick count to the SNTP synchronized system time
+ *
+ * The system time only has a resolution of seconds, so the anchor is taken
+ * right after the next second starts. This blocks for up to one second.
+ *
+ * @return true if the system time is synchronized
+ */
+bool MQTTClock_Sync(void);
+
+/**
+ * @brief true if the last MQTTClock_Sync found a synchronized system time
+ */
+bool MQTTClock_IsSynchronized(void);
+
+/**
+ * @brief Milliseconds since 1970 at the given tick count
+ */
+uint64_t MQTTClock_ToEpochMs(uint32_t tick);
+
+/**
+ * @brief Write the time of a tick count in ISO 8601 with milliseconds, as used for $.time
+ *
+ * @param[in] tick tick count, e.g. when a sample was taken
+ * @param[out] time buffer of at least MQTTCLOCK_TIME_SIZE characters
+ *
+ * @return false if the clock is not synchronized, time is empty then
+ */
+bool MQTTClock_Format(uint32_t tick, char * time);
+
+/* global inline function definitions */
+
+#endif /* MQTTCLOCK_H_ */
@@ -0,0 +1,210 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	MQTTCommand.c
+ **
+ **	DESCRIPTION:	Source Code for the Cumulocity MQTT Client for the Bosch XDK
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* system header files */
+#include <stddef.h>
+#include <string.h>
+
+/* own header files */
+#include "MQTTCommand.h"
+
+/* constant definitions ***************************************************** */
+
+/* records start at a multiple of 4, the template is read in place */
+#define MQTTCOMMAND_ALIGN(bytes)	(((bytes) + 3UL) & ~3UL)
+
+#define MQTTCOMMAND_SEED			UINT32_C(153767)	/**< Makes the hash of the command table perfect */
+
+/* local variables ********************************************************** */
+
+/* global variables ********************************************************* */
+
+/* local functions ********************************************************** */
+
+/**
+ * @brief Take the next field of a line, separators in front of it and the one behind it are skipped
+ *
+ * @return false if the line has no field left
+ */
+static bool MQTTCommand_NextField(MQTTCommand_Token_T * rest, char separator, MQTTCommand_Token_T * field) {
+	const char * position = rest->start;
+	const char * end = rest->start + rest->length;
+
+	while (position < end && (*position == ',' || *position == separator)) {
+		position++;
+	}
+	field->start = position;
+	while (position < end && *position != ',' && *position != separator) {
+		position++;
+	}
+	field->length = (uint32_t) (position - field->start);
+	// the separator that ended the field is consumed like strtok did, a ':' behind the template is no field
+	if (position < end) {
+		position++;
+	}
+	rest->start = position;
+	rest->length = (uint32_t) (end - position);
+	return field->length > 0UL;
+}
+
+/**
+ * @brief Bytes a command takes in a queue
+ */
+static uint32_t MQTTCommand_RecordSize(const MQTTCommand_T * command) {
+	return MQTTCOMMAND_ALIGN((uint32_t) offsetof(MQTTCommand_T, text) + (uint32_t) command->length);
+}
+
+/* global functions ********************************************************* */
+
+bool MQTTCommand_NextLine(const char ** cursor, const char * end, MQTTCommand_Token_T * line) {
+	const char * position = *cursor;
+
+	while (position < end) {
+		const char * start = position;
+		while (position < end && *position != '\n') {
+			position++;
+		}
+		line->start = start;
+		line->length = (uint32_t) (position - start);
+		if (position < end) {
+			// skip the '\n'
+			position++;
+		}
+		if (line->length > 0UL && start[line->length - 1UL] == '\r') {
+			line->length--;
+		}
+		if (line->length > 0UL) {
+			*cursor = position;
+			return true;
+		}
+	}
+	*cursor = position;
+	return false;
+}
+
+bool MQTTCommand_Parse(const char * line, uint32_t length, MQTTCommand_T * command) {
+	MQTTCommand_Token_T rest = { line, length };
+	MQTTCommand_Token_T field;
+
+	memset(command, 0x00, sizeof(*command));
+	if (MQTTCommand_NextField(&rest, ':', &field)) {
+		for (uint32_t i = 0UL; i < field.length; i++) {
+			const uint16_t digit = (uint16_t) (field.start[i] - '0');
+			// no wrap around, 65536 is not a template
+			if (field.start[i] < '0' || field.start[i] > '9' || command->template > (UINT16_MAX - digit) / 10U) {
+				command->template = 0U;
+				break;
+			}
+			command->template = (uint16_t) (command->template * 10U + digit);
+		}
+	}
+	// the device id is not needed
+	(void) MQTTCommand_NextField(&rest, ' ', &field);
+
+	// no command uses more arguments, further fields are ignored like before
+	while (command->count < MQTTCOMMAND_ARGS && MQTTCommand_NextField(&rest, ' ', &field)) {
+		if (field.length >= (uint32_t) (MQTTCOMMAND_TEXT_SIZE - command->length)) {
+			return false;
+		}
+		command->offsets[command->count++] = command->length;
+		memcpy(&command->text[command->length], field.start, field.length);
+		command->length = (uint8_t) (command->length + field.length + 1UL);
+	}
+	return true;
+}
+
+const char * MQTTCommand_Arg(const MQTTCommand_T * command, uint8_t index) {
+	return (index < command->count) ? &command->text[command->offsets[index]] : "";
+}
+
+uint8_t MQTTCommand_Slot(uint16_t template, const char * name) {
+	uint32_t hash = UINT32_C(2166136261);
+	while (*name != '\0') {
+		hash ^= (uint8_t) *name++;
+		hash *= UINT32_C(16777619);
+	}
+	// the top 5 bits, MQTTCOMMAND_SLOTS is 32
+	return (uint8_t) (((hash ^ template) * MQTTCOMMAND_SEED) >> 27);
+}
+
+void MQTTCommand_QueueInit(MQTTCommand_Queue_T * queue, void * storage, uint32_t size, uint8_t depth) {
+	queue->storage = (uint8_t *) storage;
+	queue->size = size & ~3UL;
+	queue->head = 0UL;
+	queue->tail = 0UL;
+	queue->wrap = queue->size;
+	queue->count = 0U;
+	queue->highWater = 0U;
+	queue->rejected = 0UL;
+	MQTTCommand_QueueSetDepth(queue, depth);
+}
+
+void MQTTCommand_QueueSetDepth(MQTTCommand_Queue_T * queue, uint8_t depth) {
+	queue->depth = (depth > 0U) ? depth : 1U;
+}
+
+bool MQTTCommand_QueuePush(MQTTCommand_Queue_T * queue, const MQTTCommand_T * command) {
+	uint32_t need = MQTTCommand_RecordSize(command);
+	uint32_t offset;
+
+	if (queue->count >= queue->depth) {
+		queue->rejected++;
+		return false;
+	}
+	if (queue->count == 0U) {
+		queue->head = 0UL;
+		queue->tail = 0UL;
+		queue->wrap = queue->size;
+	}
+	// the records wrapped if head is in front of tail, head equals tail only while the queue is empty
+	if (queue->head >= queue->tail && queue->size - queue->head >= need) {
+		offset = queue->head;
+	} else if (queue->head >= queue->tail && queue->tail > need) {
+		queue->wrap = queue->head;
+		offset = 0UL;
+	} else if (queue->head < queue->tail && queue->tail - queue->head > need) {
+		offset = queue->head;
+	} else {
+		queue->rejected++;
+		return false;
+	}
+	// the padding of the record is not copied, it may lie behind the command
+	memcpy(&queue->storage[offset], command, (size_t) offsetof(MQTTCommand_T, text) + command->length);
+	queue->head = offset + need;
+	queue->count++;
+	if (queue->count > queue->highWater) {
+		queue->highWater = queue->count;
+	}
+	return true;
+}
+
+const MQTTCommand_T * MQTTCommand_QueuePeek(const MQTTCommand_Queue_T * queue) {
+	return (queue->count > 0U) ? (const MQTTCommand_T *) (const void *) &queue->storage[queue->tail] : NULL;
+}
+
+void MQTTCommand_QueueDiscard(MQTTCommand_Queue_T * queue) {
+	const MQTTCommand_T * command = MQTTCommand_QueuePeek(queue);
+
+	if (command == NULL) {
+		return;
+	}
+	queue->tail += MQTTCommand_RecordSize(command);
+	queue->count--;
+	if (queue->count == 0U || queue->tail == queue->wrap) {
+		queue->tail = 0UL;
+		queue->wrap = queue->size;
+	}
+}
@@ -0,0 +1,159 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	MQTTCommand.h
+ **
+ **	DESCRIPTION:	Source Code for the Cumulocity MQTT Client for the Bosch XDK
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* header definition ******************************************************** */
+#ifndef MQTTCOMMAND_H_
+#define MQTTCOMMAND_H_
+
+/* local interface declaration ********************************************** */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* local type and macro definitions */
+
+#define MQTTCOMMAND_ARGS			UINT8_C(3)		/**< Arguments of a command after template and device id */
+#define MQTTCOMMAND_TEXT_SIZE		UINT8_C(255)	/**< Bytes for the arguments including their terminators */
+#define MQTTCOMMAND_SLOTS			UINT8_C(32)		/**< Slots of a command table indexed by MQTTCommand_Slot */
+
+/**
+ * @brief A part of a payload, not terminated
+ */
+typedef struct {
+	const char * start; /**< first character */
+	uint32_t length; /**< number of characters */
+} MQTTCommand_Token_T;
+
+/**
+ * @brief One SmartREST operation line as typed record, e.g. "511,XDK,speed 1000"
+ *
+ * The device id is dropped, the arguments are copied behind each other into
+ * text, each one terminated, so the record does not point into the payload
+ * it was parsed from.
+ */
+typedef struct {
+	uint16_t template; /**< number of the SmartREST template, 0 if the line does not start with one */
+	uint8_t count; /**< number of arguments */
+	uint8_t length; /**< bytes of text used */
+	uint8_t offsets[MQTTCOMMAND_ARGS]; /**< start of each argument in text */
+	char text[MQTTCOMMAND_TEXT_SIZE]; /**< the arguments */
+} MQTTCommand_T;
+
+/**
+ * @brief Queue of commands, each one stored with only the text it uses
+ *
+ * The records are placed behind each other in a byte ring, a record that
+ * does not fit at the end of the storage starts at its beginning again.
+ * The queue holds at most depth records however short they are. The queue
+ * is not thread safe, pushing and discarding have to be serialized by the
+ * caller. A record returned by MQTTCommand_QueuePeek stays valid until it
+ * is discarded.
+ */
+typedef struct {
+	uint8_t * storage; /**< memory of the records */
+	uint32_t size; /**< bytes of storage, multiple of 4 */
+	uint32_t head; /**< offset of the next record */
+	uint32_t tail; /**< offset of the oldest record */
+	uint32_t wrap; /**< end of the records behind tail while head is in front of it */
+	uint8_t count; /**< records in the queue */
+	uint8_t depth; /**< records the queue holds at most */
+	uint8_t highWater; /**< maximum count seen */
+	uint32_t rejected; /**< commands not queued because the queue was full */
+} MQTTCommand_Queue_T;
+
+/* global function prototype declarations */
+
+/**
+ * @brief Take the next line of a payload, lines end with "\n" or "\r\n"
+ *
+ * @param[in,out] cursor position in the payload, moved behind the line
+ * @param[in] end end of the payload
+ * @param[out] line the line without its end, empty lines are skipped
+ *
+ * @return false if there is no line left
+ */
+bool MQTTCommand_NextLine(const char ** cursor, const char * end, MQTTCommand_Token_T * line);
+
+/**
+ * @brief Parse a SmartREST line into a command
+ *
+ * The fields are split like before: the template ends at ',' or ':', all
+ * other fields at ',' or ' ', empty fields are skipped. Fields behind
+ * MQTTCOMMAND_ARGS arguments are ignored.
+ *
+ * @return true if the line was parsed, false if the arguments do not fit into the text of a command
+ */
+bool MQTTCommand_Parse(const char * line, uint32_t length, MQTTCommand_T * command);
+
+/**
+ * @brief Argument of a command
+ *
+ * @return the terminated argument, or "" if the command has less arguments
+ */
+const char * MQTTCommand_Arg(const MQTTCommand_T * command, uint8_t index);
+
+/**
+ * @brief Slot of a command in a table of MQTTCOMMAND_SLOTS entries
+ *
+ * FNV-1a hash of the sub command mixed with the template. The seed is
+ * chosen so that all commands of the table in MQTTOperation get a slot of
+ * their own, a new command may need a new seed.
+ *
+ * @param[in] template number of the SmartREST template
+ * @param[in] name sub command, "" for templates without one
+ *
+ * @return the slot, below MQTTCOMMAND_SLOTS
+ */
+uint8_t MQTTCommand_Slot(uint16_t template, const char * name);
+
+/**
+ * @brief Initialize an empty queue on the given storage
+ *
+ * @param[in] storage memory of the records, aligned to 4 bytes
+ * @param[in] size bytes of storage, rounded down to a multiple of 4
+ * @param[in] depth records the queue holds at most, at least 1
+ */
+void MQTTCommand_QueueInit(MQTTCommand_Queue_T * queue, void * storage, uint32_t size, uint8_t depth);
+
+/**
+ * @brief Change the records the queue holds at most, queued records are kept
+ */
+void MQTTCommand_QueueSetDepth(MQTTCommand_Queue_T * queue, uint8_t depth);
+
+/**
+ * @brief Copy a command into the queue
+ *
+ * @return false if the queue is full (rejected is counted)
+ */
+bool MQTTCommand_QueuePush(MQTTCommand_Queue_T * queue, const MQTTCommand_T * command);
+
+/**
+ * @brief Oldest command without removing it
+ *
+ * Only the text the command uses is stored, the record is shorter than
+ * MQTTCommand_T.
+ *
+ * @return the command or NULL if the queue is empty
+ */
+const MQTTCommand_T * MQTTCommand_QueuePeek(const MQTTCommand_Queue_T * queue);
+
+/**
+ * @brief Remove the command returned by MQTTCommand_QueuePeek
+ */
+void MQTTCommand_QueueDiscard(MQTTCommand_Queue_T * queue);
+
+/* global inline function definitions */
+
+#endif /* MQTTCOMMAND_H_ */
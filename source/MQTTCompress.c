@@ -0,0 +1,125 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	MQTTCompress.c
+ **
+ **	DESCRIPTION:	Source Code for the Cumulocity MQTT Client for the Bosch XDK
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* system header files */
+#include <string.h>
+
+/* own header files */
+#include "MQTTCompress.h"
+
+/* constant definitions ***************************************************** */
+
+#define MQTTCOMPRESS_HASH_SIZE		(UINT32_C(1) << MQTTCOMPRESS_HASH_BITS)
+#define MQTTCOMPRESS_EMPTY			UINT16_C(0xFFFF)	/**< Hash entry without a position */
+
+/* local variables ********************************************************** */
+
+/* last position of each hashed 3 byte sequence */
+static uint16_t head[MQTTCOMPRESS_HASH_SIZE];
+
+/* global variables ********************************************************* */
+
+/* local functions ********************************************************** */
+
+static uint32_t MQTTCompress_Hash(const uint8_t * data) {
+	uint32_t value = ((uint32_t) data[0] << 16) | ((uint32_t) data[1] << 8) | (uint32_t) data[2];
+	return (value * UINT32_C(2654435761)) >> (32U - MQTTCOMPRESS_HASH_BITS);
+}
+
+/**
+ * @brief Remember a position and return the previous one with the same hash
+ */
+static uint32_t MQTTCompress_Insert(const uint8_t * data, uint32_t position) {
+	uint32_t hash = MQTTCompress_Hash(data + position);
+	uint32_t candidate = head[hash];
+	head[hash] = (uint16_t) position;
+	return candidate;
+}
+
+/* global functions ********************************************************* */
+
+bool MQTTCompress_Payload(MQTTBuffer_Payload_T * payload, MQTTBuffer_Payload_T * scratch) {
+	const uint8_t * in = (const uint8_t *) payload->data;
+	uint8_t * out = (uint8_t *) scratch->data;
+	const uint32_t length = payload->length;
+	// only a smaller result is used, which also bounds the writes into scratch
+	const uint32_t limit = (scratch->size < length) ? scratch->size : length;
+	uint32_t written = 0UL;
+	uint32_t flags = 0UL;
+	uint8_t flagBit = 8U;
+
+	if (length <= MQTTCOMPRESS_MIN_MATCH || length >= MQTTCOMPRESS_EMPTY || limit == 0UL
+			|| in[0] == MQTTCOMPRESS_MAGIC) {
+		return false;
+	}
+	memset(head, 0xFF, sizeof(head));
+	out[written++] = MQTTCOMPRESS_MAGIC;
+
+	for (uint32_t position = 0UL; position < length;) {
+		if (flagBit == 8U) {
+			if (written >= limit) {
+				return false;
+			}
+			flags = written;
+			out[written++] = 0U;
+			flagBit = 0U;
+		}
+
+		uint32_t matchLength = 0UL;
+		uint32_t distance = 0UL;
+		if (position + MQTTCOMPRESS_MIN_MATCH <= length) {
+			uint32_t candidate = MQTTCompress_Insert(in, position);
+			if (candidate != MQTTCOMPRESS_EMPTY && position - candidate <= MQTTCOMPRESS_WINDOW) {
+				uint32_t longest = length - position;
+				if (longest > MQTTCOMPRESS_MAX_MATCH) {
+					longest = MQTTCOMPRESS_MAX_MATCH;
+				}
+				while (matchLength < longest && in[candidate + matchLength] == in[position + matchLength]) {
+					matchLength++;
+				}
+				distance = position - candidate;
+			}
+		}
+
+		if (matchLength >= MQTTCOMPRESS_MIN_MATCH) {
+			if (written + 2UL > limit) {
+				return false;
+			}
+			out[flags] |= (uint8_t) (1U << flagBit);
+			out[written++] = (uint8_t) ((distance - 1UL) & 0xFFUL);
+			out[written++] = (uint8_t) (((distance - 1UL) >> 8) | ((matchLength - MQTTCOMPRESS_MIN_MATCH) << 3));
+			// the positions within the match are remembered as well, later repetitions start there too
+			for (uint32_t next = position + 1UL; next < position + matchLength
+					&& next + MQTTCOMPRESS_MIN_MATCH <= length; next++) {
+				(void) MQTTCompress_Insert(in, next);
+			}
+			position += matchLength;
+		} else {
+			if (written >= limit) {
+				return false;
+			}
+			out[written++] = in[position++];
+		}
+		flagBit++;
+	}
+	if (written >= length) {
+		return false;
+	}
+
+	memcpy(payload->data, scratch->data, written);
+	payload->length = written;
+	return true;
+}
@@ -0,0 +1,67 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	MQTTCompress.h
+ **
+ **	DESCRIPTION:	Source Code for the Cumulocity MQTT Client for the Bosch XDK
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* header definition ******************************************************** */
+#ifndef MQTTCOMPRESS_H_
+#define MQTTCOMPRESS_H_
+
+/* local interface declaration ********************************************** */
+#include <stdint.h>
+#include <stdbool.h>
+#include "MQTTBuffer.h"
+
+/* local type and macro definitions */
+
+/*
+ * Compressed payload:
+ *
+ *   0xC9 | flags | 8 items | flags | 8 items | ...
+ *
+ * Bit n of flags, least significant first, tells whether item n is a literal
+ * byte (0) or a match of 2 bytes (1):
+ *
+ *   match:   (distance - 1) & 0xFF | (distance - 1) >> 8 + (length - 3) << 3
+ *
+ * A match repeats length bytes starting distance bytes back, it may overlap
+ * the bytes it produces. The stream ends with the payload, unused bits of the
+ * last flags are 0. The first byte tells compressed payloads apart from
+ * SmartREST and binary ones. resources/xdk_decode.py decompresses them.
+ */
+#define MQTTCOMPRESS_MAGIC			UINT8_C(0xC9)
+#define MQTTCOMPRESS_WINDOW			UINT32_C(2048)	/**< Largest distance of a match */
+#define MQTTCOMPRESS_MIN_MATCH		UINT32_C(3)
+#define MQTTCOMPRESS_MAX_MATCH		UINT32_C(34)
+#define MQTTCOMPRESS_HASH_BITS		UINT8_C(9)		/**< The hash table takes 2^bits * 2 bytes of RAM */
+
+/* global function prototype declarations */
+
+/**
+ * @brief Compress a payload in place with LZ77
+ *
+ * The payload itself is the window, so besides the scratch buffer only the
+ * hash table of the last position of each 3 byte sequence is needed. Every
+ * position is looked up once, the time is linear in the length.
+ *
+ * @param[in,out] payload complete payload, shorter than 64 KB
+ * @param[in] scratch buffer the payload is compressed into, at least the payload size
+ *
+ * @return true if the payload was compressed, false if it would not get smaller or is compressed already
+ */
+bool MQTTCompress_Payload(MQTTBuffer_Payload_T * payload, MQTTBuffer_Payload_T * scratch);
+
+/* global inline function definitions */
+
+#endif /* MQTTCOMPRESS_H_ */
@@ -0,0 +1,143 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	MQTTDeadband.c
+ **
+ **	DESCRIPTION:	Source Code for the Cumulocity MQTT Client for the Bosch XDK
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* system header files */
+#include <string.h>
+#include <stdlib.h>
+
+/* own header files */
+#include "AppController.h"
+#include "MQTTDeadband.h"
+#include "MQTTCfgParser.h"
+
+/* additional interface header files */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* constant definitions ***************************************************** */
+
+/**
+ * Deadband of one stream
+ */
+typedef struct {
+	int32_t band; /**< absolute band in the last transmitted digit, or percent if relative */
+	bool relative; /**< band is relative to the last sent value */
+} MQTTDeadband_Band_T;
+
+/**
+ * State of one stream
+ */
+typedef struct {
+	bool sent; /**< values have been sent at least once */
+	TickType_t lastTick; /**< time of the last sent measurement */
+	int32_t values[MQTTINVENTORY_MAX_VALUES]; /**< values of the last sent measurement */
+} MQTTDeadband_State_T;
+
+/**
+ * Sensor switch whose deadband applies to a stream, the orientation has no measurement
+ */
+static const int streamSensors[INVENTORY_STREAM_COUNT] = {
+		-1, ATT_IDX_ACCEL, ATT_IDX_GYRO, ATT_IDX_MAG, ATT_IDX_LIGHT,
+		ATT_IDX_ENV, ATT_IDX_ENV, ATT_IDX_ENV, ATT_IDX_NOISE };
+
+/* local variables ********************************************************** */
+
+static MQTTDeadband_Band_T bands[INVENTORY_STREAM_COUNT];
+static MQTTDeadband_State_T streams[INVENTORY_STREAM_COUNT];
+static TickType_t heartbeat = 0UL;
+static uint32_t sent = 0UL;
+static uint32_t suppressed = 0UL;
+
+/* global variables ********************************************************* */
+
+/* local functions ********************************************************** */
+
+static bool MQTTDeadband_HasLeft(const MQTTDeadband_Band_T * band, const MQTTDeadband_State_T * state,
+		const int32_t * values, uint8_t valueCount) {
+	for (uint8_t index = 0U; index < valueCount; index++) {
+		int64_t difference = llabs((int64_t) values[index] - (int64_t) state->values[index]);
+		int64_t limit = band->band;
+		if (band->relative) {
+			// compare in percent without dividing: |difference| * 100 > band * |last|
+			difference *= 100LL;
+			limit *= llabs((int64_t) state->values[index]);
+		}
+		if (difference > limit) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/* global functions ********************************************************* */
+
+void MQTTDeadband_Configure(void) {
+	for (uint8_t stream = 0U; stream < INVENTORY_STREAM_COUNT; stream++) {
+		bands[stream] = (MQTTDeadband_Band_T ) { 0L, false };
+		if (streamSensors[stream] < 0) {
+			continue;
+		}
+		const char * value = MQTTCfgParser_GetSensorDeadband(streamSensors[stream]);
+		char * end = NULL;
+		long band = strtol(value, &end, 10);
+		bands[stream].band = (band > 0L) ? (int32_t) band : 0L;
+		bands[stream].relative = (end != NULL && *end == '%');
+	}
+
+	int32_t configured = MQTTCfgParser_GetHeartbeat();
+	heartbeat = (configured > 0L) ? pdMS_TO_TICKS(configured) : 0UL;
+
+	// every stream sends its first sample after a change of the deadbands
+	memset(streams, 0x00, sizeof(streams));
+	LOG_AT_INFO(("MQTTDeadband: Heartbeat [%lu]\r\n", heartbeat));
+}
+
+bool MQTTDeadband_IsDue(MQTTInventory_Stream_T stream, const int32_t * values, uint8_t valueCount) {
+	const MQTTDeadband_Band_T * band = &bands[stream];
+	MQTTDeadband_State_T * state = &streams[stream];
+	TickType_t now = xTaskGetTickCount();
+	bool due;
+
+	if (valueCount > MQTTINVENTORY_MAX_VALUES) {
+		valueCount = MQTTINVENTORY_MAX_VALUES;
+	}
+
+	if (state->sent == false || band->band == 0L) {
+		due = true;
+	} else if (heartbeat != 0UL && (TickType_t) (now - state->lastTick) >= heartbeat) {
+		due = true;
+	} else {
+		due = MQTTDeadband_HasLeft(band, state, values, valueCount);
+	}
+
+	if (due) {
+		state->sent = true;
+		state->lastTick = now;
+		memcpy(state->values, values, valueCount * sizeof(int32_t));
+		sent++;
+	} else {
+		suppressed++;
+	}
+	return due;
+}
+
+uint32_t MQTTDeadband_GetSent(void) {
+	return sent;
+}
+
+uint32_t MQTTDeadband_GetSuppressed(void) {
+	return suppressed;
+}
@@ -0,0 +1,67 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	MQTTDeadband.h
+ **
+ **	DESCRIPTION:	Source Code for the Cumulocity MQTT Client for the Bosch XDK
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* header definition ******************************************************** */
+#ifndef MQTTDEADBAND_H_
+#define MQTTDEADBAND_H_
+
+/* local interface declaration ********************************************** */
+#include <stdint.h>
+#include <stdbool.h>
+#include "MQTTInventory.h"
+
+/* local type and macro definitions */
+
+/* global function prototype declarations */
+
+/**
+ * @brief Read the deadbands and the heartbeat from the configuration and restart all streams
+ *
+ * A deadband is configured per sensor, e.g. ENVDEADBAND, either absolute in
+ * the last transmitted digit ("10") or relative to the last sent value ("2%").
+ * The deadband of ENV applies to humidity, temperature and pressure.
+ */
+void MQTTDeadband_Configure(void);
+
+/**
+ * @brief Decide whether the measurement of a stream has to be sent
+ *
+ * A measurement is sent when one value left the deadband around the last
+ * sent value or when nothing was sent for HEARTBEAT milliseconds. If true is
+ * returned the values are remembered as the last sent ones, otherwise the
+ * measurement is counted as suppressed.
+ *
+ * @param[in] stream stream the values belong to
+ * @param[in] values values as transmitted, scaled to integers
+ * @param[in] count number of values, at most MQTTINVENTORY_MAX_VALUES
+ *
+ * @return true if the measurement has to be sent
+ */
+bool MQTTDeadband_IsDue(MQTTInventory_Stream_T stream, const int32_t * values, uint8_t count);
+
+/**
+ * @brief Number of measurements sent since startup
+ */
+uint32_t MQTTDeadband_GetSent(void);
+
+/**
+ * @brief Number of measurements suppressed since startup
+ */
+uint32_t MQTTDeadband_GetSuppressed(void);
+
+/* global inline function definitions */
+
+#endif /* MQTTDEADBAND_H_ */
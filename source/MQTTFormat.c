@@ -0,0 +1,195 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	MQTTFormat.c
+ **
+ **	DESCRIPTION:	Source Code for the Cumulocity MQTT Client for the Bosch XDK
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* system header files */
+#include <string.h>
+
+/* own header files */
+#include "MQTTFormat.h"
+
+/* constant definitions ***************************************************** */
+
+#define MQTTFORMAT_DIGITS_MAX		UINT8_C(10)	/**< Digits of the largest uint32_t */
+
+static const uint32_t powersOfTen[MQTTFORMAT_MAX_DECIMALS + 1] = { 1UL, 10UL,
+		100UL, 1000UL, 10000UL, 100000UL, 1000000UL };
+
+/* local variables ********************************************************** */
+
+/* global variables ********************************************************* */
+
+/* local functions ********************************************************** */
+
+static void MQTTFormat_Append(MQTTFormat_Line_T * line, const char * text, uint32_t length) {
+	MQTTBuffer_Payload_T * payload = line->payload;
+
+	if (line->truncated) {
+		return;
+	}
+	// keep one byte for the terminating zero
+	if (payload->length + length >= payload->size) {
+		line->truncated = true;
+		return;
+	}
+	memcpy(payload->data + payload->length, text, length);
+	payload->length += length;
+}
+
+/**
+ * @brief Append value with at least minDigits digits, leading zeros are added if required
+ */
+static void MQTTFormat_Digits(MQTTFormat_Line_T * line, uint32_t value, uint8_t minDigits) {
+	char digits[MQTTFORMAT_DIGITS_MAX];
+	uint8_t index = MQTTFORMAT_DIGITS_MAX;
+
+	// digits are produced from the right
+	do {
+		digits[--index] = (char) ('0' + (value % 10UL));
+		value /= 10UL;
+	} while (value != 0UL);
+
+	while ((MQTTFORMAT_DIGITS_MAX - index) < minDigits) {
+		digits[--index] = '0';
+	}
+	MQTTFormat_Append(line, &digits[index], MQTTFORMAT_DIGITS_MAX - index);
+}
+
+/* global functions ********************************************************* */
+
+void MQTTFormat_BeginLine(MQTTFormat_Line_T * line, MQTTBuffer_Payload_T * payload) {
+	line->payload = payload;
+	line->start = payload->length;
+	line->truncated = false;
+}
+
+bool MQTTFormat_EndLine(MQTTFormat_Line_T * line) {
+	MQTTBuffer_Payload_T * payload = line->payload;
+
+	MQTTFormat_Append(line, "\r\n", 2UL);
+	if (line->truncated) {
+		// never leave half a line in the payload
+		payload->length = line->start;
+	}
+	payload->data[payload->length] = '\0';
+	return !line->truncated;
+}
+
+void MQTTFormat_Text(MQTTFormat_Line_T * line, const char * text) {
+	MQTTFormat_Append(line, text, strlen(text));
+}
+
+void MQTTFormat_TextN(MQTTFormat_Line_T * line, const char * text, uint32_t length) {
+	const char * end = memchr(text, '\0', length);
+
+	if (end != NULL) {
+		length = (uint32_t) (end - text);
+	}
+	MQTTFormat_Append(line, text, length);
+}
+
+void MQTTFormat_Char(MQTTFormat_Line_T * line, char character) {
+	MQTTFormat_Append(line, &character, 1UL);
+}
+
+void MQTTFormat_Int(MQTTFormat_Line_T * line, int32_t value) {
+	if (value < 0L) {
+		MQTTFormat_Char(line, '-');
+		// negate in unsigned arithmetic, INT32_MIN has no positive counterpart
+		MQTTFormat_Digits(line, 0UL - (uint32_t) value, 1U);
+	} else {
+		MQTTFormat_Digits(line, (uint32_t) value, 1U);
+	}
+}
+
+void MQTTFormat_UInt(MQTTFormat_Line_T * line, uint32_t value) {
+	MQTTFormat_Digits(line, value, 1U);
+}
+
+void MQTTFormat_UIntPadded(MQTTFormat_Line_T * line, uint32_t value, uint8_t digits) {
+	MQTTFormat_Digits(line, value, (digits > MQTTFORMAT_DIGITS_MAX) ? MQTTFORMAT_DIGITS_MAX : digits);
+}
+
+void MQTTFormat_Fixed(MQTTFormat_Line_T * line, int32_t value, uint8_t decimals) {
+	uint32_t magnitude = (value < 0L) ? 0UL - (uint32_t) value : (uint32_t) value;
+
+	if (decimals > MQTTFORMAT_MAX_DECIMALS) {
+		decimals = MQTTFORMAT_MAX_DECIMALS;
+	}
+	if (value < 0L) {
+		MQTTFormat_Char(line, '-');
+	}
+	MQTTFormat_Digits(line, magnitude / powersOfTen[decimals], 1U);
+	if (decimals > 0U) {
+		MQTTFormat_Char(line, '.');
+		MQTTFormat_Digits(line, magnitude % powersOfTen[decimals], decimals);
+	}
+}
+
+uint32_t MQTTFormat_FixedLength(int32_t value, uint8_t decimals) {
+	uint32_t magnitude = (value < 0L) ? 0UL - (uint32_t) value : (uint32_t) value;
+	uint32_t length = (value < 0L) ? 1UL : 0UL;
+
+	if (decimals > MQTTFORMAT_MAX_DECIMALS) {
+		decimals = MQTTFORMAT_MAX_DECIMALS;
+	}
+	if (decimals > 0U) {
+		length += 1UL + decimals;
+	}
+	magnitude /= powersOfTen[decimals];
+	do {
+		length++;
+		magnitude /= 10UL;
+	} while (magnitude != 0UL);
+	return length;
+}
+
+void MQTTFormat_Float(MQTTFormat_Line_T * line, float value, uint8_t decimals) {
+	if (decimals > MQTTFORMAT_MAX_DECIMALS) {
+		decimals = MQTTFORMAT_MAX_DECIMALS;
+	}
+	MQTTFormat_Fixed(line, MQTTFormat_ScaleFloat(value, decimals), decimals);
+}
+
+bool MQTTFormat_TextLine(MQTTBuffer_Payload_T * payload, const char * text) {
+	MQTTFormat_Line_T line;
+
+	MQTTFormat_BeginLine(&line, payload);
+	MQTTFormat_Text(&line, text);
+	return MQTTFormat_EndLine(&line);
+}
+
+int32_t MQTTFormat_RoundDiv(int32_t numerator, int32_t denominator) {
+	// round half away from zero, printf rounded the nearest double and went either way on exact ties
+	if ((numerator < 0L) != (denominator < 0L)) {
+		return (numerator - denominator / 2L) / denominator;
+	}
+	return (numerator + denominator / 2L) / denominator;
+}
+
+int32_t MQTTFormat_ScaleFloat(float value, uint8_t decimals) {
+	if (decimals > MQTTFORMAT_MAX_DECIMALS) {
+		decimals = MQTTFORMAT_MAX_DECIMALS;
+	}
+	float scaled = value * (float) powersOfTen[decimals];
+
+	// stay clear of the int32 limits, they are not exactly representable as float
+	if (scaled > 2.0e9F) {
+		scaled = 2.0e9F;
+	} else if (scaled < -2.0e9F) {
+		scaled = -2.0e9F;
+	}
+	return (int32_t) (scaled + ((scaled < 0.0F) ? -0.5F : 0.5F));
+}
@@ -0,0 +1,127 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	MQTTFormat.h
+ **
+ **	DESCRIPTION:	Source Code for the Cumulocity MQTT Client for the Bosch XDK
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* header definition ******************************************************** */
+#ifndef MQTTFORMAT_H_
+#define MQTTFORMAT_H_
+
+/* local interface declaration ********************************************** */
+#include <stdint.h>
+#include <stdbool.h>
+#include "MQTTBuffer.h"
+
+/* local type and macro definitions */
+
+#define MQTTFORMAT_MAX_DECIMALS		UINT8_C(6)	/**< Maximum number of decimals for fixed point values */
+
+/**
+ * @brief One SmartREST line written into a payload.
+ *
+ * All appends are bounded by the payload size. When something does not fit
+ * the line is marked truncated, further appends are ignored and
+ * MQTTFormat_EndLine removes the partial line again.
+ */
+typedef struct {
+	MQTTBuffer_Payload_T * payload; /**< payload the line is appended to */
+	uint32_t start; /**< payload length before the line was started */
+	bool truncated; /**< something did not fit into the payload */
+} MQTTFormat_Line_T;
+
+/* global function prototype declarations */
+
+/**
+ * @brief Start a new line at the end of the payload
+ */
+void MQTTFormat_BeginLine(MQTTFormat_Line_T * line, MQTTBuffer_Payload_T * payload);
+
+/**
+ * @brief Finish the line with "\r\n"
+ *
+ * @return true if the line fits, false if it was truncated and has been removed from the payload
+ */
+bool MQTTFormat_EndLine(MQTTFormat_Line_T * line);
+
+/**
+ * @brief Append a zero terminated string
+ */
+void MQTTFormat_Text(MQTTFormat_Line_T * line, const char * text);
+
+/**
+ * @brief Append at most length characters of a string
+ */
+void MQTTFormat_TextN(MQTTFormat_Line_T * line, const char * text, uint32_t length);
+
+/**
+ * @brief Append a single character
+ */
+void MQTTFormat_Char(MQTTFormat_Line_T * line, char character);
+
+/**
+ * @brief Append a signed integer in decimal notation
+ */
+void MQTTFormat_Int(MQTTFormat_Line_T * line, int32_t value);
+
+/**
+ * @brief Append an unsigned integer in decimal notation
+ */
+void MQTTFormat_UInt(MQTTFormat_Line_T * line, uint32_t value);
+
+/**
+ * @brief Append an unsigned integer with leading zeros up to the given number of digits
+ */
+void MQTTFormat_UIntPadded(MQTTFormat_Line_T * line, uint32_t value, uint8_t digits);
+
+/**
+ * @brief Append a fixed point value, e.g. value 1234 with 3 decimals is written as "1.234"
+ *
+ * @param[in] value value scaled by 10^decimals
+ * @param[in] decimals number of digits after the decimal point, at most MQTTFORMAT_MAX_DECIMALS
+ */
+void MQTTFormat_Fixed(MQTTFormat_Line_T * line, int32_t value, uint8_t decimals);
+
+/**
+ * @brief Number of characters MQTTFormat_Fixed writes for the value
+ */
+uint32_t MQTTFormat_FixedLength(int32_t value, uint8_t decimals);
+
+/**
+ * @brief Append a float rounded to the given number of decimals
+ *
+ * Only the scaling is done in floating point, see MQTTFormat_ScaleFloat,
+ * the digits are produced by MQTTFormat_Fixed.
+ */
+void MQTTFormat_Float(MQTTFormat_Line_T * line, float value, uint8_t decimals);
+
+/**
+ * @brief Append a line consisting of the given text only
+ *
+ * @return true if the line fits into the payload
+ */
+bool MQTTFormat_TextLine(MQTTBuffer_Payload_T * payload, const char * text);
+
+/**
+ * @brief Integer division rounded to the nearest value, used to scale raw sensor readings
+ */
+int32_t MQTTFormat_RoundDiv(int32_t numerator, int32_t denominator);
+
+/**
+ * @brief Scale a float by 10^decimals and round it, values exceeding the int32 range are clipped
+ */
+int32_t MQTTFormat_ScaleFloat(float value, uint8_t decimals);
+
+/* global inline function definitions */
+
+#endif /* MQTTFORMAT_H_ */
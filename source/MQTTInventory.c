@@ -0,0 +1,142 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	MQTTInventory.c
+ **
+ **	DESCRIPTION:	Source Code for the Cumulocity MQTT Client for the Bosch XDK
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* system header files */
+#include <string.h>
+
+/* own header files */
+#include "AppController.h"
+#include "MQTTInventory.h"
+#include "MQTTCfgParser.h"
+
+/* additional interface header files */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* constant definitions ***************************************************** */
+
+/**
+ * State of one stream
+ */
+typedef struct {
+	bool reported; /**< values have been reported at least once */
+	uint32_t samples; /**< samples since the last update */
+	TickType_t lastTick; /**< time of the last update */
+	int32_t values[MQTTINVENTORY_MAX_VALUES]; /**< values of the last update */
+} MQTTInventory_State_T;
+
+/* local variables ********************************************************** */
+
+static MQTTInventory_Mode_T mode = INVENTORY_MODE_ALWAYS;
+static uint32_t count = 1UL;
+static int32_t delta = 0L;
+static TickType_t period = 0UL;
+static MQTTInventory_State_T streams[INVENTORY_STREAM_COUNT];
+static uint32_t savedBytes = 0UL;
+static uint32_t skipped = 0UL;
+
+/* global variables ********************************************************* */
+
+/* local functions ********************************************************** */
+
+static bool MQTTInventory_HasChanged(const MQTTInventory_State_T * state, const int32_t * values, uint8_t valueCount) {
+	for (uint8_t index = 0U; index < valueCount; index++) {
+		int32_t difference = values[index] - state->values[index];
+		if (difference >= delta || difference <= -delta) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/* global functions ********************************************************* */
+
+void MQTTInventory_Configure(void) {
+	const char * value = MQTTCfgParser_GetInventoryMode();
+
+	if (strcmp(value, "COUNT") == 0) {
+		mode = INVENTORY_MODE_COUNT;
+	} else if (strcmp(value, "CHANGE") == 0) {
+		mode = INVENTORY_MODE_CHANGE;
+	} else if (strcmp(value, "PERIOD") == 0) {
+		mode = INVENTORY_MODE_PERIOD;
+	} else {
+		mode = INVENTORY_MODE_ALWAYS;
+	}
+
+	int32_t configured = MQTTCfgParser_GetInventoryCount();
+	count = (configured > 0L) ? (uint32_t) configured : 1UL;
+	configured = MQTTCfgParser_GetInventoryDelta();
+	delta = (configured > 0L) ? configured : 1L;
+	configured = MQTTCfgParser_GetInventoryPeriod();
+	period = (configured > 0L) ? pdMS_TO_TICKS(configured) : 0UL;
+
+	// every stream reports its first sample after a change of the policy
+	memset(streams, 0x00, sizeof(streams));
+	LOG_AT_INFO(("MQTTInventory: Inventory policy [%s], count [%lu], delta [%ld], period [%lu]\r\n",
+			value, count, delta, period));
+}
+
+bool MQTTInventory_IsDue(MQTTInventory_Stream_T stream, const int32_t * values, uint8_t valueCount) {
+	MQTTInventory_State_T * state = &streams[stream];
+	TickType_t now = xTaskGetTickCount();
+	bool due;
+
+	if (valueCount > MQTTINVENTORY_MAX_VALUES) {
+		valueCount = MQTTINVENTORY_MAX_VALUES;
+	}
+	state->samples++;
+
+	if (state->reported == false) {
+		due = true;
+	} else {
+		switch (mode) {
+		case INVENTORY_MODE_COUNT:
+			due = (state->samples >= count);
+			break;
+		case INVENTORY_MODE_CHANGE:
+			due = MQTTInventory_HasChanged(state, values, valueCount);
+			break;
+		case INVENTORY_MODE_PERIOD:
+			due = ((TickType_t) (now - state->lastTick) >= period);
+			break;
+		default:
+			due = true;
+			break;
+		}
+	}
+
+	if (due) {
+		state->reported = true;
+		state->samples = 0UL;
+		state->lastTick = now;
+		memcpy(state->values, values, valueCount * sizeof(int32_t));
+	}
+	return due;
+}
+
+void MQTTInventory_Skipped(uint32_t bytes) {
+	savedBytes += bytes;
+	skipped++;
+}
+
+uint32_t MQTTInventory_GetSavedBytes(void) {
+	return savedBytes;
+}
+
+uint32_t MQTTInventory_GetSkipped(void) {
+	return skipped;
+}
@@ -0,0 +1,94 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	MQTTInventory.h
+ **
+ **	DESCRIPTION:	Source Code for the Cumulocity MQTT Client for the Bosch XDK
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* header definition ******************************************************** */
+#ifndef MQTTINVENTORY_H_
+#define MQTTINVENTORY_H_
+
+/* local interface declaration ********************************************** */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* local type and macro definitions */
+
+#define MQTTINVENTORY_MAX_VALUES	UINT8_C(4)	/**< Maximum number of values of one stream */
+
+/**
+ * Streams with an inventory update, 1990 - 1998
+ */
+typedef enum {
+	INVENTORY_STREAM_ORIENTATION,
+	INVENTORY_STREAM_ACCEL,
+	INVENTORY_STREAM_GYRO,
+	INVENTORY_STREAM_MAG,
+	INVENTORY_STREAM_LIGHT,
+	INVENTORY_STREAM_HUMIDITY,
+	INVENTORY_STREAM_TEMP,
+	INVENTORY_STREAM_PRESSURE,
+	INVENTORY_STREAM_NOISE,
+	INVENTORY_STREAM_COUNT,
+} MQTTInventory_Stream_T;
+
+/**
+ * Policy when the inventory of a stream is updated
+ */
+typedef enum {
+	INVENTORY_MODE_ALWAYS, /**< with every measurement */
+	INVENTORY_MODE_COUNT, /**< every INVENTORYCOUNT samples */
+	INVENTORY_MODE_CHANGE, /**< when a value changed by INVENTORYDELTA */
+	INVENTORY_MODE_PERIOD, /**< every INVENTORYPERIOD milliseconds */
+} MQTTInventory_Mode_T;
+
+/* global function prototype declarations */
+
+/**
+ * @brief Read the policy from the configuration and restart all streams
+ */
+void MQTTInventory_Configure(void);
+
+/**
+ * @brief Decide whether the inventory of a stream has to be updated with the given values
+ *
+ * If true is returned the values are remembered as the last reported ones.
+ *
+ * @param[in] stream stream the values belong to
+ * @param[in] values values as transmitted, scaled to integers
+ * @param[in] count number of values, at most MQTTINVENTORY_MAX_VALUES
+ *
+ * @return true if the inventory update has to be sent
+ */
+bool MQTTInventory_IsDue(MQTTInventory_Stream_T stream, const int32_t * values, uint8_t count);
+
+/**
+ * @brief Count an inventory update that was not sent
+ *
+ * @param[in] bytes length of the line that was saved
+ */
+void MQTTInventory_Skipped(uint32_t bytes);
+
+/**
+ * @brief Number of bytes saved by not sending inventory updates since startup
+ */
+uint32_t MQTTInventory_GetSavedBytes(void);
+
+/**
+ * @brief Number of inventory updates not sent since startup
+ */
+uint32_t MQTTInventory_GetSkipped(void);
+
+/* global inline function definitions */
+
+#endif /* MQTTINVENTORY_H_ */
@@ -0,0 +1,84 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	MQTTNoise.c
+ **
+ **	DESCRIPTION:	Source Code for the Cumulocity MQTT Client for the Bosch XDK
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* system header files */
+#include <string.h>
+#include <math.h>
+
+/* own header files */
+#include "MQTTNoise.h"
+
+/* constant definitions ***************************************************** */
+
+/* 20 log10(10^MQTTNOISE_DECIMALS * 20 uPa) = 20 log10(0.2), subtracted to get dB re 20 uPa */
+#define MQTTNOISE_REFERENCE_DB		(-13.9794F)
+
+/* local variables ********************************************************** */
+
+/* global variables ********************************************************* */
+
+/* local functions ********************************************************** */
+
+/**
+ * @brief Integer square root, rounded down
+ */
+static uint32_t MQTTNoise_Sqrt(uint64_t value) {
+	uint64_t root = 0ULL;
+	uint64_t bit = 1ULL << 62;
+
+	while (bit > value) {
+		bit >>= 2;
+	}
+	while (bit != 0ULL) {
+		if (value >= root + bit) {
+			value -= root + bit;
+			root = (root >> 1) + bit;
+		} else {
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+	return (uint32_t) root;
+}
+
+/* global functions ********************************************************* */
+
+void MQTTNoise_Reset(MQTTNoise_Window_T * window) {
+	memset(window, 0x00, sizeof(MQTTNoise_Window_T));
+}
+
+void MQTTNoise_Add(MQTTNoise_Window_T * window, uint32_t pressure) {
+	window->sum += (uint64_t) pressure * (uint64_t) pressure;
+	window->count++;
+	if (pressure > window->peak) {
+		window->peak = pressure;
+	}
+}
+
+uint32_t MQTTNoise_Rms(const MQTTNoise_Window_T * window) {
+	if (window->count == 0UL) {
+		return 0UL;
+	}
+	return MQTTNoise_Sqrt(window->sum / window->count);
+}
+
+float MQTTNoise_Leq(const MQTTNoise_Window_T * window) {
+	if (window->count == 0UL || window->sum == 0ULL) {
+		return 0.0F;
+	}
+	float meanSquare = (float) window->sum / (float) window->count;
+	return 10.0F * log10f(meanSquare) - MQTTNOISE_REFERENCE_DB;
+}
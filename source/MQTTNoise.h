@@ -0,0 +1,67 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	MQTTNoise.h
+ **
+ **	DESCRIPTION:	Source Code for the Cumulocity MQTT Client for the Bosch XDK
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* header definition ******************************************************** */
+#ifndef MQTTNOISE_H_
+#define MQTTNOISE_H_
+
+/* local interface declaration ********************************************** */
+#include <stdint.h>
+
+/* local type and macro definitions */
+
+#define MQTTNOISE_DECIMALS			UINT8_C(4)	/**< Sound pressures are given in Pa scaled by 10^4 */
+
+/**
+ * @brief Sound level of a window of rms readings of the microphone
+ *
+ * Each reading is the rms over a short buffer sampled at audio rate by the
+ * noise sensor. The squares are summed in integers, so the energy average
+ * over readings of equal duration is the exact rms of the whole window.
+ */
+typedef struct {
+	uint64_t sum; /**< sum of the squared sound pressures */
+	uint32_t count; /**< readings added since the last reset */
+	uint32_t peak; /**< loudest reading */
+} MQTTNoise_Window_T;
+
+/* global function prototype declarations */
+
+/**
+ * @brief Start a new window
+ */
+void MQTTNoise_Reset(MQTTNoise_Window_T * window);
+
+/**
+ * @brief Add one rms reading to the window
+ *
+ * @param[in] pressure sound pressure in Pa, scaled by 10^MQTTNOISE_DECIMALS
+ */
+void MQTTNoise_Add(MQTTNoise_Window_T * window, uint32_t pressure);
+
+/**
+ * @brief Rms sound pressure over the window, scaled like the readings
+ */
+uint32_t MQTTNoise_Rms(const MQTTNoise_Window_T * window);
+
+/**
+ * @brief Equivalent continuous sound level Leq over the window in dB re 20 uPa
+ */
+float MQTTNoise_Leq(const MQTTNoise_Window_T * window);
+
+/* global inline function definitions */
+
+#endif /* MQTTNOISE_H_ */
@@ -0,0 +1,416 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	MQTTOffline.c
+ **
+ **	DESCRIPTION:	Source Code for the Cumulocity MQTT Client for the Bosch XDK
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* system header files */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* own header files */
+#include "AppController.h"
+#include "MQTTOffline.h"
+#include "MQTTCfgParser.h"
+
+/* additional interface header files */
+#include "BCDS_SDCard_Driver.h"
+#include <ff.h>
+
+/* constant definitions ***************************************************** */
+
+#define MQTTOFFLINE_DIRECTORY		"OFFLINE"
+#define MQTTOFFLINE_PATH_SIZE		UINT8_C(24)				/**< Size of "OFFLINE/0000002A.SEG" including the terminating zero */
+#define MQTTOFFLINE_MAGIC			UINT32_C(0x51534458)	/**< "XDSQ" */
+#define MQTTOFFLINE_HEADER_SIZE		UINT32_C(10)
+#define MQTTOFFLINE_RECORD_SIZE		UINT32_C(4)
+#define MQTTOFFLINE_CHUNK_SIZE		UINT32_C(64)			/**< Bytes read at once when a segment is verified */
+
+/* local variables ********************************************************** */
+
+static bool enabled = false;
+static bool recovered = false;
+static uint32_t capacity = 0UL;
+
+/* segments first .. next - 1 exist, the store is empty if first == next */
+static uint32_t first = 0UL;
+static uint32_t next = 0UL;
+static uint32_t writeSize = 0UL;	/**< size of the newest segment */
+static uint32_t readOffset = MQTTOFFLINE_HEADER_SIZE;	/**< first unpublished record in the oldest segment */
+
+/* position after the payloads of the last fetch */
+static uint32_t fetchSequence = 0UL;
+static uint32_t fetchOffset = MQTTOFFLINE_HEADER_SIZE;
+
+static uint32_t evicted = 0UL;
+
+/* only one segment is open at a time */
+static FIL file;
+
+/* global variables ********************************************************* */
+
+/* local functions ********************************************************** */
+
+/**
+ * @brief CRC-16/CCITT, start with 0xFFFF
+ */
+static uint16_t MQTTOffline_Crc(uint16_t crc, const uint8_t * data, uint32_t length) {
+	for (uint32_t index = 0UL; index < length; index++) {
+		crc ^= (uint16_t) ((uint16_t) data[index] << 8);
+		for (uint8_t bit = 0U; bit < 8U; bit++) {
+			crc = (crc & 0x8000U) ? (uint16_t) ((crc << 1) ^ 0x1021U) : (uint16_t) (crc << 1);
+		}
+	}
+	return crc;
+}
+
+static void MQTTOffline_Put(uint8_t * data, uint32_t value, uint8_t bytes) {
+	for (uint8_t index = 0U; index < bytes; index++) {
+		data[index] = (uint8_t) (value >> (8U * index));
+	}
+}
+
+static uint32_t MQTTOffline_Get(const uint8_t * data, uint8_t bytes) {
+	uint32_t value = 0UL;
+	for (uint8_t index = 0U; index < bytes; index++) {
+		value |= (uint32_t) data[index] << (8U * index);
+	}
+	return value;
+}
+
+static void MQTTOffline_Path(uint32_t sequence, char * path) {
+	snprintf(path, MQTTOFFLINE_PATH_SIZE, MQTTOFFLINE_DIRECTORY "/%08lX.SEG", (unsigned long) sequence);
+}
+
+static bool MQTTOffline_ReadAt(uint32_t offset, void * data, uint32_t length) {
+	UINT count = 0U;
+	return f_lseek(&file, offset) == FR_OK && f_read(&file, data, length, &count) == FR_OK && count == length;
+}
+
+/**
+ * @brief Open a segment and check its header
+ */
+static bool MQTTOffline_Open(uint32_t sequence, BYTE mode) {
+	char path[MQTTOFFLINE_PATH_SIZE];
+	uint8_t header[MQTTOFFLINE_HEADER_SIZE];
+
+	MQTTOffline_Path(sequence, path);
+	if (f_open(&file, (const TCHAR *) path, FA_READ | mode) != FR_OK) {
+		return false;
+	}
+	if (MQTTOffline_ReadAt(0UL, header, MQTTOFFLINE_HEADER_SIZE) == false
+			|| MQTTOffline_Get(header, 4U) != MQTTOFFLINE_MAGIC
+			|| MQTTOffline_Get(header + 4, 4U) != sequence
+			|| MQTTOffline_Get(header + 8, 2U) != MQTTOffline_Crc(0xFFFFU, header, 8UL)) {
+		f_close(&file);
+		return false;
+	}
+	return true;
+}
+
+static bool MQTTOffline_Create(uint32_t sequence) {
+	char path[MQTTOFFLINE_PATH_SIZE];
+	uint8_t header[MQTTOFFLINE_HEADER_SIZE];
+	UINT count = 0U;
+
+	MQTTOffline_Put(header, MQTTOFFLINE_MAGIC, 4U);
+	MQTTOffline_Put(header + 4, sequence, 4U);
+	MQTTOffline_Put(header + 8, MQTTOffline_Crc(0xFFFFU, header, 8UL), 2U);
+
+	MQTTOffline_Path(sequence, path);
+	if (f_open(&file, (const TCHAR *) path, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK) {
+		LOG_AT_ERROR(("MQTTOffline: Creating segment [%s] failed\r\n", path));
+		return false;
+	}
+	// closing flushes the header, a segment is only used once its header is complete
+	bool written = f_write(&file, header, MQTTOFFLINE_HEADER_SIZE, &count) == FR_OK
+			&& count == MQTTOFFLINE_HEADER_SIZE;
+	return (f_close(&file) == FR_OK) && written;
+}
+
+static void MQTTOffline_Delete(uint32_t sequence) {
+	char path[MQTTOFFLINE_PATH_SIZE];
+
+	MQTTOffline_Path(sequence, path);
+	f_unlink((const TCHAR *) path);
+}
+
+/**
+ * @brief Drop the oldest segment to make room for a new one
+ */
+static void MQTTOffline_Evict(void) {
+	MQTTOffline_Delete(first);
+	first++;
+	readOffset = MQTTOFFLINE_HEADER_SIZE;
+	evicted++;
+	LOG_AT_WARNING(("MQTTOffline: Capacity reached, oldest segment dropped, [%lu] segments dropped so far\r\n", evicted));
+}
+
+/**
+ * @brief Check the record at offset of the open segment
+ *
+ * @return length of the payload, 0 if the record is incomplete or broken
+ */
+static uint32_t MQTTOffline_Verify(uint32_t offset, uint32_t end) {
+	uint8_t record[MQTTOFFLINE_RECORD_SIZE];
+	uint8_t chunk[MQTTOFFLINE_CHUNK_SIZE];
+
+	if (offset + MQTTOFFLINE_RECORD_SIZE > end
+			|| MQTTOffline_ReadAt(offset, record, MQTTOFFLINE_RECORD_SIZE) == false) {
+		return 0UL;
+	}
+	uint32_t length = MQTTOffline_Get(record, 2U);
+	if (length == 0UL || offset + MQTTOFFLINE_RECORD_SIZE + length > end) {
+		return 0UL;
+	}
+	uint16_t crc = 0xFFFFU;
+	for (uint32_t done = 0UL; done < length;) {
+		uint32_t size = (length - done < MQTTOFFLINE_CHUNK_SIZE) ? length - done : MQTTOFFLINE_CHUNK_SIZE;
+		UINT count = 0U;
+		if (f_read(&file, chunk, size, &count) != FR_OK || count != size) {
+			return 0UL;
+		}
+		crc = MQTTOffline_Crc(crc, chunk, size);
+		done += size;
+	}
+	return (crc == MQTTOffline_Get(record + 2, 2U)) ? length : 0UL;
+}
+
+/**
+ * @brief Find the segments left on the SD card and cut the newest one after its last complete record
+ */
+static bool MQTTOffline_Recover(void) {
+	DIR directory;
+	FILINFO info;
+	bool found = false;
+	uint32_t lowest = 0UL;
+	uint32_t highest = 0UL;
+
+	FRESULT result = f_mkdir((const TCHAR *) MQTTOFFLINE_DIRECTORY);
+	if (result != FR_OK && result != FR_EXIST) {
+		LOG_AT_ERROR(("MQTTOffline: Creating directory failed: [%d]\r\n", result));
+		return false;
+	}
+	if (f_opendir(&directory, (const TCHAR *) MQTTOFFLINE_DIRECTORY) != FR_OK) {
+		LOG_AT_ERROR(("MQTTOffline: Opening directory failed\r\n"));
+		return false;
+	}
+	while (f_readdir(&directory, &info) == FR_OK && info.fname[0] != '\0') {
+		char * end = NULL;
+		uint32_t sequence = (uint32_t) strtoul(info.fname, &end, 16);
+		if (end == info.fname || strcmp(end, ".SEG") != 0) {
+			continue;
+		}
+		if (MQTTOffline_Open(sequence, 0U) == false) {
+			// the reset happened while the segment was created
+			LOG_AT_WARNING(("MQTTOffline: Segment [%s] has no valid header, deleted\r\n", info.fname));
+			MQTTOffline_Delete(sequence);
+			continue;
+		}
+		f_close(&file);
+		if (found == false || sequence < lowest) {
+			lowest = sequence;
+		}
+		if (found == false || sequence > highest) {
+			highest = sequence;
+		}
+		found = true;
+	}
+	f_closedir(&directory);
+
+	first = found ? lowest : 0UL;
+	next = found ? highest + 1UL : 0UL;
+	readOffset = MQTTOFFLINE_HEADER_SIZE;
+	writeSize = MQTTOFFLINE_HEADER_SIZE;
+	if (found && MQTTOffline_Open(highest, FA_WRITE)) {
+		uint32_t size = f_size(&file);
+		uint32_t length;
+		while ((length = MQTTOffline_Verify(writeSize, size)) != 0UL) {
+			writeSize += MQTTOFFLINE_RECORD_SIZE + length;
+		}
+		if (writeSize < size) {
+			// the reset happened while a record was written
+			LOG_AT_WARNING(("MQTTOffline: Incomplete record cut, [%lu] bytes\r\n", size - writeSize));
+			f_lseek(&file, writeSize);
+			f_truncate(&file);
+		}
+		f_close(&file);
+	}
+	LOG_AT_INFO(("MQTTOffline: Recovered [%lu] segments\r\n", next - first));
+	return true;
+}
+
+static bool MQTTOffline_IsText(const char * data) {
+	return data[0] >= '0' && data[0] <= '9';
+}
+
+/* global functions ********************************************************* */
+
+void MQTTOffline_Configure(void) {
+	int32_t size = MQTTCfgParser_GetOfflineStore();
+
+	capacity = (size > 0L) ? (uint32_t) size * 1024UL / MQTTOFFLINE_SEGMENT_SIZE : 0UL;
+	if (size > 0L && capacity < MQTTOFFLINE_MIN_SEGMENTS) {
+		capacity = MQTTOFFLINE_MIN_SEGMENTS;
+	}
+
+	enabled = false;
+	if (capacity > 0UL) {
+		if (SDCARD_INSERTED != SDCardDriver_GetDetectStatus()) {
+			LOG_AT_WARNING(("MQTTOffline: SD card is not inserted, measurements are dropped while offline\r\n"));
+		} else {
+			recovered = recovered || MQTTOffline_Recover();
+			enabled = recovered;
+		}
+	}
+	LOG_AT_INFO(("MQTTOffline: Store [%s], capacity [%lu] segments of [%lu] bytes\r\n",
+			enabled ? "ON" : "OFF", capacity, MQTTOFFLINE_SEGMENT_SIZE));
+}
+
+bool MQTTOffline_IsEnabled(void) {
+	return enabled;
+}
+
+bool MQTTOffline_IsEmpty(void) {
+	return first == next;
+}
+
+bool MQTTOffline_Store(const MQTTBuffer_Payload_T * payload) {
+	uint8_t record[MQTTOFFLINE_RECORD_SIZE];
+	UINT count = 0U;
+
+	if (enabled == false || payload->length == 0UL
+			|| payload->length > MQTTOFFLINE_SEGMENT_SIZE - MQTTOFFLINE_HEADER_SIZE - MQTTOFFLINE_RECORD_SIZE) {
+		return false;
+	}
+
+	if (first == next || writeSize + MQTTOFFLINE_RECORD_SIZE + payload->length > MQTTOFFLINE_SEGMENT_SIZE) {
+		while (next - first >= capacity) {
+			MQTTOffline_Evict();
+		}
+		if (MQTTOffline_Create(next) == false) {
+			return false;
+		}
+		next++;
+		writeSize = MQTTOFFLINE_HEADER_SIZE;
+	}
+
+	if (MQTTOffline_Open(next - 1UL, FA_WRITE) == false) {
+		LOG_AT_ERROR(("MQTTOffline: Opening segment [%lu] failed\r\n", next - 1UL));
+		return false;
+	}
+	MQTTOffline_Put(record, payload->length, 2U);
+	MQTTOffline_Put(record + 2, MQTTOffline_Crc(0xFFFFU, (const uint8_t *) payload->data, payload->length), 2U);
+	bool written = f_lseek(&file, writeSize) == FR_OK
+			&& f_write(&file, record, MQTTOFFLINE_RECORD_SIZE, &count) == FR_OK && count == MQTTOFFLINE_RECORD_SIZE
+			&& f_write(&file, payload->data, payload->length, &count) == FR_OK && count == payload->length;
+	if (written == false) {
+		// e.g. the card is full, the segment stays as it was
+		f_lseek(&file, writeSize);
+		f_truncate(&file);
+	}
+	written = (f_close(&file) == FR_OK) && written;
+	if (written) {
+		writeSize += MQTTOFFLINE_RECORD_SIZE + payload->length;
+	} else {
+		LOG_AT_ERROR(("MQTTOffline: Writing segment [%lu] failed\r\n", next - 1UL));
+	}
+	return written;
+}
+
+bool MQTTOffline_Fetch(MQTTBuffer_Payload_T * payload) {
+	uint32_t sequence = first;
+	uint32_t offset = readOffset;
+	bool fetched = false;
+	bool full = false;
+
+	while (full == false && sequence != next) {
+		const bool newest = (sequence == next - 1UL);
+		if (MQTTOffline_Open(sequence, 0U) == false) {
+			LOG_AT_ERROR(("MQTTOffline: Segment [%lu] is lost\r\n", sequence));
+			sequence++;
+			offset = MQTTOFFLINE_HEADER_SIZE;
+			continue;
+		}
+		const uint32_t end = newest ? writeSize : (uint32_t) f_size(&file);
+		while (offset < end) {
+			uint8_t record[MQTTOFFLINE_RECORD_SIZE];
+			if (offset + MQTTOFFLINE_RECORD_SIZE > end
+					|| MQTTOffline_ReadAt(offset, record, MQTTOFFLINE_RECORD_SIZE) == false) {
+				offset = end;
+				break;
+			}
+			uint32_t length = MQTTOffline_Get(record, 2U);
+			if (length == 0UL || offset + MQTTOFFLINE_RECORD_SIZE + length > end) {
+				offset = end;
+				break;
+			}
+			if (payload->length + length > payload->size) {
+				full = true;
+				break;
+			}
+
+			char * data = payload->data + payload->length;
+			UINT count = 0U;
+			if (f_read(&file, data, length, &count) != FR_OK || count != length
+					|| MQTTOffline_Get(record + 2, 2U) != MQTTOffline_Crc(0xFFFFU, (const uint8_t *) data, length)) {
+				// the rest of the segment can not be trusted
+				LOG_AT_ERROR(("MQTTOffline: Broken record in segment [%lu], rest of the segment dropped\r\n", sequence));
+				offset = end;
+				break;
+			}
+			// only SmartREST lines can be joined, binary payloads have a header each
+			if (fetched && (MQTTOffline_IsText(payload->data) == false || MQTTOffline_IsText(data) == false)) {
+				full = true;
+				break;
+			}
+			payload->length += length;
+			offset += MQTTOFFLINE_RECORD_SIZE + length;
+			fetched = true;
+		}
+		f_close(&file);
+
+		if (full == false) {
+			if (newest) {
+				break;
+			}
+			sequence++;
+			offset = MQTTOFFLINE_HEADER_SIZE;
+		}
+	}
+
+	fetchSequence = sequence;
+	fetchOffset = offset;
+	return fetched;
+}
+
+void MQTTOffline_Commit(void) {
+	// payloads stored while the fetched ones were published may have evicted their segment
+	if ((int32_t) (fetchSequence - first) < 0L) {
+		return;
+	}
+	while (first != fetchSequence && first != next) {
+		MQTTOffline_Delete(first);
+		first++;
+	}
+	readOffset = fetchOffset;
+	if (first != next && first == next - 1UL && readOffset >= writeSize) {
+		// all is published, new payloads start a new segment
+		MQTTOffline_Delete(first);
+		first = next;
+	}
+	if (first == next) {
+		readOffset = MQTTOFFLINE_HEADER_SIZE;
+	}
+}
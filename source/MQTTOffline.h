@@ -0,0 +1,100 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	MQTTOffline.h
+ **
+ **	DESCRIPTION:	Source Code for the Cumulocity MQTT Client for the Bosch XDK
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* header definition ******************************************************** */
+#ifndef MQTTOFFLINE_H_
+#define MQTTOFFLINE_H_
+
+/* local interface declaration ********************************************** */
+#include <stdint.h>
+#include <stdbool.h>
+#include "MQTTBuffer.h"
+
+/* local type and macro definitions */
+
+/*
+ * Sensor payloads that can not be published are appended to segment files
+ * OFFLINE/<sequence in hex>.SEG on the SD card, all numbers little endian:
+ *
+ *   header:  magic "XDSQ" | sequence (4 bytes) | crc of magic and sequence (2 bytes)
+ *   record:  length (2 bytes) | crc of the payload (2 bytes) | payload
+ *
+ * The crc is CRC-16/CCITT. A new segment is started when a record does not
+ * fit into the current one. Segments are drained oldest first and deleted
+ * once all their records are published. After a reset the oldest segment is
+ * replayed from its start, so a payload is published at least once.
+ */
+#define MQTTOFFLINE_SEGMENT_SIZE	UINT32_C(16384)		/**< Largest size of a segment file */
+#define MQTTOFFLINE_MIN_SEGMENTS	UINT32_C(2)			/**< Segments kept at least, one is written while the other drains */
+
+/* global function prototype declarations */
+
+/**
+ * @brief Read the capacity from the configuration
+ *
+ * The first call recovers the segments left on the SD card: segments with a
+ * broken header are deleted and the newest segment is cut after its last
+ * complete record. Without an SD card nothing is stored.
+ */
+void MQTTOffline_Configure(void);
+
+/**
+ * @brief true if payloads are stored while offline
+ */
+bool MQTTOffline_IsEnabled(void);
+
+/**
+ * @brief true if no payloads wait to be published
+ */
+bool MQTTOffline_IsEmpty(void);
+
+/**
+ * @brief Append a payload to the newest segment
+ *
+ * If the capacity is reached the oldest segment is deleted, newer
+ * measurements are considered more valuable than old ones.
+ *
+ * @param[in] payload sensor payload that could not be published
+ *
+ * @return true if the payload is stored
+ */
+bool MQTTOffline_Store(const MQTTBuffer_Payload_T * payload);
+
+/**
+ * @brief Read the oldest stored payloads into an empty payload
+ *
+ * SmartREST payloads are joined as long as they fit, binary and compressed
+ * ones are returned one by one. The payloads stay stored until
+ * MQTTOffline_Commit is called, so the next fetch returns them again if the
+ * publish fails.
+ *
+ * @param[out] payload empty payload to fill
+ *
+ * @return true if the payload holds stored data
+ */
+bool MQTTOffline_Fetch(MQTTBuffer_Payload_T * payload);
+
+/**
+ * @brief Mark the payloads of the last fetch as published, drained segments are deleted
+ *
+ * Payloads may be stored between the fetch and the commit. If that evicted
+ * the segment of the fetch, nothing is left to mark.
+ */
+void MQTTOffline_Commit(void);
+
+/* global inline function definitions */
+
+#endif /* MQTTOFFLINE_H_ */
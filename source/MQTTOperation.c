@@ -14,14 +14,25 @@
  **
  *******************************************************************************/
 
-/* system header files */
-
 /* own header files */
 
 #include "AppController.h"
 #include "MQTTOperation.h"
 #include "MQTTStorage.h"
 #include "MQTTCfgParser.h"
+#include "MQTTBuffer.h"
+#include "MQTTFormat.h"
+#include "MQTTInventory.h"
+#include "MQTTSampler.h"
+#include "MQTTAggregate.h"
+#include "MQTTDeadband.h"
+#include "MQTTClock.h"
+#include "MQTTSpectrum.h"
+#include "MQTTNoise.h"
+#include "MQTTBinary.h"
+#include "MQTTCompress.h"
+#include "MQTTOffline.h"
+#include "MQTTCommand.h"
 
 /* additional interface header files */
 #include "BSP_BoardType.h"
@@ -41,28 +52,210 @@
 #include "XDK_WLAN.h"
 #include "BatteryMonitor.h"
 #include "XdkSensorHandle.h"
+#include "XDK_NoiseSensor.h"
 #include "XdkCommonInfo.h"
 
 static const int MINIMAL_SPEED = 25;
+static const int MINIMAL_SAMPLING_RATE = 10;
 /* constant definitions ***************************************************** */
 const float aku340ConversionRatio = 0.01258925411794167210423954106396; //pow(10,(-38/20));
+
+#define SENSOR_RING_SIZE			UINT32_C(32)	/**< Most samples buffered between sampling and publishing, power of two, BACKLOGSIZE uses a part */
+#define MQTTOPERATION_PAYLOADS		UINT8_C(2)		/**< Asset payloads, one is filled while the other one is published */
+#define MQTTOPERATION_SENSOR_PAYLOADS	UINT8_C(4)	/**< Sensor payloads, one is filled while the others wait for their acknowledgement */
+#define MQTTOPERATION_COMPLETIONS	UINT8_C(8)		/**< Completed publishes for the publish loop, power of two, more than sensor, asset and offline payloads */
+#define MQTTOPERATION_COMMAND_STORAGE	UINT32_C(2048)	/**< Bytes of the queued commands, a short command takes about 20 */
+#define MQTTOPERATION_COMMAND_DEPTH	INT32_C(32)		/**< Commands queued at most, COMMANDQUEUE can lower it */
+#define MQTTOPERATION_LOCAL_QUEUE	UINT32_C(8)		/**< Commands of the device itself queued at most, power of two */
+#define MQTTOPERATION_TOPICS		UINT8_C(3)		/**< Topics subscribed for commands, operations and errors */
+#define MQTTOPERATION_CLOCK_SYNC	UINT32_C(3600000)	/**< Time in MS after which the sample clock is anchored again */
+#define MQTTOPERATION_VIBRATION_TICKS	UINT32_C(1)		/**< Ticks between two accelerometer samples of a vibration capture */
+#define MQTTOPERATION_NOISE_RATE	INT32_C(125)	/**< Slowest noise reading in MS when a noise window is used, the "fast" time weighting */
+
+/**
+ * Sensors sampled with their own rate, in the order of the switches ACCEL to NOISE in the configuration
+ */
+typedef enum {
+	SENSOR_CHANNEL_ACCEL,
+	SENSOR_CHANNEL_GYRO,
+	SENSOR_CHANNEL_MAG,
+	SENSOR_CHANNEL_ENV,
+	SENSOR_CHANNEL_LIGHT,
+	SENSOR_CHANNEL_NOISE,
+	SENSOR_CHANNEL_COUNT,
+} SensorChannel_T;
+
+#define SENSOR_CHANNEL_BIT(channel)	(1UL << (channel))
+
+/**
+ * One sample as taken by the sampling task and handed over to the publish loop
+ */
+typedef struct {
+	Sensor_Value_T value; /**< raw sensor readings, only the channels read are valid */
+	uint16_t channels; /**< channels read in this sample */
+	TickType_t tick; /**< tick count when the sample was taken */
+#if ENABLE_SENSOR_TOOLBOX
+	Orientation_EulerData_T euler; /**< orientation at sampling time */
+	bool eulerValid; /**< orientation could be read */
+#endif
+	uint16_t inventoryDecided; /**< streams whose inventory update was decided by the publish loop */
+	uint16_t inventoryDue; /**< streams whose inventory update has to be sent */
+	uint16_t aggregated; /**< streams added to their aggregation window by the publish loop */
+	uint16_t measurementDecided; /**< streams whose deadband was checked by the publish loop */
+	uint16_t measurementDue; /**< streams whose measurement left the deadband */
+	bool noiseWindowed; /**< the noise channel carries a complete window instead of a single reading */
+	MQTTNoise_Window_T noise; /**< noise window completed with this sample */
+} SensorSample_T;
+
+/**
+ * Asset lines a command leaves to be sent after its acknowledgement, bits of CommandEntry_T.lines
+ */
+#define COMMAND_LINE_FIRMWARE		UINT8_C(0x01)	/**< "115" firmware and its change event */
+#define COMMAND_LINE_STARTED		UINT8_C(0x02)	/**< publish started event */
+#define COMMAND_LINE_STOPPED		UINT8_C(0x04)	/**< publish stopped event */
+#define COMMAND_LINE_REQUEST		UINT8_C(0x08)	/**< "500" request pending operations */
+#define COMMAND_LINE_CONFIG			UINT8_C(0x10)	/**< "113" configuration and its change event */
+
+/**
+ * How the first arguments of a command are converted
+ */
+typedef enum {
+	COMMAND_ARG_NONE, /**< nothing to convert */
+	COMMAND_ARG_NUMBER, /**< a decimal number */
+	COMMAND_ARG_FLAG, /**< "TRUE" or "1", otherwise false */
+	COMMAND_ARG_SENSOR, /**< a sensor switch of the configuration and its value */
+	COMMAND_ARG_CONFIG, /**< a key of the configuration and its value */
+	COMMAND_ARG_TEXT, /**< texts as they were received */
+} CommandArgKind_T;
+
+/**
+ * Arguments of a command, the member used is given by the kind of its table entry
+ *
+ * Texts point into the received command, they are valid while the handler runs.
+ */
+typedef union {
+	long number; /**< COMMAND_ARG_NUMBER and COMMAND_ARG_FLAG */
+	struct {
+		int8_t key; /**< ATT_IDX_* */
+		const char * value; /**< the new value of the key */
+	} setting; /**< COMMAND_ARG_SENSOR and COMMAND_ARG_CONFIG */
+	const char * text[MQTTCOMMAND_ARGS]; /**< COMMAND_ARG_TEXT */
+} CommandArgs_T;
+
+/**
+ * Executes a command after its arguments were converted
+ */
+typedef void (*CommandHandler_T)(const CommandArgs_T * args);
+
+/**
+ * One command the device executes
+ */
+typedef struct {
+	uint16_t template; /**< template of the command, 0 for a free slot of the table */
+	const char * name; /**< sub command of TEMPLATE_ID_COMMAND, "" for the other templates */
+	C8Y_COMMAND command; /**< reported in the acknowledgements */
+	uint8_t arity; /**< arguments required after the sub command */
+	CommandArgKind_T kind; /**< conversion of the arguments */
+	DEVICE_OPERATION progress; /**< phase of the operation once the handler is called */
+	CommandHandler_T handler; /**< can be NULL if acknowledging is all there is to do */
+	uint8_t lines; /**< COMMAND_LINE_* sent to the inventory once the command is acknowledged */
+} CommandEntry_T;
+
+/**
+ * Where a published payload came from
+ */
+typedef enum {
+	PUBLISH_SENSOR, /**< sensorPool */
+	PUBLISH_ASSET, /**< assetPool */
+	PUBLISH_OFFLINE /**< offlinePayload, fetched from the offline store */
+} PublishSource_T;
+
+/**
+ * A payload completed by the MQTT client, handed over to the publish loop
+ */
+typedef struct {
+	PublishSource_T source; /**< what to do with the payload */
+	MQTTBuffer_Payload_T * payload; /**< the payload, owned by the publish loop again */
+	Retcode_T result; /**< RETCODE_OK if it was delivered */
+} PublishCompletion_T;
+
+/**
+ * Inventory update templates per stream, the measurement template is the same without the leading 1
+ */
+static const char * const inventoryTemplates[INVENTORY_STREAM_COUNT] = {
+		"1990", "1991", "1992", "1993", "1994", "1995", "1996", "1997", "1998" };
+
+/**
+ * Aggregate templates per stream, the orientation is not aggregated
+ */
+static const char * const aggregateTemplates[INVENTORY_STREAM_COUNT] = {
+		NULL, "981", "982", "983", "984", "985", "986", "987", "988" };
+
+/**
+ * Series names of the sampling jitter histogram buckets
+ */
+static const char * const jitterSeries[MQTTSAMPLER_BUCKETS] = {
+		"0ms", "1ms", "2-3ms", "4-7ms", "8-15ms", "16-31ms", "32+ms" };
+
 /* local variables ********************************************************** */
 static int tickRateMS;
 static APP_ASSET_UPDATE_STATUS assetUpdateProcess = APP_ASSET_INITIAL;
+/* COMMAND_LINE_* of the executed commands not yet written to an asset payload */
+static uint8_t commandLines = 0U;
 static DEVICE_OPERATION commandProgress = DEVICE_OPERATION_WAITING;
 static C8Y_COMMAND command = CMD_UNKNOWN;
 static uint16_t connectAttemps = 0UL;
-static xTimerHandle timerHandleSensor;
 static xTimerHandle timerHandleAsset;
-static int errorCountSemaphore = 0;
 static int errorCountPublish = 0;
+static SensorSample_T sensorRingStorage[SENSOR_RING_SIZE];
+static MQTTBuffer_Ring_T sensorRing;
+/* the sample taken from the ring that did not fit into a payload yet */
+static SensorSample_T pendingSample;
+static bool samplePending = false;
+static char sensorPayloadData[MQTTOPERATION_SENSOR_PAYLOADS][SIZE_PACKET_BUF];
+static char assetPayloadData[MQTTOPERATION_PAYLOADS][SIZE_XLARGE_BUF];
+static MQTTBuffer_Payload_T sensorPayloads[MQTTOPERATION_SENSOR_PAYLOADS];
+static MQTTBuffer_Payload_T assetPayloads[MQTTOPERATION_PAYLOADS];
+static MQTTBuffer_Pool_T sensorPool;
+static MQTTBuffer_Pool_T assetPool;
+/* sealed sensor payloads queued in the MQTT client, they are released once they completed */
+static uint8_t sensorInFlight = 0U;
+static uint8_t assetInFlight = 0U;
+static bool offlineInFlight = false;
+/* completions of the queued payloads, from the MQTT command processor to the publish loop */
+static PublishCompletion_T publishCompletionStorage[MQTTOPERATION_COMPLETIONS];
+static MQTTBuffer_Ring_T publishCompletions;
+/* MQTTOperation_Local_T of the commands the device issued itself, executed before received ones */
+static uint8_t localCommandStorage[MQTTOPERATION_LOCAL_QUEUE];
+static MQTTBuffer_Ring_T localCommands;
+static MQTTAggregate_T aggregates[INVENTORY_STREAM_COUNT];
+static uint32_t aggregateWindow = 0UL;
+static uint32_t batchSize = 0UL;
+static int16_t vibrationSamples[MQTTSPECTRUM_MAX_AXES][MQTTSPECTRUM_SIZE];
+static bool vibrationPending = false;
+static MQTTNoise_Window_T noiseWindow;
+static TickType_t noiseWindowStart = 0UL;
+static volatile TickType_t noiseWindowTicks = 0UL;
+static volatile bool noiseWindowRestart = true;
+static bool payloadBinary = false;
+static bool payloadDelta = false;
+static bool payloadCompress = false;
+static TickType_t binaryTick = 0UL;
+static char binaryLineData[SIZE_LARGE_BUF];
+static MQTTBuffer_Payload_T binaryLine = { 0UL, SIZE_LARGE_BUF, binaryLineData };
+/* packing and compression work on a copy, large enough for asset and sensor payloads */
+static char publishData[SIZE_PACKET_BUF];
+static MQTTBuffer_Payload_T publishScratch = { 0UL, SIZE_PACKET_BUF, publishData };
+/* measurements replayed from the SD card */
+static char offlineData[SIZE_PACKET_BUF];
+static MQTTBuffer_Payload_T offlinePayload = { 0UL, SIZE_PACKET_BUF, offlineData };
+static TickType_t offlineDrainTicks = 0UL;
 SemaphoreHandle_t semaphoreAssetBuffer;
-SemaphoreHandle_t semaphoreSensorBuffer;
-QueueHandle_t commandQueue;
+/* received commands waiting to be executed by the publish loop */
+static uint32_t commandStorage[MQTTOPERATION_COMMAND_STORAGE / sizeof(uint32_t)];
+static MQTTCommand_Queue_T commandQueue;
 
 /* global variables ********************************************************* */
-extern SensorDataBuffer sensorStreamBuffer;
-extern AssetDataBuffer assetStreamBuffer;
 extern MQTT_Setup_TZ MqttSetupInfo;
 extern MQTT_Connect_TZ MqttConnectInfo;
 extern MQTT_Credentials_TZ MqttCredentials;
@@ -73,7 +266,8 @@ extern CmdProcessor_T MainCmdProcessor;
 /* inline functions ********************************************************* */
 
 /* local functions ********************************************************** */
-static void MQTTOperation_ClientReceive(MQTT_SubscribeCBParam_TZ param);
+static void MQTTOperation_ErrorReceive(MQTT_SubscribeCBParam_TZ param);
+static void MQTTOperation_CommandReceive(MQTT_SubscribeCBParam_TZ param);
 static void MQTTOperation_ClientPublish(void);
 static void MQTTOperation_AssetUpdate(xTimerHandle xTimer);
 static Retcode_T MQTTOperation_SubscribeTopics(void);
@@ -82,22 +276,148 @@ static void MQTTOperation_StartTimer(void);
 static void MQTTOperation_StopTimer(void);
 static void MQTTOperation_RestartCallback(xTimerHandle xTimer);
 static Retcode_T MQTTOperation_ValidateWLANConnectivity(void);
-static void MQTTOperation_SensorUpdate(xTimerHandle xTimer);
+static void MQTTOperation_SensorUpdate(uint32_t channels);
+static void MQTTOperation_ConfigureRates(void);
+static void MQTTOperation_ConfigureAggregation(void);
+static void MQTTOperation_ConfigureBatch(void);
+static void MQTTOperation_ConfigureNoise(void);
+static void MQTTOperation_ConfigurePayload(void);
+static void MQTTOperation_ConfigureOffline(void);
+static void MQTTOperation_ConfigureBacklog(void);
+static void MQTTOperation_ConfigurePublish(void);
+static bool MQTTOperation_IsTimed(void);
+static void MQTTOperation_EncodeSensorData(MQTTBuffer_Payload_T * payload, uint32_t counter);
+static void MQTTOperation_Completed(PublishSource_T source, void * context, Retcode_T result);
+static void MQTTOperation_SensorPublished(MQTT_PublishHandle_TZ handle, void * context, Retcode_T result);
+static void MQTTOperation_AssetPublished(MQTT_PublishHandle_TZ handle, void * context, Retcode_T result);
+static void MQTTOperation_OfflinePublished(MQTT_PublishHandle_TZ handle, void * context, Retcode_T result);
+static void MQTTOperation_AssetCompleted(Retcode_T result);
+static bool MQTTOperation_EncodeHeader(MQTTBuffer_Payload_T * payload, TickType_t tick);
+static bool MQTTOperation_EncodeValues(MQTTBuffer_Payload_T * payload, TickType_t tick, uint8_t tag,
+		const int32_t * values, uint8_t count, uint8_t decimals);
+static MQTTBuffer_Payload_T * MQTTOperation_LineTarget(MQTTBuffer_Payload_T * payload);
+static bool MQTTOperation_EndLine(MQTTFormat_Line_T * line, MQTTBuffer_Payload_T * payload, TickType_t tick);
+static void MQTTOperation_WindowNoise(SensorSample_T * sample);
+static bool MQTTOperation_FormatAggregate(MQTTBuffer_Payload_T * payload, MQTTInventory_Stream_T stream,
+		TickType_t tick, const char * time, uint8_t decimals);
+static bool MQTTOperation_ReadChannel(SensorChannel_T channel, Sensor_Value_T * value);
+static bool MQTTOperation_CaptureVibration(MQTTSpectrum_Result_T * result);
+static bool MQTTOperation_FormatVibration(MQTTBuffer_Payload_T * payload, const MQTTSpectrum_Result_T * result,
+		TickType_t tick, const char * time);
 static float MQTTOperation_CalcSoundPressure(float acousticRawValue);
-static void MQTTOperation_ExecuteCommand(char * commandBuffer);
-static void MQTTOperation_PrepareAssetUpdate(void);
+static void MQTTOperation_ExecuteCommand(const MQTTCommand_T * received);
+static void MQTTOperation_CheckCommands(void);
+static void MQTTOperation_CommandRestart(const CommandArgs_T * args);
+static void MQTTOperation_CommandSpeed(const CommandArgs_T * args);
+static void MQTTOperation_CommandToggle(const CommandArgs_T * args);
+static void MQTTOperation_CommandStart(const CommandArgs_T * args);
+static void MQTTOperation_CommandStop(const CommandArgs_T * args);
+static void MQTTOperation_CommandPrintConfig(const CommandArgs_T * args);
+static void MQTTOperation_CommandResetBoot(const CommandArgs_T * args);
+static void MQTTOperation_CommandSensor(const CommandArgs_T * args);
+static void MQTTOperation_CommandConfig(const CommandArgs_T * args);
+static void MQTTOperation_CommandLog(const CommandArgs_T * args);
+static void MQTTOperation_CommandVibration(const CommandArgs_T * args);
+static void MQTTOperation_CommandFirmware(const CommandArgs_T * args);
+static void MQTTOperation_Dispatch(const CommandEntry_T * entry, const CommandArgs_T * args);
+static bool MQTTOperation_PushCommand(const MQTTCommand_T * command);
+static void MQTTOperation_ConfigureCommands(void);
+static bool MQTTOperation_PrepareAssetUpdate(MQTTBuffer_Payload_T * asset);
+static bool MQTTOperation_FormatFirmware(MQTTBuffer_Payload_T * asset);
+static void MQTTOperation_FormatSampling(MQTTBuffer_Payload_T * asset);
+static bool MQTTOperation_FormatAssetLine(MQTTBuffer_Payload_T * asset, const char * template, const char * value);
+static bool MQTTOperation_FormatProgress(MQTTBuffer_Payload_T * asset);
+static bool MQTTOperation_FormatLines(MQTTBuffer_Payload_T * asset, uint8_t pending);
+static bool MQTTOperation_FormatCommand(MQTTBuffer_Payload_T * asset);
+static void MQTTOperation_Acknowledge(void);
+static void MQTTOperation_NotifyPublisher(void);
+static bool MQTTOperation_FormatValues(MQTTBuffer_Payload_T * payload, const char * template,
+		const char * source, const int32_t * values, uint8_t count, uint8_t decimals);
+static bool MQTTOperation_FormatStream(MQTTBuffer_Payload_T * payload, SensorSample_T * sample,
+		const char * time, MQTTInventory_Stream_T stream, const int32_t * values, uint8_t count, uint8_t decimals);
+static bool MQTTOperation_FormatSample(MQTTBuffer_Payload_T * payload, SensorSample_T * sample);
+static void MQTTOperation_InitPool(MQTTBuffer_Pool_T * pool, MQTTBuffer_Payload_T * payloads, uint8_t count, char * data, uint32_t size);
+
+/* the commands the device executes */
+static const CommandEntry_T commandConfig = { TEMPLATE_ID_COMMAND, "config", CMD_CONFIG, 2U, COMMAND_ARG_CONFIG,
+		DEVICE_OPERATION_BEFORE_EXECUTING, MQTTOperation_CommandConfig, 0U };
+static const CommandEntry_T commandPrintConfig = { TEMPLATE_ID_COMMAND, "printConfig", CMD_COMMAND, 0U, COMMAND_ARG_NONE,
+		DEVICE_OPERATION_IMMEDIATE_EXECUTE_BUTTON, MQTTOperation_CommandPrintConfig, 0U };
+static const CommandEntry_T commandRestart = { TEMPLATE_ID_RESTART, "", CMD_RESTART, 0U, COMMAND_ARG_NONE,
+		DEVICE_OPERATION_BEFORE_EXECUTING, MQTTOperation_CommandRestart, 0U };
+// skip phase BEFORE_EXECUTING, because LED is switched on immediately
+static const CommandEntry_T commandMessage = { TEMPLATE_ID_MESSAGE, "", CMD_MESSAGE, 1U, COMMAND_ARG_TEXT,
+		DEVICE_OPERATION_IMMEDIATE_EXECUTE_CMD, MQTTOperation_CommandToggle, 0U };
+static const CommandEntry_T commandFirmware = { TEMPLATE_ID_FIRMWARE, "", CMD_FIRMWARE, 3U, COMMAND_ARG_TEXT,
+		DEVICE_OPERATION_BEFORE_EXECUTING, MQTTOperation_CommandFirmware, COMMAND_LINE_FIRMWARE };
+static const CommandEntry_T commandRequest = { TEMPLATE_ID_COMMAND, "requestCommands", CMD_REQUEST, 0U, COMMAND_ARG_NONE,
+		DEVICE_OPERATION_IMMEDIATE_EXECUTE_BUTTON, NULL, COMMAND_LINE_REQUEST };
+static const CommandEntry_T commandSpeed = { TEMPLATE_ID_COMMAND, "speed", CMD_SPEED, 1U, COMMAND_ARG_NUMBER,
+		DEVICE_OPERATION_BEFORE_EXECUTING, MQTTOperation_CommandSpeed, COMMAND_LINE_CONFIG };
+static const CommandEntry_T commandStopButton = { TEMPLATE_ID_COMMAND, "stopButton", CMD_PUBLISH_STOP, 0U, COMMAND_ARG_NONE,
+		DEVICE_OPERATION_IMMEDIATE_EXECUTE_BUTTON, MQTTOperation_CommandStop, COMMAND_LINE_STOPPED };
+static const CommandEntry_T commandVibration = { TEMPLATE_ID_COMMAND, "vibration", CMD_VIBRATION, 0U, COMMAND_ARG_NONE,
+		DEVICE_OPERATION_BEFORE_EXECUTING, MQTTOperation_CommandVibration, 0U };
+static const CommandEntry_T commandStop = { TEMPLATE_ID_COMMAND, "stop", CMD_PUBLISH_STOP, 0U, COMMAND_ARG_NONE,
+		DEVICE_OPERATION_IMMEDIATE_EXECUTE_CMD, MQTTOperation_CommandStop, COMMAND_LINE_STOPPED };
+static const CommandEntry_T commandRestartConfirm = { TEMPLATE_ID_COMMAND, "restartConfirm", CMD_RESTART, 0U, COMMAND_ARG_NONE,
+		DEVICE_OPERATION_EXECUTING, MQTTOperation_CommandResetBoot, 0U };
+static const CommandEntry_T commandResetBoot = { TEMPLATE_ID_COMMAND, "resetBootstatus", CMD_COMMAND, 0U, COMMAND_ARG_NONE,
+		DEVICE_OPERATION_IMMEDIATE_EXECUTE_BUTTON, MQTTOperation_CommandResetBoot, 0U };
+static const CommandEntry_T commandStart = { TEMPLATE_ID_COMMAND, "start", CMD_PUBLISH_START, 0U, COMMAND_ARG_NONE,
+		DEVICE_OPERATION_IMMEDIATE_EXECUTE_CMD, MQTTOperation_CommandStart, COMMAND_LINE_STARTED };
+// skip phase BEFORE_EXECUTING, because LED is switched on immediately
+static const CommandEntry_T commandToggle = { TEMPLATE_ID_COMMAND, "toggle", CMD_TOGGLE, 0U, COMMAND_ARG_NONE,
+		DEVICE_OPERATION_IMMEDIATE_EXECUTE_CMD, MQTTOperation_CommandToggle, 0U };
+static const CommandEntry_T commandLog = { TEMPLATE_ID_COMMAND, "log", CMD_LOG, 1U, COMMAND_ARG_FLAG,
+		DEVICE_OPERATION_BEFORE_EXECUTING, MQTTOperation_CommandLog, 0U };
+static const CommandEntry_T commandStartButton = { TEMPLATE_ID_COMMAND, "startButton", CMD_PUBLISH_START, 0U, COMMAND_ARG_NONE,
+		DEVICE_OPERATION_IMMEDIATE_EXECUTE_BUTTON, MQTTOperation_CommandStart, COMMAND_LINE_STARTED };
+static const CommandEntry_T commandSensor = { TEMPLATE_ID_COMMAND, "sensor", CMD_SENSOR, 2U, COMMAND_ARG_SENSOR,
+		DEVICE_OPERATION_BEFORE_EXECUTING, MQTTOperation_CommandSensor, COMMAND_LINE_CONFIG };
 
-static MQTT_Subscribe_TZ MqttSubscribeCommandInfo = { .Topic =
-		TOPIC_DOWNSTREAM_CUSTOM, .QoS = MQTT_QOS_AT_MOST_ONE,
-		.IncomingPublishNotificationCB = MQTTOperation_ClientReceive, };/**< MQTT subscribe parameters */
-
-static MQTT_Subscribe_TZ MqttSubscribeRestartInfo = { .Topic =
-		TOPIC_DOWNSTREAM_STANDARD, .QoS = MQTT_QOS_AT_MOST_ONE,
-		.IncomingPublishNotificationCB = MQTTOperation_ClientReceive, };/**< MQTT subscribe parameters */
+/**
+ * The received commands by the hash of their template and sub command, see MQTTCommand_Slot
+ */
+static const CommandEntry_T * const commandTable[MQTTCOMMAND_SLOTS] = {
+		[2] = &commandConfig,
+		[3] = &commandPrintConfig,
+		[8] = &commandRestart,
+		[9] = &commandMessage,
+		[10] = &commandFirmware,
+		[11] = &commandRequest,
+		[12] = &commandSpeed,
+		[13] = &commandStopButton,
+		[14] = &commandVibration,
+		[18] = &commandStop,
+		[19] = &commandRestartConfirm,
+		[25] = &commandResetBoot,
+		[26] = &commandStart,
+		[27] = &commandToggle,
+		[28] = &commandLog,
+		[29] = &commandStartButton,
+		[31] = &commandSensor,
+};
 
-static MQTT_Subscribe_TZ MqttSubscribeErrorInfo = { .Topic =
-		TOPIC_DOWNSTREAM_ERROR, .QoS = MQTT_QOS_AT_MOST_ONE,
-		.IncomingPublishNotificationCB = MQTTOperation_ClientReceive, };/**< MQTT subscribe parameters */
+/**
+ * The commands of the device itself by MQTTOperation_Local_T, they take no arguments
+ */
+static const CommandEntry_T * const localTable[MQTTOPERATION_LOCAL_COMMANDS] = {
+		[MQTTOPERATION_LOCAL_START_BUTTON] = &commandStartButton,
+		[MQTTOPERATION_LOCAL_STOP_BUTTON] = &commandStopButton,
+		[MQTTOPERATION_LOCAL_REQUEST_COMMANDS] = &commandRequest,
+		[MQTTOPERATION_LOCAL_RESET_BOOTSTATUS] = &commandResetBoot,
+		[MQTTOPERATION_LOCAL_PRINT_CONFIG] = &commandPrintConfig,
+		[MQTTOPERATION_LOCAL_RESTART_CONFIRM] = &commandRestartConfirm,
+};
+
+static MQTT_Subscribe_TZ MqttSubscribeInfo[MQTTOPERATION_TOPICS] = {
+		{ .Topic = TOPIC_DOWNSTREAM_CUSTOM, .QoS = MQTT_QOS_AT_MOST_ONE,
+				.IncomingPublishNotificationCB = MQTTOperation_CommandReceive, },
+		{ .Topic = TOPIC_DOWNSTREAM_STANDARD, .QoS = MQTT_QOS_AT_MOST_ONE,
+				.IncomingPublishNotificationCB = MQTTOperation_CommandReceive, },
+		{ .Topic = TOPIC_DOWNSTREAM_ERROR, .QoS = MQTT_QOS_AT_MOST_ONE,
+				.IncomingPublishNotificationCB = MQTTOperation_ErrorReceive, }, };/**< MQTT subscribe parameters, subscribed with one packet */
 
 static MQTT_Publish_TZ MqttPublishAssetInfo = { .Topic = TOPIC_ASSET_STREAM,
 		.QoS = MQTT_QOS_AT_MOST_ONE, .Payload = NULL, .PayloadLength = 0UL, };/**< MQTT publish parameters */
@@ -106,285 +426,264 @@ static MQTT_Publish_TZ MqttPublishDataInfo = { .Topic = TOPIC_DATA_STREAM,
 		.QoS = MQTT_QOS_AT_MOST_ONE, .Payload = NULL, .PayloadLength = 0UL, };/**< MQTT publish parameters */
 
 /**
- * @brief callback function for subriptions
- *        toggles LEDS or sets read data flag
+ * @brief callback function for the error topic, reports the error as event
  *
- * @param[in] md - received message from the MQTT Broker
+ * @param[in] param - received message from the MQTT Broker
  *
  * @return NONE
  */
-static void MQTTOperation_ClientReceive(MQTT_SubscribeCBParam_TZ param) {
-
-	/* Initialize Variables */
-	static char appIncomingMsgTopicBuffer[SIZE_SMALL_BUF];/**< Incoming message topic buffer */
-	static char appIncomingMsgPayloadBuffer[SIZE_LARGE_BUF];/**< Incoming message payload buffer */
-
-	memset(appIncomingMsgTopicBuffer, 0, sizeof(appIncomingMsgTopicBuffer));
-	memset(appIncomingMsgPayloadBuffer, 0, sizeof(appIncomingMsgPayloadBuffer));
-
-	strncpy(appIncomingMsgTopicBuffer, (const char *) param.Topic,
-			fmin(param.TopicLength, (sizeof(appIncomingMsgTopicBuffer) - 1U)));
-	strncpy(appIncomingMsgPayloadBuffer, (const char *) param.Payload,
-			fmin(param.PayloadLength,
-					(sizeof(appIncomingMsgPayloadBuffer) - 1U)));
-
-	if (strncmp(appIncomingMsgTopicBuffer, TOPIC_DOWNSTREAM_ERROR,
-			strlen(TOPIC_DOWNSTREAM_ERROR)) == 0) {
-		LOG_AT_ERROR(
-				("MQTTOperation: Error from upstream: %.*s, Error Msg : %.*s\r\n", (int) param.TopicLength, appIncomingMsgTopicBuffer, (int) param.PayloadLength, appIncomingMsgPayloadBuffer));
-		assetStreamBuffer.length +=
-				snprintf(assetStreamBuffer.data + assetStreamBuffer.length,
-						sizeof(assetStreamBuffer.data)
-								- assetStreamBuffer.length,
-						"400,xdk_ErrorCountEvent,\"Error Msg : %.*s\"\r\n",
-						(int) param.PayloadLength, appIncomingMsgPayloadBuffer);
-	} else {
-		LOG_AT_INFO(
-				("MQTTOperation: Upstream msg: Topic: %.*s, Msg Received: %.*s\r\n", (int) param.TopicLength, appIncomingMsgTopicBuffer, (int) param.PayloadLength, appIncomingMsgPayloadBuffer));
+static void MQTTOperation_ErrorReceive(MQTT_SubscribeCBParam_TZ param) {
+	LOG_AT_ERROR(
+			("MQTTOperation: Error from upstream: %.*s, Error Msg : %.*s\r\n", (int) param.TopicLength, param.Topic, (int) param.PayloadLength, param.Payload));
+	// the asset timer fills the same payload, so keep the producers apart
+	if (pdPASS == xSemaphoreTake(semaphoreAssetBuffer, pdMS_TO_TICKS(SEMAPHORE_TIMEOUT))) {
+		MQTTBuffer_Payload_T * asset = MQTTBuffer_PoolAcquire(&assetPool);
+		if (asset != NULL) {
+			MQTTFormat_Line_T line;
+			MQTTFormat_BeginLine(&line, asset);
+			MQTTFormat_Text(&line, "400,xdk_ErrorCountEvent,\"Error Msg : ");
+			MQTTFormat_TextN(&line, param.Payload, param.PayloadLength);
+			MQTTFormat_Char(&line, '"');
+			MQTTFormat_EndLine(&line);
+			MQTTBuffer_PoolSeal(&assetPool);
+		}
+		xSemaphoreGive(semaphoreAssetBuffer);
+	}
+}
 
-		AppController_SetCmdStatus(APP_STATUS_COMMAND_RECEIVED);
-		// split batch of commands in single commands
-		char *token = strtok(appIncomingMsgPayloadBuffer, "\n");
-		while (token != NULL) {
+/**
+ * @brief callback function for the command and operation topics, queues the commands
+ *
+ * The lines are parsed where the stack received them, only the typed
+ * commands are copied into the queue, so batches of any length are handled.
+ *
+ * @param[in] param - received message from the MQTT Broker
+ *
+ * @return NONE
+ */
+static void MQTTOperation_CommandReceive(MQTT_SubscribeCBParam_TZ param) {
+	static MQTTCommand_T received;
+	const char * cursor = param.Payload;
+	MQTTCommand_Token_T line;
+
+	LOG_AT_INFO(
+			("MQTTOperation: Upstream msg: Topic: %.*s, Msg Received: %.*s\r\n", (int) param.TopicLength, param.Topic, (int) param.PayloadLength, param.Payload));
+
+	AppController_SetCmdStatus(APP_STATUS_COMMAND_RECEIVED);
+	// split batch of commands in single commands
+	while (MQTTCommand_NextLine(&cursor, param.Payload + param.PayloadLength, &line)) {
+		if (MQTTCommand_Parse(line.start, line.length, &received) == false) {
 			LOG_AT_ERROR(
-					("MQTTOperation: Try to place command [%s] in queue!\r\n", token));
-			if (xQueueSend(commandQueue,token, 0) != pdTRUE) {
-				LOG_AT_ERROR(
-						("MQTTOperation_ClientReceive: Could not buffer command!\r\n"));
-				break;
-			}
-			token = strtok(NULL, "\n");
+					("MQTTOperation_CommandReceive: Command too long: [%.*s]\r\n", (int) line.length, line.start));
+			continue;
+		}
+		LOG_AT_DEBUG(
+				("MQTTOperation: Try to place command [%.*s] in queue!\r\n", (int) line.length, line.start));
+		if (MQTTOperation_PushCommand(&received) == false) {
+			LOG_AT_ERROR(
+					("MQTTOperation_CommandReceive: Could not buffer command, rejected: [%lu]!\r\n", commandQueue.rejected));
 		}
-
 	}
-
+	MQTTOperation_NotifyPublisher();
 }
 
-static void MQTTOperation_ExecuteCommand(char * commandBuffer) {
-	/* Initialize Variables */
+/**
+ * @brief Log commands that are not in the slot of their hash, they would never be found
+ */
+static void MQTTOperation_CheckCommands(void) {
+	for (uint8_t slot = 0U; slot < MQTTCOMMAND_SLOTS; slot++) {
+		const CommandEntry_T * entry = commandTable[slot];
+		if (entry != NULL && MQTTCommand_Slot(entry->template, entry->name) != slot) {
+			LOG_AT_ERROR(("MQTTOperation: Command [%u,%s] not in its slot\r\n", entry->template, entry->name));
+		}
+	}
+}
 
-	command = CMD_UNKNOWN;
+/**
+ * @brief Convert the arguments of a command as its table entry declares
+ *
+ * @return false if an argument is not valid
+ */
+static bool MQTTOperation_ParseArgs(const CommandEntry_T * entry, const MQTTCommand_T * received, uint8_t first, CommandArgs_T * args) {
+	const char * token = MQTTCommand_Arg(received, first);
+
+	memset(args, 0x00, sizeof(*args));
+	switch (entry->kind) {
+	case COMMAND_ARG_NUMBER:
+		args->number = strtol(token, (char **) NULL, 10);
+		break;
+	case COMMAND_ARG_FLAG:
+		args->number = (strcmp(token, "TRUE") == 0 || strcmp(token, "1") == 0) ? 1L : 0L;
+		break;
+	case COMMAND_ARG_SENSOR:
+		args->setting.key = MQTTCfgParser_FindKey(token);
+		args->setting.value = MQTTCommand_Arg(received, first + 1U);
+		if (args->setting.key < ATT_IDX_ACCEL || args->setting.key > ATT_IDX_NOISE) {
+			LOG_AT_WARNING(("MQTTOperation: Sensor not supported: %s\r\n", token));
+			return false;
+		}
+		break;
+	case COMMAND_ARG_CONFIG:
+		args->setting.key = MQTTCfgParser_FindKey(token);
+		args->setting.value = MQTTCommand_Arg(received, first + 1U);
+		if (args->setting.key < 0) {
+			LOG_AT_WARNING(("MQTTOperation: Config change not supported: %s\r\n", token));
+			return false;
+		}
+		break;
+	case COMMAND_ARG_TEXT:
+		for (uint8_t i = 0U; i < entry->arity && first + i < MQTTCOMMAND_ARGS; i++) {
+			args->text[i] = MQTTCommand_Arg(received, first + i);
+		}
+		break;
+	default:
+		break;
+	}
+	return true;
+}
 
-	LOG_AT_INFO(("MQTTOperation: Execute command: [%s]\r\n", commandBuffer));
+/**
+ * @brief Execute a command with converted arguments, received or of the device itself
+ */
+static void MQTTOperation_Dispatch(const CommandEntry_T * entry, const CommandArgs_T * args) {
+	LOG_AT_DEBUG(
+			("MQTTOperation: Command: [%u,%s] recognized as command: [%i]\r\n", entry->template, entry->name, entry->command));
+	command = entry->command;
+	if (entry->handler != NULL) {
+		entry->handler(args);
+	}
+	// the asset timer must not acknowledge a command that is still executing, it sees progress and lines together
+	taskENTER_CRITICAL();
+	commandProgress = entry->progress;
+	commandLines |= entry->lines;
+	taskEXIT_CRITICAL();
+}
 
-	// split payload into tokens
-	int token_pos = 0;
-	int config_index = -1;
-	bool commandComplete = false;
-	char *token = strtok(commandBuffer, ",:");
+static void MQTTOperation_ExecuteCommand(const MQTTCommand_T * received) {
+	// only the standard command template has sub commands
+	const bool hasName = (received->template == TEMPLATE_ID_COMMAND);
+	const char * name = hasName ? MQTTCommand_Arg(received, 0U) : "";
+	const uint8_t first = hasName ? 1U : 0U;
+	const CommandEntry_T * entry = commandTable[MQTTCommand_Slot(received->template, name)];
+	CommandArgs_T args;
 
-	while (token != NULL) {
-		LOG_AT_TRACE(("MQTTOperation: Processing token: [%s], token_pos: [%i] \r\n", token, token_pos));
+	LOG_AT_INFO(("MQTTOperation: Execute command: template [%u], [%s]\r\n", received->template, name));
 
-		switch (token_pos) {
-		case 0:
-			if (strcmp(token, TEMPLATE_STD_RESTART) == 0) {
-				LOG_AT_TRACE(("MQTTOperation: Starting restart \r\n"));
-				AppController_SetAppStatus(APP_STATUS_REBOOT);
-				// set flag so that XDK acknowledges reboot command
-				command = CMD_RESTART;
-				commandComplete = true;
-				MQTTOperation_StartRestartTimer(REBOOT_DELAY);
-				LOG_AT_TRACE(("MQTTOperation: Ending restart\r\n"));
-			} else if (strcmp(token, TEMPLATE_STD_COMMAND) == 0) {
-				command = CMD_COMMAND;
-			} else if (strcmp(token, TEMPLATE_STD_FIRMWARE) == 0) {
-				command = CMD_FIRMWARE;
-			} else if (strcmp(token, TEMPLATE_CUS_MESSAGE) == 0) {
-				command = CMD_MESSAGE;
-			} else {
-				// set command as unknown
-				command = CMD_UNKNOWN;
-			}
-			break;
-		case 1:
-			//do nothing, ignore the device ID
-			break;
-		case 2:
-			if (command == CMD_COMMAND) {
-				if (strcmp(token, "speed") == 0) {
-					command = CMD_SPEED;
-				} else if (strcmp(token, "toggle") == 0) {
-					BSP_LED_Switch((uint32_t) BSP_XDK_LED_Y, (uint32_t) BSP_LED_COMMAND_TOGGLE);
-					command = CMD_TOGGLE;
-					commandComplete = true;
-					// skip phase BEFORE_EXECUTING, because LED is switched on immediately
-					commandProgress = DEVICE_OPERATION_IMMEDIATE_EXECUTE_CMD;
-				} else if (strcmp(token, "start") == 0) {
-					commandProgress = DEVICE_OPERATION_IMMEDIATE_EXECUTE_CMD;
-					command = CMD_PUBLISH_START;
-					commandComplete = true;
-					assetUpdateProcess = APP_ASSET_WAITING;
-					MQTTOperation_StartTimer();
-				} else if (strcmp(token, "startButton") == 0) {
-					commandProgress = DEVICE_OPERATION_IMMEDIATE_EXECUTE_BUTTON;
-					command = CMD_PUBLISH_START;
-					commandComplete = true;
-					assetUpdateProcess = APP_ASSET_WAITING;
-					MQTTOperation_StartTimer();
-				} else if (strcmp(token, "stop") == 0) {
-					commandProgress = DEVICE_OPERATION_IMMEDIATE_EXECUTE_CMD;
-					command = CMD_PUBLISH_STOP;
-					commandComplete = true;
-					assetUpdateProcess = APP_ASSET_WAITING;
-					MQTTOperation_StopTimer();
-				} else if (strcmp(token, "stopButton") == 0) {
-					commandProgress = DEVICE_OPERATION_IMMEDIATE_EXECUTE_BUTTON;
-					command = CMD_PUBLISH_STOP;
-					commandComplete = true;
-					assetUpdateProcess = APP_ASSET_WAITING;
-					MQTTOperation_StopTimer();
-				} else if (strcmp(token, "printConfig") == 0) {
-					commandProgress = DEVICE_OPERATION_IMMEDIATE_EXECUTE_BUTTON;
-					command = CMD_COMMAND;
-					commandComplete = true;
-
-					ConfigDataBuffer localbuffer;
-					localbuffer.length = NUMBER_UINT32_ZERO;
-					memset(localbuffer.data, 0x00, SIZE_XXLARGE_BUF);
-					MQTTStorage_Flash_ReadConfig(&localbuffer);
-					LOG_AT_DEBUG(
-							("MQTTOperation: Current configuration in flash:\r\n%s\r\n", localbuffer.data));
-
-					localbuffer.length = NUMBER_UINT32_ZERO;
-					memset(localbuffer.data, 0x00, SIZE_XXLARGE_BUF);
-					MQTTCfgParser_GetConfig(&localbuffer, CFG_FALSE);
-					LOG_AT_DEBUG(
-							("5s: Currently used configuration:\r\n%s\r\n", localbuffer.data));
-				} else if (strcmp(token, "resetBootstatus") == 0) {
-					commandProgress = DEVICE_OPERATION_IMMEDIATE_EXECUTE_BUTTON;
-					command = CMD_COMMAND;
-					commandComplete = true;
-					MQTTStorage_Flash_WriteBootStatus(
-							(uint8_t*) NO_BOOT_PENDING);
-				} else if (strcmp(token, "requestCommands") == 0) {
-					commandProgress = DEVICE_OPERATION_IMMEDIATE_EXECUTE_BUTTON;
-					command = CMD_REQUEST;
-					commandComplete = true;
-				} else if (strcmp(token, "sensor") == 0) {
-					command = CMD_SENSOR;
-				} else if (strcmp(token, "config") == 0) {
-					command = CMD_CONFIG;
-				} else if (strcmp(token, "restartConfirm") == 0) {
-					command = CMD_RESTART;
-					commandComplete = true;
-					commandProgress = DEVICE_OPERATION_EXECUTING;
-					MQTTStorage_Flash_WriteBootStatus((uint8_t*) NO_BOOT_PENDING);
-				} else if (strcmp(token, "log") == 0) {
-					command = CMD_LOG;
-				} else {
-					commandProgress = DEVICE_OPERATION_BEFORE_FAILED;
-					LOG_AT_WARNING(("MQTTOperation: Unknown command: %s\r\n", token));
-				}
-				LOG_AT_DEBUG(
-						("MQTTOperation: Token: [%s] recognized as command: [%i]\r\n", token, command));
-			} else if (command == CMD_FIRMWARE) {
-				LOG_AT_DEBUG(
-						("MQTTOperation: Phase parse command firmware name: token_pos: [%i]\r\n",token_pos));
-				MQTTCfgParser_SetFirmwareName(token);
-			} else if (command == CMD_MESSAGE) {
-				BSP_LED_Switch((uint32_t) BSP_XDK_LED_Y,
-						(uint32_t) BSP_LED_COMMAND_TOGGLE);
-				commandComplete = true;
-				// skip phase BEFORE_EXECUTING, because LED is switched on immediately
-				commandProgress = DEVICE_OPERATION_IMMEDIATE_EXECUTE_CMD;
-			}
-			break;
-		case 3:
-			if (command == CMD_SPEED) {
-				int speed = strtol(token, (char **) NULL, 10);
-				speed = (speed <= 2 * MINIMAL_SPEED) ?
-						2 * MINIMAL_SPEED : speed;
-				LOG_AT_DEBUG(
-						("MQTTOperation: Phase execute command speed, new speed: [%i]\r\n", speed));
-				tickRateMS = (int) pdMS_TO_TICKS(speed);
-				xTimerChangePeriod(timerHandleSensor, tickRateMS,
-						UINT32_C(0xffff));
-				MQTTCfgParser_SetStreamRate(speed);
-				MQTTCfgParser_FLWriteConfig();
-				assetUpdateProcess = APP_ASSET_WAITING;
-				commandComplete = true;
-			} else if (command == CMD_SENSOR) {
-				LOG_AT_DEBUG(
-						("MQTTOperation: Phase parse command sensor: token_pos: [%i]\r\n", token_pos));
-				for (int var = ATT_IDX_ACCEL; var <= ATT_IDX_NOISE; ++var) {
-					if (strcmp(token, ATT_KEY_NAME[var]) == 0) {
-						config_index = var;
-						break;
-					}
-				}
-				if (config_index == -1) {
-					commandProgress = DEVICE_OPERATION_BEFORE_FAILED;
-					LOG_AT_WARNING(
-							("MQTTOperation: Sensor not supported: %s\r\n", token));
-				}
-			} else if (command == CMD_LOG) {
-				LOG_AT_DEBUG(
-						("MQTTOperation: Phase parse command log: token_pos: [%i]\r\n", token_pos));
-				if (strcmp(token,"TRUE") == 0 || strcmp(token,"1") == 0 )
-					logging_enabled = 1;
-				else
-					logging_enabled = 0;
-
-				assetUpdateProcess = APP_ASSET_WAITING;
-				commandComplete = true;
-			} else if (command == CMD_FIRMWARE) {
-				LOG_AT_DEBUG(
-						("MQTTOperation: Phase execute command firmware version: token_pos: [%i]\r\n", token_pos));
-				MQTTCfgParser_SetFirmwareVersion(token);
-			} else if (command == CMD_CONFIG) {
-				LOG_AT_DEBUG(
-						("MQTTOperation: Phase parse command config: token_pos: [%i]\r\n", token_pos));
-				for (int var = 0; var < ATT_IDX_SIZE; ++var) {
-					if (strcmp(token, ATT_KEY_NAME[var]) == 0) {
-						config_index = var;
-						break;
-					}
-				}
-				if (config_index == -1) {
-					commandProgress = DEVICE_OPERATION_BEFORE_FAILED;
-					LOG_AT_WARNING(
-							("MQTTOperation: Config change not supported: %s\r\n", token));
-				}
-			}
-			break;
-		case 4:
-			if (command == CMD_SENSOR) {
-				LOG_AT_DEBUG(
-						("MQTTOperation: Phase execute command sensor: token_pos: [%i]\r\n", token_pos));
-				MQTTCfgParser_SetSensor(token, config_index);
-				MQTTCfgParser_FLWriteConfig();
-				assetUpdateProcess = APP_ASSET_WAITING;
-				commandComplete = true;
-			} else if (command == CMD_CONFIG) {
-				LOG_AT_DEBUG(
-						("MQTTOperation: Phase execute command config: token_pos: [%i]\r\n", token_pos));
-				MQTTCfgParser_SetConfig(token, config_index);
-				MQTTCfgParser_FLWriteConfig();
-				assetUpdateProcess = APP_ASSET_WAITING;
-				commandComplete = true;
-			} else if (command == CMD_FIRMWARE) {
-				LOG_AT_DEBUG(
-						("MQTTOperation: Phase parse firmware url: token_pos: [%i]\r\n", token_pos));
-				MQTTCfgParser_SetFirmwareURL(token);
-				MQTTCfgParser_FLWriteConfig();
-				assetUpdateProcess = APP_ASSET_WAITING;
-				commandComplete = true;
-			}
-			break;
-		default:
-			LOG_AT_WARNING(("MQTTOperation: Error parsing command!\r\n"));
-			break;
-		}
-		token = strtok(NULL, ", ");
-		token_pos++;
+	if (entry == NULL || entry->template != received->template || strcmp(entry->name, name) != 0) {
+		command = hasName ? CMD_COMMAND : CMD_UNKNOWN;
+		commandProgress = DEVICE_OPERATION_BEFORE_FAILED;
+		LOG_AT_WARNING(("MQTTOperation: Unknown command: %s\r\n", name));
+		return;
 	}
-	// test if command was complete
-	if (commandComplete == false) {
+	command = entry->command;
+	if (received->count < first + entry->arity) {
 		commandProgress = DEVICE_OPERATION_BEFORE_FAILED;
 		LOG_AT_ERROR(("MQTTOperation: Incomplete command!\r\n"));
+		return;
+	}
+	if (MQTTOperation_ParseArgs(entry, received, first, &args) == false) {
+		commandProgress = DEVICE_OPERATION_BEFORE_FAILED;
+		return;
 	}
+	MQTTOperation_Dispatch(entry, &args);
+}
+
+static void MQTTOperation_CommandRestart(const CommandArgs_T * args) {
+	BCDS_UNUSED(args);
+	LOG_AT_TRACE(("MQTTOperation: Starting restart \r\n"));
+	AppController_SetAppStatus(APP_STATUS_REBOOT);
+	// the command is acknowledged before the reboot
+	MQTTOperation_StartRestartTimer(REBOOT_DELAY);
+}
+
+static void MQTTOperation_CommandSpeed(const CommandArgs_T * args) {
+	int speed = (int) args->number;
+	speed = (speed <= 2 * MINIMAL_SPEED) ?
+			2 * MINIMAL_SPEED : speed;
+	LOG_AT_DEBUG(
+			("MQTTOperation: Phase execute command speed, new speed: [%i]\r\n", speed));
+	tickRateMS = (int) pdMS_TO_TICKS(speed);
+	MQTTCfgParser_SetStreamRate(speed);
+	MQTTOperation_ConfigureRates();
+	MQTTCfgParser_FLWriteConfig();
+}
+
+static void MQTTOperation_CommandToggle(const CommandArgs_T * args) {
+	BCDS_UNUSED(args);
+	BSP_LED_Switch((uint32_t) BSP_XDK_LED_Y, (uint32_t) BSP_LED_COMMAND_TOGGLE);
+}
+
+static void MQTTOperation_CommandStart(const CommandArgs_T * args) {
+	BCDS_UNUSED(args);
+	MQTTOperation_StartTimer();
+}
+
+static void MQTTOperation_CommandStop(const CommandArgs_T * args) {
+	BCDS_UNUSED(args);
+	MQTTOperation_StopTimer();
+}
+
+static void MQTTOperation_CommandPrintConfig(const CommandArgs_T * args) {
+	BCDS_UNUSED(args);
+	// buffer is too large for the stack
+	static ConfigDataBuffer localbuffer;
+	localbuffer.length = NUMBER_UINT32_ZERO;
+	memset(localbuffer.data, 0x00, sizeof(localbuffer.data));
+	MQTTStorage_Flash_ReadConfig(&localbuffer);
+	LOG_AT_DEBUG(
+			("MQTTOperation: Current configuration in flash:\r\n%s\r\n", localbuffer.data));
+
+	localbuffer.length = NUMBER_UINT32_ZERO;
+	memset(localbuffer.data, 0x00, sizeof(localbuffer.data));
+	MQTTCfgParser_GetConfig(&localbuffer, CFG_FALSE);
+	LOG_AT_DEBUG(
+			("5s: Currently used configuration:\r\n%s\r\n", localbuffer.data));
+}
+
+static void MQTTOperation_CommandResetBoot(const CommandArgs_T * args) {
+	BCDS_UNUSED(args);
+	MQTTStorage_Flash_WriteBootStatus((uint8_t*) NO_BOOT_PENDING);
+}
+
+static void MQTTOperation_CommandSensor(const CommandArgs_T * args) {
+	LOG_AT_DEBUG(("MQTTOperation: Phase execute command sensor: [%i]\r\n", args->setting.key));
+	MQTTCfgParser_SetSensor(args->setting.value, args->setting.key);
+	MQTTCfgParser_FLWriteConfig();
+}
+
+static void MQTTOperation_CommandConfig(const CommandArgs_T * args) {
+	LOG_AT_DEBUG(("MQTTOperation: Phase execute command config: [%i]\r\n", args->setting.key));
+	MQTTCfgParser_SetConfig(args->setting.value, args->setting.key);
+	MQTTCfgParser_FLWriteConfig();
+	MQTTInventory_Configure();
+	MQTTOperation_ConfigureNoise();
+	MQTTOperation_ConfigureRates();
+	MQTTOperation_ConfigureAggregation();
+	MQTTOperation_ConfigureBatch();
+	MQTTOperation_ConfigurePayload();
+	MQTTOperation_ConfigureOffline();
+	MQTTOperation_ConfigureBacklog();
+	MQTTOperation_ConfigurePublish();
+	MQTTOperation_ConfigureCommands();
+	MQTTDeadband_Configure();
+}
+
+static void MQTTOperation_CommandLog(const CommandArgs_T * args) {
+	logging_enabled = (args->number != 0L) ? 1 : 0;
+}
+
+static void MQTTOperation_CommandVibration(const CommandArgs_T * args) {
+	BCDS_UNUSED(args);
+	// the capture takes a while, so it is done by the publish loop
+	vibrationPending = true;
+}
 
+static void MQTTOperation_CommandFirmware(const CommandArgs_T * args) {
+	LOG_AT_DEBUG(("MQTTOperation: Phase execute command firmware: [%s]\r\n", args->text[1]));
+	MQTTCfgParser_SetFirmwareName(args->text[0]);
+	MQTTCfgParser_SetFirmwareVersion(args->text[1]);
+	MQTTCfgParser_SetFirmwareURL(args->text[2]);
+	MQTTCfgParser_FLWriteConfig();
 }
 
 static void MQTTOperation_StartRestartTimer(int period) {
@@ -404,7 +703,7 @@ static void MQTTOperation_RestartCallback(xTimerHandle xTimer) {
 	MQTTStorage_Flash_WriteBootStatus((uint8_t *) BOOT_PENDING);
 	MQTTOperation_DeInit();
 	xTimerStop(timerHandleAsset, UINT32_C(0xffff));
-	xTimerStop(timerHandleSensor, UINT32_C(0xffff));
+	MQTTSampler_Stop();
 	BSP_Board_SoftReset();
 }
 
@@ -422,16 +721,27 @@ static void MQTTOperation_ClientPublish(void) {
 
 	semaphoreAssetBuffer = xSemaphoreCreateBinary();
 	xSemaphoreGive(semaphoreAssetBuffer);
-	semaphoreSensorBuffer = xSemaphoreCreateBinary();
-	xSemaphoreGive(semaphoreSensorBuffer);
-	commandQueue = xQueueCreate(4, SIZE_XSMALL_BUF);
+	MQTTBuffer_RingInit(&sensorRing, sensorRingStorage, sizeof(SensorSample_T), SENSOR_RING_SIZE);
+	MQTTBuffer_RingInit(&publishCompletions, publishCompletionStorage, sizeof(PublishCompletion_T), MQTTOPERATION_COMPLETIONS);
+	MQTTBuffer_RingInit(&localCommands, localCommandStorage, sizeof(uint8_t), MQTTOPERATION_LOCAL_QUEUE);
+	MQTTCommand_QueueInit(&commandQueue, commandStorage, sizeof(commandStorage), (uint8_t) MQTTOPERATION_COMMAND_DEPTH);
+	MQTTOperation_ConfigureCommands();
+	MQTTOperation_CheckCommands();
 
 	Retcode_T retcode = RETCODE_OK;
 	// initialize buffers
-	memset(sensorStreamBuffer.data, 0x00, sizeof(sensorStreamBuffer.data));
-	sensorStreamBuffer.length = NUMBER_UINT32_ZERO;
-	memset(assetStreamBuffer.data, 0x00, sizeof(assetStreamBuffer.data));
-	assetStreamBuffer.length = NUMBER_UINT32_ZERO;
+	MQTTOperation_InitPool(&sensorPool, sensorPayloads, MQTTOPERATION_SENSOR_PAYLOADS, &sensorPayloadData[0][0], SIZE_PACKET_BUF);
+	MQTTOperation_InitPool(&assetPool, assetPayloads, MQTTOPERATION_PAYLOADS, &assetPayloadData[0][0], SIZE_XLARGE_BUF);
+	MQTTInventory_Configure();
+	MQTTOperation_ConfigureAggregation();
+	MQTTOperation_ConfigureBatch();
+	MQTTDeadband_Configure();
+	MQTTSpectrum_Init();
+	MQTTOperation_ConfigureNoise();
+	MQTTOperation_ConfigurePayload();
+	MQTTOperation_ConfigureOffline();
+	MQTTOperation_ConfigureBacklog();
+	MQTTOperation_ConfigurePublish();
 
 	timerHandleAsset = xTimerCreate((const char * const ) "Asset Update Timer", // used only for debugging purposes
 			MILLISECONDS(1000), // timer period
@@ -441,14 +751,13 @@ static void MQTTOperation_ClientPublish(void) {
 			);
 	xTimerStart(timerHandleAsset, UINT32_C(0xffff));
 
-	timerHandleSensor = xTimerCreate(
-			(const char * const ) "Sensor Update Timer", // used only for debugging purposes
-			pdMS_TO_TICKS(tickRateMS), // timer period
-			pdTRUE, //Autoreload pdTRUE or pdFALSE - should the timer start again after it expired?
-			NULL, // optional identifier
-			MQTTOperation_SensorUpdate // static callback function
-			);
-	xTimerStart(timerHandleSensor, UINT32_C(0xffff));
+	// sampling runs in its own task at fixed deadlines, independent of the timer daemon
+	retcode = MQTTSampler_Init(MQTTOperation_SensorUpdate);
+	if (RETCODE_OK != retcode) {
+		Retcode_RaiseError(retcode);
+	}
+	MQTTOperation_ConfigureRates();
+	MQTTSampler_Start();
 
 
 	// ckeck if reboot process is pending to be confirmed
@@ -457,124 +766,237 @@ static void MQTTOperation_ClientPublish(void) {
 	LOG_AT_DEBUG(("MQTTOperation: Reading boot status: [%s]\r\n", readbuffer));
 
 	if ((strncmp(readbuffer, BOOT_PENDING, strlen(BOOT_PENDING)) == 0)) {
-		if (xQueueSend(commandQueue,(char *) "511,DUMMY,restartConfirm", 0) != pdTRUE) {
-			LOG_AT_ERROR(("MQTTOperation: Could not buffer command!\r\n"));
-		}
+		MQTTOperation_QueueCommand(NULL, (uint32_t) MQTTOPERATION_LOCAL_RESTART_CONFIRM);
 	}
 
 
 	uint32_t measurementCounter = 0;
-	char commandBuffer[SIZE_XSMALL_BUF] = { 0 };
-	BaseType_t semaphoreResult;
+	uint32_t batchSamples = 0UL;
+	TickType_t batchStart = 0UL;
+	TickType_t clockSynced = 0UL;
+	bool clockValid = false;
+	TickType_t offlineDrained = 0UL;
+	const MQTTCommand_T * pendingCommand;
+	uint8_t pendingLocal;
+	const CommandArgs_T noArgs = { 0L };
+	bool executed;
 	/* A function that implements a task must not exit or attempt to return to
 	 its caller function as there is nothing to return to. */
 	while (1) {
 
 		/* Check whether the WLAN network connection is available */
 		retcode = MQTTOperation_ValidateWLANConnectivity();
-		if (assetStreamBuffer.length > NUMBER_UINT32_ZERO) {
-			if (RETCODE_OK == retcode) {
-				semaphoreResult = xSemaphoreTake(
-						semaphoreAssetBuffer, pdMS_TO_TICKS(SEMAPHORE_TIMEOUT));
-				if (pdPASS == semaphoreResult) {
-					// only log measurements when loggin is enabled
-					if (logging_enabled) {
-						LOG_AT_DEBUG(
-								("MQTTOperation: Publishing asset data: length [%ld], content:\r\n%s", assetStreamBuffer.length, assetStreamBuffer.data));
+		if (RETCODE_OK != retcode && (sensorInFlight > 0U || assetInFlight > 0U || offlineInFlight)) {
+			// the payloads in flight are not sent again, sensor payloads are stored below like the next ones
+			MQTT_PublishAbort_Z();
+		}
+		// asset payloads and acknowledgements are queued like the sensor payloads, while
+		// offline they wait in their pool, the asset timer keeps filling the other payload
+		MQTTBuffer_Payload_T * asset = MQTTBuffer_PoolPeekAt(&assetPool, assetInFlight);
+		while (RETCODE_OK == retcode && asset != NULL) {
+			bool compressed = payloadCompress && MQTTCompress_Payload(asset, &publishScratch);
+			// only log measurements when loggin is enabled
+			if (logging_enabled && compressed) {
+				LOG_AT_DEBUG(
+						("MQTTOperation: Publishing compressed asset data: length [%ld]\r\n", asset->length));
+			} else if (logging_enabled) {
+				LOG_AT_DEBUG(
+						("MQTTOperation: Publishing asset data: length [%ld], content:\r\n%s", asset->length, asset->data));
+			}
+			MqttPublishAssetInfo.Payload = asset->data;
+			MqttPublishAssetInfo.PayloadLength = asset->length;
+			if (MQTT_PUBLISH_HANDLE_INVALID == MQTT_PublishToTopicAsync_Z(&MqttPublishAssetInfo, MQTT_PUBLISH_TIMEOUT_IN_MS,
+					MQTTOperation_AssetPublished, asset)) {
+				break;
+			}
+			assetInFlight++;
+			asset = MQTTBuffer_PoolPeekAt(&assetPool, assetInFlight);
+		}
+
+		// timed and binary samples carry their own time, anchor the tick count to the system time
+		if ((MQTTOperation_IsTimed() || payloadBinary) && (clockValid == false
+				|| (TickType_t) (xTaskGetTickCount() - clockSynced) >= pdMS_TO_TICKS(MQTTOPERATION_CLOCK_SYNC))) {
+			clockValid = MQTTClock_Sync();
+			clockSynced = xTaskGetTickCount();
+		}
+
+		if (vibrationPending) {
+			vibrationPending = false;
+			MQTTSpectrum_Result_T spectrum;
+			char time[MQTTCLOCK_TIME_SIZE] = "";
+			TickType_t captured = xTaskGetTickCount();
+			if (MQTTOperation_CaptureVibration(&spectrum)) {
+				if (MQTTOperation_IsTimed()) {
+					MQTTClock_Format(captured, time);
+				}
+				MQTTBuffer_Payload_T * payload = MQTTBuffer_PoolAcquire(&sensorPool);
+				if (payload != NULL && MQTTOperation_FormatVibration(payload, &spectrum, captured, time) == false) {
+					// payload is full, the spectrum goes first into the next one
+					MQTTBuffer_PoolSeal(&sensorPool);
+					batchSamples = 0UL;
+					payload = MQTTBuffer_PoolAcquire(&sensorPool);
+					if (payload != NULL) {
+						MQTTOperation_FormatVibration(payload, &spectrum, captured, time);
 					}
-					MqttPublishAssetInfo.Payload = assetStreamBuffer.data;
-					MqttPublishAssetInfo.PayloadLength =
-							assetStreamBuffer.length;
-					retcode = MQTT_PublishToTopic_Z(&MqttPublishAssetInfo,
-					MQTT_PUBLISH_TIMEOUT_IN_MS);
-					memset(assetStreamBuffer.data, 0x00,
-							assetStreamBuffer.length);
-					assetStreamBuffer.length = NUMBER_UINT32_ZERO;
 				}
-				xSemaphoreGive(semaphoreAssetBuffer);
+				if (payload == NULL) {
+					LOG_AT_ERROR(("MQTTOperation: No stream buffer for the vibration spectrum, dropped!\r\n"));
+				}
+			}
+		}
+
+		// move the samples taken by the sampling task into the sensor payloads, the sampler
+		// never waits for us, it drops samples as BACKLOGPOLICY says if the ring is full.
+		// A sample is copied out, with DROPOLDEST the sampler may reuse its slot meanwhile
+		SensorSample_T * sample = &pendingSample;
+		while (samplePending || MQTTBuffer_RingPop(&sensorRing, sample)) {
+			samplePending = true;
+			MQTTBuffer_Payload_T * payload = MQTTBuffer_PoolAcquire(&sensorPool);
+			if (payload == NULL) {
+				// all payloads are waiting to be published, keep the sample for the next loop
+				break;
+			}
+			const uint32_t before = payload->length;
+			if (MQTTOperation_FormatSample(payload, sample) == false) {
+				if (payload->length > NUMBER_UINT32_ZERO) {
+					// payload is full, continue with this sample in the next payload
+					MQTTBuffer_PoolSeal(&sensorPool);
+					batchSamples = 0UL;
+					continue;
+				}
+				LOG_AT_ERROR(("MQTTOperation: Sample exceeds stream buffer, dropped!\r\n"));
+			} else if (payload->length > before) {
+				if (batchSamples == 0UL) {
+					batchStart = sample->tick;
+				}
+				batchSamples++;
+			}
+			samplePending = false;
+
+			if (batchSize > 1UL && batchSamples >= batchSize) {
+				MQTTBuffer_PoolSeal(&sensorPool);
+				batchSamples = 0UL;
+			}
+		}
+		// without batching every loop publishes what was sampled, a batch waits
+		// until it is complete but not longer than STREAMRATE after its first sample
+		if (batchSize <= 1UL || (batchSamples > 0UL
+				&& (TickType_t) (xTaskGetTickCount() - batchStart) >= (TickType_t) tickRateMS)) {
+			MQTTBuffer_PoolSeal(&sensorPool);
+			batchSamples = 0UL;
+		}
 
-				if (RETCODE_OK != retcode) {
-					LOG_AT_ERROR(("MQTTOperation: MQTT publish failed \r\n"));
-					Retcode_RaiseError(retcode);
+		// the client completes the payloads in the order they were queued, the oldest of a pool is released
+		PublishCompletion_T completed;
+		while (MQTTBuffer_RingPop(&publishCompletions, &completed)) {
+			switch (completed.source) {
+			case PUBLISH_SENSOR:
+				if (RETCODE_OK != completed.result) {
+					LOG_AT_ERROR(
+							("MQTTOperation: MQTT publish failed trying to ignore\r\n"));
 					errorCountPublish++;
+					MQTTOffline_Store(completed.payload);
 				}
-
-				if (assetUpdateProcess == APP_ASSET_PUBLISHED
-						&& RETCODE_OK == retcode) {
-					// wait an extra tick rate until topic are created in Cumulocity
-					// topics are only created after the device is created
-					vTaskDelay(pdMS_TO_TICKS(1000));
-					retcode = MQTTOperation_SubscribeTopics();
-					if (RETCODE_OK != retcode) {
-						LOG_AT_ERROR(
-								("MQTTOperation: MQTT subscription failed!\r\n"));
-						retcode = MQTTOperation_ValidateWLANConnectivity();
-					} else {
-						assetUpdateProcess = APP_ASSET_COMPLETED;
-					}
+				MQTTBuffer_PoolRelease(&sensorPool);
+				sensorInFlight--;
+				break;
+			case PUBLISH_ASSET:
+				MQTTBuffer_PoolRelease(&assetPool);
+				assetInFlight--;
+				MQTTOperation_AssetCompleted(completed.result);
+				break;
+			case PUBLISH_OFFLINE:
+				// not committed, the next fetch returns the same payloads
+				if (RETCODE_OK == completed.result) {
+					MQTTOffline_Commit();
+				} else {
+					errorCountPublish++;
 				}
+				offlineInFlight = false;
+				break;
+			default:
+				break;
 			}
 		}
 
-		if (sensorStreamBuffer.length > NUMBER_UINT32_ZERO) {
+		// queue the sealed payloads without waiting for their acknowledgement,
+		// the client sends as many as PUBLISHWINDOW allows
+		MQTTBuffer_Payload_T * payload = MQTTBuffer_PoolPeekAt(&sensorPool, sensorInFlight);
+		while (payload != NULL) {
 			AppController_SetAppStatus(APP_STATUS_OPERATING_STARTED);
 			if (RETCODE_OK == retcode) {
-				   semaphoreResult = xSemaphoreTake(
-						semaphoreSensorBuffer,
-						pdMS_TO_TICKS(SEMAPHORE_TIMEOUT));
-				if (pdPASS == semaphoreResult) {
-					measurementCounter++;
-					if (logging_enabled) {
-						LOG_AT_DEBUG(
-								("MQTTOperation: Publishing sensor data: length [%ld], message [%lu], content:\r\n%s", sensorStreamBuffer.length, measurementCounter, sensorStreamBuffer.data));
-					}
-					MqttPublishDataInfo.Payload = sensorStreamBuffer.data;
-					MqttPublishDataInfo.PayloadLength =
-							sensorStreamBuffer.length;
-					retcode = MQTT_PublishToTopic_Z(&MqttPublishDataInfo,
-							MQTT_PUBLISH_TIMEOUT_IN_MS);
-					memset(sensorStreamBuffer.data, 0x00,
-							sensorStreamBuffer.length);
-					sensorStreamBuffer.length = NUMBER_UINT32_ZERO;
-					if (RETCODE_OK != retcode) {
-						LOG_AT_ERROR(
-								("MQTTOperation: MQTT publish failed trying to ignore\r\n"));
-						retcode = RETCODE_OK;
-					}
-
+				measurementCounter++;
+				MQTTOperation_EncodeSensorData(payload, measurementCounter);
+				MqttPublishDataInfo.Payload = payload->data;
+				MqttPublishDataInfo.PayloadLength = payload->length;
+				// can't fail, the client has more slots than there are sensor, asset and offline payloads
+				if (MQTT_PUBLISH_HANDLE_INVALID == MQTT_PublishToTopicAsync_Z(&MqttPublishDataInfo, MQTT_PUBLISH_TIMEOUT_IN_MS,
+						MQTTOperation_SensorPublished, payload)) {
+					break;
 				}
-				xSemaphoreGive(semaphoreSensorBuffer);
+				sensorInFlight++;
+			} else if (sensorInFlight == 0U) {
+				// appended to the segments on the SD card if the offline store is enabled, dropped otherwise
+				MQTTOffline_Store(payload);
+				MQTTBuffer_PoolRelease(&sensorPool);
+			} else {
+				// older payloads have to complete first
+				break;
+			}
+			payload = MQTTBuffer_PoolPeekAt(&sensorPool, sensorInFlight);
+		}
 
-				if (RETCODE_OK != retcode) {
-					LOG_AT_ERROR(("MQTTOperation: MQTT publish failed \r\n"));
-					Retcode_RaiseError(retcode);
-					errorCountPublish++;
+		// replay stored measurements oldest first, one publish per OFFLINEDRAIN
+		// so that live measurements and commands are not delayed. The fetched
+		// payloads are committed once the publish completed
+		if (RETCODE_OK == retcode && offlineInFlight == false && MQTTOffline_IsEmpty() == false
+				&& (TickType_t) (xTaskGetTickCount() - offlineDrained) >= offlineDrainTicks) {
+			offlineDrained = xTaskGetTickCount();
+			offlinePayload.length = NUMBER_UINT32_ZERO;
+			if (MQTTOffline_Fetch(&offlinePayload)) {
+				measurementCounter++;
+				MQTTOperation_EncodeSensorData(&offlinePayload, measurementCounter);
+				MqttPublishDataInfo.Payload = offlinePayload.data;
+				MqttPublishDataInfo.PayloadLength = offlinePayload.length;
+				if (MQTT_PUBLISH_HANDLE_INVALID != MQTT_PublishToTopicAsync_Z(&MqttPublishDataInfo, MQTT_PUBLISH_TIMEOUT_IN_MS,
+						MQTTOperation_OfflinePublished, &offlinePayload)) {
+					offlineInFlight = true;
 				}
-
 			} else {
-				// ignore previous measurements in order to prevent buffer overrun
-				memset(sensorStreamBuffer.data, 0x00,
-						sensorStreamBuffer.length);
-				sensorStreamBuffer.length = NUMBER_UINT32_ZERO;
+				// nothing readable is left, drop the rest
+				MQTTOffline_Commit();
 			}
 		}
 
 
-		// test if some commands are pending
-		if (uxQueueMessagesWaiting(commandQueue) > 0
-				&& commandProgress == DEVICE_OPERATION_WAITING) {
-			memset(commandBuffer, 0x00, SIZE_XSMALL_BUF);
-			if (xQueueReceive(commandQueue, &commandBuffer, 0) != pdTRUE)
-				LOG_AT_ERROR(
-						("MQTTOperation: Could read command from buffer!\r\n"));
-			else {
-				commandProgress = DEVICE_OPERATION_BEFORE_EXECUTING;
+		// test if some commands are pending, the phase stays WAITING while one executes
+		executed = false;
+		if (commandProgress == DEVICE_OPERATION_WAITING
+				&& MQTTBuffer_RingPop(&localCommands, &pendingLocal)) {
+			MQTTOperation_Dispatch(localTable[pendingLocal], &noArgs);
+			executed = true;
+		} else if (commandProgress == DEVICE_OPERATION_WAITING) {
+			taskENTER_CRITICAL();
+			pendingCommand = MQTTCommand_QueuePeek(&commandQueue);
+			taskEXIT_CRITICAL();
+			// the command is executed in place, producers never write a queued record
+			if (pendingCommand != NULL) {
 				LOG_AT_DEBUG(
-						("MQTTOperation: Execute command from buffer: [%s]!\r\n", commandBuffer));
-				MQTTOperation_ExecuteCommand(commandBuffer);
+						("MQTTOperation: Execute command from buffer: [%u]!\r\n", pendingCommand->template));
+				MQTTOperation_ExecuteCommand(pendingCommand);
+				taskENTER_CRITICAL();
+				MQTTCommand_QueueDiscard(&commandQueue);
+				taskEXIT_CRITICAL();
+				executed = true;
 			}
 		}
-		vTaskDelay(pdMS_TO_TICKS(MINIMAL_SPEED));
+		if (executed) {
+			// publish the acknowledgements in the next pass, then go on with the next command
+			MQTTOperation_Acknowledge();
+		} else {
+			// received commands wake the loop before the delay is over
+			(void) ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(MINIMAL_SPEED));
+		}
 	}
 
 }
@@ -586,7 +1008,7 @@ static void MQTTOperation_ClientPublish(void) {
  */
 static void MQTTOperation_StartTimer(void) {
 	LOG_AT_INFO(("MQTTOperation: Start publishing: ...\r\n"));
-	xTimerStart(timerHandleSensor, UINT32_C(0xffff));
+	MQTTSampler_Start();
 	AppController_SetAppStatus(APP_STATUS_OPERATING_STARTED);
 	return;
 }
@@ -597,33 +1019,32 @@ static void MQTTOperation_StartTimer(void) {
  */
 static void MQTTOperation_StopTimer(void) {
 	LOG_AT_INFO(("MQTTOperation: Stopped publishing!\r\n"));
-	xTimerStop(timerHandleSensor, UINT32_C(0xffff));
+	MQTTSampler_Stop();
 	AppController_SetAppStatus(APP_STATUS_OPERATING_STOPPED);
 	return;
 }
 
+/**
+ * @brief Subscribe the command, operation and error topics in one round trip
+ *
+ * @return RETCODE_OK if all topics were subscribed
+ */
 static Retcode_T MQTTOperation_SubscribeTopics(void) {
-	Retcode_T retcode;
-	retcode = MQTT_SubsribeToTopic_Z(&MqttSubscribeCommandInfo,
-	MQTT_SUBSCRIBE_TIMEOUT_IN_MS);
-
-	if (RETCODE_OK != retcode) {
-		LOG_AT_ERROR(
-				("MQTTOperation: MQTT subscribe command topic failed\r\n"));
-	} else {
-		LOG_AT_TRACE(("MQTTOperation: MQTT subscribe command topic successful\r\n"));
+	Retcode_T results[MQTTOPERATION_TOPICS];
+	TickType_t start = xTaskGetTickCount();
 
-		retcode = MQTT_SubsribeToTopic_Z(&MqttSubscribeRestartInfo,
-		MQTT_SUBSCRIBE_TIMEOUT_IN_MS);
-		retcode = MQTT_SubsribeToTopic_Z(&MqttSubscribeErrorInfo,
-		MQTT_SUBSCRIBE_TIMEOUT_IN_MS);
-		if (RETCODE_OK != retcode) {
+	Retcode_T retcode = MQTT_SubscribeToTopics_Z(MqttSubscribeInfo, MQTTOPERATION_TOPICS,
+	MQTT_SUBSCRIBE_TIMEOUT_IN_MS, results);
+	for (uint8_t index = 0U; index < MQTTOPERATION_TOPICS; index++) {
+		if (RETCODE_OK != results[index]) {
 			LOG_AT_ERROR(
-					("MQTTOperation: MQTT subscribe restart topic failed \r\n"));
-		} else {
-			LOG_AT_TRACE(("MQTTOperation: MQTT subscribe restart topic successful\r\n"));
+					("MQTTOperation: MQTT subscribe topic [%s] failed\r\n", MqttSubscribeInfo[index].Topic));
 		}
 	}
+	if (RETCODE_OK == retcode) {
+		LOG_AT_INFO(("MQTTOperation: MQTT subscribe topics successful in [%lu] ms\r\n",
+				(uint32_t) ((xTaskGetTickCount() - start) * portTICK_PERIOD_MS)));
+	}
 
 	return retcode;
 }
@@ -701,192 +1122,291 @@ static Retcode_T MQTTOperation_ValidateWLANConnectivity(void) {
 	return retcode;
 }
 
-static void MQTTOperation_PrepareAssetUpdate() {
-	assetStreamBuffer.length += snprintf(
-			assetStreamBuffer.data + assetStreamBuffer.length,
-			sizeof(assetStreamBuffer.data) - assetStreamBuffer.length,
-			"113,\"%s=%i\n%s=%i\n%s=%i\n%s=%i\n%s=%i\n%s=%i\n%s=%i\"\r\n",
-			ATT_KEY_NAME[8], tickRateMS, ATT_KEY_NAME[9],
-			MQTTCfgParser_IsAccelEnabled(), ATT_KEY_NAME[10],
-			MQTTCfgParser_IsGyroEnabled(), ATT_KEY_NAME[11],
-			MQTTCfgParser_IsMagnetEnabled(), ATT_KEY_NAME[12],
-			MQTTCfgParser_IsEnvEnabled(), ATT_KEY_NAME[13],
-			MQTTCfgParser_IsLightEnabled(), ATT_KEY_NAME[14],
-			MQTTCfgParser_IsNoiseEnabled());
+static bool MQTTOperation_PrepareAssetUpdate(MQTTBuffer_Payload_T * asset) {
+	const int32_t settings[] = { tickRateMS, MQTTCfgParser_IsAccelEnabled(),
+			MQTTCfgParser_IsGyroEnabled(), MQTTCfgParser_IsMagnetEnabled(),
+			MQTTCfgParser_IsEnvEnabled(), MQTTCfgParser_IsLightEnabled(),
+			MQTTCfgParser_IsNoiseEnabled() };
+	MQTTFormat_Line_T line;
+
+	// settings are reported as "KEY=value" lines starting with STREAMRATE
+	MQTTFormat_BeginLine(&line, asset);
+	MQTTFormat_Text(&line, "113,\"");
+	for (uint8_t index = 0U; index < sizeof(settings) / sizeof(settings[0]); index++) {
+		if (index > 0U) {
+			MQTTFormat_Char(&line, '\n');
+		}
+		MQTTFormat_Text(&line, ATT_KEY_NAME[ATT_IDX_STREAMRATE + index]);
+		MQTTFormat_Char(&line, '=');
+		MQTTFormat_Int(&line, settings[index]);
+	}
+	// effective sampling rate of each sensor
+	for (uint8_t channel = 0U; channel < SENSOR_CHANNEL_COUNT; channel++) {
+		MQTTFormat_Char(&line, '\n');
+		MQTTFormat_Text(&line, ATT_KEY_NAME[ATT_IDX_ACCELRATE + channel]);
+		MQTTFormat_Char(&line, '=');
+		MQTTFormat_Int(&line, MQTTCfgParser_GetSensorRate(ATT_IDX_ACCEL + channel));
+	}
+	MQTTFormat_Char(&line, '"');
+	return MQTTFormat_EndLine(&line);
 }
 
 /**
- * @brief Read the sensors and fill the stream data buffer
- *
- * @param[in] pvParameters - UNUSED
+ * @brief Append the firmware line "115,<name>,<version>,<url>" to the asset payload
+ */
+static bool MQTTOperation_FormatFirmware(MQTTBuffer_Payload_T * asset) {
+	MQTTFormat_Line_T line;
+
+	MQTTFormat_BeginLine(&line, asset);
+	MQTTFormat_Text(&line, "115,");
+	MQTTFormat_Text(&line, MQTTCfgParser_GetFirmwareName());
+	MQTTFormat_Char(&line, ',');
+	MQTTFormat_Text(&line, MQTTCfgParser_GetFirmwareVersion());
+	MQTTFormat_Char(&line, ',');
+	MQTTFormat_Text(&line, MQTTCfgParser_GetFirmwareURL());
+	return MQTTFormat_EndLine(&line);
+}
+
+/**
+ * @brief Append the line "<template>,<value>" to the asset payload
  *
- * @return NONE
+ * @return false if the line does not fit, nothing was appended
  */
-static void MQTTOperation_AssetUpdate(xTimerHandle xTimer) {
-	(void) xTimer;
+static bool MQTTOperation_FormatAssetLine(MQTTBuffer_Payload_T * asset, const char * template, const char * value) {
+	MQTTFormat_Line_T line;
+
+	MQTTFormat_BeginLine(&line, asset);
+	MQTTFormat_Text(&line, template);
+	MQTTFormat_Char(&line, ',');
+	MQTTFormat_Text(&line, value);
+	return MQTTFormat_EndLine(&line);
+}
 
-	// counter to send every 60 seconds a keep alive msg.
-	static uint32_t keepAlive = 0;
-	static uint32_t mvoltage = 0, battery = 0;
+/**
+ * @brief Acknowledge the phase the current command is in and move it to the next one
+ *
+ * The phase only moves on if its line fits into the payload, otherwise the
+ * next payload acknowledges it. Has to be called with semaphoreAssetBuffer taken.
+ *
+ * @return false if the command waits for nothing to be acknowledged, or the line did not fit
+ */
+static bool MQTTOperation_FormatProgress(MQTTBuffer_Payload_T * asset) {
+	MQTTFormat_Line_T line;
 
-	//LOG_AT_TRACE(("MQTTOperation: Starting buffering device data ...\r\n"));
+	switch (commandProgress) {
+	case DEVICE_OPERATION_BEFORE_EXECUTING:
+		if (MQTTOperation_FormatAssetLine(asset, "501", commands[command]) == false) {
+			return false;
+		}
+		// if restart is triggered nothing else can be initiated
+		if (command != CMD_RESTART) {
+			commandProgress = DEVICE_OPERATION_EXECUTING;
+		} else {
+			commandProgress = DEVICE_OPERATION_BLOCKING;
+		}
+		break;
+	case DEVICE_OPERATION_BEFORE_FAILED:
+		if (MQTTOperation_FormatAssetLine(asset, "501", commands[command]) == false) {
+			return false;
+		}
+		commandProgress = DEVICE_OPERATION_FAILED;
+		break;
+	case DEVICE_OPERATION_FAILED:
+		MQTTFormat_BeginLine(&line, asset);
+		MQTTFormat_Text(&line, "502,");
+		MQTTFormat_Text(&line, commands[command]);
+		MQTTFormat_Text(&line, ",\"Command unknown\"");
+		if (MQTTFormat_EndLine(&line) == false) {
+			return false;
+		}
+		commandProgress = DEVICE_OPERATION_WAITING;
+		break;
+	case DEVICE_OPERATION_EXECUTING:
+		if (MQTTOperation_FormatAssetLine(asset, "503", commands[command]) == false) {
+			return false;
+		}
+		commandProgress = DEVICE_OPERATION_WAITING;
+		break;
+	case DEVICE_OPERATION_IMMEDIATE_EXECUTE_CMD:
+		// the 503 follows as phase EXECUTING, so a full payload never repeats the 501
+		if (MQTTOperation_FormatAssetLine(asset, "501", commands[command]) == false) {
+			return false;
+		}
+		commandProgress = DEVICE_OPERATION_EXECUTING;
+		break;
+	case DEVICE_OPERATION_IMMEDIATE_EXECUTE_BUTTON:
+		commandProgress = DEVICE_OPERATION_WAITING;
+		break;
+	default:
+		return false;
+	}
+	return true;
+}
 
-	// take semaphore to avoid publish thread to access the buffer
-	BaseType_t semaphoreResult = xSemaphoreTake(semaphoreAssetBuffer,
-			pdMS_TO_TICKS(SEMAPHORE_TIMEOUT_NULL));
-	if (pdPASS == semaphoreResult) {
+/**
+ * @brief Append the lines the executed commands left for the inventory
+ *
+ * A line is only taken from commandLines once it was written. Has to be
+ * called with semaphoreAssetBuffer taken.
+ *
+ * @param[in] pending the lines read from commandLines
+ *
+ * @return false if a line did not fit
+ */
+static bool MQTTOperation_FormatLines(MQTTBuffer_Payload_T * asset, uint8_t pending) {
+	uint8_t written = 0U;
+	bool fits = true;
+
+	if (fits && (pending & COMMAND_LINE_FIRMWARE) != 0U) {
+		fits = MQTTOperation_FormatFirmware(asset)
+				&& MQTTFormat_TextLine(asset, "400,xdk_FirmwareChangeEvent,\"Firmware updated!\"");
+		written |= fits ? COMMAND_LINE_FIRMWARE : 0U;
+	}
+	if (fits && (pending & COMMAND_LINE_STARTED) != 0U) {
+		fits = MQTTFormat_TextLine(asset, "400,xdk_StatusChangeEvent,\"Publish started!\"");
+		written |= fits ? COMMAND_LINE_STARTED : 0U;
+	}
+	if (fits && (pending & COMMAND_LINE_STOPPED) != 0U) {
+		fits = MQTTFormat_TextLine(asset, "400,xdk_StatusChangeEvent,\"Publish stopped!\"");
+		written |= fits ? COMMAND_LINE_STOPPED : 0U;
+	}
+	if (fits && (pending & COMMAND_LINE_REQUEST) != 0U) {
+		fits = MQTTFormat_TextLine(asset, "500");
+		written |= fits ? COMMAND_LINE_REQUEST : 0U;
+	}
+	if (fits && (pending & COMMAND_LINE_CONFIG) != 0U) {
+		fits = MQTTOperation_PrepareAssetUpdate(asset)
+				&& MQTTFormat_TextLine(asset, "400,xdk_ConfigChangeEvent,\"Config changed!\"");
+		written |= fits ? COMMAND_LINE_CONFIG : 0U;
+	}
+	taskENTER_CRITICAL();
+	commandLines &= (uint8_t) ~written;
+	taskEXIT_CRITICAL();
+	return fits;
+}
 
-		switch (assetUpdateProcess) {
-		case APP_ASSET_INITIAL:
-			assetUpdateProcess = APP_ASSET_PUBLISHED;
-			assetStreamBuffer.length += snprintf(
-					assetStreamBuffer.data + assetStreamBuffer.length,
-					sizeof(assetStreamBuffer.data) - assetStreamBuffer.length,
-					"100,\"%s\",c8y_XDKDevice\r\n", MqttConnectInfo.ClientId);
+/**
+ * @brief Append the acknowledgements of the current command and the lines of the executed ones
+ *
+ * @return true if nothing is left to be written
+ */
+static bool MQTTOperation_FormatCommand(MQTTBuffer_Payload_T * asset) {
+	while (MQTTOperation_FormatProgress(asset)) {
+	}
+	// progress and lines are read together, lines of a command dispatched meanwhile wait for its 501
+	taskENTER_CRITICAL();
+	const bool acknowledged = (commandProgress == DEVICE_OPERATION_WAITING || commandProgress == DEVICE_OPERATION_BLOCKING);
+	const uint8_t pending = commandLines;
+	taskEXIT_CRITICAL();
+	if (acknowledged == false) {
+		return false;
+	}
+	return MQTTOperation_FormatLines(asset, pending);
+}
 
-			char readbuffer[SIZE_SMALL_BUF]; /* Temporary buffer for write file */
-			Utils_GetXdkVersionString((uint8_t *) readbuffer);
-			assetStreamBuffer.length += snprintf(
-					assetStreamBuffer.data + assetStreamBuffer.length,
-					sizeof(assetStreamBuffer.data) - assetStreamBuffer.length,
-					"110,%s,XDK,%s\r\n", MqttConnectInfo.ClientId, readbuffer);
-			assetStreamBuffer.length += snprintf(
-					assetStreamBuffer.data + assetStreamBuffer.length,
-					sizeof(assetStreamBuffer.data) - assetStreamBuffer.length,
-					"114,c8y_Restart,c8y_Message,c8y_Command,c8y_Firmware,c8y_Configuration\r\n");
-			assetStreamBuffer.length += snprintf(
-					assetStreamBuffer.data + assetStreamBuffer.length,
-					sizeof(assetStreamBuffer.data) - assetStreamBuffer.length,
-					"115,%s,%s,%s\r\n", MQTTCfgParser_GetFirmwareName(),
-					MQTTCfgParser_GetFirmwareVersion(),
-					MQTTCfgParser_GetFirmwareURL());
-			assetStreamBuffer.length += snprintf(
-					assetStreamBuffer.data + assetStreamBuffer.length,
-					sizeof(assetStreamBuffer.data) - assetStreamBuffer.length,
-					"117,5\r\n");
-			MQTTOperation_PrepareAssetUpdate();
-			assetStreamBuffer.length += snprintf(
-					assetStreamBuffer.data + assetStreamBuffer.length,
-					sizeof(assetStreamBuffer.data) - assetStreamBuffer.length,
-					"400,xdk_StartEvent,\"XDK started!\"\r\n");
-			break;
-		case APP_ASSET_WAITING:
-			assetUpdateProcess = APP_ASSET_COMPLETED;
-			switch (command) {
-			case CMD_FIRMWARE:
-				assetStreamBuffer.length += snprintf(
-						assetStreamBuffer.data + assetStreamBuffer.length,
-						sizeof(assetStreamBuffer.data)
-								- assetStreamBuffer.length, "115,%s,%s,%s\r\n",
-						MQTTCfgParser_GetFirmwareName(),
-						MQTTCfgParser_GetFirmwareVersion(),
-						MQTTCfgParser_GetFirmwareURL());
-				assetStreamBuffer.length +=	snprintf(
-						assetStreamBuffer.data
-								+ assetStreamBuffer.length,
-						sizeof(assetStreamBuffer.data)
-								- assetStreamBuffer.length,
-						"400,xdk_FirmwareChangeEvent,\"Firmware updated!\"\r\n");
-				break;
-			case CMD_PUBLISH_START:
-				assetStreamBuffer.length += snprintf(
-						assetStreamBuffer.data + assetStreamBuffer.length,
-						sizeof(assetStreamBuffer.data)
-								- assetStreamBuffer.length,
-						"400,xdk_StatusChangeEvent,\"Publish started!\"\r\n");
-				break;
-			case CMD_PUBLISH_STOP:
-				assetStreamBuffer.length += snprintf(
-						assetStreamBuffer.data + assetStreamBuffer.length,
-						sizeof(assetStreamBuffer.data)
-								- assetStreamBuffer.length,
-						"400,xdk_StatusChangeEvent,\"Publish stopped!\"\r\n");
-				break;
-			case CMD_REQUEST:
-				assetStreamBuffer.length += snprintf(
-						assetStreamBuffer.data + assetStreamBuffer.length,
-						sizeof(assetStreamBuffer.data)
-								- assetStreamBuffer.length, "500\r\n");
-				break;
-			case CMD_SENSOR:
-			case CMD_SPEED:
-				MQTTOperation_PrepareAssetUpdate();
-				assetStreamBuffer.length += snprintf(
-						assetStreamBuffer.data + assetStreamBuffer.length,
-						sizeof(assetStreamBuffer.data)
-								- assetStreamBuffer.length,
-						"400,xdk_ConfigChangeEvent,\"Config changed!\"\r\n");
-				break;
-			default:
-				break;
-			}
+/**
+ * @brief Acknowledge the command the publish loop just executed, without waiting for the asset timer
+ *
+ * All phases the command passes are acknowledged at once and handed over to
+ * the publish loop, followed by the lines the command changed. What does not
+ * fit into the open payload goes into the next one. If no asset payload is
+ * free, the asset timer writes the rest later.
+ */
+static void MQTTOperation_Acknowledge(void) {
+	if (pdPASS != xSemaphoreTake(semaphoreAssetBuffer, pdMS_TO_TICKS(SEMAPHORE_TIMEOUT))) {
+		return;
+	}
+	for (uint8_t attempt = 0U; attempt < MQTTOPERATION_PAYLOADS; attempt++) {
+		MQTTBuffer_Payload_T * asset = MQTTBuffer_PoolAcquire(&assetPool);
+		if (asset == NULL) {
 			break;
-		default:
+		}
+		bool done = MQTTOperation_FormatCommand(asset);
+		MQTTBuffer_PoolSeal(&assetPool);
+		if (done) {
 			break;
 		}
+	}
+	xSemaphoreGive(semaphoreAssetBuffer);
+}
 
-		switch (commandProgress) {
-		case DEVICE_OPERATION_BEFORE_EXECUTING:
-			// if restart is triggered nothing else can be initiated
-			assetStreamBuffer.length += snprintf(
-					assetStreamBuffer.data + assetStreamBuffer.length,
-					sizeof(assetStreamBuffer.data) - assetStreamBuffer.length,
-					"501,%s\r\n", commands[command]);
-			if (command != CMD_RESTART) {
-				commandProgress = DEVICE_OPERATION_EXECUTING;
-			} else {
-				commandProgress = DEVICE_OPERATION_BLOCKING;
-			}
-			break;
-		case DEVICE_OPERATION_BEFORE_FAILED:
-			commandProgress = DEVICE_OPERATION_FAILED;
-			assetStreamBuffer.length += snprintf(
-					assetStreamBuffer.data + assetStreamBuffer.length,
-					sizeof(assetStreamBuffer.data) - assetStreamBuffer.length,
-					"501,%s\r\n", commands[command]);
-			break;
-		case DEVICE_OPERATION_FAILED:
-			commandProgress = DEVICE_OPERATION_WAITING;
-			assetStreamBuffer.length += snprintf(
-					assetStreamBuffer.data + assetStreamBuffer.length,
-					sizeof(assetStreamBuffer.data) - assetStreamBuffer.length,
-					"502,%s,\"Command unknown\"\r\n", commands[command]);
-			break;
-		case DEVICE_OPERATION_EXECUTING:
-			commandProgress = DEVICE_OPERATION_WAITING;
-			assetStreamBuffer.length += snprintf(
-					assetStreamBuffer.data + assetStreamBuffer.length,
-					sizeof(assetStreamBuffer.data) - assetStreamBuffer.length,
-					"503,%s\r\n", commands[command]);
-			break;
-		case DEVICE_OPERATION_IMMEDIATE_EXECUTE_CMD:
-			commandProgress = DEVICE_OPERATION_WAITING;
-			assetStreamBuffer.length += snprintf(
-					assetStreamBuffer.data + assetStreamBuffer.length,
-					sizeof(assetStreamBuffer.data) - assetStreamBuffer.length,
-					"501,%s\r\n", commands[command]);
-			assetStreamBuffer.length += snprintf(
-					assetStreamBuffer.data + assetStreamBuffer.length,
-					sizeof(assetStreamBuffer.data) - assetStreamBuffer.length,
-					"503,%s\r\n", commands[command]);
-			break;
-		case DEVICE_OPERATION_IMMEDIATE_EXECUTE_BUTTON:
-			commandProgress = DEVICE_OPERATION_WAITING;
+/**
+ * @brief Wake the publish loop, something is waiting to be executed or published
+ */
+static void MQTTOperation_NotifyPublisher(void) {
+	if (AppControllerHandle != NULL) {
+		xTaskNotifyGive(AppControllerHandle);
+	}
+}
+
+/**
+ * @brief Read the sensors and fill the stream data buffer
+ *
+ * @param[in] pvParameters - UNUSED
+ *
+ * @return NONE
+ */
+static void MQTTOperation_AssetUpdate(xTimerHandle xTimer) {
+	(void) xTimer;
+
+	// counter to send every 60 seconds a keep alive msg.
+	static uint32_t keepAlive = 0;
+	static uint32_t mvoltage = 0;
+	static int32_t battery = 0;
+
+	//LOG_AT_TRACE(("MQTTOperation: Starting buffering device data ...\r\n"));
+
+	// the semaphore only keeps the producers of asset data apart, the publish
+	// thread works on sealed payloads and never takes it
+	BaseType_t semaphoreResult = xSemaphoreTake(semaphoreAssetBuffer,
+			pdMS_TO_TICKS(SEMAPHORE_TIMEOUT_NULL));
+	if (pdPASS != semaphoreResult) {
+		return;
+	}
+	MQTTBuffer_Payload_T * asset = MQTTBuffer_PoolAcquire(&assetPool);
+	if (asset != NULL) {
+		MQTTFormat_Line_T line;
+
+		switch (assetUpdateProcess) {
+		case APP_ASSET_INITIAL:
+			assetUpdateProcess = APP_ASSET_PUBLISHED;
+			MQTTFormat_BeginLine(&line, asset);
+			MQTTFormat_Text(&line, "100,\"");
+			MQTTFormat_Text(&line, MqttConnectInfo.ClientId);
+			MQTTFormat_Text(&line, "\",c8y_XDKDevice");
+			MQTTFormat_EndLine(&line);
+
+			char readbuffer[SIZE_SMALL_BUF]; /* Temporary buffer for write file */
+			Utils_GetXdkVersionString((uint8_t *) readbuffer);
+			MQTTFormat_BeginLine(&line, asset);
+			MQTTFormat_Text(&line, "110,");
+			MQTTFormat_Text(&line, MqttConnectInfo.ClientId);
+			MQTTFormat_Text(&line, ",XDK,");
+			MQTTFormat_Text(&line, readbuffer);
+			MQTTFormat_EndLine(&line);
+			MQTTFormat_TextLine(asset, "114,c8y_Restart,c8y_Message,c8y_Command,c8y_Firmware,c8y_Configuration");
+			MQTTOperation_FormatFirmware(asset);
+			MQTTFormat_TextLine(asset, "117,5");
+			MQTTOperation_PrepareAssetUpdate(asset);
+			MQTTFormat_TextLine(asset, "400,xdk_StartEvent,\"XDK started!\"");
 			break;
 		default:
 			break;
 		}
 
+		// acknowledgements and lines the publish loop could not write right away
+		(void) MQTTOperation_FormatCommand(asset);
+
 		// send keep alive message every 60 seconds
 		keepAlive++;
 		if (keepAlive >= 60) {
 			BatteryMonitor_MeasureSignal(&mvoltage);
 			// Max = 4.3V, Min = 3.3V
-			battery = (mvoltage - 3300.0) / 1000.0 * 100.0;
-			assetStreamBuffer.length += snprintf(
-					assetStreamBuffer.data + assetStreamBuffer.length,
-					sizeof(assetStreamBuffer.data) - assetStreamBuffer.length,
-					"212,%ld\r\n", battery);
+			battery = ((int32_t) mvoltage - 3300L) / 10L;
+			MQTTFormat_BeginLine(&line, asset);
+			MQTTFormat_Text(&line, "212,");
+			MQTTFormat_Int(&line, battery);
+			MQTTFormat_EndLine(&line);
 			keepAlive = 0;
 
 			uint64_t sntpTimeStamp = 0UL;
@@ -901,13 +1421,69 @@ static void MQTTOperation_AssetUpdate(xTimerHandle xTimer) {
 			LOG_AT_TRACE(("MQTTOperation: current time: %s\r\n", timezoneISO8601format));
 
 			// only send event when some error occurs
-			if (errorCountSemaphore != 0 || errorCountPublish != 0 )
-				assetStreamBuffer.length +=
-						snprintf(assetStreamBuffer.data + assetStreamBuffer.length,
-								sizeof(assetStreamBuffer.data)
-										- assetStreamBuffer.length,
-								"400,xdk_ErrorCountEvent,\"Errors: Collision Semaphore/Error Publish:%i/%i!\"\r\n",
-								errorCountSemaphore, errorCountPublish);
+			if (sensorRing.overrun != 0 || errorCountPublish != 0 ) {
+				MQTTFormat_BeginLine(&line, asset);
+				MQTTFormat_Text(&line, "400,xdk_ErrorCountEvent,\"Errors: Sample Overrun/Error Publish:");
+				MQTTFormat_UInt(&line, sensorRing.overrun);
+				MQTTFormat_Char(&line, '/');
+				MQTTFormat_Int(&line, errorCountPublish);
+				MQTTFormat_Text(&line, "!\"");
+				MQTTFormat_EndLine(&line);
+			}
+
+			MQTTOperation_FormatSampling(asset);
+
+			// samples waiting in the backlog, its peak and what it dropped since startup
+			MQTTFormat_BeginLine(&line, asset);
+			MQTTFormat_Text(&line, "201,xdk_Backlog,,xdk_Backlog,occupancy,");
+			MQTTFormat_UInt(&line, MQTTBuffer_RingCount(&sensorRing));
+			MQTTFormat_Text(&line, ",,xdk_Backlog,highWater,");
+			MQTTFormat_UInt(&line, sensorRing.highWater);
+			MQTTFormat_Text(&line, ",,xdk_Backlog,dropped,");
+			MQTTFormat_UInt(&line, sensorRing.overrun);
+			MQTTFormat_Text(&line, ",,xdk_Backlog,decimated,");
+			MQTTFormat_UInt(&line, sensorRing.decimated);
+			MQTTFormat_Char(&line, ',');
+			MQTTFormat_EndLine(&line);
+
+			// operations waiting to be executed, their peak and how many were rejected since startup
+			MQTTFormat_BeginLine(&line, asset);
+			MQTTFormat_Text(&line, "201,xdk_CommandQueue,,xdk_CommandQueue,occupancy,");
+			MQTTFormat_UInt(&line, commandQueue.count);
+			MQTTFormat_Text(&line, ",,xdk_CommandQueue,highWater,");
+			MQTTFormat_UInt(&line, commandQueue.highWater);
+			MQTTFormat_Text(&line, ",,xdk_CommandQueue,rejected,");
+			MQTTFormat_UInt(&line, commandQueue.rejected);
+			MQTTFormat_Char(&line, ',');
+			MQTTFormat_EndLine(&line);
+
+			// report how many measurements the deadbands suppressed since startup
+			if (MQTTDeadband_GetSuppressed() != 0UL) {
+				uint32_t suppressed = MQTTDeadband_GetSuppressed();
+				uint32_t total = suppressed + MQTTDeadband_GetSent();
+				MQTTFormat_BeginLine(&line, asset);
+				MQTTFormat_Text(&line, "201,xdk_Deadband,,xdk_Deadband,sent,");
+				MQTTFormat_UInt(&line, MQTTDeadband_GetSent());
+				MQTTFormat_Text(&line, ",,xdk_Deadband,suppressed,");
+				MQTTFormat_UInt(&line, suppressed);
+				MQTTFormat_Text(&line, ",,xdk_Deadband,reduction,");
+				MQTTFormat_Fixed(&line, (int32_t) (((uint64_t) suppressed * 1000ULL) / total), 1U);
+				MQTTFormat_Text(&line, ",%");
+				MQTTFormat_EndLine(&line);
+			}
+
+			// report what the inventory policy saved since startup
+			if (MQTTInventory_GetSkipped() != 0UL) {
+				MQTTFormat_BeginLine(&line, asset);
+				MQTTFormat_Text(&line, "200,xdk_InventorySaved,bytes,");
+				MQTTFormat_UInt(&line, MQTTInventory_GetSavedBytes());
+				MQTTFormat_Text(&line, ",B");
+				MQTTFormat_EndLine(&line);
+				MQTTFormat_BeginLine(&line, asset);
+				MQTTFormat_Text(&line, "200,xdk_InventorySaved,updates,");
+				MQTTFormat_UInt(&line, MQTTInventory_GetSkipped());
+				MQTTFormat_EndLine(&line);
+			}
 
 #if INCLUDE_uxTaskGetStackHighWaterMark
 			uint32_t everFreeHeap = xPortGetMinimumEverFreeHeapSize();
@@ -923,151 +1499,828 @@ static void MQTTOperation_AssetUpdate(xTimerHandle xTimer) {
 
 		}
 
+		// hand the collected lines over to the publish thread
+		MQTTBuffer_PoolSeal(&assetPool);
 	}
 
-	// release semaphore and let publish thread access the buffer
 	xSemaphoreGive(semaphoreAssetBuffer);
 
 	//LOG_AT_TRACE(("MQTTOperation: Finished buffering device data\r\n"));
 }
 
-static void MQTTOperation_SensorUpdate(xTimerHandle xTimer) {
-	(void) xTimer;
+/**
+ * @brief Read the sensor of one channel into the sample
+ *
+ * The sensors are read directly instead of Sensor_GetData, which always reads
+ * all enabled sensors, so that a channel costs I2C traffic only when it is due.
+ * Units are the same as in Sensor_GetData.
+ *
+ * @return true if the sensor could be read
+ */
+static bool MQTTOperation_ReadChannel(SensorChannel_T channel, Sensor_Value_T * value) {
+	Retcode_T retcode = RETCODE_OK;
 
-	Sensor_Value_T sensorValue;
-	Retcode_T retcode = Sensor_GetData(&sensorValue);
+	switch (channel) {
+	case SENSOR_CHANNEL_ACCEL: {
+		Accelerometer_XyzData_T accel = { 0 };
+		retcode = Accelerometer_readXyzGValue(xdkAccelerometers_BMA280_Handle, &accel);
+		value->Accel.X = accel.xAxisData;
+		value->Accel.Y = accel.yAxisData;
+		value->Accel.Z = accel.zAxisData;
+		break;
+	}
+	case SENSOR_CHANNEL_GYRO: {
+		Gyroscope_XyzData_T gyro = { 0 };
+		retcode = Gyroscope_readXyzDegreeValue(xdkGyroscope_BMG160_Handle, &gyro);
+		value->Gyro.X = gyro.xAxisData;
+		value->Gyro.Y = gyro.yAxisData;
+		value->Gyro.Z = gyro.zAxisData;
+		break;
+	}
+	case SENSOR_CHANNEL_MAG: {
+		Magnetometer_XyzData_T mag = { 0 };
+		retcode = Magnetometer_readXyzTeslaData(xdkMagnetometer_BMM150_Handle, &mag);
+		value->Mag.X = mag.xAxisData;
+		value->Mag.Y = mag.yAxisData;
+		value->Mag.Z = mag.zAxisData;
+		break;
+	}
+	case SENSOR_CHANNEL_ENV: {
+		Environmental_Data_T env = { 0 };
+		retcode = Environmental_readData(xdkEnvironmental_BME280_Handle, &env);
+		value->Pressure = env.pressure;
+		value->Temp = env.temperature;
+		value->RH = env.humidity;
+		break;
+	}
+	case SENSOR_CHANNEL_LIGHT:
+		retcode = LightSensor_readLuxData(xdkLightSensor_MAX44009_Handle, &value->Light);
+		break;
+	case SENSOR_CHANNEL_NOISE:
+		retcode = NoiseSensor_ReadRmsValue(&value->Noise, 10U);
+		break;
+	default:
+		retcode = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_INVALID_PARAM);
+		break;
+	}
+	return (RETCODE_OK == retcode);
+}
 
-	//printf("MQTTOperation: Before Semi ... \r\n");
-	BaseType_t semaphoreResult = xSemaphoreTake(semaphoreSensorBuffer,
-			pdMS_TO_TICKS(SEMAPHORE_TIMEOUT));
-	if (pdPASS == semaphoreResult) {
-		//printf("MQTTOperation: In Semi ... \r\n");
+/**
+ * @brief Sampler callback, reads the due sensors and hands the sample to the publish loop
+ *
+ * @param[in] channels - channels due at this deadline
+ */
+static void MQTTOperation_SensorUpdate(uint32_t channels) {
+	SensorSample_T sample;
+
+	sample.channels = 0U;
+	sample.tick = xTaskGetTickCount();
+	for (uint8_t channel = 0U; channel < SENSOR_CHANNEL_COUNT; channel++) {
+		if ((channels & SENSOR_CHANNEL_BIT(channel)) == 0UL) {
+			continue;
+		}
+		if (MQTTOperation_ReadChannel((SensorChannel_T) channel, &sample.value)) {
+			sample.channels |= (uint16_t) SENSOR_CHANNEL_BIT(channel);
+		} else {
+			LOG_AT_ERROR(("MQTTOperation: Reading sensor channel [%u] failed!\r\n", channel));
+		}
+	}
+	sample.noiseWindowed = false;
+	if ((sample.channels & SENSOR_CHANNEL_BIT(SENSOR_CHANNEL_NOISE)) != 0U && noiseWindowTicks != 0UL) {
+		MQTTOperation_WindowNoise(&sample);
+	}
+	if (sample.channels == 0U) {
+		return;
+	}
 
 #if ENABLE_SENSOR_TOOLBOX
-		// update inventory with latest measurements
-		Orientation_EulerData_T eulerValueInDegree = { 0.0F, 0.0F, 0.0F, 0.0F };
-		retcode = Orientation_readEulerRadianVal(&eulerValueInDegree);
-
-		if (retcode == RETCODE_SUCCESS) {
-
-			// update orientation
-			sensorStreamBuffer.length += snprintf(
-					sensorStreamBuffer.data + sensorStreamBuffer.length,
-					sizeof(sensorStreamBuffer.data) - sensorStreamBuffer.length,
-					"1990,%s,%.3lf,%.3lf,%.3lf,%.3lf\r\n",
-					MqttConnectInfo.ClientId, eulerValueInDegree.heading,
-					eulerValueInDegree.pitch, eulerValueInDegree.roll,
-					eulerValueInDegree.yaw);
-		}
+	// the orientation is fused from the motion sensors and follows the rate of ACCEL
+	sample.euler = (Orientation_EulerData_T) { 0.0F, 0.0F, 0.0F, 0.0F };
+	sample.eulerValid = ((sample.channels & SENSOR_CHANNEL_BIT(SENSOR_CHANNEL_ACCEL)) != 0U)
+			&& (Orientation_readEulerRadianVal(&sample.euler) == RETCODE_SUCCESS);
 #endif
+	sample.inventoryDecided = 0U;
+	sample.inventoryDue = 0U;
+	sample.aggregated = 0U;
+	sample.measurementDecided = 0U;
+	sample.measurementDue = 0U;
+
+	// wait-free hand over to the publish loop, a full backlog drops samples as configured
+	MQTTBuffer_RingOffer(&sensorRing, &sample);
+}
+
+/**
+ * @brief Set the sampling period of every sensor channel from the configuration
+ *
+ * Sensors are only set up at startup, so a channel is sampled only if its
+ * sensor was enabled then.
+ */
+static void MQTTOperation_ConfigureRates(void) {
+	const bool enabled[SENSOR_CHANNEL_COUNT] = { SensorSetup.Enable.Accel,
+			SensorSetup.Enable.Gyro, SensorSetup.Enable.Mag, SensorSetup.Enable.Temp,
+			SensorSetup.Enable.Light, SensorSetup.Enable.Noise };
+
+	for (uint8_t channel = 0U; channel < SENSOR_CHANNEL_COUNT; channel++) {
+		int32_t rate = MQTTCfgParser_GetSensorRate(ATT_IDX_ACCEL + channel);
+		if (rate < MINIMAL_SAMPLING_RATE) {
+			rate = MINIMAL_SAMPLING_RATE;
+		}
+		if (channel == SENSOR_CHANNEL_NOISE && noiseWindowTicks != 0UL && rate > MQTTOPERATION_NOISE_RATE) {
+			// a window needs many readings, only the window result is sent
+			rate = MQTTOPERATION_NOISE_RATE;
+		}
+		MQTTSampler_SetPeriod(channel, enabled[channel] ? (uint32_t) rate : 0UL);
+		LOG_AT_DEBUG(("MQTTOperation: Sampling rate of [%s]: [%ld]\r\n",
+				ATT_KEY_NAME[ATT_IDX_ACCEL + channel], enabled[channel] ? rate : 0L));
+	}
+}
+
+/**
+ * @brief Add the noise reading of a sample to the noise window
+ *
+ * Runs in the sampling task. The noise channel is removed from the sample
+ * unless it completes the window, then the sample carries the whole window.
+ *
+ * @param[in,out] sample - sample with a noise reading
+ */
+static void MQTTOperation_WindowNoise(SensorSample_T * sample) {
+	if (noiseWindowRestart) {
+		noiseWindowRestart = false;
+		MQTTNoise_Reset(&noiseWindow);
+		noiseWindowStart = sample->tick;
+	}
+
+	MQTTNoise_Add(&noiseWindow, (uint32_t) MQTTFormat_ScaleFloat(
+			MQTTOperation_CalcSoundPressure(sample->value.Noise), MQTTNOISE_DECIMALS));
+	if ((TickType_t) (sample->tick - noiseWindowStart) >= noiseWindowTicks) {
+		sample->noise = noiseWindow;
+		sample->noiseWindowed = true;
+		MQTTNoise_Reset(&noiseWindow);
+		noiseWindowStart = sample->tick;
+	} else {
+		sample->channels &= (uint16_t) ~SENSOR_CHANNEL_BIT(SENSOR_CHANNEL_NOISE);
+	}
+}
+
+/**
+ * @brief Read the noise window from the configuration, the sampling task restarts the window
+ */
+static void MQTTOperation_ConfigureNoise(void) {
+	int32_t window = MQTTCfgParser_GetNoiseWindow();
+
+	noiseWindowTicks = (window > 0L) ? pdMS_TO_TICKS(window) : 0UL;
+	noiseWindowRestart = true;
+	LOG_AT_INFO(("MQTTOperation: Noise window [%ld] ms\r\n", (window > 0L) ? window : 0L));
+}
+
+/**
+ * @brief Read the format of the sensor payloads from the configuration
+ *
+ * The payload being filled is sealed, so no payload mixes both formats.
+ * DELTA payloads are filled as BINARY and packed when they are published.
+ * Compression applies to asset and sensor payloads right before they are
+ * published, so it can change at any time.
+ */
+static void MQTTOperation_ConfigurePayload(void) {
+	const char * format = MQTTCfgParser_GetPayloadFormat();
+	bool delta = (strcmp(format, "DELTA") == 0);
+	bool binary = delta || (strcmp(format, "BINARY") == 0);
+
+	if (binary != payloadBinary) {
+		MQTTBuffer_PoolSeal(&sensorPool);
+		payloadBinary = binary;
+	}
+	payloadDelta = delta;
+	payloadCompress = MQTTCfgParser_IsPayloadCompressEnabled();
+	LOG_AT_INFO(("MQTTOperation: Payload format [%s], compressed [%d]\r\n",
+			payloadDelta ? "DELTA" : payloadBinary ? "BINARY" : "SMARTREST", payloadCompress));
+}
+
+/**
+ * @brief Read the store for measurements while offline and its drain rate from the configuration
+ */
+static void MQTTOperation_ConfigureOffline(void) {
+	int32_t drain = MQTTCfgParser_GetOfflineDrain();
+
+	MQTTOffline_Configure();
+	offlineDrainTicks = (drain > 0L) ? pdMS_TO_TICKS(drain) : 0UL;
+	LOG_AT_INFO(("MQTTOperation: Offline drain every [%ld] ms\r\n", (drain > 0L) ? drain : 0L));
+}
+
+/**
+ * @brief Read the depth of the sample backlog and what it drops when full from the configuration
+ *
+ * The sampler may offer a sample while this runs, at worst that one sample
+ * is handled with the previous policy.
+ */
+static void MQTTOperation_ConfigureBacklog(void) {
+	const char * name = MQTTCfgParser_GetBacklogPolicy();
+	int32_t size = MQTTCfgParser_GetBacklogSize();
+	int32_t decimation = MQTTCfgParser_GetBacklogDecimate();
+	MQTTBuffer_Policy_T policy = MQTTBUFFER_DROP_NEWEST;
+
+	if (strcmp(name, "DROPOLDEST") == 0) {
+		policy = MQTTBUFFER_DROP_OLDEST;
+	} else if (strcmp(name, "DECIMATE") == 0) {
+		policy = MQTTBUFFER_DECIMATE;
+	}
+	MQTTBuffer_RingSetPolicy(&sensorRing, (size > 0L) ? (uint32_t) size : 0UL, policy,
+			(decimation > 0L) ? (uint32_t) decimation : 1UL);
+	LOG_AT_INFO(("MQTTOperation: Backlog of [%lu] samples, policy [%s], decimation [%lu]\r\n",
+			sensorRing.limit, name, sensorRing.decimation));
+}
+
+/**
+ * @brief Read the quality of service and the publish window from the configuration
+ *
+ * Only QoS 0 and 1 are supported, higher values use QoS 1.
+ */
+static void MQTTOperation_ConfigurePublish(void) {
+	int32_t qos = MQTTCfgParser_GetPublishQoS();
+	int32_t window = MQTTCfgParser_GetPublishWindow();
+
+	MqttPublishDataInfo.QoS = (qos > 0L) ? MQTT_QOS_AT_LEAST_ONCE : MQTT_QOS_AT_MOST_ONE;
+	MqttPublishAssetInfo.QoS = MqttPublishDataInfo.QoS;
+	if (window > (int32_t) MQTT_PUBLISH_SLOTS) {
+		window = (int32_t) MQTT_PUBLISH_SLOTS;
+	}
+	MQTT_SetPublishWindow_Z((window > 0L) ? (uint8_t) window : 1U);
+	LOG_AT_INFO(("MQTTOperation: Publish with QoS [%lu], window [%ld]\r\n", MqttPublishDataInfo.QoS, window));
+}
+
+/**
+ * @brief true if SmartREST measurements carry the time they were sampled
+ *
+ * Batched samples share one publish and stored samples are published late,
+ * in both cases the time of arrival would be wrong.
+ */
+static bool MQTTOperation_IsTimed(void) {
+	return batchSize > 1UL || MQTTOffline_IsEnabled();
+}
+
+/**
+ * @brief Encode a sensor payload as configured before it is published
+ *
+ * The payload is packed and compressed in place, a payload replayed from the
+ * SD card that is encoded already stays as it is.
+ */
+static void MQTTOperation_EncodeSensorData(MQTTBuffer_Payload_T * payload, uint32_t counter) {
+	if (payloadDelta) {
+		MQTTBinary_Pack(payload, &publishScratch);
+	}
+	if (payloadCompress) {
+		MQTTCompress_Payload(payload, &publishScratch);
+	}
+	// stored payloads may have been encoded before they were stored
+	const uint8_t marker = (uint8_t) payload->data[0];
+	if (logging_enabled && (marker == MQTTBINARY_MAGIC || marker == MQTTCOMPRESS_MAGIC)) {
+		LOG_AT_DEBUG(
+				("MQTTOperation: Publishing encoded sensor data: length [%ld], message [%lu]\r\n", payload->length, counter));
+	} else if (logging_enabled) {
+		LOG_AT_DEBUG(
+				("MQTTOperation: Publishing sensor data: length [%ld], message [%lu], content:\r\n%s", payload->length, counter, payload->data));
+	}
+}
+
+/**
+ * @brief Queue a received command, called in the MQTT command processor
+ *
+ * @return false if the queue is full
+ */
+static bool MQTTOperation_PushCommand(const MQTTCommand_T * command) {
+	taskENTER_CRITICAL();
+	bool queued = MQTTCommand_QueuePush(&commandQueue, command);
+	taskEXIT_CRITICAL();
+	return queued;
+}
+
+/**
+ * @brief Apply COMMANDQUEUE, queued commands are kept when it is lowered
+ */
+static void MQTTOperation_ConfigureCommands(void) {
+	int32_t depth = MQTTCfgParser_GetCommandQueue();
+
+	if (depth < 1L) {
+		depth = 1L;
+	} else if (depth > MQTTOPERATION_COMMAND_DEPTH) {
+		depth = MQTTOPERATION_COMMAND_DEPTH;
+	}
+	taskENTER_CRITICAL();
+	MQTTCommand_QueueSetDepth(&commandQueue, (uint8_t) depth);
+	taskEXIT_CRITICAL();
+	LOG_AT_INFO(("MQTTOperation: Queue commands: [%ld]\r\n", depth));
+}
+
+/**
+ * @brief Completion of a queued payload, called in the MQTT command processor
+ *
+ * Only hands the payload back, the publish loop stores, commits or releases it.
+ */
+static void MQTTOperation_Completed(PublishSource_T source, void * context, Retcode_T result) {
+	PublishCompletion_T completed = { source, (MQTTBuffer_Payload_T *) context, result };
+	// can't be full, there are never more payloads in flight than records
+	(void) MQTTBuffer_RingPush(&publishCompletions, &completed);
+}
+
+static void MQTTOperation_SensorPublished(MQTT_PublishHandle_TZ handle, void * context, Retcode_T result) {
+	BCDS_UNUSED(handle);
+	MQTTOperation_Completed(PUBLISH_SENSOR, context, result);
+}
+
+static void MQTTOperation_AssetPublished(MQTT_PublishHandle_TZ handle, void * context, Retcode_T result) {
+	BCDS_UNUSED(handle);
+	MQTTOperation_Completed(PUBLISH_ASSET, context, result);
+}
+
+static void MQTTOperation_OfflinePublished(MQTT_PublishHandle_TZ handle, void * context, Retcode_T result) {
+	BCDS_UNUSED(handle);
+	MQTTOperation_Completed(PUBLISH_OFFLINE, context, result);
+}
 
-		if (SensorSetup.Enable.Accel) {
-			sensorStreamBuffer.length += snprintf(
-					sensorStreamBuffer.data + sensorStreamBuffer.length,
-					sizeof(sensorStreamBuffer.data) - sensorStreamBuffer.length,
-					"991,,%.3lf,%.3lf,%.3lf\r\n", sensorValue.Accel.X / 1000.0,
-					sensorValue.Accel.Y / 1000.0, sensorValue.Accel.Z / 1000.0);
-			// update inventory with latest measurements
-			sensorStreamBuffer.length += snprintf(
-					sensorStreamBuffer.data + sensorStreamBuffer.length,
-					sizeof(sensorStreamBuffer.data) - sensorStreamBuffer.length,
-					"1991,%s,%.3lf,%.3lf,%.3lf\r\n", MqttConnectInfo.ClientId,
-					sensorValue.Accel.X / 1000.0, sensorValue.Accel.Y / 1000.0,
-					sensorValue.Accel.Z / 1000.0);
+/**
+ * @brief An asset payload completed, the topics are subscribed once the device exists
+ */
+static void MQTTOperation_AssetCompleted(Retcode_T result) {
+	if (RETCODE_OK != result) {
+		LOG_AT_ERROR(("MQTTOperation: MQTT publish failed \r\n"));
+		Retcode_RaiseError(result);
+		errorCountPublish++;
+	} else if (assetUpdateProcess == APP_ASSET_PUBLISHED) {
+		// wait an extra tick rate until topic are created in Cumulocity
+		// topics are only created after the device is created
+		vTaskDelay(pdMS_TO_TICKS(1000));
+		if (RETCODE_OK != MQTTOperation_SubscribeTopics()) {
+			LOG_AT_ERROR(
+					("MQTTOperation: MQTT subscription failed!\r\n"));
+			// the connection is checked again at the start of the next loop
+		} else {
+			assetUpdateProcess = APP_ASSET_COMPLETED;
 		}
-		if (SensorSetup.Enable.Gyro) {
-			sensorStreamBuffer.length += snprintf(
-					sensorStreamBuffer.data + sensorStreamBuffer.length,
-					sizeof(sensorStreamBuffer.data) - sensorStreamBuffer.length,
-					"992,,%ld,%ld,%ld\r\n", sensorValue.Gyro.X,
-					sensorValue.Gyro.Y, sensorValue.Gyro.Z);
-			// update inventory with latest measurements
-			sensorStreamBuffer.length += snprintf(
-					sensorStreamBuffer.data + sensorStreamBuffer.length,
-					sizeof(sensorStreamBuffer.data) - sensorStreamBuffer.length,
-					"1992,%s,%ld,%ld,%ld\r\n", MqttConnectInfo.ClientId,
-					sensorValue.Gyro.X, sensorValue.Gyro.Y, sensorValue.Gyro.Z);
+	}
+}
+
+/**
+ * @brief Start a binary payload with the time of its first record
+ *
+ * @return true if the payload is started or was started before
+ */
+static bool MQTTOperation_EncodeHeader(MQTTBuffer_Payload_T * payload, TickType_t tick) {
+	if (payload->length != NUMBER_UINT32_ZERO) {
+		return true;
+	}
+	binaryTick = tick;
+	return MQTTBinary_Header(payload, MQTTClock_IsSynchronized() ? MQTTClock_ToEpochMs(tick) : 0ULL);
+}
+
+/**
+ * @brief Append a binary record of values taken at the given tick
+ *
+ * @return true if the record fits, otherwise the payload is left unchanged. A
+ * record too far from the previous one is treated like a full payload.
+ */
+static bool MQTTOperation_EncodeValues(MQTTBuffer_Payload_T * payload, TickType_t tick, uint8_t tag,
+		const int32_t * values, uint8_t count, uint8_t decimals) {
+	const uint32_t start = payload->length;
+
+	if (MQTTOperation_EncodeHeader(payload, tick) == false) {
+		return false;
+	}
+	uint32_t delta = (uint32_t) (TickType_t) (tick - binaryTick) * portTICK_PERIOD_MS;
+	if (MQTTBinary_Values(payload, tag, delta, values, count, decimals) == false) {
+		payload->length = start;
+		return false;
+	}
+	binaryTick = tick;
+	return true;
+}
+
+/**
+ * @brief Payload a SmartREST line is written to, binary payloads take it as text record in MQTTOperation_EndLine
+ */
+static MQTTBuffer_Payload_T * MQTTOperation_LineTarget(MQTTBuffer_Payload_T * payload) {
+	if (payloadBinary == false) {
+		return payload;
+	}
+	binaryLine.length = NUMBER_UINT32_ZERO;
+	return &binaryLine;
+}
+
+/**
+ * @brief Finish a line started on MQTTOperation_LineTarget
+ *
+ * @return true if the line fits, otherwise the payload is left unchanged
+ */
+static bool MQTTOperation_EndLine(MQTTFormat_Line_T * line, MQTTBuffer_Payload_T * payload, TickType_t tick) {
+	if (MQTTFormat_EndLine(line) == false) {
+		return false;
+	}
+	if (payloadBinary == false) {
+		return true;
+	}
+
+	const uint32_t start = payload->length;
+	if (MQTTOperation_EncodeHeader(payload, tick)
+			&& MQTTBinary_Text(payload, binaryLine.data, binaryLine.length)) {
+		return true;
+	}
+	payload->length = start;
+	return false;
+}
+
+/**
+ * @brief Read the aggregation window from the configuration and restart all windows
+ */
+static void MQTTOperation_ConfigureAggregation(void) {
+	int32_t window = MQTTCfgParser_GetAggregateWindow();
+
+	aggregateWindow = (window > 1L) ? (uint32_t) window : 0UL;
+	for (uint8_t stream = 0U; stream < INVENTORY_STREAM_COUNT; stream++) {
+		MQTTAggregate_Reset(&aggregates[stream]);
+	}
+	LOG_AT_INFO(("MQTTOperation: Aggregation window [%lu] samples\r\n", aggregateWindow));
+}
+
+/**
+ * @brief Read the number of samples sent in one publish from the configuration
+ */
+static void MQTTOperation_ConfigureBatch(void) {
+	int32_t size = MQTTCfgParser_GetBatchSize();
+
+	batchSize = (size > 1L) ? (uint32_t) size : 0UL;
+	LOG_AT_INFO(("MQTTOperation: Batch size [%lu] samples\r\n", batchSize));
+}
+
+/**
+ * @brief Sample the accelerometer at the tick rate and compute the vibration spectrum
+ *
+ * The regular accelerometer sampling is paused and the bandwidth of the
+ * BMA280 is opened to half the capture rate while capturing. This blocks the
+ * publish loop for MQTTSPECTRUM_SIZE ticks.
+ *
+ * @param[out] result - vibration figures in mg
+ *
+ * @return true if all samples could be read
+ */
+static bool MQTTOperation_CaptureVibration(MQTTSpectrum_Result_T * result) {
+	Accelerometer_Bandwidth_T bandwidth;
+	Retcode_T retcode = RETCODE_OK;
+
+	if (SensorSetup.Enable.Accel == false) {
+		LOG_AT_WARNING(("MQTTOperation: Vibration needs the accelerometer enabled!\r\n"));
+		return false;
+	}
+	// the sampler must not read the BMA280 while its bandwidth is changed
+	MQTTSampler_Disable(SENSOR_CHANNEL_ACCEL);
+	retcode = Accelerometer_getBandwidth(xdkAccelerometers_BMA280_Handle, &bandwidth);
+	bool restore = (RETCODE_OK == retcode);
+	if (RETCODE_OK == retcode) {
+		retcode = Accelerometer_setBandwidth(xdkAccelerometers_BMA280_Handle, ACCELEROMETER_BMA280_BANDWIDTH_500HZ);
+	}
+
+	TickType_t wake = xTaskGetTickCount();
+	for (uint32_t n = 0UL; n < MQTTSPECTRUM_SIZE && RETCODE_OK == retcode; n++) {
+		Accelerometer_XyzData_T accel = { 0 };
+		vTaskDelayUntil(&wake, MQTTOPERATION_VIBRATION_TICKS);
+		retcode = Accelerometer_readXyzGValue(xdkAccelerometers_BMA280_Handle, &accel);
+		vibrationSamples[0][n] = (int16_t) accel.xAxisData;
+		vibrationSamples[1][n] = (int16_t) accel.yAxisData;
+		vibrationSamples[2][n] = (int16_t) accel.zAxisData;
+	}
+
+	if (restore) {
+		Accelerometer_setBandwidth(xdkAccelerometers_BMA280_Handle, bandwidth);
+	}
+	MQTTOperation_ConfigureRates();
+	if (RETCODE_OK != retcode) {
+		LOG_AT_ERROR(("MQTTOperation: Vibration capture failed!\r\n"));
+		Retcode_RaiseError(retcode);
+		return false;
+	}
+
+	const int16_t * const axes[MQTTSPECTRUM_MAX_AXES] = { vibrationSamples[0], vibrationSamples[1], vibrationSamples[2] };
+	MQTTSpectrum_Analyze(axes, MQTTSPECTRUM_MAX_AXES,
+			1000.0F / (float) (MQTTOPERATION_VIBRATION_TICKS * portTICK_PERIOD_MS), result);
+	LOG_AT_INFO(("MQTTOperation: Vibration peak at [%ld] Hz\r\n", (long) result->peakFrequency));
+	return true;
+}
+
+/**
+ * @brief Append the timing statistics of the sampling task as one measurement
+ *
+ * The jitter histogram, the maximum jitter and the skipped deadlines are
+ * series of the fragment xdk_SamplingJitter, using the static template 201.
+ */
+static void MQTTOperation_FormatSampling(MQTTBuffer_Payload_T * asset) {
+	MQTTSampler_Statistics_T statistics;
+	MQTTFormat_Line_T line;
+
+	MQTTSampler_GetStatistics(&statistics);
+	MQTTFormat_BeginLine(&line, asset);
+	MQTTFormat_Text(&line, "201,xdk_SamplingJitter,");
+	for (uint8_t bucket = 0U; bucket < MQTTSAMPLER_BUCKETS; bucket++) {
+		MQTTFormat_Text(&line, ",xdk_SamplingJitter,");
+		MQTTFormat_Text(&line, jitterSeries[bucket]);
+		MQTTFormat_Char(&line, ',');
+		MQTTFormat_UInt(&line, statistics.histogram[bucket]);
+		MQTTFormat_Char(&line, ',');
+	}
+	MQTTFormat_Text(&line, ",xdk_SamplingJitter,max,");
+	MQTTFormat_UInt(&line, statistics.jitterMax);
+	MQTTFormat_Text(&line, ",ms,xdk_SamplingJitter,overrun,");
+	MQTTFormat_UInt(&line, statistics.overrun);
+	MQTTFormat_Char(&line, ',');
+	MQTTFormat_EndLine(&line);
+}
+
+/**
+ * @brief Attach the static payload memory to a pool
+ */
+static void MQTTOperation_InitPool(MQTTBuffer_Pool_T * pool, MQTTBuffer_Payload_T * payloads, uint8_t count, char * data, uint32_t size) {
+	for (uint8_t index = 0U; index < count; index++) {
+		payloads[index].data = data + index * size;
+		payloads[index].size = size;
+	}
+	MQTTBuffer_PoolInit(pool, payloads, count);
+}
+
+/**
+ * @brief Append one SmartREST line "<template>,<source>,<value>,..." to a payload
+ *
+ * @param[in] payload - payload to append to
+ * @param[in] template - SmartREST template id
+ * @param[in] source - empty for measurements, client id for inventory updates
+ * @param[in] values - values scaled by 10^decimals
+ * @param[in] count - number of values
+ * @param[in] decimals - number of decimals of the values
+ *
+ * @return true if the line fits, otherwise the payload is left unchanged
+ */
+static bool MQTTOperation_FormatValues(MQTTBuffer_Payload_T * payload, const char * template,
+		const char * source, const int32_t * values, uint8_t count, uint8_t decimals) {
+	MQTTFormat_Line_T line;
+
+	MQTTFormat_BeginLine(&line, payload);
+	MQTTFormat_Text(&line, template);
+	MQTTFormat_Char(&line, ',');
+	MQTTFormat_Text(&line, source);
+	for (uint8_t index = 0U; index < count; index++) {
+		MQTTFormat_Char(&line, ',');
+		MQTTFormat_Fixed(&line, values[index], decimals);
+	}
+	return MQTTFormat_EndLine(&line);
+}
+
+/**
+ * @brief Append the aggregate record "<template>,<time>,<samples>,<mean>,<min>,<max>,<stddev>,..." of a complete window
+ *
+ * Mean and standard deviation get one decimal more than the values, as they
+ * are finer than the resolution of a single sample. The time is the one of
+ * the last sample in the window, or empty for the time of arrival.
+ *
+ * @return true if the line fits, otherwise the payload is left unchanged
+ */
+static bool MQTTOperation_FormatAggregate(MQTTBuffer_Payload_T * payload, MQTTInventory_Stream_T stream,
+		TickType_t tick, const char * time, uint8_t decimals) {
+	const MQTTAggregate_T * aggregate = &aggregates[stream];
+	const uint8_t fine = (decimals < MQTTFORMAT_MAX_DECIMALS) ? 1U : 0U;
+	MQTTFormat_Line_T line;
+
+	MQTTFormat_BeginLine(&line, MQTTOperation_LineTarget(payload));
+	MQTTFormat_Text(&line, aggregateTemplates[stream]);
+	MQTTFormat_Char(&line, ',');
+	MQTTFormat_Text(&line, time);
+	MQTTFormat_Char(&line, ',');
+	MQTTFormat_UInt(&line, aggregate->count);
+	for (uint8_t index = 0U; index < aggregate->values; index++) {
+		MQTTFormat_Char(&line, ',');
+		MQTTFormat_Fixed(&line, MQTTFormat_ScaleFloat(MQTTAggregate_Mean(aggregate, index), fine), decimals + fine);
+		MQTTFormat_Char(&line, ',');
+		MQTTFormat_Fixed(&line, aggregate->min[index], decimals);
+		MQTTFormat_Char(&line, ',');
+		MQTTFormat_Fixed(&line, aggregate->max[index], decimals);
+		MQTTFormat_Char(&line, ',');
+		MQTTFormat_Fixed(&line, MQTTFormat_ScaleFloat(MQTTAggregate_StdDev(aggregate, index), fine), decimals + fine);
+	}
+	return MQTTOperation_EndLine(&line, payload, tick);
+}
+
+/**
+ * @brief Append the vibration spectrum "971,<time>,<peak Hz>,<peak>,<rms>,<band 1>,...,<band 8>"
+ *
+ * The accelerometer delivers mg, amplitudes are written as g like the acceleration.
+ *
+ * @return true if the line fits, otherwise the payload is left unchanged
+ */
+static bool MQTTOperation_FormatVibration(MQTTBuffer_Payload_T * payload, const MQTTSpectrum_Result_T * result,
+		TickType_t tick, const char * time) {
+	MQTTFormat_Line_T line;
+
+	MQTTFormat_BeginLine(&line, MQTTOperation_LineTarget(payload));
+	MQTTFormat_Text(&line, TEMPLATE_CUS_VIBRATION);
+	MQTTFormat_Char(&line, ',');
+	MQTTFormat_Text(&line, time);
+	MQTTFormat_Char(&line, ',');
+	MQTTFormat_Fixed(&line, MQTTFormat_ScaleFloat(result->peakFrequency, 1U), 1U);
+	MQTTFormat_Char(&line, ',');
+	MQTTFormat_Fixed(&line, MQTTFormat_ScaleFloat(result->peakAmplitude, 0U), 3U);
+	MQTTFormat_Char(&line, ',');
+	MQTTFormat_Fixed(&line, MQTTFormat_ScaleFloat(result->rms, 0U), 3U);
+	for (uint8_t band = 0U; band < MQTTSPECTRUM_BANDS; band++) {
+		MQTTFormat_Char(&line, ',');
+		MQTTFormat_Fixed(&line, MQTTFormat_ScaleFloat(result->bands[band], 0U), 3U);
+	}
+	return MQTTOperation_EndLine(&line, payload, tick);
+}
+
+/**
+ * @brief Append the measurement and, if due, the inventory update of one stream
+ *
+ * Whether the inventory update is due is decided only once per sample, so a
+ * sample that is formatted again after a full payload gets the same lines.
+ *
+ * @param[in] payload - payload to append to
+ * @param[in] sample - sample the values are taken from
+ * @param[in] time - time of the sample for $.time, empty for the time of arrival
+ * @param[in] stream - stream of the values, orientation has no measurement line
+ * @param[in] values - values scaled by 10^decimals
+ * @param[in] count - number of values
+ * @param[in] decimals - number of decimals of the values
+ *
+ * @return true if the lines fit, otherwise the payload is left unchanged
+ */
+static bool MQTTOperation_FormatStream(MQTTBuffer_Payload_T * payload, SensorSample_T * sample,
+		const char * time, MQTTInventory_Stream_T stream, const int32_t * values, uint8_t count, uint8_t decimals) {
+	const char * template = inventoryTemplates[stream];
+	const uint16_t mask = (uint16_t) (1U << stream);
+	const uint32_t start = payload->length;
+
+	// a noise window is an aggregate already
+	if (stream != INVENTORY_STREAM_ORIENTATION && aggregateWindow > 1UL
+			&& (stream != INVENTORY_STREAM_NOISE || sample->noiseWindowed == false)) {
+		// the sample goes into the window, only a complete window is sent
+		if ((sample->aggregated & mask) == 0U) {
+			sample->aggregated |= mask;
+			MQTTAggregate_Add(&aggregates[stream], values, count);
 		}
-		if (SensorSetup.Enable.Mag) {
-			sensorStreamBuffer.length += snprintf(
-					sensorStreamBuffer.data + sensorStreamBuffer.length,
-					sizeof(sensorStreamBuffer.data) - sensorStreamBuffer.length,
-					"993,,%ld,%ld,%ld\r\n", sensorValue.Mag.X,
-					sensorValue.Mag.Y, sensorValue.Mag.Z);
-			// update inventory with latest measurements
-			sensorStreamBuffer.length += snprintf(
-					sensorStreamBuffer.data + sensorStreamBuffer.length,
-					sizeof(sensorStreamBuffer.data) - sensorStreamBuffer.length,
-					"1993,%s,%ld,%ld,%ld\r\n", MqttConnectInfo.ClientId,
-					sensorValue.Mag.X, sensorValue.Mag.Y, sensorValue.Mag.Z);
+		if (aggregates[stream].count >= aggregateWindow
+				&& MQTTOperation_FormatAggregate(payload, stream, sample->tick, time, decimals) == false) {
+			return false;
+		}
+	} else if (stream != INVENTORY_STREAM_ORIENTATION) {
+		// like the inventory the deadband is checked only once per sample
+		if ((sample->measurementDecided & mask) == 0U) {
+			sample->measurementDecided |= mask;
+			if (MQTTDeadband_IsDue(stream, values, count)) {
+				sample->measurementDue |= mask;
+			}
+		}
+		if ((sample->measurementDue & mask) != 0U) {
+			bool fits = payloadBinary ?
+					MQTTOperation_EncodeValues(payload, sample->tick, (uint8_t) stream, values, count, decimals) :
+					MQTTOperation_FormatValues(payload, &template[1], time, values, count, decimals);
+			if (fits == false) {
+				return false;
+			}
 		}
-		if (SensorSetup.Enable.Light) {
-			sensorStreamBuffer.length += snprintf(
-					sensorStreamBuffer.data + sensorStreamBuffer.length,
-					sizeof(sensorStreamBuffer.data) - sensorStreamBuffer.length,
-					"994,,%.2lf\r\n", sensorValue.Light / 1000.0);
-			// update inventory with latest measurements
-			sensorStreamBuffer.length += snprintf(
-					sensorStreamBuffer.data + sensorStreamBuffer.length,
-					sizeof(sensorStreamBuffer.data) - sensorStreamBuffer.length,
-					"1994,%s,%.2lf\r\n", MqttConnectInfo.ClientId,
-					sensorValue.Light / 1000.0);
+	}
+
+	if ((sample->inventoryDecided & mask) == 0U) {
+		sample->inventoryDecided |= mask;
+		if (MQTTInventory_IsDue(stream, values, count)) {
+			sample->inventoryDue |= mask;
+		} else {
+			// "<template>,<client id>,<value>,...\r\n"
+			uint32_t saved = strlen(template) + 1UL + strlen(MqttConnectInfo.ClientId) + 2UL;
+			for (uint8_t index = 0U; index < count; index++) {
+				saved += 1UL + MQTTFormat_FixedLength(values[index], decimals);
+			}
+			MQTTInventory_Skipped(saved);
 		}
-		// only all three at the same time can be enabled
-		if (SensorSetup.Enable.Temp) {
-			// update inventory with latest measurements
-			sensorStreamBuffer.length += snprintf(
-					sensorStreamBuffer.data + sensorStreamBuffer.length,
-					sizeof(sensorStreamBuffer.data) - sensorStreamBuffer.length,
-					"995,,%ld\r\n", sensorValue.RH);
-
-			sensorStreamBuffer.length += snprintf(
-					sensorStreamBuffer.data + sensorStreamBuffer.length,
-					sizeof(sensorStreamBuffer.data) - sensorStreamBuffer.length,
-					"1995,%s,%ld\r\n", MqttConnectInfo.ClientId,
-					sensorValue.RH);
-
-			sensorStreamBuffer.length += snprintf(
-					sensorStreamBuffer.data + sensorStreamBuffer.length,
-					sizeof(sensorStreamBuffer.data) - sensorStreamBuffer.length,
-					"996,,%.2lf\r\n", sensorValue.Temp / 972.3);
-
-			sensorStreamBuffer.length += snprintf(
-					sensorStreamBuffer.data + sensorStreamBuffer.length,
-					sizeof(sensorStreamBuffer.data) - sensorStreamBuffer.length,
-					"1996,%s,%.2lf\r\n", MqttConnectInfo.ClientId,
-					sensorValue.Temp / 972.3);
-
-			sensorStreamBuffer.length += snprintf(
-					sensorStreamBuffer.data + sensorStreamBuffer.length,
-					sizeof(sensorStreamBuffer.data) - sensorStreamBuffer.length,
-					"997,,%.2lf\r\n", sensorValue.Pressure / 100.0);
-
-			sensorStreamBuffer.length += snprintf(
-					sensorStreamBuffer.data + sensorStreamBuffer.length,
-					sizeof(sensorStreamBuffer.data) - sensorStreamBuffer.length,
-					"1997,%s,%.2lf\r\n", MqttConnectInfo.ClientId,
-					sensorValue.Pressure / 100.0);
+	}
+
+	if ((sample->inventoryDue & mask) != 0U) {
+		// update inventory with latest measurements
+		bool fits = payloadBinary ?
+				MQTTOperation_EncodeValues(payload, sample->tick, (uint8_t) stream | MQTTBINARY_TAG_INVENTORY,
+						values, count, decimals) :
+				MQTTOperation_FormatValues(payload, template, MqttConnectInfo.ClientId, values, count, decimals);
+		if (fits == false) {
+			payload->length = start;
+			payload->data[start] = '\0';
+			return false;
 		}
+	}
+	return true;
+}
+
+/**
+ * @brief Append the SmartREST lines of one sample to a payload
+ *
+ * All values are scaled to integers, so no floating point printf is needed.
+ *
+ * @param[in] payload - payload to append to
+ * @param[in] sample - sample taken by the sampling task
+ *
+ * @return true if all lines fit, otherwise the payload is left unchanged
+ */
+static bool MQTTOperation_FormatSample(MQTTBuffer_Payload_T * payload, SensorSample_T * sample) {
+	const uint32_t start = payload->length;
+	const Sensor_Value_T * sensorValue = &sample->value;
+	int32_t values[MQTTINVENTORY_MAX_VALUES];
+	char time[MQTTCLOCK_TIME_SIZE] = "";
+	bool fits = true;
+
+	if (MQTTOperation_IsTimed()) {
+		MQTTClock_Format(sample->tick, time);
+	}
+
+#if ENABLE_SENSOR_TOOLBOX
+	if (sample->eulerValid) {
+		// update orientation
+		values[0] = MQTTFormat_ScaleFloat(sample->euler.heading, 3U);
+		values[1] = MQTTFormat_ScaleFloat(sample->euler.pitch, 3U);
+		values[2] = MQTTFormat_ScaleFloat(sample->euler.roll, 3U);
+		values[3] = MQTTFormat_ScaleFloat(sample->euler.yaw, 3U);
+		fits = fits && MQTTOperation_FormatStream(payload, sample, time,
+				INVENTORY_STREAM_ORIENTATION, values, 4U, 3U);
+	}
+#endif
 
-		if (SensorSetup.Enable.Noise) {
-			sensorStreamBuffer.length += snprintf(
-					sensorStreamBuffer.data + sensorStreamBuffer.length,
-					sizeof(sensorStreamBuffer.data) - sensorStreamBuffer.length,
-					"998,,%.4f\r\n",
-					MQTTOperation_CalcSoundPressure(sensorValue.Noise));
-			// update inventory with latest measurements
-			sensorStreamBuffer.length += snprintf(
-					sensorStreamBuffer.data + sensorStreamBuffer.length,
-					sizeof(sensorStreamBuffer.data) - sensorStreamBuffer.length,
-					"1998,%s,%.4f\r\n", MqttConnectInfo.ClientId,
-					MQTTOperation_CalcSoundPressure(sensorValue.Noise));
+	if (sample->channels & SENSOR_CHANNEL_BIT(SENSOR_CHANNEL_ACCEL)) {
+		// mg, written as g with 3 decimals
+		values[0] = sensorValue->Accel.X;
+		values[1] = sensorValue->Accel.Y;
+		values[2] = sensorValue->Accel.Z;
+		fits = fits && MQTTOperation_FormatStream(payload, sample, time,
+				INVENTORY_STREAM_ACCEL, values, 3U, 3U);
+	}
+	if (sample->channels & SENSOR_CHANNEL_BIT(SENSOR_CHANNEL_GYRO)) {
+		values[0] = sensorValue->Gyro.X;
+		values[1] = sensorValue->Gyro.Y;
+		values[2] = sensorValue->Gyro.Z;
+		fits = fits && MQTTOperation_FormatStream(payload, sample, time,
+				INVENTORY_STREAM_GYRO, values, 3U, 0U);
+	}
+	if (sample->channels & SENSOR_CHANNEL_BIT(SENSOR_CHANNEL_MAG)) {
+		values[0] = sensorValue->Mag.X;
+		values[1] = sensorValue->Mag.Y;
+		values[2] = sensorValue->Mag.Z;
+		fits = fits && MQTTOperation_FormatStream(payload, sample, time,
+				INVENTORY_STREAM_MAG, values, 3U, 0U);
+	}
+	if (sample->channels & SENSOR_CHANNEL_BIT(SENSOR_CHANNEL_LIGHT)) {
+		// mlux, written as lux with 2 decimals
+		values[0] = MQTTFormat_RoundDiv((int32_t) sensorValue->Light, 10L);
+		fits = fits && MQTTOperation_FormatStream(payload, sample, time,
+				INVENTORY_STREAM_LIGHT, values, 1U, 2U);
+	}
+	// humidity, temperature and pressure are read together
+	if (sample->channels & SENSOR_CHANNEL_BIT(SENSOR_CHANNEL_ENV)) {
+		values[0] = (int32_t) sensorValue->RH;
+		fits = fits && MQTTOperation_FormatStream(payload, sample, time,
+				INVENTORY_STREAM_HUMIDITY, values, 1U, 0U);
+
+		// Temp / 972.3 with 2 decimals
+		values[0] = MQTTFormat_RoundDiv(sensorValue->Temp * 1000L, 9723L);
+		fits = fits && MQTTOperation_FormatStream(payload, sample, time,
+				INVENTORY_STREAM_TEMP, values, 1U, 2U);
+
+		// Pa, written as hPa with 2 decimals
+		values[0] = (int32_t) sensorValue->Pressure;
+		fits = fits && MQTTOperation_FormatStream(payload, sample, time,
+				INVENTORY_STREAM_PRESSURE, values, 1U, 2U);
+	}
+
+	if (sample->channels & SENSOR_CHANNEL_BIT(SENSOR_CHANNEL_NOISE)) {
+		if (sample->noiseWindowed) {
+			// rms and peak in Pa, Leq in dB, all with the decimals of the pressure
+			values[0] = (int32_t) MQTTNoise_Rms(&sample->noise);
+			values[1] = MQTTFormat_ScaleFloat(MQTTNoise_Leq(&sample->noise), MQTTNOISE_DECIMALS);
+			values[2] = (int32_t) sample->noise.peak;
+			fits = fits && MQTTOperation_FormatStream(payload, sample, time,
+					INVENTORY_STREAM_NOISE, values, 3U, MQTTNOISE_DECIMALS);
+		} else {
+			values[0] = MQTTFormat_ScaleFloat(
+					MQTTOperation_CalcSoundPressure(sensorValue->Noise), 4U);
+			fits = fits && MQTTOperation_FormatStream(payload, sample, time,
+					INVENTORY_STREAM_NOISE, values, 1U, 4U);
 		}
-	} else
-		errorCountSemaphore++;
-	//	printf("MQTTOperation: Sorry Semi ... \r\n");
-	xSemaphoreGive(semaphoreSensorBuffer);
+	}
 
+	if (fits == false) {
+		// never publish half a sample
+		payload->length = start;
+		payload->data[start] = '\0';
+	} else {
+		// windows are only restarted once their record is in the payload
+		for (uint8_t stream = 0U; stream < INVENTORY_STREAM_COUNT; stream++) {
+			if (aggregateWindow > 1UL && aggregates[stream].count >= aggregateWindow) {
+				MQTTAggregate_Reset(&aggregates[stream]);
+			}
+		}
+	}
+	return fits;
 }
 
 static float MQTTOperation_CalcSoundPressure(float acousticRawValue) {
@@ -1077,16 +2330,29 @@ static float MQTTOperation_CalcSoundPressure(float acousticRawValue) {
 /* global functions ********************************************************* */
 
 /**
- * @brief stops the data streaming timer
+ * @brief Queue a command of the device itself, it is executed without being parsed
  *
- * @return NONE
+ * Has the signature of a CmdProcessor function, so the buttons can enqueue it from their ISR.
+ *
+ * @param[in] param1 UNUSED
+ * @param[in] param2 the command, MQTTOperation_Local_T
  */
 void MQTTOperation_QueueCommand(void * param1, uint32_t param2) {
-	BCDS_UNUSED(param2);
-	if (xQueueSend(commandQueue,(char *) param1, 0) != pdTRUE) {
-		LOG_AT_ERROR(("MQTTOperation: Could not buffer command!\r\n"));
+	BCDS_UNUSED(param1);
+	uint8_t local = (uint8_t) param2;
+
+	if (param2 >= (uint32_t) MQTTOPERATION_LOCAL_COMMANDS) {
+		return;
 	}
-	return;
+	// the buttons and the publish loop queue local commands
+	taskENTER_CRITICAL();
+	bool queued = MQTTBuffer_RingPush(&localCommands, &local);
+	taskEXIT_CRITICAL();
+	if (queued == false) {
+		LOG_AT_ERROR(("MQTTOperation: Could not buffer local command [%lu]!\r\n", param2));
+		return;
+	}
+	MQTTOperation_NotifyPublisher();
 }
 
 /**
@@ -1142,12 +2408,10 @@ void MQTTOperation_Init(void* pvParameters) {
  */
 void MQTTOperation_DeInit(void) {
 	LOG_AT_DEBUG(("MQTTOperation: Calling DeInit\r\n"));
-	MQTT_UnSubsribeFromTopic_Z(&MqttSubscribeCommandInfo,
-	MQTT_UNSUBSCRIBE_TIMEOUT_IN_MS);
-	MQTT_UnSubsribeFromTopic_Z(&MqttSubscribeRestartInfo,
-	MQTT_UNSUBSCRIBE_TIMEOUT_IN_MS);
-	MQTT_UnSubsribeFromTopic_Z(&MqttSubscribeErrorInfo,
-	MQTT_UNSUBSCRIBE_TIMEOUT_IN_MS);
+	for (uint8_t index = 0U; index < MQTTOPERATION_TOPICS; index++) {
+		MQTT_UnSubsribeFromTopic_Z(&MqttSubscribeInfo[index],
+		MQTT_UNSUBSCRIBE_TIMEOUT_IN_MS);
+	}
 	//ignore return code
 	Retcode_T retcode = RETCODE_OK;
 
@@ -29,6 +29,13 @@
 #define TEMPLATE_STD_COMMAND    	"511"
 #define TEMPLATE_STD_FIRMWARE    	"515"
 #define TEMPLATE_CUS_MESSAGE    	"999"
+#define TEMPLATE_CUS_VIBRATION  	"971"
+
+//template numbers of the operations received as commands
+#define TEMPLATE_ID_RESTART    		510U
+#define TEMPLATE_ID_COMMAND    		511U
+#define TEMPLATE_ID_FIRMWARE    	515U
+#define TEMPLATE_ID_MESSAGE    		999U
 
 
 //Cumulocity topics to send data
@@ -46,6 +53,20 @@
 #define MQTTOPERATION_LOGPREFIX 	 "MQTTOperation"
 
 
+/**
+ * Commands the device issues itself, passed as param2 of MQTTOperation_QueueCommand
+ */
+typedef enum
+{
+	MQTTOPERATION_LOCAL_START_BUTTON,
+	MQTTOPERATION_LOCAL_STOP_BUTTON,
+	MQTTOPERATION_LOCAL_REQUEST_COMMANDS,
+	MQTTOPERATION_LOCAL_RESET_BOOTSTATUS,
+	MQTTOPERATION_LOCAL_PRINT_CONFIG,
+	MQTTOPERATION_LOCAL_RESTART_CONFIRM,
+	MQTTOPERATION_LOCAL_COMMANDS,
+} MQTTOperation_Local_T;
+
 /* global function prototype declarations */
 void MQTTOperation_Init(void* pvParameters);
 void MQTTOperation_DeInit(void);
@@ -91,6 +112,7 @@ typedef enum
 	CMD_REQUEST,
 	CMD_LOG,
 	CMD_COMMAND,
+	CMD_VIBRATION,
 } C8Y_COMMAND;
 
 
@@ -108,6 +130,7 @@ static const char * const commands[] = {
 		"c8y_Command",
 		"c8y_Command",
 		"c8y_Command",
+		"c8y_Command",
 };
 
 /* global variable declarations */
@@ -0,0 +1,194 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	MQTTRouter.c
+ **
+ **	DESCRIPTION:	Source Code for the Cumulocity MQTT Client for the Bosch XDK
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* system header files */
+#include <string.h>
+
+/* own header files */
+#include "MQTTRouter.h"
+
+/* constant definitions ***************************************************** */
+
+#define MQTTROUTER_SLOT(hash)		((hash) & (MQTTROUTER_SLOTS - 1UL))
+
+/* local variables ********************************************************** */
+
+/* global variables ********************************************************* */
+
+/* local functions ********************************************************** */
+
+/**
+ * @brief FNV-1a hash of a topic
+ */
+static uint32_t MQTTRouter_Hash(const char * topic, uint32_t length) {
+	uint32_t hash = UINT32_C(2166136261);
+	for (uint32_t i = 0UL; i < length; i++) {
+		hash ^= (uint8_t) topic[i];
+		hash *= UINT32_C(16777619);
+	}
+	return hash;
+}
+
+/**
+ * @brief Check a filter, '#' only as the last level and wildcards only as a whole level
+ */
+static bool MQTTRouter_IsValid(const char * filter, uint32_t length, bool * wildcard) {
+	*wildcard = false;
+	for (uint32_t i = 0UL; i < length; i++) {
+		if (filter[i] != '+' && filter[i] != '#') {
+			continue;
+		}
+		const bool levelStart = (i == 0UL || filter[i - 1UL] == '/');
+		const bool levelEnd = (i + 1UL == length || filter[i + 1UL] == '/');
+		if (levelStart == false || levelEnd == false || (filter[i] == '#' && i + 1UL != length)) {
+			return false;
+		}
+		*wildcard = true;
+	}
+	return length > 0UL;
+}
+
+/**
+ * @brief Match a topic level by level against a wildcard filter
+ */
+static bool MQTTRouter_MatchFilter(const MQTTRouter_Route_T * route, const char * topic, uint32_t length) {
+	uint32_t f = 0UL;
+	uint32_t t = 0UL;
+
+	// topics starting with '$' are not matched by a wildcard at the first level, "$SYS/#" still matches
+	if (length > 0UL && topic[0] == '$' && (route->filter[0] == '+' || route->filter[0] == '#')) {
+		return false;
+	}
+	while (f < route->length) {
+		const char c = route->filter[f];
+		if (c == '#') {
+			// also matches the parent level, "a/#" matches "a"
+			return true;
+		}
+		if (c == '+') {
+			while (t < length && topic[t] != '/') {
+				t++;
+			}
+			f++;
+		} else if (t < length && topic[t] == c) {
+			f++;
+			t++;
+		} else if (t == length && c == '/' && f + 2UL == route->length && route->filter[f + 1UL] == '#') {
+			return true;
+		} else {
+			return false;
+		}
+	}
+	return t == length;
+}
+
+/**
+ * @brief Build the hash index of the exact filters
+ */
+static void MQTTRouter_Index(MQTTRouter_T * router) {
+	memset(router->index, MQTTROUTER_NONE, sizeof(router->index));
+	router->wildcards = 0U;
+	for (uint8_t route = 0U; route < MQTTROUTER_ROUTES; route++) {
+		const MQTTRouter_Route_T * entry = &router->routes[route];
+		if (entry->filter == NULL) {
+			continue;
+		}
+		if (entry->wildcard) {
+			router->wildcards++;
+			continue;
+		}
+		uint32_t slot = MQTTROUTER_SLOT(entry->hash);
+		while (router->index[slot] != MQTTROUTER_NONE) {
+			slot = MQTTROUTER_SLOT(slot + 1UL);
+		}
+		router->index[slot] = (int8_t) route;
+	}
+}
+
+/**
+ * @brief Find the route of a filter that was added
+ */
+static int8_t MQTTRouter_Find(const MQTTRouter_T * router, const char * filter, uint32_t length) {
+	for (uint8_t route = 0U; route < MQTTROUTER_ROUTES; route++) {
+		const MQTTRouter_Route_T * entry = &router->routes[route];
+		if (entry->filter != NULL && entry->length == length && memcmp(entry->filter, filter, length) == 0) {
+			return (int8_t) route;
+		}
+	}
+	return MQTTROUTER_NONE;
+}
+
+/* global functions ********************************************************* */
+
+void MQTTRouter_Init(MQTTRouter_T * router) {
+	memset(router->routes, 0x00, sizeof(router->routes));
+	MQTTRouter_Index(router);
+}
+
+int8_t MQTTRouter_Add(MQTTRouter_T * router, const char * filter) {
+	const uint32_t length = (uint32_t) strlen(filter);
+	bool wildcard = false;
+
+	if (MQTTRouter_IsValid(filter, length, &wildcard) == false || length > UINT16_MAX) {
+		return MQTTROUTER_NONE;
+	}
+	int8_t route = MQTTRouter_Find(router, filter, length);
+	if (route != MQTTROUTER_NONE) {
+		return route;
+	}
+	for (uint8_t free = 0U; free < MQTTROUTER_ROUTES; free++) {
+		MQTTRouter_Route_T * entry = &router->routes[free];
+		if (entry->filter == NULL) {
+			entry->filter = filter;
+			entry->length = (uint16_t) length;
+			entry->hash = MQTTRouter_Hash(filter, length);
+			entry->wildcard = wildcard;
+			MQTTRouter_Index(router);
+			return (int8_t) free;
+		}
+	}
+	return MQTTROUTER_NONE;
+}
+
+int8_t MQTTRouter_Remove(MQTTRouter_T * router, const char * filter) {
+	const int8_t route = MQTTRouter_Find(router, filter, (uint32_t) strlen(filter));
+	if (route != MQTTROUTER_NONE) {
+		memset(&router->routes[route], 0x00, sizeof(router->routes[route]));
+		// removing from open addressing breaks probe chains, the index is small enough to rebuild
+		MQTTRouter_Index(router);
+	}
+	return route;
+}
+
+int8_t MQTTRouter_Match(const MQTTRouter_T * router, const char * topic, uint32_t length) {
+	const uint32_t hash = MQTTRouter_Hash(topic, length);
+
+	for (uint32_t slot = MQTTROUTER_SLOT(hash); router->index[slot] != MQTTROUTER_NONE; slot = MQTTROUTER_SLOT(slot + 1UL)) {
+		const MQTTRouter_Route_T * entry = &router->routes[router->index[slot]];
+		if (entry->hash == hash && entry->length == length && memcmp(entry->filter, topic, length) == 0) {
+			return router->index[slot];
+		}
+	}
+	if (router->wildcards > 0U) {
+		for (uint8_t route = 0U; route < MQTTROUTER_ROUTES; route++) {
+			const MQTTRouter_Route_T * entry = &router->routes[route];
+			if (entry->filter != NULL && entry->wildcard && MQTTRouter_MatchFilter(entry, topic, length)) {
+				return (int8_t) route;
+			}
+		}
+	}
+	return MQTTROUTER_NONE;
+}
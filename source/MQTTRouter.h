@@ -0,0 +1,90 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	MQTTRouter.h
+ **
+ **	DESCRIPTION:	Source Code for the Cumulocity MQTT Client for the Bosch XDK
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* header definition ******************************************************** */
+#ifndef MQTTROUTER_H_
+#define MQTTROUTER_H_
+
+/* local interface declaration ********************************************** */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* local type and macro definitions */
+
+#define MQTTROUTER_ROUTES			UINT8_C(8)		/**< Topic filters that can be routed */
+#define MQTTROUTER_SLOTS			UINT8_C(16)		/**< Slots of the hash index of exact filters, power of two and more than the routes */
+#define MQTTROUTER_NONE				INT8_C(-1)		/**< No route */
+
+/**
+ * @brief One topic filter, see MQTT 3.1.1 section 4.7
+ */
+typedef struct {
+	const char * filter; /**< the filter, not copied, NULL if the route is not used */
+	uint16_t length; /**< length of the filter */
+	uint32_t hash; /**< hash of the filter, only used for exact filters */
+	bool wildcard; /**< the filter contains '+' or '#' */
+} MQTTRouter_Route_T;
+
+/**
+ * @brief Routes topics of incoming publishes to the index of the matching filter
+ *
+ * Exact filters are found through a hash index of their precomputed hashes,
+ * so the cost of a lookup does not grow with the number of filters. Only the
+ * few wildcard filters are matched level by level. The router is not thread
+ * safe.
+ */
+typedef struct {
+	MQTTRouter_Route_T routes[MQTTROUTER_ROUTES]; /**< filters by route */
+	int8_t index[MQTTROUTER_SLOTS]; /**< routes of exact filters by hash, open addressing */
+	uint8_t wildcards; /**< number of wildcard filters */
+} MQTTRouter_T;
+
+/* global function prototype declarations */
+
+/**
+ * @brief Initialize an empty router
+ */
+void MQTTRouter_Init(MQTTRouter_T * router);
+
+/**
+ * @brief Add a topic filter, a filter added before keeps its route
+ *
+ * @param[in] filter topic filter, must stay valid until it is removed
+ *
+ * @return route of the filter or MQTTROUTER_NONE if the filter is invalid or all routes are used
+ */
+int8_t MQTTRouter_Add(MQTTRouter_T * router, const char * filter);
+
+/**
+ * @brief Remove a topic filter, the route can be used again
+ *
+ * @return route the filter had or MQTTROUTER_NONE if it was not added
+ */
+int8_t MQTTRouter_Remove(MQTTRouter_T * router, const char * filter);
+
+/**
+ * @brief Find the route of a topic, an exact filter is preferred to a wildcard filter
+ *
+ * @param[in] topic topic of an incoming publish, not terminated
+ * @param[in] length length of the topic
+ *
+ * @return route of the matching filter or MQTTROUTER_NONE
+ */
+int8_t MQTTRouter_Match(const MQTTRouter_T * router, const char * topic, uint32_t length);
+
+/* global inline function definitions */
+
+#endif /* MQTTROUTER_H_ */
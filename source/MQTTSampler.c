@@ -0,0 +1,285 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	MQTTSampler.c
+ **
+ **	DESCRIPTION:	Source Code for the Cumulocity MQTT Client for the Bosch XDK
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* system header files */
+#include <string.h>
+
+/* own header files */
+#include "XdkAppInfo.h"
+#include "AppController.h"
+#include "MQTTSampler.h"
+
+/* additional interface header files */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+/* constant definitions ***************************************************** */
+
+#define MQTTSAMPLER_IDLE_MS			UINT32_C(1000)	/**< Time to check again when no channel is enabled */
+
+/* local variables ********************************************************** */
+
+static MQTTSampler_Callback_T sampleCallback = NULL;
+static volatile TickType_t periods[MQTTSAMPLER_MAX_CHANNELS];
+static volatile uint32_t changedChannels = 0UL;
+static volatile bool running = false;
+static SemaphoreHandle_t semaphoreStart = NULL;
+static SemaphoreHandle_t samplingMutex = NULL;
+static xTaskHandle samplerHandle = NULL;
+static MQTTSampler_Statistics_T statistics;
+
+/* owned by the sampling task */
+static TickType_t intervals[MQTTSAMPLER_MAX_CHANNELS];
+static TickType_t deadlines[MQTTSAMPLER_MAX_CHANNELS];
+
+/* global variables ********************************************************* */
+
+/* local functions ********************************************************** */
+
+/**
+ * @brief Count the delay between deadline and wake up in its power of two bucket
+ */
+static void MQTTSampler_RecordJitter(TickType_t jitter) {
+	uint32_t jitterMS = jitter * portTICK_PERIOD_MS;
+	uint8_t bucket = 0U;
+
+	for (uint32_t rest = jitterMS; rest > 0UL && bucket < MQTTSAMPLER_BUCKETS - 1U; rest >>= 1) {
+		bucket++;
+	}
+
+	taskENTER_CRITICAL();
+	statistics.samples++;
+	statistics.histogram[bucket]++;
+	if (jitterMS > statistics.jitterMax) {
+		statistics.jitterMax = jitterMS;
+	}
+	taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Take over changed periods, a changed channel is due one period after the reference
+ */
+static void MQTTSampler_Reschedule(TickType_t reference) {
+	taskENTER_CRITICAL();
+	uint32_t changed = changedChannels;
+	changedChannels = 0UL;
+	taskEXIT_CRITICAL();
+
+	for (uint8_t channel = 0U; channel < MQTTSAMPLER_MAX_CHANNELS; channel++) {
+		if ((changed & (1UL << channel)) != 0UL) {
+			intervals[channel] = periods[channel];
+			deadlines[channel] = reference + intervals[channel];
+		}
+	}
+}
+
+/**
+ * @brief Mask of the channels with a sampling period, taken at the deadline
+ *
+ * A channel disabled while the task waited for the deadline must not be
+ * sampled, even though it was due when the deadline was computed.
+ */
+static uint32_t MQTTSampler_Enabled(void) {
+	uint32_t enabled = 0UL;
+
+	taskENTER_CRITICAL();
+	for (uint8_t channel = 0U; channel < MQTTSAMPLER_MAX_CHANNELS; channel++) {
+		if (periods[channel] != 0UL) {
+			enabled |= 1UL << channel;
+		}
+	}
+	taskEXIT_CRITICAL();
+	return enabled;
+}
+
+/**
+ * @brief Find the earliest deadline, all deadlines lie after the reference
+ *
+ * @return bit mask of the channels due at the earliest deadline, 0 if no channel is enabled
+ */
+static uint32_t MQTTSampler_NextDeadline(TickType_t reference, TickType_t * next) {
+	TickType_t earliest = portMAX_DELAY;
+	uint32_t due = 0UL;
+
+	for (uint8_t channel = 0U; channel < MQTTSAMPLER_MAX_CHANNELS; channel++) {
+		if (intervals[channel] == 0UL) {
+			continue;
+		}
+		TickType_t distance = deadlines[channel] - reference;
+		if (due == 0UL || distance < earliest) {
+			earliest = distance;
+			due = 1UL << channel;
+		} else if (distance == earliest) {
+			due |= 1UL << channel;
+		}
+	}
+	*next = reference + earliest;
+	return due;
+}
+
+/**
+ * @brief Move the deadlines of the sampled channels one period ahead
+ *
+ * When sampling took longer than a period the missed deadlines are skipped
+ * and counted as overrun instead of being caught up in a burst.
+ */
+static void MQTTSampler_Advance(uint32_t due, TickType_t now) {
+	uint32_t missed = 0UL;
+
+	for (uint8_t channel = 0U; channel < MQTTSAMPLER_MAX_CHANNELS; channel++) {
+		if ((due & (1UL << channel)) == 0UL) {
+			continue;
+		}
+		deadlines[channel] += intervals[channel];
+		TickType_t late = now - deadlines[channel];
+		if ((int32_t) late >= 0L) {
+			TickType_t skip = late / intervals[channel] + 1UL;
+			deadlines[channel] += skip * intervals[channel];
+			missed += skip;
+		}
+	}
+
+	if (missed != 0UL) {
+		taskENTER_CRITICAL();
+		statistics.overrun += missed;
+		taskEXIT_CRITICAL();
+	}
+}
+
+/**
+ * @brief Sampling task, runs the callback at the deadlines of the channels while sampling is started
+ *
+ * A single scheduler serves all channels: it sleeps until the earliest
+ * deadline and hands the mask of all channels due at that moment to the
+ * callback, so only those sensors are read. The deadlines are absolute, so
+ * the time the callback needs does not shift the sampling grid.
+ */
+static void MQTTSampler_Run(void * pvParameters) {
+	BCDS_UNUSED(pvParameters);
+
+	for (;;) {
+		xSemaphoreTake(semaphoreStart, portMAX_DELAY);
+		TickType_t reference = xTaskGetTickCount();
+
+		// every channel starts one period from now
+		taskENTER_CRITICAL();
+		changedChannels = (1UL << MQTTSAMPLER_MAX_CHANNELS) - 1UL;
+		taskEXIT_CRITICAL();
+
+		while (running) {
+			TickType_t next;
+			MQTTSampler_Reschedule(reference);
+			uint32_t due = MQTTSampler_NextDeadline(reference, &next);
+			if (due == 0UL) {
+				next = reference + pdMS_TO_TICKS(MQTTSAMPLER_IDLE_MS);
+			}
+
+			vTaskDelayUntil(&reference, next - reference);
+			if (running == false) {
+				break;
+			}
+			// a start while still running must not restart the loop after the next stop
+			xSemaphoreTake(semaphoreStart, 0UL);
+			if (due == 0UL) {
+				continue;
+			}
+
+			// the sensors are only read while holding the mutex, see MQTTSampler_Disable
+			xSemaphoreTake(samplingMutex, portMAX_DELAY);
+			due &= MQTTSampler_Enabled();
+			if (due != 0UL) {
+				MQTTSampler_RecordJitter(xTaskGetTickCount() - reference);
+				sampleCallback(due);
+			}
+			xSemaphoreGive(samplingMutex);
+			MQTTSampler_Advance(due, xTaskGetTickCount());
+		}
+	}
+}
+
+/* global functions ********************************************************* */
+
+Retcode_T MQTTSampler_Init(MQTTSampler_Callback_T callback) {
+	if (callback == NULL) {
+		return RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_NULL_POINTER);
+	}
+
+	sampleCallback = callback;
+	memset((void *) periods, 0x00, sizeof(periods));
+	memset(intervals, 0x00, sizeof(intervals));
+	memset(&statistics, 0x00, sizeof(statistics));
+
+	semaphoreStart = xSemaphoreCreateBinary();
+	if (semaphoreStart == NULL) {
+		return RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_SEMAPHORE_ERROR);
+	}
+	samplingMutex = xSemaphoreCreateMutex();
+	if (samplingMutex == NULL) {
+		return RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_SEMAPHORE_ERROR);
+	}
+
+	if (pdPASS != xTaskCreate(MQTTSampler_Run, (const char * const ) "Sampler",
+			TASK_STACK_SIZE_SAMPLER, NULL, TASK_PRIO_SAMPLER, &samplerHandle)) {
+		LOG_AT_ERROR(("MQTTSampler: Creating sampling task failed!\r\n"));
+		return RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_OUT_OF_RESOURCES);
+	}
+	return RETCODE_OK;
+}
+
+void MQTTSampler_Start(void) {
+	if (running == false) {
+		running = true;
+		xSemaphoreGive(semaphoreStart);
+	}
+}
+
+void MQTTSampler_Stop(void) {
+	running = false;
+}
+
+void MQTTSampler_SetPeriod(uint8_t channel, uint32_t periodMS) {
+	if (channel >= MQTTSAMPLER_MAX_CHANNELS) {
+		return;
+	}
+	TickType_t ticks = pdMS_TO_TICKS(periodMS);
+	if (periodMS > 0UL && ticks == 0UL) {
+		ticks = 1UL;
+	}
+
+	taskENTER_CRITICAL();
+	if (periods[channel] != ticks) {
+		periods[channel] = ticks;
+		changedChannels |= 1UL << channel;
+	}
+	taskEXIT_CRITICAL();
+}
+
+void MQTTSampler_Disable(uint8_t channel) {
+	MQTTSampler_SetPeriod(channel, 0UL);
+
+	// wait for a sample in progress, every later sample skips the channel
+	if (samplingMutex != NULL) {
+		xSemaphoreTake(samplingMutex, portMAX_DELAY);
+		xSemaphoreGive(samplingMutex);
+	}
+}
+
+void MQTTSampler_GetStatistics(MQTTSampler_Statistics_T * copy) {
+	taskENTER_CRITICAL();
+	*copy = statistics;
+	taskEXIT_CRITICAL();
+}
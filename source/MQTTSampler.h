@@ -0,0 +1,97 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	MQTTSampler.h
+ **
+ **	DESCRIPTION:	Source Code for the Cumulocity MQTT Client for the Bosch XDK
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* header definition ******************************************************** */
+#ifndef MQTTSAMPLER_H_
+#define MQTTSAMPLER_H_
+
+/* local interface declaration ********************************************** */
+#include <stdint.h>
+#include <stdbool.h>
+#include "BCDS_Retcode.h"
+
+/* local type and macro definitions */
+
+#define MQTTSAMPLER_BUCKETS			UINT8_C(7)	/**< Jitter buckets: 0, 1, 2-3, 4-7, 8-15, 16-31, 32+ ms */
+#define MQTTSAMPLER_MAX_CHANNELS	UINT8_C(8)	/**< Maximum number of channels with their own sampling period */
+
+/**
+ * @brief Function called by the sampling task when channels are due
+ *
+ * @param[in] channels bit mask of the channels due at this deadline
+ */
+typedef void (*MQTTSampler_Callback_T)(uint32_t channels);
+
+/**
+ * @brief Timing statistics of the sampling task since startup
+ */
+typedef struct {
+	uint32_t samples; /**< number of deadlines executed */
+	uint32_t overrun; /**< channel deadlines skipped because sampling took longer than the period */
+	uint32_t jitterMax; /**< maximum delay between deadline and wake up in ms */
+	uint32_t histogram[MQTTSAMPLER_BUCKETS]; /**< wake up delay, bucket i counts delays below 2^i ms */
+} MQTTSampler_Statistics_T;
+
+/* global function prototype declarations */
+
+/**
+ * @brief Create the sampling task, sampling has to be started with MQTTSampler_Start
+ *
+ * All channels are disabled until a period is set with MQTTSampler_SetPeriod.
+ *
+ * @param[in] callback function reading the sensors of the due channels
+ *
+ * @return RETCODE_OK if the task was created
+ */
+Retcode_T MQTTSampler_Init(MQTTSampler_Callback_T callback);
+
+/**
+ * @brief Start sampling, every channel is sampled the first time one period later
+ */
+void MQTTSampler_Start(void);
+
+/**
+ * @brief Stop sampling after the current sample
+ */
+void MQTTSampler_Stop(void);
+
+/**
+ * @brief Change the sampling period of a channel, takes effect with the next deadline of any channel
+ *
+ * @param[in] channel channel index, less than MQTTSAMPLER_MAX_CHANNELS
+ * @param[in] periodMS sampling period in milliseconds, 0 disables the channel
+ */
+void MQTTSampler_SetPeriod(uint8_t channel, uint32_t periodMS);
+
+/**
+ * @brief Disable a channel and wait until a sample in progress has been read
+ *
+ * Unlike MQTTSampler_SetPeriod this is synchronous: when it returns the
+ * callback does not read the channel any more, so the caller may reconfigure
+ * its sensor. Sampling is enabled again with MQTTSampler_SetPeriod.
+ *
+ * @param[in] channel channel index, less than MQTTSAMPLER_MAX_CHANNELS
+ */
+void MQTTSampler_Disable(uint8_t channel);
+
+/**
+ * @brief Copy the timing statistics
+ */
+void MQTTSampler_GetStatistics(MQTTSampler_Statistics_T * statistics);
+
+/* global inline function definitions */
+
+#endif /* MQTTSAMPLER_H_ */
@@ -0,0 +1,215 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	MQTTSpectrum.c
+ **
+ **	DESCRIPTION:	Source Code for the Cumulocity MQTT Client for the Bosch XDK
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* system header files */
+#include <string.h>
+#include <math.h>
+
+/* own header files */
+#include "MQTTSpectrum.h"
+
+/* constant definitions ***************************************************** */
+
+#define MQTTSPECTRUM_HALF			(MQTTSPECTRUM_SIZE / 2U)
+#define MQTTSPECTRUM_QUARTER		(MQTTSPECTRUM_SIZE / 4U)
+#define MQTTSPECTRUM_Q15_ONE		INT32_C(32767)
+#define MQTTSPECTRUM_HEADROOM		INT32_C(0x3FFF)		/**< Largest input that can not overflow in the transform */
+#define MQTTSPECTRUM_PI				3.14159265F
+
+/*
+ * A Hann windowed sine of amplitude A gives |X[k]| = A * N / 4 at its bin,
+ * and the mean square of the window is 3/8. With the transform already
+ * divided by N the one-sided mean square of bin k is 16/3 * |X[k]|^2.
+ */
+#define MQTTSPECTRUM_POWER_GAIN		(16.0F / 3.0F)
+#define MQTTSPECTRUM_AMPLITUDE_GAIN	3.0F				/**< amplitude^2 of a sine per mean square of its bin */
+
+/* local variables ********************************************************** */
+
+/* cos(2 pi n / N) in Q15 for n = 0 .. N/2, sin and the Hann window are derived from it */
+static int16_t cosine[MQTTSPECTRUM_HALF + 1U];
+
+static int16_t workRe[MQTTSPECTRUM_SIZE];
+static int16_t workIm[MQTTSPECTRUM_SIZE];
+static float power[MQTTSPECTRUM_HALF];
+
+/* global variables ********************************************************* */
+
+/* local functions ********************************************************** */
+
+static int16_t MQTTSpectrum_Sine(uint32_t n) {
+	return (n <= MQTTSPECTRUM_QUARTER) ? cosine[MQTTSPECTRUM_QUARTER - n] : cosine[n - MQTTSPECTRUM_QUARTER];
+}
+
+static int32_t MQTTSpectrum_Multiply(int32_t a, int32_t b) {
+	return (a * b + (INT32_C(1) << 14)) >> 15;
+}
+
+/**
+ * @brief Hann window (1 - cos(2 pi n / N)) / 2 in Q15
+ */
+static int32_t MQTTSpectrum_Window(uint32_t n) {
+	int32_t c = (n <= MQTTSPECTRUM_HALF) ? cosine[n] : cosine[MQTTSPECTRUM_SIZE - n];
+	return (MQTTSPECTRUM_Q15_ONE - c + 1L) >> 1;
+}
+
+static uint32_t MQTTSpectrum_Reverse(uint32_t n) {
+	uint32_t reversed = 0UL;
+	for (uint8_t bit = 0U; bit < MQTTSPECTRUM_SIZE_LOG2; bit++) {
+		reversed = (reversed << 1) | (n & 1UL);
+		n >>= 1;
+	}
+	return reversed;
+}
+
+/**
+ * @brief Remove the mean, apply the window and scale the samples of one axis into the work buffers
+ *
+ * The windowed samples are scaled to use the full headroom of the transform,
+ * so weak vibrations keep their resolution.
+ *
+ * @return power of two the samples were scaled with, negative if they were reduced
+ */
+static int8_t MQTTSpectrum_Prepare(const int16_t * samples) {
+	int32_t sum = 0L;
+	for (uint32_t n = 0UL; n < MQTTSPECTRUM_SIZE; n++) {
+		sum += samples[n];
+	}
+	int32_t mean = sum / (int32_t) MQTTSPECTRUM_SIZE;
+
+	// windowed samples in Q15
+	int32_t largest = 0L;
+	for (uint32_t n = 0UL; n < MQTTSPECTRUM_SIZE; n++) {
+		int32_t value = ((int32_t) samples[n] - mean) * MQTTSpectrum_Window(n);
+		int32_t magnitude = (value < 0L) ? -value : value;
+		if (magnitude > largest) {
+			largest = magnitude;
+		}
+	}
+
+	// shift so that the largest value just stays within the headroom
+	int8_t reduce = 0;
+	if (largest > 0L) {
+		int8_t bits = 0;
+		while ((largest >> bits) != 0L) {
+			bits++;
+		}
+		reduce = bits - 14;
+	}
+
+	for (uint32_t n = 0UL; n < MQTTSPECTRUM_SIZE; n++) {
+		// windowing again is cheaper than a buffer of N 32 bit values
+		int32_t value = ((int32_t) samples[n] - mean) * MQTTSpectrum_Window(n);
+		if (reduce > 0) {
+			value = (value + (INT32_C(1) << (reduce - 1))) >> reduce;
+		} else {
+			value <<= -reduce;
+		}
+		workRe[MQTTSpectrum_Reverse(n)] = (int16_t) value;
+		workIm[n] = 0;
+	}
+	return (int8_t) (15 - reduce);
+}
+
+/* global functions ********************************************************* */
+
+void MQTTSpectrum_Init(void) {
+	for (uint32_t n = 0UL; n <= MQTTSPECTRUM_HALF; n++) {
+		float value = cosf(2.0F * MQTTSPECTRUM_PI * (float) n / (float) MQTTSPECTRUM_SIZE);
+		cosine[n] = (int16_t) lrintf(value * (float) MQTTSPECTRUM_Q15_ONE);
+	}
+}
+
+void MQTTSpectrum_Transform(int16_t * re, int16_t * im) {
+	// decimation in time, the input is expected in bit reversed order
+	for (uint32_t size = 2UL; size <= MQTTSPECTRUM_SIZE; size <<= 1) {
+		uint32_t half = size >> 1;
+		uint32_t step = MQTTSPECTRUM_SIZE / size;
+		for (uint32_t k = 0UL; k < half; k++) {
+			// W = exp(-2 pi i k / size)
+			int32_t wr = cosine[k * step];
+			int32_t wi = -MQTTSpectrum_Sine(k * step);
+			for (uint32_t i = k; i < MQTTSPECTRUM_SIZE; i += size) {
+				uint32_t j = i + half;
+				int32_t tr = MQTTSpectrum_Multiply(wr, re[j]) - MQTTSpectrum_Multiply(wi, im[j]);
+				int32_t ti = MQTTSpectrum_Multiply(wr, im[j]) + MQTTSpectrum_Multiply(wi, re[j]);
+				int32_t ur = re[i];
+				int32_t ui = im[i];
+				re[i] = (int16_t) ((ur + tr) >> 1);
+				im[i] = (int16_t) ((ui + ti) >> 1);
+				re[j] = (int16_t) ((ur - tr) >> 1);
+				im[j] = (int16_t) ((ui - ti) >> 1);
+			}
+		}
+	}
+}
+
+void MQTTSpectrum_Analyze(const int16_t * const * axes, uint8_t axisCount, float sampleRate,
+		MQTTSpectrum_Result_T * result) {
+	memset(power, 0x00, sizeof(power));
+	memset(result, 0x00, sizeof(MQTTSpectrum_Result_T));
+	if (axisCount > MQTTSPECTRUM_MAX_AXES) {
+		axisCount = MQTTSPECTRUM_MAX_AXES;
+	}
+
+	for (uint8_t axis = 0U; axis < axisCount; axis++) {
+		int8_t shift = MQTTSpectrum_Prepare(axes[axis]);
+		MQTTSpectrum_Transform(workRe, workIm);
+		// undo the scaling of the input, squared as we sum powers
+		float scale = MQTTSPECTRUM_POWER_GAIN * ldexpf(1.0F, -2 * shift);
+		for (uint32_t k = 1UL; k < MQTTSPECTRUM_HALF; k++) {
+			int32_t re = workRe[k];
+			int32_t im = workIm[k];
+			power[k] += (float) (re * re + im * im) * scale;
+		}
+	}
+
+	// DC is left out and the Nyquist bin is not part of the one-sided spectrum
+	uint32_t peak = 1UL;
+	float total = 0.0F;
+	for (uint32_t k = 1UL; k < MQTTSPECTRUM_HALF; k++) {
+		total += power[k];
+		result->bands[k / (MQTTSPECTRUM_HALF / MQTTSPECTRUM_BANDS)] += power[k];
+		if (power[k] > power[peak]) {
+			peak = k;
+		}
+	}
+	result->rms = sqrtf(total);
+	for (uint8_t band = 0U; band < MQTTSPECTRUM_BANDS; band++) {
+		result->bands[band] = sqrtf(result->bands[band]);
+	}
+
+	// the peak lies between the bins, for a Hann windowed sine the ratio a of the larger
+	// neighbour to the peak magnitude gives the offset (2a - 1) / (a + 1) towards the neighbour
+	float offset = 0.0F;
+	if (peak > 1UL && peak < MQTTSPECTRUM_HALF - 1UL && power[peak] > 0.0F) {
+		float left = sqrtf(power[peak - 1UL]);
+		float center = sqrtf(power[peak]);
+		float right = sqrtf(power[peak + 1UL]);
+		float ratio = ((right > left) ? right : left) / center;
+		offset = (2.0F * ratio - 1.0F) / (ratio + 1.0F);
+		if (right <= left) {
+			offset = -offset;
+		}
+	}
+	result->peakFrequency = ((float) peak + offset) * sampleRate / (float) MQTTSPECTRUM_SIZE;
+	result->peakAmplitude = sqrtf(MQTTSPECTRUM_AMPLITUDE_GAIN * power[peak]);
+	if (offset != 0.0F) {
+		// the Hann window attenuates a component off the bin center by sinc(offset) / (1 - offset^2)
+		float x = MQTTSPECTRUM_PI * offset;
+		result->peakAmplitude *= x * (1.0F - offset * offset) / sinf(x);
+	}
+}
@@ -0,0 +1,77 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	MQTTSpectrum.h
+ **
+ **	DESCRIPTION:	Source Code for the Cumulocity MQTT Client for the Bosch XDK
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* header definition ******************************************************** */
+#ifndef MQTTSPECTRUM_H_
+#define MQTTSPECTRUM_H_
+
+/* local interface declaration ********************************************** */
+#include <stdint.h>
+
+/* local type and macro definitions */
+
+#define MQTTSPECTRUM_SIZE_LOG2		UINT8_C(8)							/**< log2 of the number of samples per transform */
+#define MQTTSPECTRUM_SIZE			(1U << MQTTSPECTRUM_SIZE_LOG2)		/**< Number of samples per transform */
+#define MQTTSPECTRUM_BANDS			UINT8_C(8)							/**< Bands of equal width between 0 and half the sample rate */
+#define MQTTSPECTRUM_MAX_AXES		UINT8_C(3)							/**< Axes combined into one spectrum */
+
+/**
+ * Vibration figures of one capture, all values in the unit of the samples
+ */
+typedef struct {
+	float peakFrequency; /**< frequency of the strongest component in Hz */
+	float peakAmplitude; /**< amplitude of the strongest component */
+	float rms; /**< rms of all components without DC */
+	float bands[MQTTSPECTRUM_BANDS]; /**< rms per band, the first band starts above DC */
+} MQTTSpectrum_Result_T;
+
+/* global function prototype declarations */
+
+/**
+ * @brief Build the twiddle table, has to be called once before the first transform
+ */
+void MQTTSpectrum_Init(void);
+
+/**
+ * @brief In-place radix-2 FFT of MQTTSPECTRUM_SIZE complex Q15 values
+ *
+ * Every stage halves the values, so the result is the DFT divided by
+ * MQTTSPECTRUM_SIZE and can not overflow as long as all inputs stay below
+ * 2^14.
+ *
+ * @param[in,out] re real parts, replaced by the real parts of the spectrum
+ * @param[in,out] im imaginary parts, replaced by the imaginary parts of the spectrum
+ */
+void MQTTSpectrum_Transform(int16_t * re, int16_t * im);
+
+/**
+ * @brief Spectrum of up to MQTTSPECTRUM_MAX_AXES axes of MQTTSPECTRUM_SIZE samples each
+ *
+ * Each axis is freed from its mean, Hann windowed and scaled to the full
+ * range before the transform. The power of all axes is added, so the
+ * figures describe the vibration independent of its direction.
+ *
+ * @param[in] axes samples per axis
+ * @param[in] axisCount number of axes
+ * @param[in] sampleRate sample rate in Hz
+ * @param[out] result vibration figures
+ */
+void MQTTSpectrum_Analyze(const int16_t * const * axes, uint8_t axisCount, float sampleRate,
+		MQTTSpectrum_Result_T * result);
+
+/* global inline function definitions */
+
+#endif /* MQTTSPECTRUM_H_ */
@@ -139,6 +139,13 @@ Retcode_T MQTTStorage_Flash_ReadConfig(ConfigDataBuffer *configBuffer) {
 	if ((RETCODE_OK == retcode) && (true == status)) {
 		retcode = WifiStorage_GetFileStatus((const uint8_t*) &(CONFIG_FILENAME),
 				&(readCredentials.BytesToRead));
+		// keep room for the terminating zero
+		if (retcode == RETCODE_OK
+				&& readCredentials.BytesToRead >= sizeof(configBuffer->data)) {
+			LOG_AT_ERROR(
+					("MQTTStorage: Config in flash too big: [%lu]\r\n", readCredentials.BytesToRead));
+			retcode = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_OUT_OF_RESOURCES);
+		}
 		if (retcode == RETCODE_OK) {
 			retcode = Storage_Read(STORAGE_MEDIUM_WIFI_FILE_SYSTEM,
 					&readCredentials);
@@ -0,0 +1,88 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	MQTTWheel.c
+ **
+ **	DESCRIPTION:	Source Code for the Cumulocity MQTT Client for the Bosch XDK
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* system header files */
+#include <string.h>
+
+/* own header files */
+#include "MQTTWheel.h"
+
+/* constant definitions ***************************************************** */
+
+#define MQTTWHEEL_BUCKET(tick)		((tick) & (MQTTWHEEL_BUCKETS - 1UL))
+
+/* local variables ********************************************************** */
+
+/* global variables ********************************************************* */
+
+/* local functions ********************************************************** */
+
+/* global functions ********************************************************* */
+
+void MQTTWheel_Init(MQTTWheel_T * wheel) {
+	memset(wheel->buckets, 0x00, sizeof(wheel->buckets));
+	wheel->now = 0UL;
+}
+
+void MQTTWheel_Start(MQTTWheel_T * wheel, MQTTWheel_Timer_T * timer, uint32_t ticks) {
+	MQTTWheel_Stop(wheel, timer);
+
+	timer->expiry = wheel->now + ((ticks > 0UL) ? ticks : 1UL);
+	MQTTWheel_Timer_T ** bucket = &wheel->buckets[MQTTWHEEL_BUCKET(timer->expiry)];
+	timer->prev = NULL;
+	timer->next = *bucket;
+	if (*bucket != NULL) {
+		(*bucket)->prev = timer;
+	}
+	*bucket = timer;
+	timer->running = true;
+}
+
+void MQTTWheel_Stop(MQTTWheel_T * wheel, MQTTWheel_Timer_T * timer) {
+	if (timer->running == false) {
+		return;
+	}
+	if (timer->prev != NULL) {
+		timer->prev->next = timer->next;
+	} else {
+		wheel->buckets[MQTTWHEEL_BUCKET(timer->expiry)] = timer->next;
+	}
+	if (timer->next != NULL) {
+		timer->next->prev = timer->prev;
+	}
+	timer->next = NULL;
+	timer->prev = NULL;
+	timer->running = false;
+}
+
+MQTTWheel_Timer_T * MQTTWheel_Advance(MQTTWheel_T * wheel) {
+	MQTTWheel_Timer_T * expired = NULL;
+	MQTTWheel_Timer_T ** last = &expired;
+
+	wheel->now++;
+	MQTTWheel_Timer_T * timer = wheel->buckets[MQTTWHEEL_BUCKET(wheel->now)];
+	while (timer != NULL) {
+		MQTTWheel_Timer_T * next = timer->next;
+		// timers of a later turn stay in the bucket
+		if (timer->expiry == wheel->now) {
+			MQTTWheel_Stop(wheel, timer);
+			*last = timer;
+			last = &timer->next;
+		}
+		timer = next;
+	}
+	return expired;
+}
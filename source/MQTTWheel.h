@@ -0,0 +1,82 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	MQTTWheel.h
+ **
+ **	DESCRIPTION:	Source Code for the Cumulocity MQTT Client for the Bosch XDK
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* header definition ******************************************************** */
+#ifndef MQTTWHEEL_H_
+#define MQTTWHEEL_H_
+
+/* local interface declaration ********************************************** */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* local type and macro definitions */
+
+#define MQTTWHEEL_BUCKETS			UINT32_C(16)	/**< Buckets of the wheel, power of two */
+
+/**
+ * @brief One timeout, embedded in the object it belongs to
+ *
+ * A timer is linked into the bucket of its expiry. Timers that expire more
+ * than one turn of the wheel later stay in their bucket until their turn.
+ */
+typedef struct MQTTWheel_Timer_S {
+	struct MQTTWheel_Timer_S * next; /**< next timer in the bucket, or in the list of expired timers */
+	struct MQTTWheel_Timer_S * prev; /**< previous timer in the bucket */
+	uint32_t expiry; /**< tick of the wheel at which the timer expires */
+	bool running; /**< linked into a bucket */
+	void * owner; /**< object the timer belongs to */
+} MQTTWheel_Timer_T;
+
+/**
+ * @brief Hashed timing wheel, starting and stopping a timer takes constant time
+ *
+ * The wheel is not thread safe, it has to be used from one task.
+ */
+typedef struct {
+	MQTTWheel_Timer_T * buckets[MQTTWHEEL_BUCKETS]; /**< timers by expiry modulo the number of buckets */
+	uint32_t now; /**< ticks of the wheel so far */
+} MQTTWheel_T;
+
+/* global function prototype declarations */
+
+/**
+ * @brief Initialize an empty wheel
+ */
+void MQTTWheel_Init(MQTTWheel_T * wheel);
+
+/**
+ * @brief Start a timer, a running timer is started again
+ *
+ * @param[in] timer timer to start, owner has to be set
+ * @param[in] ticks ticks of the wheel until the timer expires, at least 1
+ */
+void MQTTWheel_Start(MQTTWheel_T * wheel, MQTTWheel_Timer_T * timer, uint32_t ticks);
+
+/**
+ * @brief Stop a timer, nothing happens if it is not running
+ */
+void MQTTWheel_Stop(MQTTWheel_T * wheel, MQTTWheel_Timer_T * timer);
+
+/**
+ * @brief Advance the wheel by one tick
+ *
+ * @return the expired timers linked by next, they are stopped already, NULL if none expired
+ */
+MQTTWheel_Timer_T * MQTTWheel_Advance(MQTTWheel_T * wheel);
+
+/* global inline function definitions */
+
+#endif /* MQTTWHEEL_H_ */
@@ -60,6 +60,11 @@
 /**< Application controller task stack size */
 #define TASK_STACK_SIZE_APP_CONTROLLER              (UINT32_C(1000))
 
+/**< Sensor sampling task priority, above the application controller to keep the sampling period */
+#define TASK_PRIO_SAMPLER                           (UINT32_C(4))
+/**< Sensor sampling task stack size */
+#define TASK_STACK_SIZE_SAMPLER                     (UINT32_C(600))
+
 /**
  * @brief BCDS_APP_MODULE_ID for Application C module of XDK
  * @info  usage:
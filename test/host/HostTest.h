@@ -0,0 +1,154 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	HostTest.h
+ **
+ **	DESCRIPTION:	Checks and timing for the host tests of the portable modules
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* header definition ******************************************************** */
+#ifndef HOSTTEST_H_
+#define HOSTTEST_H_
+
+/* local interface declaration ********************************************** */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+/* local type and macro definitions */
+
+/**
+ * @brief Count a failed check and report where it failed, the test goes on
+ */
+#define HOSTTEST_CHECK(condition) \
+	HostTest_Check((condition), #condition, __FILE__, __LINE__)
+
+/**
+ * @brief Keep a computed value alive so the benchmark loop is not optimized away
+ */
+#define HOSTTEST_KEEP(value) \
+	__asm__ __volatile__("" : : "g"(value) : "memory")
+
+/* local variables ********************************************************** */
+
+static uint32_t hostTestChecks = 0UL;
+static uint32_t hostTestFailures = 0UL;
+/* the terminal, while stdout goes to the log of HostTest_Log */
+static FILE * hostTestOut = NULL;
+
+/* global inline function definitions */
+
+static inline void HostTest_Check(bool passed, const char * condition, const char * file, int line) {
+	hostTestChecks++;
+	if (passed == false) {
+		hostTestFailures++;
+		if (hostTestFailures <= 20UL) {
+			fprintf(stderr, "%s:%d: check failed: %s\n", file, line, condition);
+		}
+	}
+}
+
+/**
+ * @brief Time stamp counter, nanoseconds where the processor has none
+ */
+static inline uint64_t HostTest_Cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+	uint32_t low;
+	uint32_t high;
+	__asm__ __volatile__("rdtsc" : "=a"(low), "=d"(high));
+	return ((uint64_t) high << 32) | low;
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * UINT64_C(1000000000) + (uint64_t) now.tv_nsec;
+#endif
+}
+
+/**
+ * @brief True if the program was started with "bench", only then the benchmarks run
+ */
+static inline bool HostTest_Bench(int argc, char ** argv) {
+	return argc > 1 && strcmp(argv[1], "bench") == 0;
+}
+
+/**
+ * @brief Send stdout, where the firmware modules log with printf, into a file, the summary still goes to the terminal
+ */
+static inline void HostTest_Log(const char * path) {
+	fflush(stdout);
+	hostTestOut = fdopen(dup(fileno(stdout)), "w");
+	if (hostTestOut == NULL || freopen(path, "w", stdout) == NULL) {
+		fprintf(stderr, "%s: can not be written\n", path);
+	}
+}
+
+/**
+ * @brief Where the results of a test are printed, the terminal even after HostTest_Log
+ */
+static inline FILE * HostTest_Out(void) {
+	return (hostTestOut != NULL) ? hostTestOut : stdout;
+}
+
+/**
+ * @brief Run a function in a child process, like the firmware after a reset, its checks count for the test
+ *
+ * Modules keep state in static variables, a new process starts them afresh
+ * while the files they wrote stay.
+ */
+static inline void HostTest_Boot(void (*boot)(void)) {
+	int channel[2];
+	uint32_t counts[2] = { 0UL, 0UL };
+	int status = -1;
+
+	fflush(NULL);
+	if (pipe(channel) != 0) {
+		HostTest_Check(false, "pipe", __FILE__, __LINE__);
+		return;
+	}
+	pid_t child = fork();
+	if (child == 0) {
+		close(channel[0]);
+		hostTestChecks = 0UL;
+		hostTestFailures = 0UL;
+		boot();
+		counts[0] = hostTestChecks;
+		counts[1] = hostTestFailures;
+		fflush(NULL);
+		_exit((write(channel[1], counts, sizeof(counts)) == (ssize_t) sizeof(counts)) ? 0 : 1);
+	}
+	close(channel[1]);
+	ssize_t received = (child > 0) ? read(channel[0], counts, sizeof(counts)) : -1;
+	close(channel[0]);
+	if (child > 0) {
+		(void) waitpid(child, &status, 0);
+	}
+	HostTest_Check(received == (ssize_t) sizeof(counts) && WIFEXITED(status) && WEXITSTATUS(status) == 0,
+			"boot", __FILE__, __LINE__);
+	hostTestChecks += counts[0];
+	hostTestFailures += counts[1];
+}
+
+/**
+ * @brief Print the summary of the checks
+ *
+ * @return exit code of the test program
+ */
+static inline int HostTest_Result(const char * name) {
+	fprintf(HostTest_Out(), "%s: %lu checks, %lu failed\n", name, (unsigned long) hostTestChecks, (unsigned long) hostTestFailures);
+	return hostTestFailures == 0UL ? 0 : 1;
+}
+
+#endif /* HOSTTEST_H_ */
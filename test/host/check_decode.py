@@ -0,0 +1,92 @@
+#!/usr/bin/env python3
+#
+# COPYRIGHT (c) 2019 Software AG
+#
+# Decodes the payloads written by the host tests with resources/xdk_decode.py
+# and compares the records with the ones the tests appended on the device side.
+#
+# usage: check_decode.py DIRECTORY
+
+import os
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", "resources"))
+
+import xdk_decode  # noqa: E402
+
+
+def expected_records(path):
+    """Read the records written by the test, one per line."""
+    records = []
+    with open(path, "r") as stream:
+        for line in stream:
+            line = line.rstrip("\n")
+            if line.startswith("text "):
+                records.append({"text": line[5:]})
+                continue
+            fields = line.split(" ")
+            records.append({
+                "template": fields[0],
+                "time": xdk_decode.iso_time(int(fields[1])),
+                "decimals": int(fields[2]),
+                "values": [int(value) for value in fields[3:]],
+            })
+    return records
+
+
+def comparable(record):
+    if "text" in record:
+        return (0, "", record["text"], 0, ())
+    return (1, record["time"], record["template"], record["decimals"], tuple(record["values"]))
+
+
+def read(path):
+    with open(path, "rb") as stream:
+        return stream.read()
+
+
+def check_binary(directory, name):
+    """Both payload versions decode to the appended records, version 2 may reorder them by time."""
+    expected = expected_records(os.path.join(directory, "binary_%s.expected" % name))
+    unpacked = [comparable(record) for record in xdk_decode.decode(read(os.path.join(directory, "binary_%s.v1" % name)))]
+    packed = [comparable(record) for record in xdk_decode.decode(read(os.path.join(directory, "binary_%s.v2" % name)))]
+    reference = [comparable(record) for record in expected]
+    failures = 0
+    if unpacked != reference:
+        print("binary %s: version 1 payload decodes to different records" % name)
+        failures += 1
+    if sorted(packed) != sorted(reference):
+        print("binary %s: packed payload decodes to different records" % name)
+        failures += 1
+    return failures
+
+
+def check_compress(directory, name):
+    """A compressed payload decompresses to the original, any other payload is unchanged."""
+    original = read(os.path.join(directory, "compress_%s.in" % name))
+    payload = read(os.path.join(directory, "compress_%s.z" % name))
+    if payload[:1] == bytes([xdk_decode.COMPRESSED]):
+        payload = xdk_decode.decompress(payload)
+    if payload != original:
+        print("compress %s: payload does not decompress to the original" % name)
+        return 1
+    return 0
+
+
+def main():
+    directory = sys.argv[1]
+    checks = 0
+    failures = 0
+    for entry in sorted(os.listdir(directory)):
+        if entry.startswith("binary_") and entry.endswith(".expected"):
+            failures += check_binary(directory, entry[len("binary_"):-len(".expected")])
+            checks += 2
+        elif entry.startswith("compress_") and entry.endswith(".in"):
+            failures += check_compress(directory, entry[len("compress_"):-len(".in")])
+            checks += 1
+    print("check_decode: %d checks, %d failed" % (checks, failures))
+    sys.exit(1 if failures or checks == 0 else 0)
+
+
+if __name__ == "__main__":
+    main()
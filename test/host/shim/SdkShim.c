@@ -0,0 +1,543 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	SdkShim.c
+ **
+ **	DESCRIPTION:	Stand-ins for the parts of the XDK SDK the host tests link against
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* system header files */
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+/* the directory of FatFs has the name of the one of POSIX */
+typedef DIR Shim_HostDir_T;
+#define DIR FF_DIR
+
+/* own header files */
+#include "SdkShim.h"
+
+/* constant definitions ***************************************************** */
+
+#define SHIM_JOBS				UINT32_C(64)		/**< Jobs the command processor holds */
+#define SHIM_LATER				UINT32_C(64)		/**< Jobs waiting for their time */
+#define SHIM_TIMERS				UINT32_C(4)
+#define SHIM_SEMAPHORES			UINT32_C(16)
+#define SHIM_PATH_SIZE			UINT32_C(256)
+
+#ifndef HOSTTEST_DATA
+#define HOSTTEST_DATA			"."
+#endif
+#define SHIM_SDCARD				HOSTTEST_DATA "/sdcard"
+
+/* local variables ********************************************************** */
+
+struct Shim_Semaphore_S {
+	uint32_t count;
+};
+
+struct Shim_Timer_S {
+	bool used;
+	bool active;
+	bool reload;
+	TickType_t period;
+	uint32_t due;
+	TimerCallbackFunction_t callback;
+};
+
+typedef struct {
+	CmdProcessor_Func_T func;
+	void * param1;
+	uint32_t param2;
+	uint32_t due;
+} Shim_Job_T;
+
+static Shim_Job_T jobs[SHIM_JOBS];
+static uint32_t jobHead = 0UL;
+static uint32_t jobTail = 0UL;
+
+/* sorted by due, jobs with the same due in the order they were added */
+static Shim_Job_T later[SHIM_LATER];
+static uint32_t laterCount = 0UL;
+
+static struct Shim_Timer_S timers[SHIM_TIMERS];
+/* modules create their semaphores at every setup and never delete them, so they are not allocated */
+static struct Shim_Semaphore_S semaphores[SHIM_SEMAPHORES];
+static uint32_t semaphoreCount = 0UL;
+static uint32_t now = 0UL;
+static MqttSession_T * session = NULL;
+static uint32_t inEvent = 0UL;
+
+/* global variables ********************************************************* */
+
+Shim_T shim;
+
+/* the firmware keeps it in AppController.c */
+uint16_t logging_enabled = 1U;
+
+/* local functions ********************************************************** */
+
+static bool Shim_RunJob(void) {
+	if (jobHead == jobTail) {
+		return false;
+	}
+	Shim_Job_T job = jobs[jobTail % SHIM_JOBS];
+	jobTail++;
+	job.func(job.param1, job.param2);
+	return true;
+}
+
+static void Shim_Later(uint32_t delay, CmdProcessor_Func_T func, void * param1, uint32_t param2) {
+	uint32_t index = laterCount;
+
+	if (laterCount >= SHIM_LATER) {
+		fprintf(stderr, "SdkShim: too many jobs waiting\n");
+		abort();
+	}
+	while (index > 0UL && later[index - 1UL].due > now + delay) {
+		later[index] = later[index - 1UL];
+		index--;
+	}
+	later[index] = (Shim_Job_T) { func, param1, param2, now + delay };
+	laterCount++;
+}
+
+/**
+ * @brief One millisecond passes, due timers fire and due jobs are queued
+ */
+static void Shim_Tick(void) {
+	now++;
+	for (uint32_t index = 0UL; index < SHIM_TIMERS; index++) {
+		struct Shim_Timer_S * timer = &timers[index];
+		if (timer->used && timer->active && timer->due == now) {
+			timer->active = timer->reload;
+			timer->due = now + timer->period;
+			timer->callback(timer);
+		}
+	}
+	while (laterCount > 0UL && later[0].due <= now) {
+		(void) CmdProcessor_Enqueue(NULL, later[0].func, later[0].param1, later[0].param2);
+		laterCount--;
+		memmove(&later[0], &later[1], laterCount * sizeof(later[0]));
+	}
+}
+
+/**
+ * @brief Job of the stack reporting an event
+ */
+static void Shim_EventJob(void * param1, uint32_t param2) {
+	BCDS_UNUSED(param1);
+	if (session != NULL && session->onMqttEvent != NULL) {
+		inEvent++;
+		(void) session->onMqttEvent(session, (MqttEvent_t) param2, NULL);
+		inEvent--;
+	}
+}
+
+static void Shim_Path(const char * name, char * path, size_t size) {
+	snprintf(path, size, "%s/%s", SHIM_SDCARD, name);
+}
+
+/**
+ * @brief Remove the files of a directory of the SD card and the directory
+ */
+static void Shim_RemoveDirectory(const char * path) {
+	DIR handle;
+	FILINFO info;
+
+	if (f_opendir(&handle, path) == FR_OK) {
+		while (f_readdir(&handle, &info) == FR_OK && info.fname[0] != '\0') {
+			char file[SHIM_PATH_SIZE];
+			snprintf(file, sizeof(file), "%s/%s", path, info.fname);
+			(void) f_unlink(file);
+		}
+		(void) f_closedir(&handle);
+	}
+	char host[SHIM_PATH_SIZE];
+	Shim_Path(path, host, sizeof(host));
+	(void) rmdir(host);
+}
+
+/* global functions ********************************************************* */
+
+void Shim_Reset(void) {
+	jobHead = 0UL;
+	jobTail = 0UL;
+	laterCount = 0UL;
+	now = 0UL;
+	session = NULL;
+	inEvent = 0UL;
+	memset(timers, 0x00, sizeof(timers));
+	semaphoreCount = 0UL;
+	memset(&shim, 0x00, sizeof(shim));
+	shim.publishResult = RC_OK;
+	shim.writeLimit = UINT32_MAX;
+
+	(void) mkdir(HOSTTEST_DATA, 0777);
+	(void) mkdir(SHIM_SDCARD, 0777);
+	Shim_RemoveDirectory("OFFLINE");
+}
+
+uint32_t Shim_Now(void) {
+	return now;
+}
+
+void Shim_Advance(uint32_t milliseconds) {
+	const uint32_t end = now + milliseconds;
+
+	for (;;) {
+		while (Shim_RunJob()) {
+		}
+		if (now == end) {
+			break;
+		}
+		Shim_Tick();
+	}
+}
+
+void Shim_Event(uint32_t delay, MqttEvent_t event) {
+	Shim_Later(delay, Shim_EventJob, NULL, (uint32_t) event);
+}
+
+void Shim_SdCardPath(const char * name, char * path, size_t size) {
+	Shim_Path(name, path, size);
+}
+
+void Retcode_RaiseError(Retcode_T retcode) {
+	shim.raised = retcode;
+}
+
+/* FreeRTOS */
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+	if (semaphoreCount >= SHIM_SEMAPHORES) {
+		return NULL;
+	}
+	semaphores[semaphoreCount].count = 0UL;
+	return &semaphores[semaphoreCount++];
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+	SemaphoreHandle_t semaphore = xSemaphoreCreateBinary();
+	if (semaphore != NULL) {
+		semaphore->count = 1UL;
+	}
+	return semaphore;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+	BCDS_UNUSED(semaphore);
+}
+
+/**
+ * @brief The caller blocks, meanwhile the command processor runs and time passes
+ */
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+	const uint32_t end = now + ticks;
+
+	for (;;) {
+		if (semaphore->count > 0UL) {
+			semaphore->count--;
+			return pdTRUE;
+		}
+		if (ticks == 0UL) {
+			return pdFALSE;
+		}
+		if (Shim_RunJob()) {
+			continue;
+		}
+		if (now == end) {
+			return pdFALSE;
+		}
+		Shim_Tick();
+	}
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+	if (semaphore->count > 0UL) {
+		return pdFALSE;
+	}
+	semaphore->count = 1UL;
+	return pdTRUE;
+}
+
+xTimerHandle xTimerCreate(const char * const name, TickType_t period, UBaseType_t reload, void * id,
+		TimerCallbackFunction_t callback) {
+	BCDS_UNUSED(name);
+	BCDS_UNUSED(id);
+	for (uint32_t index = 0UL; index < SHIM_TIMERS; index++) {
+		if (timers[index].used == false) {
+			timers[index] = (struct Shim_Timer_S) { true, false, reload != 0UL, period, 0UL, callback };
+			return &timers[index];
+		}
+	}
+	return NULL;
+}
+
+BaseType_t xTimerStart(xTimerHandle timer, TickType_t ticks) {
+	BCDS_UNUSED(ticks);
+	timer->active = true;
+	timer->due = now + timer->period;
+	return pdPASS;
+}
+
+BaseType_t xTimerStop(xTimerHandle timer, TickType_t ticks) {
+	BCDS_UNUSED(ticks);
+	timer->active = false;
+	return pdPASS;
+}
+
+/* command processor */
+
+Retcode_T CmdProcessor_Enqueue(CmdProcessor_T * processor, CmdProcessor_Func_T func, void * param1, uint32_t param2) {
+	if (jobHead - jobTail >= SHIM_JOBS) {
+		return RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_OUT_OF_RESOURCES);
+	}
+	if (processor != NULL) {
+		processor->jobs++;
+	}
+	jobs[jobHead % SHIM_JOBS] = (Shim_Job_T) { func, param1, param2, now };
+	jobHead++;
+	return RETCODE_OK;
+}
+
+/* Serval MQTT, the broker answers after shim.roundTrip */
+
+void StringDescr_wrap(StringDescr_T * description, const char * string) {
+	description->start = string;
+	description->length = (uint32_t) strlen(string);
+}
+
+int Ip_convertAddrToString(Ip_Address_T * address, char * buffer) {
+	return sprintf(buffer, "%u.%u.%u.%u", (unsigned) (*address & 0xFFU), (unsigned) ((*address >> 8) & 0xFFU),
+			(unsigned) ((*address >> 16) & 0xFFU), (unsigned) (*address >> 24));
+}
+
+retcode_t SupportedUrl_fromString(const char * url, uint16_t length, SupportedUrl_T * target) {
+	BCDS_UNUSED(url);
+	BCDS_UNUSED(length);
+	BCDS_UNUSED(target);
+	return RC_OK;
+}
+
+retcode_t Mqtt_initialize(void) {
+	return RC_OK;
+}
+
+retcode_t Mqtt_initializeInternalSession(MqttSession_T * mqttSession) {
+	session = mqttSession;
+	return RC_OK;
+}
+
+retcode_t Mqtt_connect(MqttSession_T * mqttSession) {
+	session = mqttSession;
+	shim.connects++;
+	if (shim.roundTrip != 0UL) {
+		shim.connected = true;
+		Shim_Event(shim.roundTrip, MQTT_CONNECTION_ESTABLISHED);
+	}
+	return RC_OK;
+}
+
+retcode_t Mqtt_disconnect(MqttSession_T * mqttSession) {
+	BCDS_UNUSED(mqttSession);
+	shim.connected = false;
+	Shim_Event(0UL, MQTT_CONNECTION_CLOSED);
+	return RC_OK;
+}
+
+bool Mqtt_isConnected(MqttSession_T * mqttSession) {
+	BCDS_UNUSED(mqttSession);
+	return shim.connected;
+}
+
+retcode_t Mqtt_subscribe(MqttSession_T * mqttSession, uint8_t count, StringDescr_T * topics, Mqtt_qos_t * qos) {
+	BCDS_UNUSED(mqttSession);
+	BCDS_UNUSED(topics);
+	BCDS_UNUSED(qos);
+	shim.subscribes++;
+	shim.topics += count;
+	if (shim.roundTrip != 0UL) {
+		Shim_Event(shim.roundTrip, MQTT_SUBSCRIPTION_ACKNOWLEDGED);
+	}
+	return RC_OK;
+}
+
+retcode_t Mqtt_unsubscribe(MqttSession_T * mqttSession, uint8_t count, StringDescr_T * topics) {
+	BCDS_UNUSED(mqttSession);
+	BCDS_UNUSED(count);
+	BCDS_UNUSED(topics);
+	if (shim.roundTrip != 0UL) {
+		Shim_Event(shim.roundTrip, MQTT_SUBSCRIPTION_ACKNOWLEDGED);
+	}
+	return RC_OK;
+}
+
+/**
+ * @brief Record the publish, the test acknowledges it with Shim_Event
+ */
+retcode_t Mqtt_publish(MqttSession_T * mqttSession, StringDescr_T topic, const void * payload, uint32_t length,
+		uint8_t qos, bool retain) {
+	BCDS_UNUSED(mqttSession);
+	BCDS_UNUSED(topic);
+	BCDS_UNUSED(retain);
+	if (inEvent > 0UL) {
+		shim.reentrant++;
+	}
+	if (shim.publishResult == RC_OK) {
+		shim.publishes++;
+		shim.lastPayload = (const char *) payload;
+		shim.lastLength = length;
+		shim.lastQoS = qos;
+	}
+	return shim.publishResult;
+}
+
+/* security and network */
+
+retcode_t MbedTLSAdapter_Initialize(void) {
+	return RC_OK;
+}
+
+Retcode_T HTTPRestClientSecurity_Setup(void) {
+	return RETCODE_OK;
+}
+
+Retcode_T HTTPRestClientSecurity_Enable(void) {
+	return RETCODE_OK;
+}
+
+Retcode_T WlanNetworkConfig_GetIpAddress(uint8_t * url, Ip_Address_T * address) {
+	BCDS_UNUSED(url);
+	*address = UINT32_C(0x0100007F);
+	return RETCODE_OK;
+}
+
+/* SD card and FatFs */
+
+SDCardDriver_Status_T SDCardDriver_GetDetectStatus(void) {
+	return shim.sdCard ? SDCARD_INSERTED : SDCARD_NOT_INSERTED;
+}
+
+FRESULT f_open(FIL * fp, const TCHAR * path, BYTE mode) {
+	char host[SHIM_PATH_SIZE];
+	struct stat status;
+	int flags = ((mode & FA_WRITE) != 0U) ? (((mode & FA_READ) != 0U) ? O_RDWR : O_WRONLY) : O_RDONLY;
+
+	flags |= ((mode & FA_CREATE_ALWAYS) != 0U) ? (O_CREAT | O_TRUNC) : 0;
+	flags |= ((mode & FA_OPEN_ALWAYS) != 0U) ? O_CREAT : 0;
+	Shim_Path(path, host, sizeof(host));
+	fp->fd = open(host, flags, 0666);
+	if (fp->fd < 0) {
+		return (errno == ENOENT) ? FR_NO_FILE : FR_DENIED;
+	}
+	(void) fstat(fp->fd, &status);
+	fp->fptr = 0UL;
+	fp->fsize = (DWORD) status.st_size;
+	return FR_OK;
+}
+
+FRESULT f_close(FIL * fp) {
+	int result = close(fp->fd);
+	fp->fd = -1;
+	return (result == 0) ? FR_OK : FR_INVALID_OBJECT;
+}
+
+FRESULT f_read(FIL * fp, void * buffer, UINT length, UINT * count) {
+	ssize_t done = (lseek(fp->fd, (off_t) fp->fptr, SEEK_SET) < 0) ? -1 : read(fp->fd, buffer, length);
+	if (done < 0) {
+		*count = 0U;
+		return FR_DISK_ERR;
+	}
+	*count = (UINT) done;
+	fp->fptr += (DWORD) done;
+	return FR_OK;
+}
+
+/**
+ * @brief Write, a card with a write limit fails in the middle of the data like at a reset
+ */
+FRESULT f_write(FIL * fp, const void * buffer, UINT length, UINT * count) {
+	UINT allowed = (length < shim.writeLimit) ? length : (UINT) shim.writeLimit;
+	ssize_t done = (lseek(fp->fd, (off_t) fp->fptr, SEEK_SET) < 0) ? -1 : write(fp->fd, buffer, allowed);
+
+	*count = (done > 0) ? (UINT) done : 0U;
+	fp->fptr += *count;
+	if (fp->fptr > fp->fsize) {
+		fp->fsize = fp->fptr;
+	}
+	if (shim.writeLimit != UINT32_MAX) {
+		shim.writeLimit -= *count;
+	}
+	return (done >= 0 && *count == length) ? FR_OK : FR_DISK_ERR;
+}
+
+FRESULT f_lseek(FIL * fp, DWORD offset) {
+	fp->fptr = offset;
+	return FR_OK;
+}
+
+FRESULT f_truncate(FIL * fp) {
+	if (ftruncate(fp->fd, (off_t) fp->fptr) != 0) {
+		return FR_DISK_ERR;
+	}
+	fp->fsize = fp->fptr;
+	return FR_OK;
+}
+
+FRESULT f_unlink(const TCHAR * path) {
+	char host[SHIM_PATH_SIZE];
+
+	Shim_Path(path, host, sizeof(host));
+	return (unlink(host) == 0) ? FR_OK : FR_NO_FILE;
+}
+
+FRESULT f_mkdir(const TCHAR * path) {
+	char host[SHIM_PATH_SIZE];
+
+	Shim_Path(path, host, sizeof(host));
+	if (mkdir(host, 0777) == 0) {
+		return FR_OK;
+	}
+	return (errno == EEXIST) ? FR_EXIST : FR_DISK_ERR;
+}
+
+FRESULT f_opendir(DIR * directory, const TCHAR * path) {
+	char host[SHIM_PATH_SIZE];
+
+	Shim_Path(path, host, sizeof(host));
+	directory->stream = opendir(host);
+	return (directory->stream != NULL) ? FR_OK : FR_NO_FILE;
+}
+
+FRESULT f_readdir(DIR * directory, FILINFO * info) {
+	struct dirent * entry;
+
+	do {
+		entry = readdir((Shim_HostDir_T *) directory->stream);
+	} while (entry != NULL && entry->d_name[0] == '.');
+	memset(info, 0x00, sizeof(*info));
+	// longer names than 8.3 are not on a FatFs card
+	if (entry != NULL && strlen(entry->d_name) < sizeof(info->fname)) {
+		memcpy(info->fname, entry->d_name, strlen(entry->d_name));
+	}
+	return FR_OK;
+}
+
+FRESULT f_closedir(DIR * directory) {
+	(void) closedir((Shim_HostDir_T *) directory->stream);
+	return FR_OK;
+}
@@ -0,0 +1,315 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	SdkShim.h
+ **
+ **	DESCRIPTION:	Stand-ins for the parts of the XDK SDK the host tests link against
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* header definition ******************************************************** */
+#ifndef SDKSHIM_H_
+#define SDKSHIM_H_
+
+/* local interface declaration ********************************************** */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Only what the firmware modules under test use is declared, with the names
+ * of the SDK. The tasks of the device are simulated in one thread: the
+ * command processor runs its jobs whenever the caller blocks on a semaphore
+ * or lets time pass with Shim_Advance, one tick is one millisecond.
+ */
+
+/* local type and macro definitions */
+
+/* Basics and Retcode */
+
+#define XDK_CONNECTIVITY_MQTT				1		/**< Set by the makefile of the firmware */
+#define XDK_COMMON_ID_MQTT					UINT32_C(5)
+#define BCDS_UNUSED(x)						(void) (x)
+
+typedef uint32_t Retcode_T;
+
+/* the severity is dropped, the tests compare the codes */
+#define RETCODE(severity, code)				((Retcode_T) (code))
+#define Retcode_GetCode(retcode)			((uint32_t) (retcode))
+#define RETCODE_OK							UINT32_C(0)
+#define RETCODE_SEVERITY_ERROR				1
+#define RETCODE_SEVERITY_WARNING			2
+
+enum {
+	RETCODE_FAILURE = 1,
+	RETCODE_NULL_POINTER,
+	RETCODE_OUT_OF_RESOURCES,
+	RETCODE_INVALID_PARAM,
+	RETCODE_SEMAPHORE_ERROR,
+	RETCODE_MQTT_CONNECTION_CLOSED = 100,
+	RETCODE_MQTT_PUBLISH_FAILED,
+	RETCODE_MQTT_PUBLISH_CB_NOT_RECEIVED,
+	RETCODE_MQTT_PUBLISH_STATUS_ERROR,
+	RETCODE_MQTT_INIT_FAILED,
+	RETCODE_MQTT_INIT_INTERNAL_SESSION_FAILED,
+	RETCODE_MQTT_IPCONIG_FAIL,
+	RETCODE_MQTT_CONNECT_FAILED,
+	RETCODE_MQTT_PARSING_ERROR,
+	RETCODE_MQTT_CONNECT_CB_NOT_RECEIVED,
+	RETCODE_MQTT_CONNECT_STATUS_ERROR,
+	RETCODE_MQTT_SUBSCRIBE_FAILED,
+	RETCODE_MQTT_SUBSCRIBE_CB_NOT_RECEIVED,
+	RETCODE_MQTT_SUBSCRIBE_STATUS_ERROR,
+	RETCODE_MQTT_DISCONNECT,
+	RETCODE_HTTP_INIT_REQUEST_FAILED,
+	RETCODE_FIRST_CUSTOM_CODE = 200,
+};
+
+void Retcode_RaiseError(Retcode_T retcode);
+
+/* FreeRTOS */
+
+typedef uint32_t TickType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef struct Shim_Semaphore_S * SemaphoreHandle_t;
+typedef struct Shim_Timer_S * xTimerHandle;
+typedef void (*TimerCallbackFunction_t)(xTimerHandle timer);
+
+#define pdTRUE								1L
+#define pdFALSE								0L
+#define pdPASS								pdTRUE
+#define pdFAIL								pdFALSE
+#define pdMS_TO_TICKS(ms)					((TickType_t) (ms))
+
+/* one thread, nothing to lock */
+#define taskENTER_CRITICAL()
+#define taskEXIT_CRITICAL()
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+void vSemaphoreDelete(SemaphoreHandle_t semaphore);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+xTimerHandle xTimerCreate(const char * const name, TickType_t period, UBaseType_t reload, void * id,
+		TimerCallbackFunction_t callback);
+BaseType_t xTimerStart(xTimerHandle timer, TickType_t ticks);
+BaseType_t xTimerStop(xTimerHandle timer, TickType_t ticks);
+
+/* command processor */
+
+typedef struct {
+	uint32_t jobs; /**< jobs run so far */
+} CmdProcessor_T;
+
+typedef void (*CmdProcessor_Func_T)(void * param1, uint32_t param2);
+
+Retcode_T CmdProcessor_Enqueue(CmdProcessor_T * processor, CmdProcessor_Func_T func, void * param1, uint32_t param2);
+
+/* Serval MQTT */
+
+typedef int retcode_t;
+#define RC_OK								0
+#define RC_MQTT_NOT_CONNECTED				1
+
+typedef struct {
+	const char * start;
+	uint32_t length;
+} StringDescr_T;
+
+typedef enum {
+	MQTT_QOS_AT_MOST_ONE,
+	MQTT_QOS_AT_LEAST_ONCE,
+	MQTT_QOS_EXACTLY_ONCE
+} Mqtt_qos_t;
+
+typedef uint32_t Ip_Address_T;
+
+typedef struct {
+	int scheme;
+} SupportedUrl_T;
+
+#define SERVAL_SCHEME_MQTT					1
+#define SERVAL_SCHEME_MQTTS					2
+
+typedef struct {
+	StringDescr_T topic;
+	const uint8_t * payload;
+	uint32_t length;
+} MqttPublishData_T;
+
+typedef union {
+	MqttPublishData_T publish;
+} MqttEventData_t;
+
+typedef enum {
+	MQTT_CONNECTION_ESTABLISHED,
+	MQTT_CONNECTION_ERROR,
+	MQTT_CONNECT_SEND_FAILED,
+	MQTT_CONNECT_TIMEOUT,
+	MQTT_CONNECTION_CLOSED,
+	MQTT_SUBSCRIPTION_ACKNOWLEDGED,
+	MQTT_SUBSCRIBE_SEND_FAILED,
+	MQTT_SUBSCRIBE_TIMEOUT,
+	MQTT_SUBSCRIPTION_REMOVED,
+	MQTT_INCOMING_PUBLISH,
+	MQTT_PUBLISHED_DATA,
+	MQTT_PUBLISH_SEND_FAILED,
+	MQTT_PUBLISH_SEND_ACK_FAILED,
+	MQTT_PUBLISH_TIMEOUT
+} MqttEvent_t;
+
+typedef struct MqttSession_S MqttSession_T;
+
+struct MqttSession_S {
+	int MQTTVersion;
+	uint32_t keepAliveInterval;
+	bool cleanSession;
+	struct {
+		bool haveWill;
+	} will;
+	retcode_t (*onMqttEvent)(MqttSession_T * session, MqttEvent_t event, const MqttEventData_t * data);
+	StringDescr_T clientID;
+	StringDescr_T username;
+	StringDescr_T password;
+	SupportedUrl_T target;
+};
+
+void StringDescr_wrap(StringDescr_T * description, const char * string);
+int Ip_convertAddrToString(Ip_Address_T * address, char * buffer);
+retcode_t SupportedUrl_fromString(const char * url, uint16_t length, SupportedUrl_T * target);
+retcode_t Mqtt_initialize(void);
+retcode_t Mqtt_initializeInternalSession(MqttSession_T * session);
+retcode_t Mqtt_connect(MqttSession_T * session);
+retcode_t Mqtt_disconnect(MqttSession_T * session);
+bool Mqtt_isConnected(MqttSession_T * session);
+retcode_t Mqtt_subscribe(MqttSession_T * session, uint8_t count, StringDescr_T * topics, Mqtt_qos_t * qos);
+retcode_t Mqtt_unsubscribe(MqttSession_T * session, uint8_t count, StringDescr_T * topics);
+retcode_t Mqtt_publish(MqttSession_T * session, StringDescr_T topic, const void * payload, uint32_t length,
+		uint8_t qos, bool retain);
+
+/* security and network */
+
+retcode_t MbedTLSAdapter_Initialize(void);
+Retcode_T HTTPRestClientSecurity_Setup(void);
+Retcode_T HTTPRestClientSecurity_Enable(void);
+Retcode_T WlanNetworkConfig_GetIpAddress(uint8_t * url, Ip_Address_T * address);
+
+/* SD card and FatFs, the files live in a directory of the host */
+
+typedef char TCHAR;
+typedef uint8_t BYTE;
+typedef unsigned int UINT;
+typedef uint32_t DWORD;
+
+typedef enum {
+	FR_OK = 0,
+	FR_DISK_ERR,
+	FR_NO_FILE,
+	FR_DENIED,
+	FR_EXIST,
+	FR_INVALID_OBJECT,
+} FRESULT;
+
+#define FA_READ								0x01U
+#define FA_WRITE							0x02U
+#define FA_CREATE_ALWAYS					0x08U
+#define FA_OPEN_ALWAYS						0x10U
+
+typedef struct {
+	int fd; /**< file of the host */
+	DWORD fptr; /**< read and write position */
+	DWORD fsize; /**< size of the file */
+} FIL;
+
+typedef struct {
+	void * stream; /**< directory of the host */
+} DIR;
+
+typedef struct {
+	DWORD fsize;
+	TCHAR fname[13]; /**< 8.3 name */
+} FILINFO;
+
+#define f_size(fp)							((fp)->fsize)
+
+FRESULT f_open(FIL * fp, const TCHAR * path, BYTE mode);
+FRESULT f_close(FIL * fp);
+FRESULT f_read(FIL * fp, void * buffer, UINT length, UINT * count);
+FRESULT f_write(FIL * fp, const void * buffer, UINT length, UINT * count);
+FRESULT f_lseek(FIL * fp, DWORD offset);
+FRESULT f_truncate(FIL * fp);
+FRESULT f_unlink(const TCHAR * path);
+FRESULT f_mkdir(const TCHAR * path);
+FRESULT f_opendir(DIR * directory, const TCHAR * path);
+FRESULT f_readdir(DIR * directory, FILINFO * info);
+FRESULT f_closedir(DIR * directory);
+
+typedef enum {
+	SDCARD_NOT_INSERTED,
+	SDCARD_INSERTED
+} SDCardDriver_Status_T;
+
+SDCardDriver_Status_T SDCardDriver_GetDetectStatus(void);
+
+/* control of the simulation by the tests */
+
+/**
+ * @brief The broker and the SD card as a test sets them up
+ */
+typedef struct {
+	uint32_t roundTrip; /**< milliseconds until the broker answers CONNECT and SUBSCRIBE, 0 never answers */
+	bool connected; /**< returned by Mqtt_isConnected */
+	retcode_t publishResult; /**< returned by Mqtt_publish */
+	uint32_t connects; /**< CONNECT packets sent */
+	uint32_t subscribes; /**< SUBSCRIBE packets sent */
+	uint32_t topics; /**< topics in all SUBSCRIBE packets */
+	uint32_t publishes; /**< PUBLISH packets sent */
+	uint32_t reentrant; /**< publishes sent from within the event callback of the stack */
+	const char * lastPayload; /**< payload of the last PUBLISH */
+	uint32_t lastLength; /**< length of the last PUBLISH */
+	uint8_t lastQoS; /**< QoS of the last PUBLISH */
+	Retcode_T raised; /**< last error passed to Retcode_RaiseError */
+	bool sdCard; /**< SD card inserted */
+	uint32_t writeLimit; /**< bytes f_write writes until the card fails, UINT32_MAX without limit */
+} Shim_T;
+
+extern Shim_T shim;
+
+/**
+ * @brief Start a new simulation, time 0, no jobs, no broker answers, no SD card files
+ */
+void Shim_Reset(void);
+
+/**
+ * @brief Milliseconds since Shim_Reset
+ */
+uint32_t Shim_Now(void);
+
+/**
+ * @brief Let time pass, the command processor runs its jobs and the timers fire
+ */
+void Shim_Advance(uint32_t milliseconds);
+
+/**
+ * @brief Let the stack report an event in the command processor after a delay, as the broker answered
+ */
+void Shim_Event(uint32_t delay, MqttEvent_t event);
+
+/**
+ * @brief Path on the host of a file on the SD card
+ */
+void Shim_SdCardPath(const char * name, char * path, size_t size);
+
+/* global inline function definitions */
+
+#endif /* SDKSHIM_H_ */
@@ -0,0 +1,2 @@
+/* stand-in of the XDK SDK header, see SdkShim.h */
+#include "SdkShim.h"
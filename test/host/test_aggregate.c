@@ -0,0 +1,206 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	test_aggregate.c
+ **
+ **	DESCRIPTION:	Host test of the running window statistics in MQTTAggregate
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* system header files */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <math.h>
+
+/* own header files */
+#include "HostTest.h"
+#include "MQTTAggregate.h"
+
+/* constant definitions ***************************************************** */
+
+#define TEST_MAX_WINDOW		UINT32_C(100000)	/**< Longest window compared */
+#define TEST_MEAN_TOLERANCE		2.0e-6	/**< Mean error relative to the mean, float has 24 bits */
+#define TEST_SPREAD_TOLERANCE	1.0e-4	/**< Mean error relative to the standard deviation, grows with the window */
+#define TEST_STDDEV_TOLERANCE	1.0e-2	/**< Standard deviation error relative to the standard deviation */
+
+/* local variables ********************************************************** */
+
+static int32_t samples[MQTTAGGREGATE_MAX_VALUES][TEST_MAX_WINDOW];
+
+/* local functions ********************************************************** */
+
+/**
+ * @brief Uniformly distributed value in offset - amplitude .. offset + amplitude
+ */
+static int32_t TestValue(int32_t offset, int32_t amplitude) {
+	if (amplitude == 0L) {
+		return offset;
+	}
+	return offset + (int32_t) ((uint32_t) rand() % (uint32_t) (2L * amplitude + 1L)) - amplitude;
+}
+
+/**
+ * @brief Add a window of samples and compare every axis with a two-pass double reference
+ */
+static void TestWindow(const char * name, const int32_t * offsets, const int32_t * amplitudes, uint8_t axes, uint32_t window) {
+	MQTTAggregate_T aggregate;
+	double worstMean = 0.0;
+	double worstDeviation = 0.0;
+
+	MQTTAggregate_Reset(&aggregate);
+	for (uint32_t n = 0UL; n < window; n++) {
+		int32_t values[MQTTAGGREGATE_MAX_VALUES];
+		for (uint8_t axis = 0U; axis < axes; axis++) {
+			values[axis] = TestValue(offsets[axis], amplitudes[axis]);
+			samples[axis][n] = values[axis];
+		}
+		MQTTAggregate_Add(&aggregate, values, axes);
+	}
+	HOSTTEST_CHECK(aggregate.count == window && aggregate.values == axes);
+
+	for (uint8_t axis = 0U; axis < axes; axis++) {
+		double sum = 0.0;
+		int32_t min = samples[axis][0];
+		int32_t max = samples[axis][0];
+		for (uint32_t n = 0UL; n < window; n++) {
+			sum += samples[axis][n];
+			min = (samples[axis][n] < min) ? samples[axis][n] : min;
+			max = (samples[axis][n] > max) ? samples[axis][n] : max;
+		}
+		double mean = sum / window;
+		double squares = 0.0;
+		for (uint32_t n = 0UL; n < window; n++) {
+			squares += (samples[axis][n] - mean) * (samples[axis][n] - mean);
+		}
+		double deviation = sqrt(squares / window);
+
+		double meanError = fabs(MQTTAggregate_Mean(&aggregate, axis) - mean);
+		double deviationError = fabs(MQTTAggregate_StdDev(&aggregate, axis) - deviation);
+		HOSTTEST_CHECK(aggregate.min[axis] == min && aggregate.max[axis] == max);
+		HOSTTEST_CHECK(aggregate.m2[axis] >= 0.0F);
+		HOSTTEST_CHECK(meanError <= TEST_MEAN_TOLERANCE * fabs(mean) + TEST_SPREAD_TOLERANCE * deviation);
+		if (deviation == 0.0) {
+			HOSTTEST_CHECK(deviationError == 0.0);
+		} else {
+			HOSTTEST_CHECK(deviationError <= TEST_STDDEV_TOLERANCE * deviation);
+			deviationError /= deviation;
+		}
+		worstMean = (meanError > worstMean) ? meanError : worstMean;
+		worstDeviation = (deviationError > worstDeviation) ? deviationError : worstDeviation;
+	}
+	printf("%s window %lu: mean error %.3g, relative stddev error %.3g\n", name,
+			(unsigned long) window, worstMean, worstDeviation);
+}
+
+/**
+ * @brief Accelerometer like signal on three axes around 0 and 1 g
+ */
+static void TestAccel(void) {
+	const int32_t offsets[3] = { 0L, 0L, 1000L };
+	const int32_t amplitudes[3] = { 2000L, 50L, 300L };
+
+	for (uint32_t window = 1UL; window <= TEST_MAX_WINDOW; window *= 10UL) {
+		TestWindow("accel", offsets, amplitudes, 3U, window);
+	}
+}
+
+/**
+ * @brief Constant signals, m2 must stay exactly 0 and not turn negative
+ */
+static void TestConstant(void) {
+	const int32_t offsets[4] = { 981L, -981L, 101325L, 50000000L };
+	const int32_t amplitudes[4] = { 0L, 0L, 0L, 0L };
+
+	TestWindow("constant", offsets, amplitudes, 4U, 10000UL);
+}
+
+/**
+ * @brief Small variations on a large offset, where a single-pass float sum of squares cancels out
+ *
+ * Pressure in Pa, a value around 10^6 and light in mlux of a sunny day.
+ */
+static void TestLargeOffset(void) {
+	const int32_t offsets[3] = { 101325L, 1000000L, 50000000L };
+	const int32_t amplitudes[3] = { 5L, 10L, 1000L };
+
+	for (uint32_t window = 10UL; window <= TEST_MAX_WINDOW; window *= 10UL) {
+		TestWindow("offset", offsets, amplitudes, 3U, window);
+	}
+
+	// for comparison, the naive float variance sum(x^2)/n - mean^2 of the pressure
+	float sum = 0.0F;
+	float squares = 0.0F;
+	for (uint32_t n = 0UL; n < 1000UL; n++) {
+		float value = (float) TestValue(101325L, 5L);
+		sum += value;
+		squares += value * value;
+	}
+	float mean = sum / 1000.0F;
+	printf("offset: naive float variance of the pressure %.1f instead of about 10\n", squares / 1000.0F - mean * mean);
+}
+
+/**
+ * @brief Nearly constant signals on large offsets, m2 must never become negative
+ */
+static void TestNearlyConstant(void) {
+	const int32_t offsets[] = { 0L, -981L, 101325L, 1000000L, 16777217L, 50000000L, -50000000L, 2000000000L };
+	uint32_t negative = 0UL;
+
+	for (uint32_t o = 0UL; o < sizeof(offsets) / sizeof(offsets[0]); o++) {
+		for (uint32_t run = 0UL; run < 200UL; run++) {
+			MQTTAggregate_T aggregate;
+			MQTTAggregate_Reset(&aggregate);
+			for (uint32_t n = 0UL; n < 500UL; n++) {
+				int32_t value = offsets[o] + (((uint32_t) rand() % 8U == 0U) ? (int32_t) ((uint32_t) rand() % 3U) - 1L : 0L);
+				MQTTAggregate_Add(&aggregate, &value, 1U);
+				if (aggregate.m2[0] < 0.0F || isnan(MQTTAggregate_StdDev(&aggregate, 0U))) {
+					negative++;
+				}
+			}
+		}
+	}
+	HOSTTEST_CHECK(negative == 0UL);
+}
+
+/**
+ * @brief A reset window starts from scratch
+ */
+static void TestReset(void) {
+	MQTTAggregate_T aggregate;
+	int32_t value = 5L;
+
+	MQTTAggregate_Reset(&aggregate);
+	HOSTTEST_CHECK(MQTTAggregate_StdDev(&aggregate, 0U) == 0.0F);
+	MQTTAggregate_Add(&aggregate, &value, 1U);
+	value = 7L;
+	MQTTAggregate_Add(&aggregate, &value, 1U);
+	MQTTAggregate_Reset(&aggregate);
+	value = -3L;
+	MQTTAggregate_Add(&aggregate, &value, 1U);
+	HOSTTEST_CHECK(aggregate.count == 1UL);
+	HOSTTEST_CHECK(MQTTAggregate_Mean(&aggregate, 0U) == -3.0F);
+	HOSTTEST_CHECK(aggregate.min[0] == -3L && aggregate.max[0] == -3L);
+	HOSTTEST_CHECK(MQTTAggregate_StdDev(&aggregate, 0U) == 0.0F);
+}
+
+/* global functions ********************************************************* */
+
+int main(int argc, char ** argv) {
+	(void) argc;
+	(void) argv;
+	srand(3U);
+	TestAccel();
+	TestConstant();
+	TestLargeOffset();
+	TestNearlyConstant();
+	TestReset();
+	return HostTest_Result("test_aggregate");
+}
@@ -0,0 +1,367 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	test_binary.c
+ **
+ **	DESCRIPTION:	Host test and benchmark of the binary payloads and MQTTBinary_Pack
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* system header files */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+/* own header files */
+#include "HostTest.h"
+#include "MQTTBuffer.h"
+#include "MQTTBinary.h"
+
+/* constant definitions ***************************************************** */
+
+#define TEST_PAYLOAD_SIZE	UINT32_C(860)			/**< SIZE_PACKET_BUF of the firmware */
+#define TEST_MAX_RECORDS	UINT32_C(256)
+#define TEST_EPOCH			UINT64_C(1700000000123)
+#define BENCH_ROUNDS		UINT32_C(20000)
+#define TRACE_SAMPLES		UINT32_C(400)
+#define TRACE_FILE			"trace_motion.csv"		/**< Accelerometer and gyroscope at 100 Hz, see its header */
+#define TRACE_MAX_PERCENT	50.0					/**< Packed size of the trace relative to version 1 */
+
+#ifndef HOSTTEST_DATA
+#define HOSTTEST_DATA		"."						/**< Directory for the payloads checked by check_decode.py */
+#endif
+
+/* local variables ********************************************************** */
+
+/**
+ * @brief Traces with the rates and value ranges of the XDK sensors
+ */
+typedef enum {
+	TRACE_ACCEL, /**< accelerometer at 100 Hz, device lying still with small vibrations */
+	TRACE_MOTION, /**< gyroscope and magnetometer at 50 Hz while the device is moved */
+	TRACE_ENVIRONMENT, /**< humidity, temperature, pressure and light once per second with inventory updates */
+	TRACE_MIXED, /**< all of the above with aggregates embedded as text records */
+	TRACE_RANDOM, /**< uncorrelated int32 values, packing must not make the payload larger */
+	TRACE_COUNT
+} Trace_T;
+
+static const char * const traceNames[TRACE_COUNT] = { "accel", "motion", "environment", "mixed", "random" };
+
+/**
+ * @brief One record appended to a payload, as the decoder has to return it
+ */
+typedef struct {
+	uint8_t tag;
+	uint8_t count;
+	uint8_t decimals;
+	uint64_t time;
+	int32_t values[3];
+	const char * text;
+} Record_T;
+
+static char data[TEST_PAYLOAD_SIZE];
+static char scratchData[TEST_PAYLOAD_SIZE];
+static char original[TEST_PAYLOAD_SIZE];
+static MQTTBuffer_Payload_T payload = { 0UL, TEST_PAYLOAD_SIZE, data };
+static MQTTBuffer_Payload_T scratch = { 0UL, TEST_PAYLOAD_SIZE, scratchData };
+static Record_T records[TEST_MAX_RECORDS];
+static uint32_t recordCount = 0UL;
+static int32_t traceSamples[TRACE_SAMPLES][6];
+static uint32_t traceCount = 0UL;
+
+/* local functions ********************************************************** */
+
+static int32_t Noise(int32_t amplitude) {
+	return (int32_t) ((uint32_t) rand() % (uint32_t) (2L * amplitude + 1L)) - amplitude;
+}
+
+static bool Append(uint8_t tag, uint64_t * time, uint32_t delta, const int32_t * values, uint8_t count, uint8_t decimals) {
+	if (MQTTBinary_Values(&payload, tag, delta, values, count, decimals) == false) {
+		return false;
+	}
+	Record_T * record = &records[recordCount++];
+	*time += delta;
+	record->tag = tag;
+	record->count = count;
+	record->decimals = decimals;
+	record->time = *time;
+	memcpy(record->values, values, count * sizeof(int32_t));
+	record->text = NULL;
+	return true;
+}
+
+static bool AppendText(const char * text) {
+	if (MQTTBinary_Text(&payload, text, (uint32_t) strlen(text)) == false) {
+		return false;
+	}
+	records[recordCount].text = text;
+	recordCount++;
+	return true;
+}
+
+/**
+ * @brief Fill a version 1 payload with a trace until it is full
+ */
+static void Fill(Trace_T trace) {
+	int32_t accel[3] = { 12L, -981L, 31L };
+	int32_t gyro[3] = { 0L, 0L, 0L };
+	int32_t mag[3] = { -12L, 33L, -41L };
+	int32_t humidity = 45L;
+	int32_t temp = 2315L;
+	int32_t pressure = 101325L;
+	int32_t light = 120000L;
+	uint64_t time = TEST_EPOCH;
+	bool fits = true;
+
+	payload.length = 0UL;
+	recordCount = 0UL;
+	HOSTTEST_CHECK(MQTTBinary_Header(&payload, TEST_EPOCH));
+
+	for (uint32_t n = 0UL; fits && recordCount < TEST_MAX_RECORDS - 4UL; n++) {
+		int32_t values[3];
+		switch (trace) {
+		case TRACE_ACCEL:
+			for (uint8_t axis = 0U; axis < 3U; axis++) {
+				values[axis] = accel[axis] + Noise(4L);
+			}
+			fits = Append(1U, &time, 10UL, values, 3U, 3U);
+			break;
+		case TRACE_MOTION:
+			for (uint8_t axis = 0U; axis < 3U; axis++) {
+				gyro[axis] += Noise(40L);
+				mag[axis] += Noise(2L);
+			}
+			fits = Append(2U, &time, 20UL, gyro, 3U, 0U)
+					&& Append(3U, &time, 0UL, mag, 3U, 0U);
+			break;
+		case TRACE_ENVIRONMENT:
+			humidity += Noise(1L);
+			temp += Noise(3L);
+			pressure += Noise(4L);
+			light += Noise(500L);
+			fits = Append(5U, &time, 1000UL, &humidity, 1U, 0U)
+					&& Append(6U, &time, 0UL, &temp, 1U, 2U)
+					&& Append(7U, &time, 0UL, &pressure, 1U, 2U)
+					&& Append(4U, &time, 0UL, &light, 1U, 2U)
+					&& Append(4U | MQTTBINARY_TAG_INVENTORY, &time, 0UL, &light, 1U, 2U);
+			break;
+		case TRACE_MIXED:
+			for (uint8_t axis = 0U; axis < 3U; axis++) {
+				accel[axis] += Noise(3L);
+			}
+			fits = Append(1U, &time, 100UL + (uint32_t) rand() % 5UL, accel, 3U, 3U);
+			if (fits && n % 4UL == 3UL) {
+				pressure += Noise(2L);
+				fits = Append(7U, &time, 0UL, &pressure, 1U, 2U);
+			}
+			if (fits && n % 10UL == 9UL) {
+				fits = AppendText("981,,10,0.012,-0.981,0.031,0.004,0.002,0.003");
+			}
+			break;
+		default:
+			for (uint8_t axis = 0U; axis < 3U; axis++) {
+				values[axis] = (int32_t) ((uint32_t) rand() * 65536UL + (uint32_t) rand());
+			}
+			fits = Append(1U, &time, (uint32_t) rand() % MQTTBINARY_MAX_DELTA, values, 3U, 0U);
+			break;
+		}
+	}
+}
+
+/**
+ * @brief Write the payload and the expected records for check_decode.py
+ */
+static void Save(const char * name, const char * suffix, const MQTTBuffer_Payload_T * target) {
+	char path[256];
+
+	snprintf(path, sizeof(path), "%s/binary_%s.%s", HOSTTEST_DATA, name, suffix);
+	FILE * file = fopen(path, "wb");
+	HOSTTEST_CHECK(file != NULL);
+	if (file == NULL) {
+		return;
+	}
+	if (target != NULL) {
+		fwrite(target->data, 1U, target->length, file);
+	} else {
+		// one record per line: text or template, time, decimals and values
+		for (uint32_t n = 0UL; n < recordCount; n++) {
+			const Record_T * record = &records[n];
+			if (record->text != NULL) {
+				fprintf(file, "text %s\n", record->text);
+				continue;
+			}
+			fprintf(file, "%u %" PRIu64 " %u", (unsigned) (((record->tag & MQTTBINARY_TAG_INVENTORY) ? 1990U : 990U)
+					+ (record->tag & MQTTBINARY_TAG_STREAM)), record->time, (unsigned) record->decimals);
+			for (uint8_t value = 0U; value < record->count; value++) {
+				fprintf(file, " %ld", (long) record->values[value]);
+			}
+			fprintf(file, "\n");
+		}
+	}
+	fclose(file);
+}
+
+/**
+ * @brief Fill, pack and save every trace, report the compression ratio
+ */
+static void TestPack(void) {
+	for (Trace_T trace = TRACE_ACCEL; trace < TRACE_COUNT; trace++) {
+		Fill(trace);
+		uint32_t before = payload.length;
+		memcpy(original, data, before);
+		Save(traceNames[trace], "v1", &payload);
+		Save(traceNames[trace], "expected", NULL);
+
+		bool packed = MQTTBinary_Pack(&payload, &scratch);
+		HOSTTEST_CHECK(payload.length <= before);
+		if (packed) {
+			HOSTTEST_CHECK(payload.length < before && (uint8_t) data[1] == MQTTBINARY_VERSION_PACKED);
+		} else {
+			// not packed, the payload is left as it was
+			HOSTTEST_CHECK(payload.length == before && memcmp(original, data, before) == 0);
+		}
+		Save(traceNames[trace], "v2", &payload);
+		printf("pack %s: %lu records, %lu -> %lu bytes, %.1f%%\n", traceNames[trace], (unsigned long) recordCount,
+				(unsigned long) before, (unsigned long) payload.length, 100.0 * payload.length / before);
+	}
+}
+
+/**
+ * @brief Read the accelerometer and gyroscope columns of the trace, lines starting with # are comments
+ */
+static void ReadTrace(void) {
+	char line[128];
+	FILE * file = fopen(TRACE_FILE, "r");
+
+	HOSTTEST_CHECK(file != NULL);
+	if (file == NULL) {
+		return;
+	}
+	traceCount = 0UL;
+	while (traceCount < TRACE_SAMPLES && fgets(line, sizeof(line), file) != NULL) {
+		long time;
+		long values[6];
+		if (line[0] == '#') {
+			continue;
+		}
+		HOSTTEST_CHECK(sscanf(line, "%ld,%ld,%ld,%ld,%ld,%ld,%ld", &time, &values[0], &values[1], &values[2],
+				&values[3], &values[4], &values[5]) == 7);
+		HOSTTEST_CHECK(time == (long) traceCount * 10L);
+		for (uint8_t column = 0U; column < 6U; column++) {
+			traceSamples[traceCount][column] = (int32_t) values[column];
+		}
+		traceCount++;
+	}
+	fclose(file);
+	HOSTTEST_CHECK(traceCount == TRACE_SAMPLES);
+}
+
+/**
+ * @brief Pack the payloads of the motion trace and check the compression ratio over all of them
+ */
+static void TestTrace(void) {
+	uint32_t sample = 0UL;
+	uint32_t payloads = 0UL;
+	uint32_t before = 0UL;
+	uint32_t after = 0UL;
+
+	ReadTrace();
+	while (sample < traceCount) {
+		uint64_t time = TEST_EPOCH;
+		payload.length = 0UL;
+		recordCount = 0UL;
+		HOSTTEST_CHECK(MQTTBinary_Header(&payload, TEST_EPOCH));
+		// accelerometer in g with 3 decimals and gyroscope in mdeg/s, as one sample of the firmware
+		while (sample < traceCount && recordCount < TEST_MAX_RECORDS - 2UL
+				&& Append(1U, &time, recordCount == 0UL ? 0UL : 10UL, &traceSamples[sample][0], 3U, 3U)) {
+			if (Append(2U, &time, 0UL, &traceSamples[sample][3], 3U, 0U) == false) {
+				break;
+			}
+			sample++;
+		}
+		if (payloads == 0UL) {
+			Save("trace", "v1", &payload);
+			Save("trace", "expected", NULL);
+		}
+		before += payload.length;
+		HOSTTEST_CHECK(MQTTBinary_Pack(&payload, &scratch));
+		after += payload.length;
+		if (payloads == 0UL) {
+			Save("trace", "v2", &payload);
+		}
+		payloads++;
+	}
+	HOSTTEST_CHECK(sample == traceCount && payloads > 1UL);
+	HOSTTEST_CHECK(100.0 * after / before <= TRACE_MAX_PERCENT);
+	printf("pack trace: %lu samples in %lu payloads, %lu -> %lu bytes, %.1f%%\n", (unsigned long) traceCount,
+			(unsigned long) payloads, (unsigned long) before, (unsigned long) after, 100.0 * after / before);
+}
+
+/**
+ * @brief Records that do not fit leave the payload unchanged
+ */
+static void TestLimits(void) {
+	char small[16];
+	MQTTBuffer_Payload_T target = { 0UL, sizeof(small), small };
+	int32_t values[3] = { 1L, 70000L, -3L };
+
+	HOSTTEST_CHECK(MQTTBinary_Header(&target, TEST_EPOCH));
+	HOSTTEST_CHECK(MQTTBinary_Values(&target, 1U, 0UL, values, 3U, 3U) == false);
+	HOSTTEST_CHECK(target.length == MQTTBINARY_HEADER_SIZE);
+	HOSTTEST_CHECK(MQTTBinary_Values(&target, 1U, 0UL, values, 1U, 3U));
+	HOSTTEST_CHECK(target.length == MQTTBINARY_HEADER_SIZE + 6UL);
+	HOSTTEST_CHECK(MQTTBinary_Values(&target, 1U, MQTTBINARY_MAX_DELTA + 1UL, values, 1U, 3U) == false);
+	HOSTTEST_CHECK(MQTTBinary_Text(&target, "x", 1UL) == false);
+	HOSTTEST_CHECK(target.length == MQTTBINARY_HEADER_SIZE + 6UL);
+}
+
+/**
+ * @brief Cycles to append one accelerometer record and to pack a full payload
+ */
+static void BenchPack(void) {
+	int32_t values[3] = { 12L, -981L, 31L };
+	uint64_t append = 0UL;
+	uint64_t pack = 0UL;
+	uint64_t records = 0UL;
+	uint64_t bytes = 0UL;
+
+	for (uint32_t round = 0UL; round < BENCH_ROUNDS; round++) {
+		payload.length = 0UL;
+		(void) MQTTBinary_Header(&payload, TEST_EPOCH);
+		uint64_t start = HostTest_Cycles();
+		while (MQTTBinary_Values(&payload, 1U, 10UL, values, 3U, 3U)) {
+			values[round % 3UL] += (int32_t) (round & 3UL) - 1L;
+			records++;
+		}
+		append += HostTest_Cycles() - start;
+		bytes += payload.length;
+
+		start = HostTest_Cycles();
+		(void) MQTTBinary_Pack(&payload, &scratch);
+		pack += HostTest_Cycles() - start;
+		HOSTTEST_KEEP(data[0]);
+	}
+	printf("bench binary: %.1f cycles per record, pack %.0f cycles per payload, %.2f cycles per byte\n",
+			(double) append / records, (double) pack / BENCH_ROUNDS, (double) pack / bytes);
+}
+
+/* global functions ********************************************************* */
+
+int main(int argc, char ** argv) {
+	srand(5U);
+	TestPack();
+	TestTrace();
+	TestLimits();
+	if (HostTest_Bench(argc, argv)) {
+		BenchPack();
+	}
+	return HostTest_Result("test_binary");
+}
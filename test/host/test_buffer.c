@@ -0,0 +1,404 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	test_buffer.c
+ **
+ **	DESCRIPTION:	Host test and benchmark of the sample ring and payload pool in MQTTBuffer
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* system header files */
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+/* own header files */
+#include "HostTest.h"
+#include "MQTTBuffer.h"
+
+/* constant definitions ***************************************************** */
+
+#define TEST_CAPACITY		UINT32_C(32)		/**< Ring size used by the firmware for the samples */
+#define TEST_TRANSFERS		UINT32_C(2000000)	/**< Records handed between the threads */
+#define TEST_LIMIT			UINT32_C(8)		/**< Backlog limit of the policy tests */
+#define TEST_OFFERS			UINT32_C(20)	/**< Records offered to a backlog of TEST_LIMIT */
+#define BENCH_ROUNDS		UINT32_C(4000000)	/**< Push and pop pairs per benchmark */
+
+/* local variables ********************************************************** */
+
+/**
+ * @brief Record of the size of a firmware sample
+ */
+typedef struct {
+	uint32_t sequence;
+	uint32_t values[11];
+} Record_T;
+
+static Record_T storage[TEST_CAPACITY];
+static MQTTBuffer_Ring_T ring;
+static volatile bool producerDone = false;
+
+/* local functions ********************************************************** */
+
+static Record_T TestRecord(uint32_t sequence) {
+	Record_T record;
+
+	record.sequence = sequence;
+	for (uint32_t i = 0UL; i < 11UL; i++) {
+		record.values[i] = sequence * 31UL + i;
+	}
+	return record;
+}
+
+static bool TestValid(const Record_T * record) {
+	for (uint32_t i = 0UL; i < 11UL; i++) {
+		if (record->values[i] != record->sequence * 31UL + i) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Records come out in order, a full ring rejects and counts instead of overwriting
+ */
+static void TestRingSequential(void) {
+	uint8_t small[3];
+	HOSTTEST_CHECK(MQTTBuffer_RingInit(&ring, small, 1UL, 3UL) == false);
+	HOSTTEST_CHECK(MQTTBuffer_RingInit(&ring, storage, sizeof(Record_T), TEST_CAPACITY));
+	HOSTTEST_CHECK(MQTTBuffer_RingPeek(&ring) == NULL);
+
+	for (uint32_t n = 0UL; n < TEST_CAPACITY; n++) {
+		Record_T record = TestRecord(n);
+		HOSTTEST_CHECK(MQTTBuffer_RingPush(&ring, &record));
+	}
+	Record_T extra = TestRecord(99UL);
+	HOSTTEST_CHECK(MQTTBuffer_RingPush(&ring, &extra) == false);
+	HOSTTEST_CHECK(ring.overrun == 1UL);
+	HOSTTEST_CHECK(ring.highWater == TEST_CAPACITY);
+	HOSTTEST_CHECK(MQTTBuffer_RingCount(&ring) == TEST_CAPACITY);
+
+	for (uint32_t n = 0UL; n < TEST_CAPACITY / 2UL; n++) {
+		Record_T * record = (Record_T *) MQTTBuffer_RingPeek(&ring);
+		HOSTTEST_CHECK(record != NULL && record->sequence == n && TestValid(record));
+		MQTTBuffer_RingDiscard(&ring);
+	}
+	for (uint32_t n = TEST_CAPACITY / 2UL; n < TEST_CAPACITY; n++) {
+		Record_T record;
+		HOSTTEST_CHECK(MQTTBuffer_RingPop(&ring, &record) && record.sequence == n);
+	}
+	HOSTTEST_CHECK(MQTTBuffer_RingPeek(&ring) == NULL);
+	MQTTBuffer_RingDiscard(&ring);
+	HOSTTEST_CHECK(MQTTBuffer_RingCount(&ring) == 0UL);
+}
+
+/**
+ * @brief The free running indices may wrap around 2^32
+ */
+static void TestRingIndexWrap(void) {
+	MQTTBuffer_RingInit(&ring, storage, sizeof(Record_T), TEST_CAPACITY);
+	ring.head = UINT32_MAX - 5UL;
+	ring.tail = UINT32_MAX - 5UL;
+
+	for (uint32_t n = 0UL; n < 100UL; n++) {
+		Record_T record = TestRecord(n);
+		HOSTTEST_CHECK(MQTTBuffer_RingPush(&ring, &record));
+		HOSTTEST_CHECK(MQTTBuffer_RingCount(&ring) == 1UL);
+		HOSTTEST_CHECK(MQTTBuffer_RingPop(&ring, &record) && record.sequence == n);
+	}
+	HOSTTEST_CHECK(ring.overrun == 0UL);
+}
+
+static void * TestProducer(void * parameter) {
+	(void) parameter;
+	for (uint32_t n = 0UL; n < TEST_TRANSFERS; n++) {
+		Record_T record = TestRecord(n);
+		// the sampling task never waits, a full ring drops the sample
+		(void) MQTTBuffer_RingPush(&ring, &record);
+		for (uint32_t delay = 0UL; delay < 100UL; delay++) {
+			HOSTTEST_KEEP(delay);
+		}
+	}
+	producerDone = true;
+	return NULL;
+}
+
+/**
+ * @brief One producer and one consumer thread, no lock
+ *
+ * Every record arrives complete and in order, and every record that was not
+ * received was counted as overrun by the producer.
+ */
+static void TestRingConcurrent(void) {
+	pthread_t producer;
+	uint32_t received = 0UL;
+	uint32_t torn = 0UL;
+	uint32_t last = 0UL;
+	bool ordered = true;
+
+	MQTTBuffer_RingInit(&ring, storage, sizeof(Record_T), TEST_CAPACITY);
+	producerDone = false;
+	HOSTTEST_CHECK(pthread_create(&producer, NULL, TestProducer, NULL) == 0);
+
+	for (;;) {
+		bool done = producerDone;
+		Record_T * record = (Record_T *) MQTTBuffer_RingPeek(&ring);
+		if (record == NULL) {
+			if (done) {
+				break;
+			}
+			continue;
+		}
+		if (TestValid(record) == false) {
+			torn++;
+		}
+		if (received > 0UL && record->sequence <= last) {
+			ordered = false;
+		}
+		last = record->sequence;
+		received++;
+		MQTTBuffer_RingDiscard(&ring);
+	}
+	pthread_join(producer, NULL);
+
+	HOSTTEST_CHECK(torn == 0UL);
+	HOSTTEST_CHECK(ordered);
+	HOSTTEST_CHECK(received + ring.overrun == TEST_TRANSFERS);
+	printf("ring: %lu records received, %lu overrun\n", (unsigned long) received, (unsigned long) ring.overrun);
+}
+
+/**
+ * @brief Offer TEST_OFFERS records to an empty backlog without consuming
+ *
+ * @return number of records stored, their sequences are in kept
+ */
+static uint32_t TestOffer(MQTTBuffer_Policy_T policy, uint32_t decimation, uint32_t * kept) {
+	uint32_t count = 0UL;
+	Record_T record;
+
+	MQTTBuffer_RingInit(&ring, storage, sizeof(Record_T), TEST_CAPACITY);
+	MQTTBuffer_RingSetPolicy(&ring, TEST_LIMIT, policy, decimation);
+	for (uint32_t n = 0UL; n < TEST_OFFERS; n++) {
+		record = TestRecord(n);
+		(void) MQTTBuffer_RingOffer(&ring, &record);
+		HOSTTEST_CHECK(MQTTBuffer_RingCount(&ring) <= TEST_LIMIT);
+	}
+	while (MQTTBuffer_RingPop(&ring, &record)) {
+		kept[count++] = record.sequence;
+	}
+	return count;
+}
+
+/**
+ * @brief What each BACKLOGPOLICY keeps of a burst beyond the backlog limit
+ */
+static void TestRingPolicies(void) {
+	uint32_t kept[TEST_OFFERS];
+
+	// DROPNEWEST keeps the oldest records
+	HOSTTEST_CHECK(TestOffer(MQTTBUFFER_DROP_NEWEST, 1UL, kept) == TEST_LIMIT);
+	for (uint32_t n = 0UL; n < TEST_LIMIT; n++) {
+		HOSTTEST_CHECK(kept[n] == n);
+	}
+	HOSTTEST_CHECK(ring.overrun == TEST_OFFERS - TEST_LIMIT);
+
+	// DROPOLDEST keeps the latest records
+	HOSTTEST_CHECK(TestOffer(MQTTBUFFER_DROP_OLDEST, 1UL, kept) == TEST_LIMIT);
+	for (uint32_t n = 0UL; n < TEST_LIMIT; n++) {
+		HOSTTEST_CHECK(kept[n] == TEST_OFFERS - TEST_LIMIT + n);
+	}
+	HOSTTEST_CHECK(ring.overrun == TEST_OFFERS - TEST_LIMIT);
+
+	// DECIMATE keeps all records up to half the limit, then every third, then rejects
+	const uint32_t decimated[TEST_LIMIT] = { 0UL, 1UL, 2UL, 3UL, 6UL, 9UL, 12UL, 15UL };
+	HOSTTEST_CHECK(TestOffer(MQTTBUFFER_DECIMATE, 3UL, kept) == TEST_LIMIT);
+	for (uint32_t n = 0UL; n < TEST_LIMIT; n++) {
+		HOSTTEST_CHECK(kept[n] == decimated[n]);
+	}
+	HOSTTEST_CHECK(ring.overrun == 1UL);
+	HOSTTEST_CHECK(ring.decimated == TEST_OFFERS - TEST_LIMIT - 1UL);
+
+	// a limit of 0 or above the capacity uses the whole ring
+	MQTTBuffer_RingSetPolicy(&ring, 0UL, MQTTBUFFER_DROP_NEWEST, 0UL);
+	HOSTTEST_CHECK(ring.limit == TEST_CAPACITY && ring.decimation == 1UL);
+	MQTTBuffer_RingSetPolicy(&ring, TEST_CAPACITY + 1UL, MQTTBUFFER_DROP_NEWEST, 1UL);
+	HOSTTEST_CHECK(ring.limit == TEST_CAPACITY);
+}
+
+static void * TestOldestProducer(void * parameter) {
+	(void) parameter;
+	for (uint32_t n = 0UL; n < TEST_TRANSFERS; n++) {
+		Record_T record = TestRecord(n);
+		(void) MQTTBuffer_RingOffer(&ring, &record);
+	}
+	producerDone = true;
+	return NULL;
+}
+
+/**
+ * @brief With DROPOLDEST producer and consumer both move the tail
+ *
+ * A record the producer drops while the consumer copies it must not be
+ * returned torn, and no record may be returned twice.
+ */
+static void TestRingDropOldestConcurrent(void) {
+	pthread_t producer;
+	uint32_t received = 0UL;
+	uint32_t torn = 0UL;
+	uint32_t last = 0UL;
+	bool ordered = true;
+
+	MQTTBuffer_RingInit(&ring, storage, sizeof(Record_T), TEST_CAPACITY);
+	MQTTBuffer_RingSetPolicy(&ring, TEST_LIMIT, MQTTBUFFER_DROP_OLDEST, 1UL);
+	producerDone = false;
+	HOSTTEST_CHECK(pthread_create(&producer, NULL, TestOldestProducer, NULL) == 0);
+
+	for (;;) {
+		bool done = producerDone;
+		Record_T record;
+		if (MQTTBuffer_RingPop(&ring, &record) == false) {
+			if (done) {
+				break;
+			}
+			continue;
+		}
+		if (TestValid(&record) == false) {
+			torn++;
+		}
+		if (received > 0UL && record.sequence <= last) {
+			ordered = false;
+		}
+		last = record.sequence;
+		received++;
+	}
+	pthread_join(producer, NULL);
+
+	HOSTTEST_CHECK(torn == 0UL);
+	HOSTTEST_CHECK(ordered);
+	HOSTTEST_CHECK(last == TEST_TRANSFERS - 1UL);
+	HOSTTEST_CHECK(received + ring.overrun == TEST_TRANSFERS);
+	printf("drop oldest: %lu records received, %lu dropped\n", (unsigned long) received, (unsigned long) ring.overrun);
+}
+
+/**
+ * @brief Payloads go from the producer to the publisher and back, an exhausted pool is counted
+ */
+static void TestPool(void) {
+	char data[2][16];
+	MQTTBuffer_Payload_T payloads[2] = { { 0UL, sizeof(data[0]), data[0] }, { 0UL, sizeof(data[1]), data[1] } };
+	MQTTBuffer_Pool_T pool;
+
+	HOSTTEST_CHECK(MQTTBuffer_PoolInit(&pool, payloads, 0U) == false);
+	HOSTTEST_CHECK(MQTTBuffer_PoolInit(&pool, payloads, 2U));
+
+	MQTTBuffer_Payload_T * first = MQTTBuffer_PoolAcquire(&pool);
+	HOSTTEST_CHECK(first != NULL && MQTTBuffer_PoolAcquire(&pool) == first);
+	// an empty payload is not handed over
+	MQTTBuffer_PoolSeal(&pool);
+	HOSTTEST_CHECK(MQTTBuffer_PoolPeek(&pool) == NULL);
+
+	first->length = 5UL;
+	MQTTBuffer_PoolSeal(&pool);
+	MQTTBuffer_Payload_T * second = MQTTBuffer_PoolAcquire(&pool);
+	HOSTTEST_CHECK(second != NULL && second != first);
+	second->length = 7UL;
+	MQTTBuffer_PoolSeal(&pool);
+
+	// both payloads wait for the publisher, the producer has to back off
+	HOSTTEST_CHECK(MQTTBuffer_PoolAcquire(&pool) == NULL);
+	HOSTTEST_CHECK(pool.exhausted == 1UL);
+	HOSTTEST_CHECK(MQTTBuffer_PoolPeek(&pool) == first);
+	HOSTTEST_CHECK(MQTTBuffer_PoolPeekAt(&pool, 1U) == second);
+	HOSTTEST_CHECK(MQTTBuffer_PoolPeekAt(&pool, 2U) == NULL);
+
+	// released oldest first
+	MQTTBuffer_PoolRelease(&pool);
+	HOSTTEST_CHECK(first->length == 0UL);
+	HOSTTEST_CHECK(MQTTBuffer_PoolPeek(&pool) == second);
+	HOSTTEST_CHECK(MQTTBuffer_PoolAcquire(&pool) == first);
+}
+
+/**
+ * @brief Semaphore guarded buffer like the SensorDataBuffer before the ring, a mutex on the host
+ */
+static pthread_mutex_t lockedMutex = PTHREAD_MUTEX_INITIALIZER;
+static Record_T lockedStorage[TEST_CAPACITY];
+static uint32_t lockedCount = 0UL;
+
+static bool LockedPush(const Record_T * record) {
+	bool stored = false;
+
+	pthread_mutex_lock(&lockedMutex);
+	if (lockedCount < TEST_CAPACITY) {
+		lockedStorage[lockedCount++] = *record;
+		stored = true;
+	}
+	pthread_mutex_unlock(&lockedMutex);
+	return stored;
+}
+
+static bool LockedPop(Record_T * record) {
+	bool taken = false;
+
+	pthread_mutex_lock(&lockedMutex);
+	if (lockedCount > 0UL) {
+		*record = lockedStorage[0];
+		memmove(&lockedStorage[0], &lockedStorage[1], (lockedCount - 1UL) * sizeof(Record_T));
+		lockedCount--;
+		taken = true;
+	}
+	pthread_mutex_unlock(&lockedMutex);
+	return taken;
+}
+
+/**
+ * @brief Cycles for one sample handed from the producer to the consumer, single threaded
+ */
+static void BenchRing(void) {
+	Record_T record = TestRecord(1UL);
+	Record_T copy;
+
+	MQTTBuffer_RingInit(&ring, storage, sizeof(Record_T), TEST_CAPACITY);
+	uint64_t start = HostTest_Cycles();
+	for (uint32_t n = 0UL; n < BENCH_ROUNDS; n++) {
+		record.sequence = n;
+		(void) MQTTBuffer_RingPush(&ring, &record);
+		(void) MQTTBuffer_RingPop(&ring, &copy);
+		HOSTTEST_KEEP(copy.sequence);
+	}
+	uint64_t ringCycles = HostTest_Cycles() - start;
+
+	start = HostTest_Cycles();
+	for (uint32_t n = 0UL; n < BENCH_ROUNDS; n++) {
+		record.sequence = n;
+		(void) LockedPush(&record);
+		(void) LockedPop(&copy);
+		HOSTTEST_KEEP(copy.sequence);
+	}
+	uint64_t lockedCycles = HostTest_Cycles() - start;
+
+	printf("bench ring: %.1f cycles per sample, locked buffer %.1f cycles per sample\n",
+			(double) ringCycles / BENCH_ROUNDS, (double) lockedCycles / BENCH_ROUNDS);
+}
+
+/* global functions ********************************************************* */
+
+int main(int argc, char ** argv) {
+	TestRingSequential();
+	TestRingIndexWrap();
+	TestRingConcurrent();
+	TestRingPolicies();
+	TestRingDropOldestConcurrent();
+	TestPool();
+	if (HostTest_Bench(argc, argv)) {
+		BenchRing();
+	}
+	return HostTest_Result("test_buffer");
+}
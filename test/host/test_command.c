@@ -0,0 +1,637 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	test_command.c
+ **
+ **	DESCRIPTION:	Host test and benchmark of the SmartREST command parser, command table and queue
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* system header files */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stddef.h>
+
+/* own header files */
+#include "HostTest.h"
+#include "MQTTCommand.h"
+
+/* constant definitions ***************************************************** */
+
+#define TEST_LINE_SIZE		UINT32_C(320)
+#define TEST_PAYLOAD_SIZE	UINT32_C(2048)
+#define TEST_RANDOM			UINT32_C(100000)
+#define TEST_NAME_SIZE		UINT32_C(64)
+#define TEST_QUEUE_OPERATIONS	UINT32_C(200000)
+#define TEST_QUEUE_STORAGE	UINT32_C(2048)			/**< MQTTOPERATION_COMMAND_STORAGE of the firmware */
+#define TEST_QUEUE_DEPTH	UINT8_C(32)				/**< MQTTOPERATION_COMMAND_DEPTH of the firmware */
+#define TEST_QUEUE_GUARD	UINT32_C(16)			/**< Words around the storage that must stay untouched */
+#define TEST_GUARD_WORD		UINT32_C(0xA5A5A5A5)
+#define BENCH_ROUNDS		UINT32_C(200000)
+
+#ifndef HOSTTEST_SOURCE
+#define HOSTTEST_SOURCE		"../../source"			/**< Directory of MQTTOperation.c, its command table is checked */
+#endif
+
+/* local variables ********************************************************** */
+
+/**
+ * @brief A command as the strtok parser of the callback split it before
+ */
+typedef struct {
+	uint16_t template;
+	uint8_t count;
+	bool fits;
+	char args[MQTTCOMMAND_ARGS][TEST_LINE_SIZE];
+} Expected_T;
+
+/**
+ * @brief An entry of the command table in MQTTOperation.c
+ */
+typedef struct {
+	char variable[TEST_NAME_SIZE];
+	uint16_t template;
+	char name[TEST_NAME_SIZE];
+} Entry_T;
+
+static Entry_T entries[MQTTCOMMAND_SLOTS];
+static uint32_t entryCount = 0UL;
+static const Entry_T * table[MQTTCOMMAND_SLOTS];
+
+/**
+ * @brief Commands as the device receives them, mixed with a firmware update, a message and unknown commands
+ */
+static const char * const mixedStream[] = { "511,XDK,speed 1000", "511,XDK,config STREAMRATE 5000",
+		"511,XDK,sensor ACCEL TRUE", "511,XDK,toggle", "999,XDK,hello", "511,XDK,start", "510,XDK",
+		"515,XDK,xdk,1.0,http://example.com/xdk.bin", "511,XDK,unknown", "511,XDK,stop" };
+
+/* local functions ********************************************************** */
+
+/**
+ * @brief Parse a copy of the line, not terminated, so reads behind it are caught by the sanitizer
+ */
+static bool Parse(const char * line, uint32_t length, MQTTCommand_T * command) {
+	char * copy = malloc(length > 0UL ? length : 1UL);
+	memcpy(copy, line, length);
+	bool parsed = MQTTCommand_Parse(copy, length, command);
+	free(copy);
+	return parsed;
+}
+
+/**
+ * @brief Split a line with strtok as the callback did before, template at ",:", the other fields at ", "
+ */
+static void Reference(const char * line, uint32_t length, Expected_T * expected) {
+	char copy[TEST_LINE_SIZE + 1U];
+	uint32_t used = 0UL;
+
+	memset(expected, 0x00, sizeof(*expected));
+	expected->fits = true;
+	memcpy(copy, line, length);
+	copy[length] = '\0';
+
+	char * token = strtok(copy, ",:");
+	if (token != NULL && strspn(token, "0123456789") == strlen(token) && strlen(token) <= 5U
+			&& strtoul(token, NULL, 10) <= UINT16_MAX) {
+		expected->template = (uint16_t) strtoul(token, NULL, 10);
+	}
+	// device id
+	(void) strtok(NULL, ", ");
+	while (expected->count < MQTTCOMMAND_ARGS && (token = strtok(NULL, ", ")) != NULL) {
+		used += (uint32_t) strlen(token) + 1UL;
+		if (used > MQTTCOMMAND_TEXT_SIZE) {
+			expected->fits = false;
+			return;
+		}
+		strcpy(expected->args[expected->count++], token);
+	}
+}
+
+static bool Same(const MQTTCommand_T * command, const Expected_T * expected) {
+	if (command->template != expected->template || command->count != expected->count) {
+		return false;
+	}
+	for (uint8_t i = 0U; i < MQTTCOMMAND_ARGS; i++) {
+		if (strcmp(MQTTCommand_Arg(command, i), expected->args[i]) != 0) {
+			return false;
+		}
+	}
+	return MQTTCommand_Arg(command, MQTTCOMMAND_ARGS)[0] == '\0';
+}
+
+/**
+ * @brief Lines of a batch, with CRLF, empty lines and a last line without end
+ */
+static void TestLines(void) {
+	const char * batch = "511,XDK,speed 1000\r\n\n\r\n515,XDK,fw,1.0,http://host:80/a\n510,XDK\n999,XDK,hello world";
+	const char * const lines[] = { "511,XDK,speed 1000", "515,XDK,fw,1.0,http://host:80/a", "510,XDK",
+			"999,XDK,hello world" };
+	const char * cursor = batch;
+	const char * end = batch + strlen(batch);
+	MQTTCommand_Token_T line;
+	uint32_t count = 0UL;
+
+	while (MQTTCommand_NextLine(&cursor, end, &line)) {
+		HOSTTEST_CHECK(count < 4UL && line.length == strlen(lines[count])
+				&& strncmp(line.start, lines[count], line.length) == 0);
+		count++;
+	}
+	HOSTTEST_CHECK(count == 4UL && cursor == end);
+	HOSTTEST_CHECK(MQTTCommand_NextLine(&cursor, end, &line) == false);
+
+	// nothing but line ends
+	cursor = "\r\n\n\r\n";
+	HOSTTEST_CHECK(MQTTCommand_NextLine(&cursor, cursor + 5, &line) == false);
+}
+
+/**
+ * @brief Commands the device receives, and the limits of a record
+ */
+static void TestParse(void) {
+	MQTTCommand_T command;
+
+	HOSTTEST_CHECK(Parse("511,XDK,speed 1000", 18UL, &command));
+	HOSTTEST_CHECK(command.template == 511U && command.count == 2U);
+	HOSTTEST_CHECK(strcmp(MQTTCommand_Arg(&command, 0U), "speed") == 0 && strcmp(MQTTCommand_Arg(&command, 1U), "1000") == 0);
+	HOSTTEST_CHECK(strcmp(MQTTCommand_Arg(&command, 2U), "") == 0);
+
+	HOSTTEST_CHECK(Parse("515,XDK,fw,1.0,http://host:80/a", 31UL, &command));
+	HOSTTEST_CHECK(command.template == 515U && command.count == 3U);
+	HOSTTEST_CHECK(strcmp(MQTTCommand_Arg(&command, 2U), "http://host:80/a") == 0);
+
+	HOSTTEST_CHECK(Parse("510,XDK", 7UL, &command) && command.template == 510U && command.count == 0U);
+	HOSTTEST_CHECK(Parse("511:XDK,,config  STREAMRATE,5000", 32UL, &command) && command.template == 511U);
+	HOSTTEST_CHECK(command.count == 3U && strcmp(MQTTCommand_Arg(&command, 1U), "STREAMRATE") == 0);
+
+	// the ':' that ends the template is no field of its own
+	HOSTTEST_CHECK(Parse("511:,XDK,speed", 14UL, &command) && command.count == 1U);
+	HOSTTEST_CHECK(strcmp(MQTTCommand_Arg(&command, 0U), "speed") == 0);
+
+	// no template
+	HOSTTEST_CHECK(Parse("xx,1,2", 6UL, &command) && command.template == 0U && command.count == 1U);
+	HOSTTEST_CHECK(Parse("70000,X,a", 9UL, &command) && command.template == 0U);
+	HOSTTEST_CHECK(Parse("65536,X,a", 9UL, &command) && command.template == 0U);
+	HOSTTEST_CHECK(Parse("65539,X,a", 9UL, &command) && command.template == 0U);
+	HOSTTEST_CHECK(Parse("65535,X,a", 9UL, &command) && command.template == 65535U);
+	HOSTTEST_CHECK(Parse("", 0UL, &command) && command.template == 0U && command.count == 0U);
+
+	// fields behind the arguments are ignored
+	HOSTTEST_CHECK(Parse("511,X,a b c d", 13UL, &command) && command.count == 3U);
+	HOSTTEST_CHECK(strcmp(MQTTCommand_Arg(&command, 2U), "c") == 0 && strcmp(MQTTCommand_Arg(&command, 3U), "") == 0);
+
+	// arguments that fill the text exactly fit, one more byte does not
+	char line[TEST_LINE_SIZE];
+	memcpy(line, "511,X,", 6U);
+	memset(&line[6], 'a', MQTTCOMMAND_TEXT_SIZE - 1U);
+	HOSTTEST_CHECK(Parse(line, 6UL + MQTTCOMMAND_TEXT_SIZE - 1UL, &command) && command.count == 1U);
+	HOSTTEST_CHECK(command.length == MQTTCOMMAND_TEXT_SIZE);
+	HOSTTEST_CHECK(Parse(line, 6UL + MQTTCOMMAND_TEXT_SIZE, &command) == false);
+}
+
+/**
+ * @brief Random character of a command line, separators more often than in real payloads
+ */
+static char RandomChar(void) {
+	static const char characters[] = "5110,,  ::XDKab\r";
+	return characters[(uint32_t) rand() % (sizeof(characters) - 1U)];
+}
+
+/**
+ * @brief Random batches split into lines and parsed, against strtok
+ */
+static void TestRandom(void) {
+	static char batch[TEST_PAYLOAD_SIZE];
+	uint32_t wrong = 0UL;
+	uint32_t lines = 0UL;
+	uint32_t tooLong = 0UL;
+
+	for (uint32_t run = 0UL; run < TEST_RANDOM / 10UL; run++) {
+		uint32_t length = 0UL;
+		uint32_t count = 1UL + (uint32_t) rand() % 10UL;
+		for (uint32_t n = 0UL; n < count; n++) {
+			uint32_t lineLength = (uint32_t) rand() % 40UL;
+			for (uint32_t i = 0UL; i < lineLength; i++) {
+				char c = RandomChar();
+				// a '\r' only at the end of a line
+				batch[length++] = (c == '\r') ? 'b' : c;
+			}
+			// a few arguments around the size of a record
+			if ((uint32_t) rand() % 50UL == 0UL) {
+				uint32_t argLength = 230UL + (uint32_t) rand() % 40UL;
+				batch[length++] = ',';
+				memset(&batch[length], 'a', argLength);
+				length += argLength;
+			}
+			if ((uint32_t) rand() % 2UL == 0UL) {
+				batch[length++] = '\r';
+			}
+			batch[length++] = '\n';
+		}
+		// the last line may end without '\n'
+		if ((uint32_t) rand() % 2UL == 0UL) {
+			length--;
+		}
+
+		// the lines found by hand
+		uint32_t offsets[TEST_PAYLOAD_SIZE / 2U];
+		uint32_t lengths[TEST_PAYLOAD_SIZE / 2U];
+		uint32_t expectedLines = 0UL;
+		for (uint32_t start = 0UL; start < length;) {
+			uint32_t end = start;
+			while (end < length && batch[end] != '\n') {
+				end++;
+			}
+			uint32_t lineLength = end - start;
+			if (lineLength > 0UL && batch[end - 1UL] == '\r') {
+				lineLength--;
+			}
+			if (lineLength > 0UL) {
+				offsets[expectedLines] = start;
+				lengths[expectedLines++] = lineLength;
+			}
+			start = end + 1UL;
+		}
+
+		char * payload = malloc(length);
+		memcpy(payload, batch, length);
+		const char * cursor = payload;
+		MQTTCommand_Token_T line;
+		uint32_t found = 0UL;
+		while (MQTTCommand_NextLine(&cursor, payload + length, &line)) {
+			if (found >= expectedLines || line.length != lengths[found]
+					|| (uint32_t) (line.start - payload) != offsets[found]) {
+				wrong++;
+				break;
+			}
+			found++;
+
+			MQTTCommand_T command;
+			Expected_T expected;
+			bool parsed = MQTTCommand_Parse(line.start, line.length, &command);
+			Reference(line.start, line.length, &expected);
+			if (parsed != expected.fits || (parsed && !Same(&command, &expected))) {
+				wrong++;
+			}
+			tooLong += parsed ? 0UL : 1UL;
+			lines++;
+		}
+		wrong += (found != expectedLines) ? 1UL : 0UL;
+		free(payload);
+	}
+	HOSTTEST_CHECK(wrong == 0UL);
+	HOSTTEST_CHECK(tooLong > 0UL);
+	printf("command: %lu random lines, %lu too long\n", (unsigned long) lines, (unsigned long) tooLong);
+}
+
+/**
+ * @brief Bytes a record takes in the queue, the text used rounded up to 4 bytes
+ */
+static uint32_t RecordSize(const MQTTCommand_T * command) {
+	return ((uint32_t) offsetof(MQTTCommand_T, text) + command->length + 3UL) & ~3UL;
+}
+
+static bool SameRecord(const MQTTCommand_T * record, const MQTTCommand_T * command) {
+	return record->template == command->template && record->count == command->count
+			&& record->length == command->length
+			&& memcmp(record->offsets, command->offsets, sizeof(command->offsets)) == 0
+			&& memcmp(record->text, command->text, command->length) == 0;
+}
+
+/**
+ * @brief Random command with arguments from a few bytes up to a full record
+ */
+static bool RandomCommand(MQTTCommand_T * command, uint32_t serial) {
+	char line[TEST_LINE_SIZE];
+	uint32_t length = (uint32_t) sprintf(line, "511,XDK,%lu", (unsigned long) serial);
+	uint32_t text = ((uint32_t) rand() % 8UL == 0UL) ? (uint32_t) rand() % 240UL : (uint32_t) rand() % 40UL;
+
+	for (uint32_t i = 0UL; i < text; i++) {
+		line[length++] = (i % 20UL == 0UL) ? ' ' : (char) ('a' + (char) (i % 26UL));
+	}
+	return MQTTCommand_Parse(line, length, command);
+}
+
+/**
+ * @brief Fixed cases: empty queue, depth, size rounding and a record that fills the storage
+ */
+static void TestQueue(void) {
+	static uint32_t storage[TEST_QUEUE_STORAGE / sizeof(uint32_t)];
+	MQTTCommand_Queue_T queue;
+	MQTTCommand_T command;
+
+	MQTTCommand_QueueInit(&queue, storage, 1023UL, 0U);
+	HOSTTEST_CHECK(queue.size == 1020UL && queue.depth == 1U);
+	HOSTTEST_CHECK(MQTTCommand_QueuePeek(&queue) == NULL);
+	MQTTCommand_QueueDiscard(&queue);
+	HOSTTEST_CHECK(queue.count == 0U);
+
+	HOSTTEST_CHECK(Parse("511,XDK,speed 1000", 18UL, &command));
+	HOSTTEST_CHECK(MQTTCommand_QueuePush(&queue, &command));
+	HOSTTEST_CHECK(MQTTCommand_QueuePush(&queue, &command) == false && queue.rejected == 1UL);
+	MQTTCommand_QueueSetDepth(&queue, 3U);
+	HOSTTEST_CHECK(MQTTCommand_QueuePush(&queue, &command) && queue.count == 2U && queue.highWater == 2U);
+	// a lower depth keeps the records
+	MQTTCommand_QueueSetDepth(&queue, 1U);
+	HOSTTEST_CHECK(queue.count == 2U && MQTTCommand_QueuePush(&queue, &command) == false);
+	MQTTCommand_QueueDiscard(&queue);
+	HOSTTEST_CHECK(MQTTCommand_QueuePush(&queue, &command) == false);
+	MQTTCommand_QueueDiscard(&queue);
+	HOSTTEST_CHECK(queue.count == 0U && MQTTCommand_QueuePush(&queue, &command));
+	HOSTTEST_CHECK(SameRecord(MQTTCommand_QueuePeek(&queue), &command));
+	HOSTTEST_CHECK(strcmp(MQTTCommand_Arg(MQTTCommand_QueuePeek(&queue), 1U), "1000") == 0);
+
+	// a record is shorter than MQTTCommand_T, a full one fits into storage of its size
+	MQTTCommand_QueueInit(&queue, storage, RecordSize(&command), 4U);
+	HOSTTEST_CHECK(RecordSize(&command) < sizeof(MQTTCommand_T));
+	HOSTTEST_CHECK(MQTTCommand_QueuePush(&queue, &command));
+	HOSTTEST_CHECK(MQTTCommand_QueuePush(&queue, &command) == false);
+	char line[TEST_LINE_SIZE];
+	memcpy(line, "511,X,", 6U);
+	memset(&line[6], 'a', MQTTCOMMAND_TEXT_SIZE - 1U);
+	HOSTTEST_CHECK(Parse(line, 6UL + MQTTCOMMAND_TEXT_SIZE - 1UL, &command));
+	MQTTCommand_QueueInit(&queue, storage, RecordSize(&command), 4U);
+	HOSTTEST_CHECK(MQTTCommand_QueuePush(&queue, &command) && SameRecord(MQTTCommand_QueuePeek(&queue), &command));
+}
+
+/**
+ * @brief Random pushes, discards and depth changes against a FIFO of the pushed commands
+ *
+ * The records of the model are compared field by field. A push may only
+ * fail for space if the storage is nearly full: the free bytes are split
+ * at most by the gap in front of the wrap, which is below the largest
+ * record.
+ */
+static void TestQueueModel(uint32_t size, uint8_t depth) {
+	static uint32_t words[TEST_QUEUE_GUARD + TEST_QUEUE_STORAGE / sizeof(uint32_t) + TEST_QUEUE_GUARD];
+	static MQTTCommand_T model[UINT8_MAX];
+	uint32_t * storage = &words[TEST_QUEUE_GUARD];
+	const uint32_t largest = ((uint32_t) offsetof(MQTTCommand_T, text) + MQTTCOMMAND_TEXT_SIZE + 3UL) & ~3UL;
+	uint32_t modelHead = 0UL;
+	uint32_t modelTail = 0UL;
+	uint32_t used = 0UL;
+	uint32_t rejected = 0UL;
+	uint32_t pushed = 0UL;
+	uint8_t highWater = 0U;
+	uint8_t limit = depth;
+	uint32_t wrong = 0UL;
+	MQTTCommand_Queue_T queue;
+
+	for (uint32_t i = 0UL; i < sizeof(words) / sizeof(words[0]); i++) {
+		words[i] = TEST_GUARD_WORD;
+	}
+	MQTTCommand_QueueInit(&queue, storage, size, depth);
+	for (uint32_t operation = 0UL; operation < TEST_QUEUE_OPERATIONS; operation++) {
+		uint32_t count = modelHead - modelTail;
+		uint32_t choice = (uint32_t) rand() % 100UL;
+
+		if (choice < 52UL) {
+			MQTTCommand_T command;
+			wrong += RandomCommand(&command, operation) ? 0UL : 1UL;
+			const MQTTCommand_T * oldest = MQTTCommand_QueuePeek(&queue);
+			if (MQTTCommand_QueuePush(&queue, &command)) {
+				model[modelHead++ % UINT8_MAX] = command;
+				used += RecordSize(&command);
+				pushed++;
+				// a record returned by peek stays where it is
+				wrong += (oldest != NULL && oldest != MQTTCommand_QueuePeek(&queue)) ? 1UL : 0UL;
+			} else {
+				rejected++;
+				wrong += (count < limit && used + RecordSize(&command) + largest <= queue.size) ? 1UL : 0UL;
+			}
+		} else if (choice < 99UL) {
+			const MQTTCommand_T * record = MQTTCommand_QueuePeek(&queue);
+			if ((record == NULL) != (count == 0UL)) {
+				wrong++;
+			} else if (record != NULL) {
+				const MQTTCommand_T * expected = &model[modelTail++ % UINT8_MAX];
+				wrong += (SameRecord(record, expected) && ((uintptr_t) record & 3U) == 0U) ? 0UL : 1UL;
+				used -= RecordSize(expected);
+				MQTTCommand_QueueDiscard(&queue);
+			}
+		} else {
+			limit = (uint8_t) (1U + (uint32_t) rand() % depth);
+			MQTTCommand_QueueSetDepth(&queue, limit);
+		}
+		count = modelHead - modelTail;
+		highWater = (count > highWater) ? (uint8_t) count : highWater;
+		if (queue.count != count || queue.rejected != rejected || queue.highWater != highWater) {
+			wrong++;
+		}
+	}
+	for (uint32_t i = 0UL; i < TEST_QUEUE_GUARD; i++) {
+		HOSTTEST_CHECK(words[i] == TEST_GUARD_WORD && words[TEST_QUEUE_GUARD + size / sizeof(uint32_t) + i] == TEST_GUARD_WORD);
+	}
+	HOSTTEST_CHECK(wrong == 0UL);
+	HOSTTEST_CHECK(pushed > 0UL && rejected > 0UL);
+	printf("queue %lu bytes, depth %u: %lu pushed, %lu rejected, high water %u\n", (unsigned long) size,
+			(unsigned) depth, (unsigned long) pushed, (unsigned long) rejected, (unsigned) highWater);
+}
+
+/**
+ * @brief Value of a TEMPLATE_ID_ define of MQTTOperation.h
+ */
+static uint16_t TemplateId(const char * id) {
+	char line[256];
+	char defined[TEST_NAME_SIZE];
+	unsigned value;
+	uint16_t template = 0U;
+
+	FILE * file = fopen(HOSTTEST_SOURCE "/MQTTOperation.h", "r");
+	HOSTTEST_CHECK(file != NULL);
+	while (file != NULL && fgets(line, sizeof(line), file) != NULL) {
+		if (sscanf(line, "#define %63s %uU", defined, &value) == 2 && strcmp(defined, id) == 0) {
+			template = (uint16_t) value;
+		}
+	}
+	if (file != NULL) {
+		fclose(file);
+	}
+	return template;
+}
+
+/**
+ * @brief Read the command entries and the command table from MQTTOperation.c, it needs the SDK to build
+ */
+static void ReadTable(void) {
+	char line[256];
+	char variable[TEST_NAME_SIZE];
+	char id[TEST_NAME_SIZE];
+	unsigned slot;
+	bool inTable = false;
+
+	FILE * file = fopen(HOSTTEST_SOURCE "/MQTTOperation.c", "r");
+	HOSTTEST_CHECK(file != NULL);
+	while (file != NULL && fgets(line, sizeof(line), file) != NULL) {
+		const char * quote = strchr(line, '"');
+		if (sscanf(line, "static const CommandEntry_T %63s = { %63[A-Z_],", variable, id) == 2 && quote != NULL
+				&& entryCount < MQTTCOMMAND_SLOTS) {
+			Entry_T * entry = &entries[entryCount++];
+			strcpy(entry->variable, variable);
+			entry->template = TemplateId(id);
+			HOSTTEST_CHECK(entry->template != 0U);
+			(void) sscanf(quote + 1, "%63[^\"]", entry->name);
+		} else if (strstr(line, "commandTable[MQTTCOMMAND_SLOTS] = {") != NULL) {
+			inTable = true;
+		} else if (inTable && strstr(line, "};") != NULL) {
+			inTable = false;
+		} else if (inTable && sscanf(line, " [%u] = &%63[A-Za-z],", &slot, variable) == 2) {
+			HOSTTEST_CHECK(slot < MQTTCOMMAND_SLOTS && table[slot] == NULL);
+			for (uint32_t i = 0UL; i < entryCount && slot < MQTTCOMMAND_SLOTS; i++) {
+				if (strcmp(entries[i].variable, variable) == 0) {
+					table[slot] = &entries[i];
+				}
+			}
+			HOSTTEST_CHECK(slot < MQTTCOMMAND_SLOTS && table[slot] != NULL);
+		}
+	}
+	if (file != NULL) {
+		fclose(file);
+	}
+}
+
+/**
+ * @brief Entry of a received command, NULL if the command is not in the table
+ */
+static const Entry_T * Lookup(const MQTTCommand_T * command) {
+	// only TEMPLATE_ID_COMMAND has sub commands, MQTTOperation.h needs the SDK
+	const char * name = (command->template == 511U) ? MQTTCommand_Arg(command, 0U) : "";
+	const Entry_T * entry = table[MQTTCommand_Slot(command->template, name)];
+
+	return (entry != NULL && entry->template == command->template && strcmp(entry->name, name) == 0) ? entry : NULL;
+}
+
+/**
+ * @brief Every command of MQTTOperation.c sits in the slot of its hash, so it is found
+ */
+static void TestTable(void) {
+	uint32_t used = 0UL;
+
+	ReadTable();
+	HOSTTEST_CHECK(entryCount >= 17UL);
+	for (uint8_t slot = 0U; slot < MQTTCOMMAND_SLOTS; slot++) {
+		if (table[slot] != NULL) {
+			used++;
+			HOSTTEST_CHECK(MQTTCommand_Slot(table[slot]->template, table[slot]->name) == slot);
+		}
+	}
+	// each entry is in the table once
+	HOSTTEST_CHECK(used == entryCount);
+
+	MQTTCommand_T command;
+	HOSTTEST_CHECK(Parse("511,XDK,speed 1000", 18UL, &command) && Lookup(&command) != NULL
+			&& strcmp(Lookup(&command)->name, "speed") == 0);
+	HOSTTEST_CHECK(Parse("510,XDK", 7UL, &command) && Lookup(&command) != NULL && Lookup(&command)->template == 510U);
+	HOSTTEST_CHECK(Parse("511,XDK,unknown", 15UL, &command) && Lookup(&command) == NULL);
+	HOSTTEST_CHECK(Parse("512,XDK,speed", 13UL, &command) && Lookup(&command) == NULL);
+}
+
+/**
+ * @brief Split and dispatch a batch as the callback did before: copy, strtok and a strcmp cascade
+ */
+static uint32_t DispatchBefore(const char * payload, uint32_t length) {
+	static char buffer[TEST_PAYLOAD_SIZE];
+	char * lineRest;
+	uint32_t found = 0UL;
+
+	memcpy(buffer, payload, length);
+	buffer[length] = '\0';
+	for (char * line = strtok_r(buffer, "\r\n", &lineRest); line != NULL; line = strtok_r(NULL, "\r\n", &lineRest)) {
+		char * fieldRest;
+		char * template = strtok_r(line, ",:", &fieldRest);
+		(void) strtok_r(NULL, ", ", &fieldRest);
+		char * name = strtok_r(NULL, ", ", &fieldRest);
+		char * args[2];
+		args[0] = strtok_r(NULL, ", ", &fieldRest);
+		args[1] = (args[0] != NULL) ? strtok_r(NULL, ", ", &fieldRest) : NULL;
+		HOSTTEST_KEEP(args[1]);
+		if (template == NULL) {
+			continue;
+		}
+		uint16_t id = (uint16_t) atoi(template);
+		for (uint32_t i = 0UL; i < entryCount; i++) {
+			const char * entryName = (entries[i].name[0] != '\0') ? entries[i].name : NULL;
+			if (id == entries[i].template
+					&& ((entryName == NULL && id != 511U) || (entryName != NULL && name != NULL && strcmp(entryName, name) == 0))) {
+				found++;
+				break;
+			}
+		}
+	}
+	return found;
+}
+
+/**
+ * @brief Split, parse and dispatch a batch in place through the command table
+ */
+static uint32_t DispatchNow(const char * payload, uint32_t length) {
+	static MQTTCommand_T command;
+	const char * cursor = payload;
+	MQTTCommand_Token_T line;
+	uint32_t found = 0UL;
+
+	while (MQTTCommand_NextLine(&cursor, payload + length, &line)) {
+		if (MQTTCommand_Parse(line.start, line.length, &command) && Lookup(&command) != NULL) {
+			found++;
+		}
+	}
+	return found;
+}
+
+/**
+ * @brief Cycles per command of mixed batches, against copying, strtok and a strcmp cascade
+ */
+static void BenchParse(void) {
+	static char payload[TEST_PAYLOAD_SIZE];
+	const uint32_t lines = (uint32_t) (sizeof(mixedStream) / sizeof(mixedStream[0]));
+	uint32_t length = 0UL;
+	uint32_t found = 0UL;
+
+	for (uint32_t i = 0UL; i < lines; i++) {
+		length += (uint32_t) sprintf(&payload[length], "%s\r\n", mixedStream[i]);
+	}
+	HOSTTEST_CHECK(DispatchNow(payload, length) == DispatchBefore(payload, length));
+	HOSTTEST_CHECK(DispatchNow(payload, length) == lines - 1UL);
+
+	uint64_t start = HostTest_Cycles();
+	for (uint32_t round = 0UL; round < BENCH_ROUNDS; round++) {
+		found += DispatchNow(payload, length);
+	}
+	uint64_t now = HostTest_Cycles() - start;
+
+	start = HostTest_Cycles();
+	for (uint32_t round = 0UL; round < BENCH_ROUNDS; round++) {
+		found += DispatchBefore(payload, length);
+	}
+	uint64_t before = HostTest_Cycles() - start;
+	HOSTTEST_KEEP(found);
+
+	printf("bench command: %.1f cycles per command, strtok and strcmp cascade %.1f cycles, %lu bytes per batch\n",
+			(double) now / ((double) BENCH_ROUNDS * lines), (double) before / ((double) BENCH_ROUNDS * lines),
+			(unsigned long) length);
+}
+
+/* global functions ********************************************************* */
+
+int main(int argc, char ** argv) {
+	srand(9U);
+	TestLines();
+	TestParse();
+	TestRandom();
+	TestTable();
+	TestQueue();
+	TestQueueModel(TEST_QUEUE_STORAGE, TEST_QUEUE_DEPTH);
+	TestQueueModel(512UL, 8U);
+	TestQueueModel(TEST_QUEUE_STORAGE, UINT8_C(200));
+	if (HostTest_Bench(argc, argv)) {
+		BenchParse();
+	}
+	return HostTest_Result("test_command");
+}
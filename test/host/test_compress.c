@@ -0,0 +1,242 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	test_compress.c
+ **
+ **	DESCRIPTION:	Host test and benchmark of the LZ77 payload compression in MQTTCompress
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* system header files */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/* own header files */
+#include "HostTest.h"
+#include "MQTTBuffer.h"
+#include "MQTTBinary.h"
+#include "MQTTCompress.h"
+
+/* constant definitions ***************************************************** */
+
+#define TEST_PAYLOAD_SIZE	UINT32_C(860)		/**< SIZE_PACKET_BUF of the firmware */
+#define TEST_LARGE_SIZE		UINT32_C(4096)		/**< Beyond the window of MQTTCOMPRESS_WINDOW */
+#define BENCH_ROUNDS		UINT32_C(20000)
+
+#ifndef HOSTTEST_DATA
+#define HOSTTEST_DATA		"."					/**< Directory for the payloads checked by check_decode.py */
+#endif
+
+/* local variables ********************************************************** */
+
+/**
+ * @brief Payloads as the firmware publishes them
+ */
+typedef enum {
+	PAYLOAD_ACCEL, /**< batched accelerometer measurements in SmartREST with their time */
+	PAYLOAD_ENVIRONMENT, /**< batched environment measurements in SmartREST */
+	PAYLOAD_INVENTORY, /**< inventory update of all sensors */
+	PAYLOAD_EVENT, /**< a single short event, not worth compressing */
+	PAYLOAD_BINARY, /**< binary accelerometer records */
+	PAYLOAD_RANDOM, /**< random bytes, must stay unchanged */
+	PAYLOAD_COUNT
+} Payload_T;
+
+static const char * const payloadNames[PAYLOAD_COUNT] = { "accel", "environment", "inventory", "event", "binary", "random" };
+
+static char data[TEST_LARGE_SIZE];
+static char scratchData[TEST_LARGE_SIZE];
+static char original[TEST_LARGE_SIZE];
+
+/* local functions ********************************************************** */
+
+/**
+ * @brief Write the content of one payload into original
+ *
+ * @return length of the payload
+ */
+static uint32_t Generate(Payload_T kind) {
+	static const char * const inventory[] = { "1991", "1992", "1993", "1994", "1995", "1996" };
+	uint32_t length = 0UL;
+
+	switch (kind) {
+	case PAYLOAD_ACCEL:
+		for (uint32_t n = 0UL; length < 800UL; n++) {
+			length += (uint32_t) snprintf(original + length, TEST_PAYLOAD_SIZE - length,
+					"991,2019-05-01T12:00:%02lu.%03luZ,0.%03d,-0.%03d,0.%03d\r\n", (unsigned long) (n / 10UL),
+					(unsigned long) (n % 10UL * 100UL), rand() % 50, 970 + rand() % 20, rand() % 50);
+		}
+		break;
+	case PAYLOAD_ENVIRONMENT:
+		for (uint32_t n = 0UL; length < 800UL; n++) {
+			length += (uint32_t) snprintf(original + length, TEST_PAYLOAD_SIZE - length,
+					"997,2019-05-01T12:%02lu:00.000Z,1013.%02d\r\n996,2019-05-01T12:%02lu:00.000Z,23.%02d\r\n",
+					(unsigned long) n, rand() % 100, (unsigned long) n, rand() % 100);
+		}
+		break;
+	case PAYLOAD_INVENTORY:
+		for (uint32_t n = 0UL; n < 6UL; n++) {
+			length += (uint32_t) snprintf(original + length, TEST_PAYLOAD_SIZE - length,
+					"%s,XDK-9C8E99F01234,%d.%03d,%d.%03d,%d.%03d\r\n", inventory[n], rand() % 2, rand() % 1000,
+					rand() % 2, rand() % 1000, rand() % 2, rand() % 1000);
+		}
+		break;
+	case PAYLOAD_EVENT:
+		length = (uint32_t) snprintf(original, TEST_PAYLOAD_SIZE, "400,xdk_SamplingJitter,count,120,max,3,overrun,0\r\n");
+		break;
+	case PAYLOAD_BINARY: {
+		MQTTBuffer_Payload_T binary = { 0UL, TEST_PAYLOAD_SIZE, original };
+		int32_t values[3] = { 10L, -980L, 25L };
+		(void) MQTTBinary_Header(&binary, UINT64_C(1700000000000));
+		do {
+			for (uint8_t axis = 0U; axis < 3U; axis++) {
+				values[axis] += rand() % 7 - 3;
+			}
+		} while (MQTTBinary_Values(&binary, 1U, 100UL, values, 3U, 3U));
+		length = binary.length;
+		break;
+	}
+	default:
+		for (length = 0UL; length < TEST_PAYLOAD_SIZE; length++) {
+			original[length] = (char) rand();
+		}
+		// never starts like a compressed payload
+		original[0] = 'x';
+		break;
+	}
+	return length;
+}
+
+static void Save(const char * name, const char * suffix, const char * content, uint32_t length) {
+	char path[256];
+
+	snprintf(path, sizeof(path), "%s/compress_%s.%s", HOSTTEST_DATA, name, suffix);
+	FILE * file = fopen(path, "wb");
+	HOSTTEST_CHECK(file != NULL);
+	if (file != NULL) {
+		fwrite(content, 1U, length, file);
+		fclose(file);
+	}
+}
+
+/**
+ * @brief Compress a copy of original, the result is in data
+ *
+ * @return length of the payload after compression
+ */
+static uint32_t Compress(uint32_t length, uint32_t size, bool * compressed) {
+	MQTTBuffer_Payload_T payload = { length, size, data };
+	MQTTBuffer_Payload_T scratch = { 0UL, size, scratchData };
+
+	memcpy(data, original, length);
+	*compressed = MQTTCompress_Payload(&payload, &scratch);
+	return payload.length;
+}
+
+/**
+ * @brief Compress every kind of payload and save it for the round trip through xdk_decode.py
+ */
+static void TestPayloads(void) {
+	for (Payload_T kind = PAYLOAD_ACCEL; kind < PAYLOAD_COUNT; kind++) {
+		bool compressed;
+		uint32_t length = Generate(kind);
+		uint32_t result = Compress(length, TEST_PAYLOAD_SIZE, &compressed);
+
+		if (compressed) {
+			HOSTTEST_CHECK(result < length && (uint8_t) data[0] == MQTTCOMPRESS_MAGIC);
+		} else {
+			HOSTTEST_CHECK(result == length && memcmp(data, original, length) == 0);
+		}
+		HOSTTEST_CHECK(kind != PAYLOAD_RANDOM || compressed == false);
+		HOSTTEST_CHECK(kind != PAYLOAD_EVENT || compressed == false);
+		HOSTTEST_CHECK(kind == PAYLOAD_RANDOM || kind == PAYLOAD_EVENT || compressed);
+
+		Save(payloadNames[kind], "in", original, length);
+		Save(payloadNames[kind], "z", data, result);
+		printf("compress %s: %lu -> %lu bytes, %.1f%%\n", payloadNames[kind], (unsigned long) length,
+				(unsigned long) result, 100.0 * result / length);
+	}
+}
+
+/**
+ * @brief Long runs, overlapping matches and repeats at the edge of the window
+ */
+static void TestEdges(void) {
+	bool compressed;
+
+	// a run is one literal and overlapping matches of the longest length
+	memset(original, 'a', 1000U);
+	uint32_t result = Compress(1000UL, TEST_LARGE_SIZE, &compressed);
+	HOSTTEST_CHECK(compressed && result < 100UL);
+	Save("run", "in", original, 1000UL);
+	Save("run", "z", data, result);
+
+	// a random block, a run and the block again at distances around the window size
+	const uint32_t distances[] = { MQTTCOMPRESS_WINDOW - 1UL, MQTTCOMPRESS_WINDOW, MQTTCOMPRESS_WINDOW + 1UL };
+	uint32_t results[3];
+	for (uint32_t d = 0UL; d < sizeof(distances) / sizeof(distances[0]); d++) {
+		char name[32];
+		uint32_t length = distances[d] + 200UL;
+		for (uint32_t n = 0UL; n < 200UL; n++) {
+			original[n] = (char) rand();
+		}
+		original[0] = 'x';
+		memset(original + 200U, 'a', distances[d] - 200UL);
+		memcpy(original + distances[d], original, 200U);
+		results[d] = Compress(length, TEST_LARGE_SIZE, &compressed);
+		HOSTTEST_CHECK(compressed);
+		snprintf(name, sizeof(name), "window%lu", (unsigned long) distances[d]);
+		Save(name, "in", original, length);
+		Save(name, "z", data, results[d]);
+	}
+	// the block is only found again within the window
+	HOSTTEST_CHECK(results[1] < results[0] + 10UL);
+	HOSTTEST_CHECK(results[2] > results[1] + 150UL);
+
+	// a compressed payload is not compressed again, an empty one stays empty
+	memset(original, 'b', 100U);
+	result = Compress(100UL, TEST_PAYLOAD_SIZE, &compressed);
+	memcpy(original, data, result);
+	HOSTTEST_CHECK(Compress(result, TEST_PAYLOAD_SIZE, &compressed) == result && compressed == false);
+	HOSTTEST_CHECK(Compress(0UL, TEST_PAYLOAD_SIZE, &compressed) == 0UL && compressed == false);
+}
+
+/**
+ * @brief Bytes saved against the cycles spent per payload
+ */
+static void BenchCompress(void) {
+	for (Payload_T kind = PAYLOAD_ACCEL; kind < PAYLOAD_COUNT; kind++) {
+		bool compressed;
+		uint32_t length = Generate(kind);
+		uint32_t result = 0UL;
+
+		uint64_t start = HostTest_Cycles();
+		for (uint32_t round = 0UL; round < BENCH_ROUNDS; round++) {
+			result = Compress(length, TEST_PAYLOAD_SIZE, &compressed);
+			HOSTTEST_KEEP(data[0]);
+		}
+		double cycles = (double) (HostTest_Cycles() - start) / BENCH_ROUNDS;
+		printf("bench compress %s: %lu bytes saved, %.0f cycles per payload, %.1f cycles per byte\n",
+				payloadNames[kind], (unsigned long) (length - result), cycles, cycles / length);
+	}
+}
+
+/* global functions ********************************************************* */
+
+int main(int argc, char ** argv) {
+	srand(6U);
+	TestPayloads();
+	TestEdges();
+	if (HostTest_Bench(argc, argv)) {
+		BenchCompress();
+	}
+	return HostTest_Result("test_compress");
+}
@@ -0,0 +1,290 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	test_format.c
+ **
+ **	DESCRIPTION:	Host test and benchmark of MQTTFormat against the former snprintf("%.3lf") lines
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* system header files */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <limits.h>
+
+/* own header files */
+#include "HostTest.h"
+#include "MQTTBuffer.h"
+#include "MQTTFormat.h"
+
+/* constant definitions ***************************************************** */
+
+#define TEST_TEXT_SIZE		UINT32_C(64)		/**< Enough for one value or one sensor line */
+#define TEST_RANDOM			UINT32_C(1000000)	/**< Random values per check */
+#define BENCH_LINES			UINT32_C(1000000)	/**< Lines per benchmark */
+
+/* local variables ********************************************************** */
+
+static char data[TEST_TEXT_SIZE];
+static MQTTBuffer_Payload_T payload = { 0UL, TEST_TEXT_SIZE, data };
+
+/**
+ * @brief How the new output differs from the old one
+ */
+typedef struct {
+	uint32_t values; /**< values compared */
+	uint32_t negativeZero; /**< old "-0.00", new "0.00" */
+	uint32_t ties; /**< exact decimal ties, the old output rounded the nearest double */
+} Difference_T;
+
+/* local functions ********************************************************** */
+
+/**
+ * @brief Text of a single fixed point value written by MQTTFormat
+ */
+static const char * NewFixed(int32_t value, uint8_t decimals) {
+	MQTTFormat_Line_T line;
+
+	payload.length = 0UL;
+	MQTTFormat_BeginLine(&line, &payload);
+	MQTTFormat_Fixed(&line, value, decimals);
+	data[payload.length] = '\0';
+	return data;
+}
+
+/**
+ * @brief Compare one value with the old output, only known and counted differences are accepted
+ *
+ * @param[in] old text written by snprintf
+ * @param[in] value value scaled by 10^decimals, as computed by the firmware
+ * @param[in] tie the exact value lies halfway between two decimals
+ */
+static void Compare(Difference_T * difference, const char * old, int32_t value, uint8_t decimals, bool tie) {
+	const char * written = NewFixed(value, decimals);
+
+	difference->values++;
+	if (strcmp(old, written) == 0) {
+		return;
+	}
+	if (old[0] == '-' && value == 0L && strcmp(old + 1, written) == 0) {
+		difference->negativeZero++;
+		return;
+	}
+	// a tie is rounded away from zero, printf got the double just below or above it
+	char * end;
+	double delta = strtod(old, &end) * (double) (decimals == 3U ? 1000 : 100) - (double) value;
+	if (tie && (delta > -1.5 && delta < 1.5)) {
+		difference->ties++;
+		return;
+	}
+	HOSTTEST_CHECK(strcmp(old, written) == 0);
+	fprintf(stderr, "old %s new %s\n", old, written);
+}
+
+static void Report(const char * name, const Difference_T * difference) {
+	printf("%s: %lu values, %lu negative zero, %lu ties rounded differently\n", name,
+			(unsigned long) difference->values, (unsigned long) difference->negativeZero,
+			(unsigned long) difference->ties);
+}
+
+/**
+ * @brief Accelerometer in mg, formerly "%.3lf" of mg / 1000.0, over the whole BMA280 range
+ */
+static void TestAccel(void) {
+	Difference_T difference = { 0UL, 0UL, 0UL };
+	char old[TEST_TEXT_SIZE];
+
+	for (int32_t mg = -16000L; mg <= 16000L; mg++) {
+		snprintf(old, sizeof(old), "%.3lf", mg / 1000.0);
+		Compare(&difference, old, mg, 3U, false);
+	}
+	HOSTTEST_CHECK(difference.negativeZero == 0UL && difference.ties == 0UL);
+	Report("accel", &difference);
+}
+
+/**
+ * @brief Light in mlux, formerly "%.2lf" of mlux / 1000.0, now rounded to 10 mlux
+ */
+static void TestLight(void) {
+	Difference_T difference = { 0UL, 0UL, 0UL };
+	char old[TEST_TEXT_SIZE];
+
+	for (int32_t mlux = 0L; mlux <= 2000000L; mlux++) {
+		snprintf(old, sizeof(old), "%.2lf", mlux / 1000.0);
+		Compare(&difference, old, MQTTFormat_RoundDiv(mlux, 10L), 2U, (mlux % 10L) == 5L);
+	}
+	// up to the 188000 lux of the MAX44009
+	srand(1U);
+	for (uint32_t n = 0UL; n < TEST_RANDOM; n++) {
+		int32_t mlux = (int32_t) (((uint32_t) rand() * 65536UL + (uint32_t) rand()) % 188000001UL);
+		snprintf(old, sizeof(old), "%.2lf", mlux / 1000.0);
+		Compare(&difference, old, MQTTFormat_RoundDiv(mlux, 10L), 2U, (mlux % 10L) == 5L);
+	}
+	HOSTTEST_CHECK(difference.negativeZero == 0UL);
+	Report("light", &difference);
+}
+
+/**
+ * @brief Temperature, formerly "%.2lf" of Temp / 972.3, including negative values
+ *
+ * 2000 * Temp is even and 9723 is odd, so Temp * 1000 / 9723 never is a tie.
+ */
+static void TestTemp(void) {
+	Difference_T difference = { 0UL, 0UL, 0UL };
+	char old[TEST_TEXT_SIZE];
+
+	for (int32_t temp = -100000L; temp <= 200000L; temp++) {
+		snprintf(old, sizeof(old), "%.2lf", temp / 972.3);
+		Compare(&difference, old, MQTTFormat_RoundDiv(temp * 1000L, 9723L), 2U, false);
+	}
+	HOSTTEST_CHECK(difference.ties == 0UL);
+	// only -0.004 .. -0.001 were printed as "-0.00"
+	HOSTTEST_CHECK(difference.negativeZero == 4UL);
+	Report("temp", &difference);
+}
+
+/**
+ * @brief Pressure in Pa, formerly "%.2lf" of Pa / 100.0, over the BME280 range
+ */
+static void TestPressure(void) {
+	Difference_T difference = { 0UL, 0UL, 0UL };
+	char old[TEST_TEXT_SIZE];
+
+	for (int32_t pa = 0L; pa <= 200000L; pa++) {
+		snprintf(old, sizeof(old), "%.2lf", pa / 100.0);
+		Compare(&difference, old, pa, 2U, false);
+	}
+	HOSTTEST_CHECK(difference.negativeZero == 0UL && difference.ties == 0UL);
+	Report("pressure", &difference);
+}
+
+/**
+ * @brief Fixed point output for any int32 and all decimals against an integer reference
+ */
+static void TestFixedRange(void) {
+	const int32_t edges[] = { 0L, 1L, -1L, 9L, -10L, 999999L, -1000000L, INT32_MAX, INT32_MIN };
+	char expected[TEST_TEXT_SIZE];
+
+	srand(2U);
+	for (uint32_t n = 0UL; n < TEST_RANDOM; n++) {
+		int32_t value = (n < sizeof(edges) / sizeof(edges[0])) ? edges[n]
+				: (int32_t) ((uint32_t) rand() * 65536UL + (uint32_t) rand());
+		uint8_t decimals = (uint8_t) (n % (MQTTFORMAT_MAX_DECIMALS + 1U));
+		int64_t magnitude = (value < 0L) ? -(int64_t) value : (int64_t) value;
+		int64_t scale = 1LL;
+		for (uint8_t d = 0U; d < decimals; d++) {
+			scale *= 10LL;
+		}
+		if (decimals == 0U) {
+			snprintf(expected, sizeof(expected), "%s%lld", value < 0L ? "-" : "", (long long) magnitude);
+		} else {
+			snprintf(expected, sizeof(expected), "%s%lld.%0*lld", value < 0L ? "-" : "",
+					(long long) (magnitude / scale), (int) decimals, (long long) (magnitude % scale));
+		}
+		HOSTTEST_CHECK(strcmp(NewFixed(value, decimals), expected) == 0);
+		HOSTTEST_CHECK(MQTTFormat_FixedLength(value, decimals) == strlen(expected));
+	}
+}
+
+/**
+ * @brief Rounding of the scaled integers and floats, half away from zero
+ */
+static void TestRounding(void) {
+	HOSTTEST_CHECK(MQTTFormat_RoundDiv(15L, 10L) == 2L);
+	HOSTTEST_CHECK(MQTTFormat_RoundDiv(14L, 10L) == 1L);
+	HOSTTEST_CHECK(MQTTFormat_RoundDiv(-15L, 10L) == -2L);
+	HOSTTEST_CHECK(MQTTFormat_RoundDiv(-14L, 10L) == -1L);
+	HOSTTEST_CHECK(MQTTFormat_RoundDiv(15L, -10L) == -2L);
+	HOSTTEST_CHECK(MQTTFormat_ScaleFloat(1.23456F, 4U) == 12346L);
+	HOSTTEST_CHECK(MQTTFormat_ScaleFloat(-1.23456F, 4U) == -12346L);
+	HOSTTEST_CHECK(MQTTFormat_ScaleFloat(1.0e12F, 3U) == 2000000000L);
+	HOSTTEST_CHECK(MQTTFormat_ScaleFloat(-1.0e12F, 3U) == -2000000000L);
+}
+
+/**
+ * @brief A line that does not fit is removed completely
+ */
+static void TestTruncation(void) {
+	char small[16];
+	MQTTBuffer_Payload_T target = { 0UL, sizeof(small), small };
+	MQTTFormat_Line_T line;
+
+	MQTTFormat_BeginLine(&line, &target);
+	MQTTFormat_Text(&line, "991,,");
+	MQTTFormat_Fixed(&line, 1234L, 3U);
+	HOSTTEST_CHECK(MQTTFormat_EndLine(&line));
+	HOSTTEST_CHECK(strcmp(small, "991,,1.234\r\n") == 0);
+
+	MQTTFormat_BeginLine(&line, &target);
+	MQTTFormat_Text(&line, "994,,");
+	MQTTFormat_Fixed(&line, 5L, 2U);
+	HOSTTEST_CHECK(MQTTFormat_EndLine(&line) == false);
+	HOSTTEST_CHECK(target.length == 12UL && strcmp(small, "991,,1.234\r\n") == 0);
+	HOSTTEST_CHECK(MQTTFormat_TextLine(&target, "xyz") == false);
+	HOSTTEST_CHECK(MQTTFormat_TextLine(&target, "") && target.length == 14UL);
+}
+
+/**
+ * @brief Cycles for one 991 accelerometer line, snprintf of the baseline against MQTTFormat
+ */
+static void BenchLine(void) {
+	char old[TEST_TEXT_SIZE];
+	int32_t accel[3] = { 12L, -981L, 40L };
+	uint32_t length = 0UL;
+
+	uint64_t start = HostTest_Cycles();
+	for (uint32_t n = 0UL; n < BENCH_LINES; n++) {
+		accel[0] = (int32_t) (n & 0x3FFUL);
+		length += (uint32_t) snprintf(old, sizeof(old), "991,,%.3lf,%.3lf,%.3lf\r\n",
+				accel[0] / 1000.0, accel[1] / 1000.0, accel[2] / 1000.0);
+		HOSTTEST_KEEP(old[0]);
+	}
+	uint64_t before = HostTest_Cycles() - start;
+
+	start = HostTest_Cycles();
+	for (uint32_t n = 0UL; n < BENCH_LINES; n++) {
+		MQTTFormat_Line_T line;
+		accel[0] = (int32_t) (n & 0x3FFUL);
+		payload.length = 0UL;
+		MQTTFormat_BeginLine(&line, &payload);
+		MQTTFormat_Text(&line, "991,,");
+		MQTTFormat_Fixed(&line, accel[0], 3U);
+		MQTTFormat_Char(&line, ',');
+		MQTTFormat_Fixed(&line, accel[1], 3U);
+		MQTTFormat_Char(&line, ',');
+		MQTTFormat_Fixed(&line, accel[2], 3U);
+		(void) MQTTFormat_EndLine(&line);
+		length -= payload.length;
+		HOSTTEST_KEEP(data[0]);
+	}
+	uint64_t after = HostTest_Cycles() - start;
+
+	// both wrote the same number of characters
+	HOSTTEST_CHECK(length == 0UL);
+	printf("bench 991 line: snprintf %.1f cycles, MQTTFormat %.1f cycles\n",
+			(double) before / BENCH_LINES, (double) after / BENCH_LINES);
+}
+
+/* global functions ********************************************************* */
+
+int main(int argc, char ** argv) {
+	TestAccel();
+	TestLight();
+	TestTemp();
+	TestPressure();
+	TestFixedRange();
+	TestRounding();
+	TestTruncation();
+	if (HostTest_Bench(argc, argv)) {
+		BenchLine();
+	}
+	return HostTest_Result("test_format");
+}
@@ -0,0 +1,310 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	test_offline.c
+ **
+ **	DESCRIPTION:	Host test of the segments MQTTOffline writes to the SD card, against the FatFs stand-in
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/*
+ * The stand-in keeps the files of the SD card in build/data/sdcard. A reset
+ * of the device is a new process started with HostTest_Boot, the files stay
+ * and the module recovers them.
+ */
+
+/* system header files */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/* own header files */
+#include "HostTest.h"
+#include "SdkShim.h"
+#include "MQTTOffline.h"
+
+/* constant definitions ***************************************************** */
+
+#define TEST_HEADER_SIZE	UINT32_C(10)
+#define TEST_RECORD_SIZE	UINT32_C(4)
+#define TEST_BINARY_SIZE	UINT32_C(1000)
+#define TEST_PATH_SIZE		UINT32_C(256)
+#define TEST_PAYLOAD_SIZE	UINT32_C(2048)
+
+/* local variables ********************************************************** */
+
+static int32_t offlineStoreKB = 64L;
+static char fetchData[TEST_PAYLOAD_SIZE];
+static MQTTBuffer_Payload_T fetched = { 0UL, TEST_PAYLOAD_SIZE, fetchData };
+static const char * const lines[] = { "200,c8y_Acceleration,x,0.1,g\r\n", "200,c8y_Temperature,T,21.5,C\r\n",
+		"200,c8y_Light,l,812,lux\r\n" };
+
+/* global functions ********************************************************* */
+
+/* the configuration of the firmware, OFFLINESTORE in KB */
+int32_t MQTTCfgParser_GetOfflineStore(void) {
+	return offlineStoreKB;
+}
+
+/* local functions ********************************************************** */
+
+/**
+ * @brief CRC-16/CCITT-FALSE, written again for the test
+ */
+static uint16_t TestCrc(const uint8_t * data, uint32_t length) {
+	uint16_t crc = 0xFFFFU;
+	for (uint32_t index = 0UL; index < length; index++) {
+		crc ^= (uint16_t) (data[index] << 8);
+		for (uint8_t bit = 0U; bit < 8U; bit++) {
+			crc = (crc & 0x8000U) ? (uint16_t) ((crc << 1) ^ 0x1021U) : (uint16_t) (crc << 1);
+		}
+	}
+	return crc;
+}
+
+static uint32_t TestGet(const uint8_t * data, uint8_t bytes) {
+	uint32_t value = 0UL;
+	for (uint8_t index = 0U; index < bytes; index++) {
+		value |= (uint32_t) data[index] << (8U * index);
+	}
+	return value;
+}
+
+/**
+ * @brief Read a segment file from the SD card
+ *
+ * @return size of the file, 0 if it does not exist
+ */
+static uint32_t TestReadSegment(uint32_t sequence, uint8_t * data, uint32_t size) {
+	char name[32];
+	char path[TEST_PATH_SIZE];
+
+	snprintf(name, sizeof(name), "OFFLINE/%08lX.SEG", (unsigned long) sequence);
+	Shim_SdCardPath(name, path, sizeof(path));
+	FILE * file = fopen(path, "rb");
+	if (file == NULL) {
+		return 0UL;
+	}
+	uint32_t length = (uint32_t) fread(data, 1U, size, file);
+	fclose(file);
+	return length;
+}
+
+static void TestAppendSegment(uint32_t sequence, const void * data, uint32_t length) {
+	char name[32];
+	char path[TEST_PATH_SIZE];
+
+	snprintf(name, sizeof(name), "OFFLINE/%08lX.SEG", (unsigned long) sequence);
+	Shim_SdCardPath(name, path, sizeof(path));
+	FILE * file = fopen(path, "ab");
+	HOSTTEST_CHECK(file != NULL);
+	if (file != NULL) {
+		HOSTTEST_CHECK(fwrite(data, 1U, length, file) == length);
+		fclose(file);
+	}
+}
+
+static bool TestStoreText(const char * text) {
+	MQTTBuffer_Payload_T payload = { (uint32_t) strlen(text), (uint32_t) strlen(text), (char *) text };
+	return MQTTOffline_Store(&payload);
+}
+
+/**
+ * @brief Store a binary payload, it starts with a header byte and carries its number
+ */
+static bool TestStoreBinary(uint32_t number) {
+	char data[TEST_BINARY_SIZE];
+	MQTTBuffer_Payload_T payload = { TEST_BINARY_SIZE, TEST_BINARY_SIZE, data };
+
+	memset(data, (int) (number & 0x7FUL), sizeof(data));
+	data[0] = 'B';
+	memcpy(&data[1], &number, sizeof(number));
+	return MQTTOffline_Store(&payload);
+}
+
+/**
+ * @brief Number of the binary payload fetched, UINT32_MAX if nothing or something else was fetched
+ */
+static uint32_t TestFetchBinary(void) {
+	uint32_t number = UINT32_MAX;
+
+	fetched.length = 0UL;
+	if (MQTTOffline_Fetch(&fetched) && fetched.length == TEST_BINARY_SIZE && fetched.data[0] == 'B') {
+		memcpy(&number, &fetched.data[1], sizeof(number));
+	}
+	return number;
+}
+
+static void TestConfigure(void) {
+	shim.sdCard = true;
+	MQTTOffline_Configure();
+	HOSTTEST_CHECK(MQTTOffline_IsEnabled());
+}
+
+/**
+ * @brief Header and records on the card as MQTTOffline.h describes them, SmartREST lines are joined
+ */
+static void BootRoundTrip(void) {
+	uint8_t segment[MQTTOFFLINE_SEGMENT_SIZE];
+	char joined[TEST_PAYLOAD_SIZE] = "";
+
+	TestConfigure();
+	HOSTTEST_CHECK(MQTTOffline_IsEmpty());
+	for (uint32_t line = 0UL; line < 3UL; line++) {
+		HOSTTEST_CHECK(TestStoreText(lines[line]));
+		strcat(joined, lines[line]);
+	}
+	HOSTTEST_CHECK(MQTTOffline_IsEmpty() == false);
+
+	uint32_t size = TestReadSegment(0UL, segment, sizeof(segment));
+	HOSTTEST_CHECK(size == TEST_HEADER_SIZE + 3UL * TEST_RECORD_SIZE + (uint32_t) strlen(joined));
+	HOSTTEST_CHECK(memcmp(segment, "XDSQ", 4U) == 0);
+	HOSTTEST_CHECK(TestGet(segment + 4, 4U) == 0UL);
+	HOSTTEST_CHECK(TestGet(segment + 8, 2U) == TestCrc(segment, 8UL));
+	uint32_t offset = TEST_HEADER_SIZE;
+	for (uint32_t line = 0UL; line < 3UL && offset + TEST_RECORD_SIZE <= size; line++) {
+		uint32_t length = TestGet(segment + offset, 2U);
+		HOSTTEST_CHECK(length == strlen(lines[line]));
+		HOSTTEST_CHECK(TestGet(segment + offset + 2, 2U) == TestCrc(segment + offset + TEST_RECORD_SIZE, length));
+		HOSTTEST_CHECK(memcmp(segment + offset + TEST_RECORD_SIZE, lines[line], length) == 0);
+		offset += TEST_RECORD_SIZE + length;
+	}
+
+	fetched.length = 0UL;
+	HOSTTEST_CHECK(MQTTOffline_Fetch(&fetched));
+	HOSTTEST_CHECK(fetched.length == strlen(joined) && memcmp(fetched.data, joined, fetched.length) == 0);
+	MQTTOffline_Commit();
+	HOSTTEST_CHECK(MQTTOffline_IsEmpty());
+	HOSTTEST_CHECK(TestReadSegment(0UL, segment, sizeof(segment)) == 0UL);
+
+	// the check value of CRC-16/CCITT-FALSE
+	HOSTTEST_CHECK(TestCrc((const uint8_t *) "123456789", 9UL) == 0x29B1U);
+}
+
+/**
+ * @brief Without a commit the next fetch returns the same payload, binary payloads come one by one
+ */
+static void BootReplay(void) {
+	TestConfigure();
+	for (uint32_t number = 1UL; number <= 3UL; number++) {
+		HOSTTEST_CHECK(TestStoreBinary(number));
+	}
+	HOSTTEST_CHECK(TestFetchBinary() == 1UL);
+	// the publish failed
+	HOSTTEST_CHECK(TestFetchBinary() == 1UL);
+	MQTTOffline_Commit();
+	HOSTTEST_CHECK(TestFetchBinary() == 2UL);
+	HOSTTEST_CHECK(TestFetchBinary() == 2UL);
+	MQTTOffline_Commit();
+	HOSTTEST_CHECK(TestFetchBinary() == 3UL);
+	MQTTOffline_Commit();
+	HOSTTEST_CHECK(MQTTOffline_IsEmpty());
+	fetched.length = 0UL;
+	HOSTTEST_CHECK(MQTTOffline_Fetch(&fetched) == false);
+}
+
+/**
+ * @brief The first boot stores, a reset tears the record being written
+ */
+static void BootBeforeReset(void) {
+	TestConfigure();
+	for (uint32_t number = 1UL; number <= 3UL; number++) {
+		HOSTTEST_CHECK(TestStoreBinary(number));
+	}
+}
+
+/**
+ * @brief The next boot cuts the torn record, keeps the complete ones and appends behind them
+ */
+static void BootAfterReset(void) {
+	uint8_t segment[MQTTOFFLINE_SEGMENT_SIZE];
+
+	TestConfigure();
+	HOSTTEST_CHECK(TestReadSegment(0UL, segment, sizeof(segment))
+			== TEST_HEADER_SIZE + 3UL * (TEST_RECORD_SIZE + TEST_BINARY_SIZE));
+	// the segment with the broken header is gone
+	HOSTTEST_CHECK(TestReadSegment(7UL, segment, sizeof(segment)) == 0UL);
+	HOSTTEST_CHECK(MQTTOffline_IsEmpty() == false);
+	HOSTTEST_CHECK(TestStoreBinary(4UL));
+	for (uint32_t number = 1UL; number <= 4UL; number++) {
+		HOSTTEST_CHECK(TestFetchBinary() == number);
+		MQTTOffline_Commit();
+	}
+	HOSTTEST_CHECK(MQTTOffline_IsEmpty());
+}
+
+/**
+ * @brief A store beyond the capacity drops the oldest segment
+ */
+static void BootEvict(void) {
+	const uint32_t perSegment = (MQTTOFFLINE_SEGMENT_SIZE - TEST_HEADER_SIZE) / (TEST_RECORD_SIZE + TEST_BINARY_SIZE);
+	uint8_t segment[MQTTOFFLINE_SEGMENT_SIZE];
+
+	TestConfigure();
+	// two segments, the smallest capacity
+	for (uint32_t number = 0UL; number < 2UL * perSegment; number++) {
+		HOSTTEST_CHECK(TestStoreBinary(number));
+	}
+	HOSTTEST_CHECK(TestReadSegment(0UL, segment, sizeof(segment)) != 0UL);
+	HOSTTEST_CHECK(TestFetchBinary() == 0UL);
+
+	// the fetch is published while the next payload evicts its segment
+	HOSTTEST_CHECK(TestStoreBinary(2UL * perSegment));
+	HOSTTEST_CHECK(TestReadSegment(0UL, segment, sizeof(segment)) == 0UL);
+	HOSTTEST_CHECK(TestReadSegment(2UL, segment, sizeof(segment)) != 0UL);
+	MQTTOffline_Commit();
+	HOSTTEST_CHECK(TestFetchBinary() == perSegment);
+	MQTTOffline_Commit();
+	HOSTTEST_CHECK(TestFetchBinary() == perSegment + 1UL);
+}
+
+/**
+ * @brief Without SD card or without capacity nothing is stored
+ */
+static void BootDisabled(void) {
+	shim.sdCard = false;
+	MQTTOffline_Configure();
+	HOSTTEST_CHECK(MQTTOffline_IsEnabled() == false);
+	HOSTTEST_CHECK(TestStoreText(lines[0]) == false);
+	HOSTTEST_CHECK(MQTTOffline_IsEmpty());
+}
+
+/* global functions ********************************************************* */
+
+int main(int argc, char ** argv) {
+	uint8_t torn[TEST_RECORD_SIZE + 5U] = { (uint8_t) TEST_BINARY_SIZE, (uint8_t) (TEST_BINARY_SIZE >> 8), 0x12U, 0x34U, 'B' };
+	uint8_t header[TEST_HEADER_SIZE] = { 'X', 'D', 'S', 'Q', 7U, 0U, 0U, 0U, 0U, 0U };
+
+	BCDS_UNUSED(argc);
+	BCDS_UNUSED(argv);
+	HostTest_Log(HOSTTEST_DATA "/test_offline.log");
+
+	Shim_Reset();
+	HostTest_Boot(BootRoundTrip);
+	Shim_Reset();
+	HostTest_Boot(BootReplay);
+
+	Shim_Reset();
+	HostTest_Boot(BootBeforeReset);
+	TestAppendSegment(0UL, torn, sizeof(torn));
+	// created just before the reset, its crc was not written yet
+	TestAppendSegment(7UL, header, sizeof(header));
+	HostTest_Boot(BootAfterReset);
+
+	Shim_Reset();
+	offlineStoreKB = 32L;
+	HostTest_Boot(BootEvict);
+
+	Shim_Reset();
+	HostTest_Boot(BootDisabled);
+	offlineStoreKB = 0L;
+	HostTest_Boot(BootDisabled);
+	return HostTest_Result("test_offline");
+}
@@ -0,0 +1,315 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	test_publish.c
+ **
+ **	DESCRIPTION:	Host test of the publish slots of MQTTClient against the Serval stand-in
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/*
+ * The broker of the stand-in acknowledges a publish when the test lets it
+ * report MQTT_PUBLISHED_DATA, connections and subscriptions after
+ * shim.roundTrip. All times are in simulated milliseconds.
+ */
+
+/* system header files */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* own header files */
+#include "HostTest.h"
+#include "SdkShim.h"
+#include "MQTTClient.h"
+
+/* constant definitions ***************************************************** */
+
+#define TEST_ROUND_TRIP_MS	UINT32_C(50)
+#define TEST_TIMEOUT_MS		UINT32_C(1000)
+#define TEST_TICK_MS		UINT32_C(100)		/**< MQTT_PUBLISH_TICK_IN_MS of MQTTClient.c */
+#define TEST_PUBLISHES		UINT32_C(16)
+
+/* local variables ********************************************************** */
+
+static CmdProcessor_T processor;
+static char payloads[TEST_PUBLISHES][8];
+
+/* completions in the order the callbacks were called */
+static uint32_t completed[TEST_PUBLISHES];
+static Retcode_T results[TEST_PUBLISHES];
+static uint32_t completions = 0UL;
+
+/* local functions ********************************************************** */
+
+static void TestPublished(MQTT_PublishHandle_TZ handle, void * context, Retcode_T result) {
+	BCDS_UNUSED(handle);
+	if (completions < TEST_PUBLISHES) {
+		completed[completions] = (uint32_t) (uintptr_t) context;
+		results[completions] = result;
+	}
+	completions++;
+}
+
+static Retcode_T TestConnect(void) {
+	MQTT_Connect_TZ connect = { "XDK", "broker", 1883U, true, 60UL };
+	MQTT_Credentials_TZ credentials = { NULL, NULL, true };
+
+	return MQTT_ConnectToBroker_Z(&connect, TEST_TIMEOUT_MS, &credentials);
+}
+
+/**
+ * @brief A new connection to the broker with an empty queue
+ */
+static void TestSetup(uint8_t window) {
+	MQTT_Setup_TZ setup = { &processor, false };
+
+	Shim_Reset();
+	shim.roundTrip = TEST_ROUND_TRIP_MS;
+	HOSTTEST_CHECK(MQTT_Setup_Z(&setup) == RETCODE_OK);
+	HOSTTEST_CHECK(TestConnect() == RETCODE_OK);
+	MQTT_SetPublishWindow_Z(window);
+	completions = 0UL;
+}
+
+static MQTT_PublishHandle_TZ TestQueue(uint32_t index, uint32_t qos) {
+	snprintf(payloads[index], sizeof(payloads[index]), "%lu", (unsigned long) index);
+	MQTT_Publish_TZ publish = { "s/us", qos, payloads[index], (uint32_t) strlen(payloads[index]) };
+	return MQTT_PublishToTopicAsync_Z(&publish, TEST_TIMEOUT_MS, TestPublished, (void *) (uintptr_t) index);
+}
+
+/**
+ * @brief The broker acknowledges the oldest sent publishes, one after the other
+ */
+static void TestAcknowledge(uint32_t count) {
+	for (uint32_t n = 0UL; n < count; n++) {
+		Shim_Event(1UL, MQTT_PUBLISHED_DATA);
+		Shim_Advance(2UL);
+	}
+}
+
+/**
+ * @brief Nothing stays queued for the next test
+ */
+static void TestTeardown(void) {
+	MQTT_PublishAbort_Z();
+	Shim_Advance(TEST_TICK_MS);
+}
+
+/**
+ * @brief Acknowledgements complete the sent publishes in order, the next publish is sent by a job
+ */
+static void TestInOrder(void) {
+	TestSetup(2U);
+	for (uint32_t index = 0UL; index < 5UL; index++) {
+		HOSTTEST_CHECK(TestQueue(index, 1UL) != MQTT_PUBLISH_HANDLE_INVALID);
+	}
+	Shim_Advance(1UL);
+	// the window holds two
+	HOSTTEST_CHECK(shim.publishes == 2UL);
+	HOSTTEST_CHECK(completions == 0UL);
+
+	TestAcknowledge(1UL);
+	HOSTTEST_CHECK(completions == 1UL && completed[0] == 0UL && results[0] == RETCODE_OK);
+	HOSTTEST_CHECK(shim.publishes == 3UL);
+	HOSTTEST_CHECK(shim.lastPayload == payloads[2]);
+
+	TestAcknowledge(4UL);
+	HOSTTEST_CHECK(completions == 5UL);
+	for (uint32_t index = 0UL; index < 5UL; index++) {
+		HOSTTEST_CHECK(completed[index] == index && results[index] == RETCODE_OK);
+	}
+	HOSTTEST_CHECK(shim.publishes == 5UL);
+	// the stack is never entered from its own event callback
+	HOSTTEST_CHECK(shim.reentrant == 0UL);
+
+	// a QoS 0 publish is not sent while an acknowledgement is pending
+	HOSTTEST_CHECK(TestQueue(5UL, 1UL) != MQTT_PUBLISH_HANDLE_INVALID);
+	HOSTTEST_CHECK(TestQueue(6UL, 0UL) != MQTT_PUBLISH_HANDLE_INVALID);
+	Shim_Advance(1UL);
+	HOSTTEST_CHECK(shim.publishes == 6UL);
+	TestAcknowledge(1UL);
+	HOSTTEST_CHECK(shim.publishes == 7UL && shim.lastQoS == 0U);
+	TestAcknowledge(1UL);
+	HOSTTEST_CHECK(completions == 7UL && completed[6] == 6UL && results[6] == RETCODE_OK);
+	HOSTTEST_CHECK(shim.reentrant == 0UL);
+	TestTeardown();
+}
+
+/**
+ * @brief Publishes beyond the slots are rejected
+ */
+static void TestFull(void) {
+	TestSetup(1U);
+	for (uint32_t index = 0UL; index < MQTT_PUBLISH_SLOTS; index++) {
+		HOSTTEST_CHECK(TestQueue(index, 1UL) != MQTT_PUBLISH_HANDLE_INVALID);
+	}
+	HOSTTEST_CHECK(TestQueue(MQTT_PUBLISH_SLOTS, 1UL) == MQTT_PUBLISH_HANDLE_INVALID);
+	MQTT_Publish_TZ publish = { "s/us", 1UL, "200", 3UL };
+	HOSTTEST_CHECK(MQTT_PublishToTopic_Z(&publish, TEST_TIMEOUT_MS) == RETCODE_OUT_OF_RESOURCES);
+
+	// one acknowledgement frees one slot
+	TestAcknowledge(1UL);
+	HOSTTEST_CHECK(TestQueue(MQTT_PUBLISH_SLOTS, 1UL) != MQTT_PUBLISH_HANDLE_INVALID);
+	HOSTTEST_CHECK(TestQueue(MQTT_PUBLISH_SLOTS + 1UL, 1UL) == MQTT_PUBLISH_HANDLE_INVALID);
+
+	TestTeardown();
+	HOSTTEST_CHECK(completions == MQTT_PUBLISH_SLOTS + 1UL);
+	for (uint32_t index = 1UL; index < completions; index++) {
+		HOSTTEST_CHECK(completed[index] == index && results[index] == RETCODE_MQTT_PUBLISH_FAILED);
+	}
+}
+
+/**
+ * @brief A publish not acknowledged in time is sent again on the next connection
+ */
+static void TestResend(void) {
+	TestSetup(1U);
+	HOSTTEST_CHECK(TestQueue(0UL, 1UL) != MQTT_PUBLISH_HANDLE_INVALID);
+	HOSTTEST_CHECK(TestQueue(1UL, 1UL) != MQTT_PUBLISH_HANDLE_INVALID);
+	Shim_Advance(TEST_TIMEOUT_MS + 2UL * TEST_TICK_MS);
+	// the connection is given up, nothing is sent on it any more
+	HOSTTEST_CHECK(shim.publishes == 1UL);
+	HOSTTEST_CHECK(completions == 0UL);
+
+	HOSTTEST_CHECK(TestConnect() == RETCODE_OK);
+	HOSTTEST_CHECK(shim.connects == 2UL);
+	Shim_Advance(1UL);
+	HOSTTEST_CHECK(shim.publishes == 2UL && shim.lastPayload == payloads[0]);
+	TestAcknowledge(2UL);
+	HOSTTEST_CHECK(shim.publishes == 3UL && shim.lastPayload == payloads[1]);
+	HOSTTEST_CHECK(completions == 2UL);
+	HOSTTEST_CHECK(completed[0] == 0UL && results[0] == RETCODE_OK);
+	HOSTTEST_CHECK(completed[1] == 1UL && results[1] == RETCODE_OK);
+	TestTeardown();
+}
+
+/**
+ * @brief A publish is sent MQTT_PUBLISH_ATTEMPTS times at most
+ */
+static void TestAttempts(void) {
+	TestSetup(1U);
+	HOSTTEST_CHECK(TestQueue(0UL, 1UL) != MQTT_PUBLISH_HANDLE_INVALID);
+	for (uint8_t attempt = 1U; attempt <= MQTT_PUBLISH_ATTEMPTS; attempt++) {
+		Shim_Advance(1UL);
+		HOSTTEST_CHECK(shim.publishes == attempt);
+		HOSTTEST_CHECK(completions == 0UL);
+		Shim_Advance(TEST_TIMEOUT_MS + TEST_TICK_MS);
+		if (attempt < MQTT_PUBLISH_ATTEMPTS) {
+			HOSTTEST_CHECK(TestConnect() == RETCODE_OK);
+		}
+	}
+	HOSTTEST_CHECK(completions == 1UL && results[0] == RETCODE_MQTT_PUBLISH_CB_NOT_RECEIVED);
+	HOSTTEST_CHECK(TestConnect() == RETCODE_OK);
+	Shim_Advance(TEST_TIMEOUT_MS);
+	HOSTTEST_CHECK(shim.publishes == MQTT_PUBLISH_ATTEMPTS);
+	TestTeardown();
+}
+
+/**
+ * @brief A waiting publish fails once the timeouts of all its attempts passed without a connection
+ */
+static void TestDeadline(void) {
+	TestSetup(1U);
+	// the connection is lost before the first publish
+	shim.publishResult = RC_MQTT_NOT_CONNECTED;
+	HOSTTEST_CHECK(TestQueue(0UL, 1UL) != MQTT_PUBLISH_HANDLE_INVALID);
+	Shim_Advance(MQTT_PUBLISH_ATTEMPTS * TEST_TIMEOUT_MS - 2UL * TEST_TICK_MS);
+	HOSTTEST_CHECK(completions == 0UL);
+	Shim_Advance(3UL * TEST_TICK_MS);
+	HOSTTEST_CHECK(completions == 1UL && results[0] == RETCODE_MQTT_PUBLISH_CB_NOT_RECEIVED);
+
+	// one that was sent waits for the rest of its time
+	shim.publishResult = RC_OK;
+	HOSTTEST_CHECK(TestConnect() == RETCODE_OK);
+	HOSTTEST_CHECK(TestQueue(1UL, 1UL) != MQTT_PUBLISH_HANDLE_INVALID);
+	Shim_Advance(TEST_TICK_MS);
+	Shim_Event(0UL, MQTT_CONNECTION_CLOSED);
+	Shim_Advance(MQTT_PUBLISH_ATTEMPTS * TEST_TIMEOUT_MS - 3UL * TEST_TICK_MS);
+	HOSTTEST_CHECK(completions == 1UL);
+	Shim_Advance(3UL * TEST_TICK_MS);
+	HOSTTEST_CHECK(completions == 2UL && results[1] == RETCODE_MQTT_PUBLISH_CB_NOT_RECEIVED);
+	HOSTTEST_CHECK(Retcode_GetCode(shim.raised) == RETCODE_MQTT_CONNECTION_CLOSED);
+	TestTeardown();
+}
+
+/**
+ * @brief A closed connection takes back the sent publishes, they are sent again in order
+ */
+static void TestReconnect(void) {
+	TestSetup(3U);
+	for (uint32_t index = 0UL; index < 4UL; index++) {
+		HOSTTEST_CHECK(TestQueue(index, 1UL) != MQTT_PUBLISH_HANDLE_INVALID);
+	}
+	Shim_Advance(1UL);
+	HOSTTEST_CHECK(shim.publishes == 3UL);
+	TestAcknowledge(1UL);
+	HOSTTEST_CHECK(shim.publishes == 4UL);
+	shim.connected = false;
+	Shim_Event(0UL, MQTT_CONNECTION_CLOSED);
+	Shim_Advance(TEST_TICK_MS);
+	HOSTTEST_CHECK(completions == 1UL);
+	HOSTTEST_CHECK(shim.publishes == 4UL);
+
+	HOSTTEST_CHECK(TestConnect() == RETCODE_OK);
+	Shim_Advance(1UL);
+	HOSTTEST_CHECK(shim.publishes == 7UL && shim.lastPayload == payloads[3]);
+	TestAcknowledge(3UL);
+	HOSTTEST_CHECK(completions == 4UL);
+	for (uint32_t index = 0UL; index < 4UL; index++) {
+		HOSTTEST_CHECK(completed[index] == index && results[index] == RETCODE_OK);
+	}
+	TestTeardown();
+}
+
+/**
+ * @brief The synchronous publish returns the result of its slot
+ */
+static void TestSync(void) {
+	MQTT_Publish_TZ publish = { "s/us", 1UL, "200", 3UL };
+
+	TestSetup(1U);
+	Shim_Event(30UL, MQTT_PUBLISHED_DATA);
+	uint32_t start = Shim_Now();
+	HOSTTEST_CHECK(MQTT_PublishToTopic_Z(&publish, TEST_TIMEOUT_MS) == RETCODE_OK);
+	HOSTTEST_CHECK(Shim_Now() - start == 30UL);
+
+	// not acknowledged, without retry it completes after its timeout
+	start = Shim_Now();
+	HOSTTEST_CHECK(MQTT_PublishToTopic_Z(&publish, TEST_TIMEOUT_MS) == RETCODE_MQTT_PUBLISH_CB_NOT_RECEIVED);
+	HOSTTEST_CHECK(Shim_Now() - start >= TEST_TIMEOUT_MS - TEST_TICK_MS && Shim_Now() - start <= TEST_TIMEOUT_MS);
+
+	// the connection closes while it waits
+	HOSTTEST_CHECK(TestConnect() == RETCODE_OK);
+	Shim_Event(30UL, MQTT_CONNECTION_CLOSED);
+	HOSTTEST_CHECK(MQTT_PublishToTopic_Z(&publish, TEST_TIMEOUT_MS) == RETCODE_MQTT_CONNECTION_CLOSED);
+
+	// the stack refuses to send
+	HOSTTEST_CHECK(TestConnect() == RETCODE_OK);
+	shim.publishResult = RC_MQTT_NOT_CONNECTED;
+	HOSTTEST_CHECK(MQTT_PublishToTopic_Z(&publish, TEST_TIMEOUT_MS) == RETCODE_MQTT_PUBLISH_FAILED);
+	HOSTTEST_CHECK(shim.reentrant == 0UL);
+	TestTeardown();
+}
+
+/* global functions ********************************************************* */
+
+int main(int argc, char ** argv) {
+	BCDS_UNUSED(argc);
+	BCDS_UNUSED(argv);
+	HostTest_Log(HOSTTEST_DATA "/test_publish.log");
+	TestInOrder();
+	TestFull();
+	TestResend();
+	TestAttempts();
+	TestDeadline();
+	TestReconnect();
+	TestSync();
+	return HostTest_Result("test_publish");
+}
@@ -0,0 +1,268 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	test_router.c
+ **
+ **	DESCRIPTION:	Host test and benchmark of the topic routing in MQTTRouter
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* system header files */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/* own header files */
+#include "HostTest.h"
+#include "MQTTRouter.h"
+
+/* constant definitions ***************************************************** */
+
+#define TEST_LEVELS			UINT32_C(4)
+#define TEST_TOPIC_SIZE		UINT32_C(64)
+#define TEST_RANDOM			UINT32_C(200000)
+#define BENCH_ROUNDS		UINT32_C(2000000)
+
+/* local variables ********************************************************** */
+
+static MQTTRouter_T router;
+
+/* local functions ********************************************************** */
+
+static int8_t Match(const char * topic) {
+	return MQTTRouter_Match(&router, topic, (uint32_t) strlen(topic));
+}
+
+/**
+ * @brief Reference of MQTT 3.1.1 section 4.7, written from the specification level by level
+ */
+static bool Matches(const char * filter, const char * topic) {
+	// wildcards at the first level do not match topics starting with '$'
+	if (topic[0] == '$' && (filter[0] == '+' || filter[0] == '#')) {
+		return false;
+	}
+	for (;;) {
+		const char * filterEnd = strchr(filter, '/');
+		const char * topicEnd = strchr(topic, '/');
+		size_t filterLength = (filterEnd != NULL) ? (size_t) (filterEnd - filter) : strlen(filter);
+		size_t topicLength = (topicEnd != NULL) ? (size_t) (topicEnd - topic) : strlen(topic);
+
+		if (filterLength == 1U && filter[0] == '#') {
+			return true;
+		}
+		if (!(filterLength == 1U && filter[0] == '+')
+				&& (filterLength != topicLength || strncmp(filter, topic, filterLength) != 0)) {
+			return false;
+		}
+		if (filterEnd == NULL || topicEnd == NULL) {
+			// "a/#" also matches "a"
+			return (filterEnd == NULL && topicEnd == NULL) || (topicEnd == NULL && strcmp(filterEnd, "/#") == 0);
+		}
+		filter = filterEnd + 1;
+		topic = topicEnd + 1;
+	}
+}
+
+/**
+ * @brief Cases of the specification and of the topics of the device
+ */
+static void TestFilters(void) {
+	MQTTRouter_Init(&router);
+	int8_t custom = MQTTRouter_Add(&router, "s/dc/XDK");
+	int8_t standard = MQTTRouter_Add(&router, "s/ds");
+	int8_t error = MQTTRouter_Add(&router, "s/e");
+	int8_t level = MQTTRouter_Add(&router, "a/+/c");
+	int8_t multi = MQTTRouter_Add(&router, "b/#");
+	int8_t system = MQTTRouter_Add(&router, "$SYS/#");
+	HOSTTEST_CHECK(custom >= 0 && standard >= 0 && error >= 0 && level >= 0 && multi >= 0 && system >= 0);
+
+	// invalid filters
+	HOSTTEST_CHECK(MQTTRouter_Add(&router, "a/#x") == MQTTROUTER_NONE);
+	HOSTTEST_CHECK(MQTTRouter_Add(&router, "a+") == MQTTROUTER_NONE);
+	HOSTTEST_CHECK(MQTTRouter_Add(&router, "#/a") == MQTTROUTER_NONE);
+	HOSTTEST_CHECK(MQTTRouter_Add(&router, "") == MQTTROUTER_NONE);
+	// a filter added again keeps its route
+	HOSTTEST_CHECK(MQTTRouter_Add(&router, "s/ds") == standard);
+
+	HOSTTEST_CHECK(Match("s/dc/XDK") == custom);
+	HOSTTEST_CHECK(Match("s/ds") == standard);
+	HOSTTEST_CHECK(Match("s/e") == error);
+	HOSTTEST_CHECK(Match("s/d") == MQTTROUTER_NONE);
+	HOSTTEST_CHECK(Match("a/x/c") == level);
+	HOSTTEST_CHECK(Match("a//c") == level);
+	HOSTTEST_CHECK(Match("a/x/c/d") == MQTTROUTER_NONE);
+	HOSTTEST_CHECK(Match("b") == multi);
+	HOSTTEST_CHECK(Match("b/1/2") == multi);
+	HOSTTEST_CHECK(Match("bb") == MQTTROUTER_NONE);
+	// an explicit '$' filter matches, see the wildcard cases below for the rest
+	HOSTTEST_CHECK(Match("$SYS/broker/load") == system);
+	HOSTTEST_CHECK(Match("$SYS") == system);
+	HOSTTEST_CHECK(MQTTRouter_Match(&router, "s/dsx", 4UL) == standard);
+
+	// removed routes are free again
+	HOSTTEST_CHECK(MQTTRouter_Remove(&router, "s/ds") == standard);
+	HOSTTEST_CHECK(MQTTRouter_Remove(&router, "s/ds") == MQTTROUTER_NONE);
+	HOSTTEST_CHECK(Match("s/ds") == MQTTROUTER_NONE);
+	HOSTTEST_CHECK(Match("s/e") == error && Match("s/dc/XDK") == custom);
+	HOSTTEST_CHECK(MQTTRouter_Add(&router, "s/ds") == standard);
+}
+
+/**
+ * @brief Wildcards at the first level do not match '$' topics, an exact filter wins over a wildcard
+ */
+static void TestPrecedence(void) {
+	MQTTRouter_Init(&router);
+	int8_t all = MQTTRouter_Add(&router, "#");
+	int8_t first = MQTTRouter_Add(&router, "+/info");
+	HOSTTEST_CHECK(Match("$SYS/info") == MQTTROUTER_NONE);
+	HOSTTEST_CHECK(Match("x/info") == all || Match("x/info") == first);
+	int8_t exact = MQTTRouter_Add(&router, "x/info");
+	HOSTTEST_CHECK(Match("x/info") == exact);
+	int8_t system = MQTTRouter_Add(&router, "$SYS/+");
+	HOSTTEST_CHECK(Match("$SYS/info") == system);
+	HOSTTEST_CHECK(Match("$SYS/info/x") == MQTTROUTER_NONE);
+
+	// all routes used, with colliding and non colliding hashes in the index
+	MQTTRouter_Init(&router);
+	for (uint8_t route = 0U; route < MQTTROUTER_ROUTES; route++) {
+		static char filters[MQTTROUTER_ROUTES][8];
+		snprintf(filters[route], sizeof(filters[route]), "t/%u", (unsigned) route);
+		HOSTTEST_CHECK(MQTTRouter_Add(&router, filters[route]) == (int8_t) route);
+	}
+	HOSTTEST_CHECK(MQTTRouter_Add(&router, "t/x") == MQTTROUTER_NONE);
+	for (uint8_t route = 0U; route < MQTTROUTER_ROUTES; route++) {
+		char topic[8];
+		snprintf(topic, sizeof(topic), "t/%u", (unsigned) route);
+		HOSTTEST_CHECK(Match(topic) == (int8_t) route);
+	}
+}
+
+/**
+ * @brief Random level
+ */
+static const char * Level(bool filter) {
+	static const char * const topicLevels[] = { "a", "b", "", "$SYS", "ab" };
+	static const char * const filterLevels[] = { "a", "b", "", "$SYS", "ab", "+", "+", "#" };
+
+	return filter ? filterLevels[(uint32_t) rand() % 8U] : topicLevels[(uint32_t) rand() % 5U];
+}
+
+/**
+ * @brief Random path of up to TEST_LEVELS levels, a '#' ends a filter
+ */
+static void Path(char * path, bool filter) {
+	uint32_t levels = 1UL + (uint32_t) rand() % TEST_LEVELS;
+
+	path[0] = '\0';
+	for (uint32_t level = 0UL; level < levels; level++) {
+		const char * part = Level(filter);
+		if (level > 0UL) {
+			strcat(path, "/");
+		}
+		strcat(path, part);
+		if (part[0] == '#') {
+			break;
+		}
+	}
+}
+
+/**
+ * @brief Random filters and topics against the reference
+ */
+static void TestRandom(void) {
+	static char filters[MQTTROUTER_ROUTES][TEST_TOPIC_SIZE];
+	uint32_t wrong = 0UL;
+	uint32_t matched = 0UL;
+
+	for (uint32_t run = 0UL; run < TEST_RANDOM / 100UL; run++) {
+		uint8_t count = (uint8_t) (1U + (uint32_t) rand() % 4U);
+		MQTTRouter_Init(&router);
+		for (uint8_t route = 0U; route < count; route++) {
+			Path(filters[route], true);
+			int8_t added = MQTTRouter_Add(&router, filters[route]);
+			if (added != (int8_t) route) {
+				// a filter drawn twice keeps its first route
+				filters[route][0] = '\0';
+			}
+		}
+		for (uint32_t n = 0UL; n < 100UL; n++) {
+			char topic[TEST_TOPIC_SIZE];
+			bool any = false;
+			bool exact = false;
+			Path(topic, false);
+			for (uint8_t route = 0U; route < count; route++) {
+				if (filters[route][0] != '\0' && Matches(filters[route], topic)) {
+					any = true;
+					exact = exact || strcmp(filters[route], topic) == 0;
+				}
+			}
+			int8_t route = Match(topic);
+			if ((route == MQTTROUTER_NONE) == any
+					|| (route != MQTTROUTER_NONE && (filters[route][0] == '\0' || !Matches(filters[route], topic)
+							|| (exact && strcmp(filters[route], topic) != 0)))) {
+				wrong++;
+			}
+			matched += (route != MQTTROUTER_NONE) ? 1UL : 0UL;
+		}
+	}
+	HOSTTEST_CHECK(wrong == 0UL);
+	printf("router: %lu random topics, %lu matched\n", (unsigned long) TEST_RANDOM, (unsigned long) matched);
+}
+
+/**
+ * @brief Cycles per routed topic, against the strncmp cascade the callback used before
+ */
+static void BenchRouter(void) {
+	const char * const topics[] = { "s/dc/XDK", "s/ds", "s/e" };
+	uint32_t found = 0UL;
+
+	MQTTRouter_Init(&router);
+	(void) MQTTRouter_Add(&router, "s/dc/XDK");
+	(void) MQTTRouter_Add(&router, "s/ds");
+	(void) MQTTRouter_Add(&router, "s/e");
+
+	uint64_t start = HostTest_Cycles();
+	for (uint32_t round = 0UL; round < BENCH_ROUNDS; round++) {
+		const char * topic = topics[round % 3UL];
+		found += (uint32_t) MQTTRouter_Match(&router, topic, (uint32_t) strlen(topic));
+	}
+	uint64_t routed = HostTest_Cycles() - start;
+
+	start = HostTest_Cycles();
+	for (uint32_t round = 0UL; round < BENCH_ROUNDS; round++) {
+		const char * topic = topics[round % 3UL];
+		uint32_t length = (uint32_t) strlen(topic);
+		if (strncmp(topic, "s/dc/XDK", length) == 0) {
+			found += 0UL;
+		} else if (strncmp(topic, "s/ds", length) == 0) {
+			found += 1UL;
+		} else if (strncmp(topic, "s/e", length) == 0) {
+			found += 2UL;
+		}
+	}
+	uint64_t compared = HostTest_Cycles() - start;
+	HOSTTEST_KEEP(found);
+
+	printf("bench router: %.1f cycles per topic, strncmp cascade %.1f cycles\n",
+			(double) routed / BENCH_ROUNDS, (double) compared / BENCH_ROUNDS);
+}
+
+/* global functions ********************************************************* */
+
+int main(int argc, char ** argv) {
+	srand(8U);
+	TestFilters();
+	TestPrecedence();
+	TestRandom();
+	if (HostTest_Bench(argc, argv)) {
+		BenchRouter();
+	}
+	return HostTest_Result("test_router");
+}
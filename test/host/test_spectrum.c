@@ -0,0 +1,247 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	test_spectrum.c
+ **
+ **	DESCRIPTION:	Host accuracy test and benchmark of the Q15 vibration spectrum in MQTTSpectrum
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* system header files */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <math.h>
+
+/* own header files */
+#include "HostTest.h"
+#include "MQTTSpectrum.h"
+
+/* constant definitions ***************************************************** */
+
+#define TEST_PI					3.14159265358979323846
+#define TEST_SAMPLE_RATE		1000.0F		/**< Capture rate of the firmware, one sample per tick */
+#define TEST_FREQUENCY_TOLERANCE	0.2		/**< Hz */
+#define TEST_AMPLITUDE_TOLERANCE	0.02	/**< Relative to the amplitude of the sine */
+#define TEST_RMS_TOLERANCE		0.02		/**< Relative to the double precision reference */
+#define TEST_TRANSFORM_TOLERANCE	8.0		/**< Q15 steps of the transform result */
+#define BENCH_ROUNDS			UINT32_C(2000)
+
+/* local variables ********************************************************** */
+
+static int16_t samples[MQTTSPECTRUM_MAX_AXES][MQTTSPECTRUM_SIZE];
+
+/* local functions ********************************************************** */
+
+static uint32_t Reverse(uint32_t n) {
+	uint32_t reversed = 0UL;
+	for (uint8_t bit = 0U; bit < MQTTSPECTRUM_SIZE_LOG2; bit++) {
+		reversed = (reversed << 1) | (n & 1UL);
+		n >>= 1;
+	}
+	return reversed;
+}
+
+/**
+ * @brief The Q15 transform equals the DFT divided by N within a few steps
+ */
+static void TestTransform(void) {
+	int16_t re[MQTTSPECTRUM_SIZE];
+	int16_t im[MQTTSPECTRUM_SIZE];
+	int16_t input[MQTTSPECTRUM_SIZE];
+	double worst = 0.0;
+
+	for (uint32_t run = 0UL; run < 20UL; run++) {
+		for (uint32_t n = 0UL; n < MQTTSPECTRUM_SIZE; n++) {
+			input[n] = (int16_t) ((int32_t) ((uint32_t) rand() % 0x7FFFU) - 0x3FFF);
+			re[Reverse(n)] = input[n];
+			im[n] = 0;
+		}
+		MQTTSpectrum_Transform(re, im);
+		for (uint32_t k = 0UL; k < MQTTSPECTRUM_SIZE; k++) {
+			double sumRe = 0.0;
+			double sumIm = 0.0;
+			for (uint32_t n = 0UL; n < MQTTSPECTRUM_SIZE; n++) {
+				double angle = -2.0 * TEST_PI * (double) ((k * n) % MQTTSPECTRUM_SIZE) / MQTTSPECTRUM_SIZE;
+				sumRe += input[n] * cos(angle);
+				sumIm += input[n] * sin(angle);
+			}
+			double errorRe = fabs(re[k] - sumRe / MQTTSPECTRUM_SIZE);
+			double errorIm = fabs(im[k] - sumIm / MQTTSPECTRUM_SIZE);
+			worst = (errorRe > worst) ? errorRe : worst;
+			worst = (errorIm > worst) ? errorIm : worst;
+		}
+	}
+	HOSTTEST_CHECK(worst <= TEST_TRANSFORM_TOLERANCE);
+	printf("transform: largest error %.2f Q15 steps\n", worst);
+}
+
+/**
+ * @brief Rms of all bins without DC and Nyquist, computed in double like MQTTSpectrum_Analyze
+ */
+static double ReferenceRms(uint8_t axisCount, double * bands) {
+	double total = 0.0;
+
+	memset(bands, 0x00, MQTTSPECTRUM_BANDS * sizeof(double));
+	for (uint32_t k = 1UL; k < MQTTSPECTRUM_SIZE / 2UL; k++) {
+		double power = 0.0;
+		for (uint8_t axis = 0U; axis < axisCount; axis++) {
+			double mean = 0.0;
+			for (uint32_t n = 0UL; n < MQTTSPECTRUM_SIZE; n++) {
+				mean += samples[axis][n];
+			}
+			mean /= MQTTSPECTRUM_SIZE;
+			double sumRe = 0.0;
+			double sumIm = 0.0;
+			for (uint32_t n = 0UL; n < MQTTSPECTRUM_SIZE; n++) {
+				double window = 0.5 * (1.0 - cos(2.0 * TEST_PI * n / MQTTSPECTRUM_SIZE));
+				double angle = -2.0 * TEST_PI * (double) ((k * n) % MQTTSPECTRUM_SIZE) / MQTTSPECTRUM_SIZE;
+				sumRe += (samples[axis][n] - mean) * window * cos(angle);
+				sumIm += (samples[axis][n] - mean) * window * sin(angle);
+			}
+			// one-sided mean square of the bin, see MQTTSPECTRUM_POWER_GAIN
+			power += 16.0 / 3.0 * (sumRe * sumRe + sumIm * sumIm) / ((double) MQTTSPECTRUM_SIZE * MQTTSPECTRUM_SIZE);
+		}
+		total += power;
+		bands[k / (MQTTSPECTRUM_SIZE / 2UL / MQTTSPECTRUM_BANDS)] += power;
+	}
+	for (uint8_t band = 0U; band < MQTTSPECTRUM_BANDS; band++) {
+		bands[band] = sqrt(bands[band]);
+	}
+	return sqrt(total);
+}
+
+/**
+ * @brief Capture a sine of the given amplitude in mg, split over x and y, on top of 1 g in z
+ */
+static void Capture(double frequency, double amplitude, int32_t noise) {
+	double phase = (double) ((uint32_t) rand() % 628U) / 100.0;
+
+	for (uint32_t n = 0UL; n < MQTTSPECTRUM_SIZE; n++) {
+		double value = amplitude * sin(2.0 * TEST_PI * frequency * n / TEST_SAMPLE_RATE + phase);
+		int32_t jitter[MQTTSPECTRUM_MAX_AXES] = { 0L, 0L, 0L };
+		if (noise > 0L) {
+			for (uint8_t axis = 0U; axis < MQTTSPECTRUM_MAX_AXES; axis++) {
+				jitter[axis] = (int32_t) ((uint32_t) rand() % (uint32_t) (2L * noise + 1L)) - noise;
+			}
+		}
+		samples[0][n] = (int16_t) lrint(0.6 * value) + (int16_t) jitter[0];
+		samples[1][n] = (int16_t) lrint(0.8 * value) + (int16_t) jitter[1];
+		samples[2][n] = (int16_t) (1000L + jitter[2]);
+	}
+}
+
+/**
+ * @brief Peak frequency within 0.2 Hz, amplitude, rms and bands within 2% of the reference
+ */
+static void TestAccuracy(void) {
+	const double frequencies[] = { 12.3, 37.5, 50.0, 80.1, 123.4, 199.9, 250.7, 333.3, 421.0, 470.2 };
+	const double amplitudes[] = { 20.0, 200.0, 2000.0, 8000.0 };
+	const int16_t * const axes[MQTTSPECTRUM_MAX_AXES] = { samples[0], samples[1], samples[2] };
+	double worstFrequency = 0.0;
+	double worstAmplitude = 0.0;
+	double worstRms = 0.0;
+	double worstBand = 0.0;
+
+	for (uint32_t f = 0UL; f < sizeof(frequencies) / sizeof(frequencies[0]); f++) {
+		for (uint32_t a = 0UL; a < sizeof(amplitudes) / sizeof(amplitudes[0]); a++) {
+			MQTTSpectrum_Result_T result;
+			double bands[MQTTSPECTRUM_BANDS];
+
+			Capture(frequencies[f], amplitudes[a], 0L);
+			MQTTSpectrum_Analyze(axes, MQTTSPECTRUM_MAX_AXES, TEST_SAMPLE_RATE, &result);
+			double rms = ReferenceRms(MQTTSPECTRUM_MAX_AXES, bands);
+
+			double frequencyError = fabs(result.peakFrequency - frequencies[f]);
+			double amplitudeError = fabs(result.peakAmplitude - amplitudes[a]) / amplitudes[a];
+			double rmsError = fabs(result.rms - rms) / rms;
+			HOSTTEST_CHECK(frequencyError <= TEST_FREQUENCY_TOLERANCE);
+			HOSTTEST_CHECK(amplitudeError <= TEST_AMPLITUDE_TOLERANCE);
+			HOSTTEST_CHECK(rmsError <= TEST_RMS_TOLERANCE);
+			// bands holding a noticeable part of the vibration
+			for (uint8_t band = 0U; band < MQTTSPECTRUM_BANDS; band++) {
+				if (bands[band] >= 0.1 * rms) {
+					double bandError = fabs(result.bands[band] - bands[band]) / bands[band];
+					HOSTTEST_CHECK(bandError <= TEST_RMS_TOLERANCE);
+					worstBand = (bandError > worstBand) ? bandError : worstBand;
+				}
+			}
+			worstFrequency = (frequencyError > worstFrequency) ? frequencyError : worstFrequency;
+			worstAmplitude = (amplitudeError > worstAmplitude) ? amplitudeError : worstAmplitude;
+			worstRms = (rmsError > worstRms) ? rmsError : worstRms;
+		}
+	}
+	printf("sine: peak frequency within %.3f Hz, amplitude within %.2f%%, rms within %.2f%%, bands within %.2f%%\n",
+			worstFrequency, 100.0 * worstAmplitude, 100.0 * worstRms, 100.0 * worstBand);
+}
+
+/**
+ * @brief A sine in sensor noise is still found, the rms includes the noise
+ */
+static void TestNoise(void) {
+	const int16_t * const axes[MQTTSPECTRUM_MAX_AXES] = { samples[0], samples[1], samples[2] };
+	MQTTSpectrum_Result_T result;
+	double bands[MQTTSPECTRUM_BANDS];
+
+	Capture(87.6, 100.0, 10L);
+	MQTTSpectrum_Analyze(axes, MQTTSPECTRUM_MAX_AXES, TEST_SAMPLE_RATE, &result);
+	double rms = ReferenceRms(MQTTSPECTRUM_MAX_AXES, bands);
+	HOSTTEST_CHECK(fabs(result.peakFrequency - 87.6) <= TEST_FREQUENCY_TOLERANCE);
+	HOSTTEST_CHECK(fabs(result.rms - rms) <= TEST_RMS_TOLERANCE * rms);
+
+	// no vibration at all
+	Capture(87.6, 0.0, 0L);
+	MQTTSpectrum_Analyze(axes, MQTTSPECTRUM_MAX_AXES, TEST_SAMPLE_RATE, &result);
+	HOSTTEST_CHECK(result.rms == 0.0F && result.peakAmplitude == 0.0F);
+}
+
+/**
+ * @brief Cycles of one transform and of the analysis of a capture of three axes
+ */
+static void BenchSpectrum(void) {
+	const int16_t * const axes[MQTTSPECTRUM_MAX_AXES] = { samples[0], samples[1], samples[2] };
+	int16_t re[MQTTSPECTRUM_SIZE];
+	int16_t im[MQTTSPECTRUM_SIZE];
+	MQTTSpectrum_Result_T result;
+
+	Capture(123.4, 500.0, 5L);
+	uint64_t start = HostTest_Cycles();
+	for (uint32_t round = 0UL; round < BENCH_ROUNDS; round++) {
+		memcpy(re, samples[0], sizeof(re));
+		memset(im, 0x00, sizeof(im));
+		MQTTSpectrum_Transform(re, im);
+		HOSTTEST_KEEP(re[1]);
+	}
+	uint64_t transform = HostTest_Cycles() - start;
+
+	start = HostTest_Cycles();
+	for (uint32_t round = 0UL; round < BENCH_ROUNDS; round++) {
+		MQTTSpectrum_Analyze(axes, MQTTSPECTRUM_MAX_AXES, TEST_SAMPLE_RATE, &result);
+		HOSTTEST_KEEP(result.rms);
+	}
+	uint64_t analyze = HostTest_Cycles() - start;
+
+	printf("bench spectrum: transform of %u points %.0f cycles, analysis of 3 axes %.0f cycles\n",
+			MQTTSPECTRUM_SIZE, (double) transform / BENCH_ROUNDS, (double) analyze / BENCH_ROUNDS);
+}
+
+/* global functions ********************************************************* */
+
+int main(int argc, char ** argv) {
+	srand(4U);
+	MQTTSpectrum_Init();
+	TestTransform();
+	TestAccuracy();
+	TestNoise();
+	if (HostTest_Bench(argc, argv)) {
+		BenchSpectrum();
+	}
+	return HostTest_Result("test_spectrum");
+}
@@ -0,0 +1,151 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	test_subscribe.c
+ **
+ **	DESCRIPTION:	Host test of the batched subscription of MQTTClient against the Serval stand-in
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/*
+ * MQTTOperation_SubscribeTopics subscribes its topics with one call of
+ * MQTT_SubscribeToTopics_Z. The stand-in of the stack counts the SUBSCRIBE
+ * packets MQTTClient.c sends and answers each with a SUBACK after the round
+ * trip, so the simulated time to subscribe is the number of round trips the
+ * client waits for.
+ */
+
+/* system header files */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* own header files */
+#include "HostTest.h"
+#include "SdkShim.h"
+#include "MQTTClient.h"
+
+/* constant definitions ***************************************************** */
+
+#define TEST_TOPICS			UINT8_C(3)
+#define TEST_ROUND_TRIP_MS	UINT32_C(10)
+#define TEST_TIMEOUT_MS		UINT32_C(1000)
+
+/* local variables ********************************************************** */
+
+static CmdProcessor_T processor;
+
+/* the downstream topics of MQTTOperation.h, subscribed with QoS 0 */
+static MQTT_Subscribe_TZ subscriptions[TEST_TOPICS] = {
+	{ "s/dc/XDK", 0UL, NULL },
+	{ "s/ds", 0UL, NULL },
+	{ "s/e", 0UL, NULL }
+};
+
+/* local functions ********************************************************** */
+
+static void TestSetup(uint32_t roundTrip) {
+	MQTT_Setup_TZ setup = { &processor, false };
+	MQTT_Connect_TZ connect = { "XDK", "broker", 1883U, true, 60UL };
+	MQTT_Credentials_TZ credentials = { NULL, NULL, true };
+
+	Shim_Reset();
+	shim.roundTrip = roundTrip;
+	HOSTTEST_CHECK(MQTT_Setup_Z(&setup) == RETCODE_OK);
+	HOSTTEST_CHECK(MQTT_ConnectToBroker_Z(&connect, TEST_TIMEOUT_MS, &credentials) == RETCODE_OK);
+}
+
+/**
+ * @brief Simulated milliseconds until all topics are subscribed, one call per topic or one for all
+ */
+static uint32_t SubscribeTopics(bool batched, Retcode_T * results) {
+	const uint32_t start = Shim_Now();
+
+	if (batched) {
+		HOSTTEST_CHECK(MQTT_SubscribeToTopics_Z(subscriptions, TEST_TOPICS, TEST_TIMEOUT_MS, results) == RETCODE_OK);
+	} else {
+		for (uint8_t topic = 0U; topic < TEST_TOPICS; topic++) {
+			results[topic] = MQTT_SubsribeToTopic_Z(&subscriptions[topic], TEST_TIMEOUT_MS);
+		}
+	}
+	return Shim_Now() - start;
+}
+
+/**
+ * @brief Subscribing all topics in one packet saves the round trips of the other topics
+ */
+static void TestSubscribe(void) {
+	Retcode_T results[TEST_TOPICS];
+
+	TestSetup(TEST_ROUND_TRIP_MS);
+	uint32_t sequential = SubscribeTopics(false, results);
+	HOSTTEST_CHECK(shim.subscribes == TEST_TOPICS && shim.topics == TEST_TOPICS);
+	HOSTTEST_CHECK(sequential == TEST_TOPICS * TEST_ROUND_TRIP_MS);
+	for (uint8_t topic = 0U; topic < TEST_TOPICS; topic++) {
+		HOSTTEST_CHECK(results[topic] == RETCODE_OK);
+	}
+
+	TestSetup(TEST_ROUND_TRIP_MS);
+	memset(results, 0xFF, sizeof(results));
+	uint32_t batched = SubscribeTopics(true, results);
+	HOSTTEST_CHECK(shim.subscribes == 1UL && shim.topics == TEST_TOPICS);
+	HOSTTEST_CHECK(batched == TEST_ROUND_TRIP_MS);
+	for (uint8_t topic = 0U; topic < TEST_TOPICS; topic++) {
+		HOSTTEST_CHECK(results[topic] == RETCODE_OK);
+	}
+	fprintf(HostTest_Out(), "subscribe: round trip %lu ms, sequential %lu ms, batched %lu ms\n",
+			(unsigned long) TEST_ROUND_TRIP_MS, (unsigned long) sequential, (unsigned long) batched);
+}
+
+/**
+ * @brief Every topic reports the error if the SUBACK does not arrive, too many topics are refused
+ */
+static void TestFailure(void) {
+	Retcode_T results[TEST_TOPICS];
+
+	TestSetup(TEST_ROUND_TRIP_MS);
+	shim.roundTrip = 0UL;
+	HOSTTEST_CHECK(MQTT_SubscribeToTopics_Z(subscriptions, TEST_TOPICS, TEST_TIMEOUT_MS, results)
+			== RETCODE_MQTT_SUBSCRIBE_CB_NOT_RECEIVED);
+	for (uint8_t topic = 0U; topic < TEST_TOPICS; topic++) {
+		HOSTTEST_CHECK(results[topic] == RETCODE_MQTT_SUBSCRIBE_CB_NOT_RECEIVED);
+	}
+	HOSTTEST_CHECK(MQTT_SubscribeToTopics_Z(subscriptions, MQTT_SUBSCRIBE_TOPICS + 1U, TEST_TIMEOUT_MS, NULL)
+			== RETCODE_INVALID_PARAM);
+	HOSTTEST_CHECK(shim.subscribes == 1UL);
+}
+
+/**
+ * @brief Time to subscribe on reconnect for round trips of a local broker up to a distant tenant
+ */
+static void BenchSubscribe(void) {
+	const uint32_t roundTrips[] = { 20UL, 100UL, 300UL };
+	Retcode_T results[TEST_TOPICS];
+
+	for (uint32_t r = 0UL; r < sizeof(roundTrips) / sizeof(roundTrips[0]); r++) {
+		TestSetup(roundTrips[r]);
+		uint32_t sequential = SubscribeTopics(false, results);
+		TestSetup(roundTrips[r]);
+		uint32_t batched = SubscribeTopics(true, results);
+		fprintf(HostTest_Out(), "bench subscribe: round trip %lu ms, sequential %lu ms, batched %lu ms\n",
+				(unsigned long) roundTrips[r], (unsigned long) sequential, (unsigned long) batched);
+	}
+}
+
+/* global functions ********************************************************* */
+
+int main(int argc, char ** argv) {
+	HostTest_Log(HOSTTEST_DATA "/test_subscribe.log");
+	TestSubscribe();
+	TestFailure();
+	if (HostTest_Bench(argc, argv)) {
+		BenchSubscribe();
+	}
+	return HostTest_Result("test_subscribe");
+}
@@ -0,0 +1,165 @@
+/******************************************************************************
+ **	COPYRIGHT (c) 2019		Software AG
+ **
+ **	The use of this software is subject to the XDK SDK EULA
+ **
+ *******************************************************************************
+ **
+ **	OBJECT NAME:	test_wheel.c
+ **
+ **	DESCRIPTION:	Host test and benchmark of the publish timeouts in MQTTWheel
+ **
+ **	AUTHOR(S):		Christof Strack, Software AG
+ **
+ **
+ *******************************************************************************/
+
+/* system header files */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/* own header files */
+#include "HostTest.h"
+#include "MQTTWheel.h"
+
+/* constant definitions ***************************************************** */
+
+#define TEST_TIMERS			UINT32_C(64)
+#define TEST_STEPS			UINT32_C(200000)
+#define TEST_MAX_TICKS		UINT32_C(100)		/**< Several turns of the wheel */
+#define BENCH_TIMERS		UINT32_C(1024)
+#define BENCH_ROUNDS		UINT32_C(1000000)
+
+/* local variables ********************************************************** */
+
+static MQTTWheel_T wheel;
+static MQTTWheel_Timer_T timers[BENCH_TIMERS];
+static uint32_t owners[BENCH_TIMERS];
+/* tick at which each timer has to expire, only valid while expected is set */
+static uint32_t expiries[TEST_TIMERS];
+static bool expected[TEST_TIMERS];
+
+/* local functions ********************************************************** */
+
+static void TestSetup(uint32_t start) {
+	MQTTWheel_Init(&wheel);
+	wheel.now = start;
+	for (uint32_t n = 0UL; n < BENCH_TIMERS; n++) {
+		memset(&timers[n], 0x00, sizeof(MQTTWheel_Timer_T));
+		owners[n] = n;
+		timers[n].owner = &owners[n];
+	}
+	memset(expected, 0x00, sizeof(expected));
+}
+
+/**
+ * @brief Random starts, restarts, stops and ticks against a model of the expiry of every timer
+ *
+ * Every timer has to expire exactly at its tick, once, and stopped.
+ */
+static void TestModel(uint32_t start) {
+	uint32_t expirations = 0UL;
+	uint32_t wrong = 0UL;
+
+	TestSetup(start);
+	for (uint32_t step = 0UL; step < TEST_STEPS; step++) {
+		uint32_t operation = (uint32_t) rand() % 8U;
+		uint32_t index = (uint32_t) rand() % TEST_TIMERS;
+
+		if (operation < 3U) {
+			uint32_t ticks = (uint32_t) rand() % (TEST_MAX_TICKS + 1UL);
+			MQTTWheel_Start(&wheel, &timers[index], ticks);
+			expiries[index] = wheel.now + ((ticks > 0UL) ? ticks : 1UL);
+			expected[index] = true;
+		} else if (operation < 4U) {
+			MQTTWheel_Stop(&wheel, &timers[index]);
+			expected[index] = false;
+		} else {
+			bool seen[TEST_TIMERS] = { false };
+			MQTTWheel_Timer_T * timer = MQTTWheel_Advance(&wheel);
+			for (; timer != NULL; timer = timer->next) {
+				uint32_t expired = *(uint32_t *) timer->owner;
+				if (expected[expired] == false || expiries[expired] != wheel.now || seen[expired] || timer->running) {
+					wrong++;
+				}
+				seen[expired] = true;
+				expected[expired] = false;
+				expirations++;
+			}
+			// nothing due was left behind
+			for (uint32_t n = 0UL; n < TEST_TIMERS; n++) {
+				if (expected[n] && expiries[n] == wheel.now) {
+					wrong++;
+				}
+			}
+		}
+	}
+	for (uint32_t n = 0UL; n < TEST_TIMERS; n++) {
+		HOSTTEST_CHECK(timers[n].running == expected[n]);
+	}
+	HOSTTEST_CHECK(wrong == 0UL);
+	HOSTTEST_CHECK(expirations > 0UL);
+	printf("wheel from tick %lu: %lu expirations\n", (unsigned long) start, (unsigned long) expirations);
+}
+
+/**
+ * @brief A timer more than one turn ahead stays in its bucket until its turn
+ */
+static void TestLaterTurn(void) {
+	TestSetup(0UL);
+	MQTTWheel_Start(&wheel, &timers[0], MQTTWHEEL_BUCKETS + 3UL);
+	MQTTWheel_Start(&wheel, &timers[1], 3UL);
+
+	for (uint32_t tick = 1UL; tick <= 2UL * MQTTWHEEL_BUCKETS; tick++) {
+		MQTTWheel_Timer_T * timer = MQTTWheel_Advance(&wheel);
+		if (tick == 3UL) {
+			HOSTTEST_CHECK(timer == &timers[1] && timer->next == NULL);
+		} else if (tick == MQTTWHEEL_BUCKETS + 3UL) {
+			HOSTTEST_CHECK(timer == &timers[0] && timer->next == NULL);
+		} else {
+			HOSTTEST_CHECK(timer == NULL);
+		}
+	}
+	// stopping a stopped timer does nothing
+	MQTTWheel_Stop(&wheel, &timers[0]);
+	HOSTTEST_CHECK(timers[0].running == false);
+}
+
+/**
+ * @brief Start and stop take the same time whatever the number of pending timers
+ */
+static void BenchWheel(void) {
+	const uint32_t pending[] = { 8UL, 64UL, BENCH_TIMERS - 1UL };
+
+	for (uint32_t p = 0UL; p < sizeof(pending) / sizeof(pending[0]); p++) {
+		TestSetup(0UL);
+		for (uint32_t n = 0UL; n < pending[p]; n++) {
+			MQTTWheel_Start(&wheel, &timers[n], 1UL + n % 50UL);
+		}
+		MQTTWheel_Timer_T * timer = &timers[BENCH_TIMERS - 1UL];
+		uint64_t start = HostTest_Cycles();
+		for (uint32_t round = 0UL; round < BENCH_ROUNDS; round++) {
+			MQTTWheel_Start(&wheel, timer, 1UL + round % 50UL);
+			MQTTWheel_Stop(&wheel, timer);
+		}
+		uint64_t cycles = HostTest_Cycles() - start;
+		HOSTTEST_KEEP(wheel.buckets[0]);
+		printf("bench wheel: %lu pending, %.1f cycles per start and stop\n", (unsigned long) pending[p],
+				(double) cycles / BENCH_ROUNDS);
+	}
+}
+
+/* global functions ********************************************************* */
+
+int main(int argc, char ** argv) {
+	srand(7U);
+	TestModel(0UL);
+	// the tick counter wraps around
+	TestModel(UINT32_MAX - 1000UL);
+	TestLaterTurn();
+	if (HostTest_Bench(argc, argv)) {
+		BenchWheel();
+	}
+	return HostTest_Result("test_wheel");
+}